@@ -13,12 +13,26 @@
 #include <iomanip>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <sstream>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <iterator>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <bitset>
+#include <stdexcept>
+#include <cctype>
+
+#include "PatternTriggerCore.h"
 
 // Autore: Umberto Meglio
 // Supporto alla creazione: Claude di Anthropic
@@ -28,6 +42,10 @@
 #define ERROR_OPERATION_ABORTED 995L
 #endif
 
+#ifndef ERROR_NOTIFY_ENUM_DIR
+#define ERROR_NOTIFY_ENUM_DIR 1022L
+#endif
+
 #ifndef SERVICE_CONFIG_DESCRIPTION
 #define SERVICE_CONFIG_DESCRIPTION 1
 #endif
@@ -69,15 +87,84 @@ struct SERVICE_DESCRIPTION_STRUCT {
 
 // Intervalli di tempo ottimizzati
 #define FILE_CHECK_INTERVAL 1000
-#define MONITORING_RESTART_DELAY 1000
 #define BATCH_TIMEOUT 45000
+#define DEFAULT_BATCH_WAIT_MS 2000
+#define MAX_BATCH_FILES 10000
+#define MAX_BATCH_WAIT_MS 600000
+#define MAX_RESIDENT_WORKERS 64
 #define CACHE_CLEANUP_INTERVAL 180000
 #define SERVICE_SHUTDOWN_TIMEOUT 8000
 #define WEB_UPDATE_INTERVAL 2000
-#define METRICS_UPDATE_INTERVAL 5000
-#define SCHEDULER_CHECK_INTERVAL 15000
+#define METRICS_UPDATE_INTERVAL 5000         // ripubblicazione dell'istantanea anche senza cambiamenti
+#define METRICS_CHANGE_CHECK_INTERVAL 250    // controllo dei contatori per ripubblicare subito
+#define SCHEDULER_RESYNC_INTERVAL 60000   // verifica dei salti dell'orologio di sistema
+#define SCHEDULER_CLOCK_TOLERANCE_MS 2000
 #define DEFAULT_SCHEDULER_FOLDER "C:\\PTC\\schedules"
 
+// Motore watcher (completion port condivisa)
+#define DEFAULT_WATCHER_THREADS 2
+#define MAX_WATCHER_THREADS 16
+#define DEFAULT_SCAN_THREADS 4
+#define MAX_SCAN_THREADS 32
+#define DEFAULT_NOTIFICATION_BUFFER_KB 64
+#define MAX_NOTIFICATION_BUFFER_KB 1024
+#define NETWORK_NOTIFICATION_BUFFER_KB 64     // limite di ReadDirectoryChangesW su share di rete
+#define WATCHER_SHUTDOWN_KEY 0
+
+// Pool esecutori comandi (coda limitata MPMC)
+#define DEFAULT_EXECUTOR_THREADS 4
+#define MAX_EXECUTOR_THREADS 64
+#define DEFAULT_MAX_CONCURRENT_PROCESSES 32
+#define MAX_CONCURRENT_PROCESSES_LIMIT 4096
+#define DEFAULT_EXECUTOR_QUEUE_SIZE 1024
+
+// Debounce eventi file
+#define DEFAULT_DEBOUNCE_MS 500          // periodo di quiete prima di considerare pronto un file
+#define MAX_DEBOUNCE_MS 600000
+#define DEBOUNCE_TICK_MS 25
+#define DEBOUNCE_WHEEL_SLOTS 256         // un giro = 6,4 s; scadenze piu' lontane contano i giri
+
+// Web server (ciclo di readiness con WSAPoll e keep-alive)
+#define HTTP_MAX_CONNECTIONS 256
+#define HTTP_KEEPALIVE_TIMEOUT_MS 15000   // connessioni inattive chiuse dopo questo tempo
+#define HTTP_POLL_TIMEOUT_MS 200          // serve solo ad accorgersi dell'arresto
+#define HTTP_IO_CHUNK 16384
+// Limiti di parser HTTP e JSON (HTTP_MAX_*, JSON_MAX_*) in PatternTriggerCore.h
+
+// Canale Server-Sent Events (/api/events)
+#define SSE_QUEUE_CAPACITY 1024           // eventi in attesa di distribuzione, poi si scarta il piu' vecchio
+#define SSE_MAX_BACKLOG (1024 * 1024)     // client troppo lento: chiuso, alla riconnessione riceve lo stato completo
+#define SSE_PING_INTERVAL_MS 15000
+#define SSE_RETRY_MS 3000
+
+// Logger asincrono
+#define LOG_RING_CAPACITY 8192       // potenza di 2
+#define LOG_WRITER_BATCH 1024
+#define LOG_FLUSH_INTERVAL 50
+#define MAX_RECENT_ACTIVITY 20
+
+// Journal database file processati
+#define DEFAULT_JOURNAL_COMPACT_THRESHOLD 50000
+#define DEDUP_HASH_READ_SIZE (1024 * 1024)   // letture sequenziali per l'impronta del contenuto
+
+// Retention database file processati
+#define DEFAULT_PROCESSED_RETENTION_DAYS 0          // 0 = nessuna scadenza
+#define MAX_PROCESSED_RETENTION_DAYS 36500
+#define DEFAULT_PROCESSED_SWEEP_INTERVAL_MINUTES 60
+#define PROCESSED_SWEEP_START_DELAY_SECONDS 60      // lascia terminare la scansione iniziale
+#define PROCESSED_SWEEP_SLICE 256                   // voci esaminate per fetta
+#define PROCESSED_SWEEP_PAUSE_MS 20                 // pausa tra una fetta e la successiva
+
+// Istantanee cartelle per la scansione incrementale
+#define SNAPSHOT_MAGIC "PTCSNAP1"
+#define SNAPSHOT_VERSION 1
+#define MAX_SNAPSHOT_ENTRIES 50000000ULL
+#define DEFAULT_SNAPSHOT_CHECKPOINT_SECONDS 300
+
+// Matcher multi-pattern
+#define MAX_MATCHER_NFA_STATES 100000   // per cartella; oltre, i pattern restano su std::regex
+#define MAX_MATCHER_DFA_CACHE_BYTES (8 * 1024 * 1024)   // cache DFA per cartella, svuotata quando piena
+
 // Variabili globali del servizio
 SERVICE_STATUS serviceStatus;
 SERVICE_STATUS_HANDLE serviceStatusHandle;
@@ -85,10 +172,11 @@ std::atomic<bool> globalShutdown(false);
 HANDLE stopEvent = NULL;
 
 // Mutex per thread safety
-std::mutex logMutex;
 std::mutex configMutex;
 std::mutex processedFilesMutex;
+std::mutex processedCompactionMutex;
 std::mutex metricsMutex;
+std::mutex folderMonitorsMutex;     // struttura di folderMonitors (inserimenti e svuotamento)
 std::mutex patternStatsMutex;
 std::mutex schedulerMutex;
 
@@ -103,6 +191,27 @@ int webServerPort = DEFAULT_WEB_PORT;
 bool webServerEnabled = true;
 std::string schedulerFolder = DEFAULT_SCHEDULER_FOLDER;
 bool schedulerEnabled = true;
+int watcherThreadCount = DEFAULT_WATCHER_THREADS;
+int scanThreadCount = DEFAULT_SCAN_THREADS;
+int notificationBufferKB = DEFAULT_NOTIFICATION_BUFFER_KB;
+int executorThreadCount = DEFAULT_EXECUTOR_THREADS;
+int maxConcurrentProcesses = DEFAULT_MAX_CONCURRENT_PROCESSES;
+int executorQueueSize = DEFAULT_EXECUTOR_QUEUE_SIZE;
+int journalCompactThreshold = DEFAULT_JOURNAL_COMPACT_THRESHOLD;
+int processedRetentionDays = DEFAULT_PROCESSED_RETENTION_DAYS;
+bool processedEvictMissing = false;
+int processedSweepIntervalMinutes = DEFAULT_PROCESSED_SWEEP_INTERVAL_MINUTES;
+
+// Chiave con cui un file risulta gia' processato
+enum DedupMode {
+    DedupPath,      // percorso completo (storico)
+    DedupMetadata,  // percorso + dimensione + data di scrittura
+    DedupContent    // come metadata, piu' l'impronta XXH64 del contenuto
+};
+DedupMode dedupMode = DedupPath;
+int snapshotCheckpointSeconds = DEFAULT_SNAPSHOT_CHECKPOINT_SECONDS;
+int debounceMs = DEFAULT_DEBOUNCE_MS;
+std::map<std::string, int> folderDebounceMs;  // sezione [Debounce], chiave cartella normalizzata
 
 // Statistiche pattern (separate dalla struct per evitare problemi di move)
 std::map<std::string, size_t> patternMatchCounts;
@@ -119,11 +228,116 @@ struct SystemMetrics {
     std::atomic<size_t> errorsCount{0};
     std::chrono::steady_clock::time_point serviceStartTime;
     std::chrono::steady_clock::time_point lastFileProcessed;
-    std::vector<std::pair<std::string, std::chrono::steady_clock::time_point>> recentActivity;
+    std::deque<std::pair<std::string, std::chrono::steady_clock::time_point>> recentActivity;
+    std::atomic<size_t> recentActivityGeneration{0};
     
     SystemMetrics() : serviceStartTime(std::chrono::steady_clock::now()) {}
 } systemMetrics;
 
+// Risposta HTTP completa (intestazioni + corpo) condivisa tra le connessioni senza copie
+typedef std::shared_ptr<const std::string> HttpBuffer;
+
+// Istantanea immutabile di /api/metrics: documento e risposta HTTP gia' pronti,
+// sostituita in blocco con atomic_store e letta con atomic_load senza lock
+struct MetricsSnapshot {
+    std::string json;
+    std::string etag;
+    HttpBuffer response;        // 200 completa di intestazioni (senza Connection)
+    HttpBuffer notModified;     // 304 per If-None-Match uguale all'ETag
+    unsigned long long generation;
+};
+
+std::shared_ptr<const MetricsSnapshot> metricsSnapshot;
+std::atomic<bool> metricsPublisherRunning{false};
+
+// Ring buffer lock-free limitato (multi-produttore, multi-consumatore) con numero
+// di sequenza per slot: TryPush/TryPop non bloccano mai e falliscono a ring pieno/vuoto.
+template <typename T>
+struct LockFreeRing {
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    char pad0[64];
+    std::atomic<size_t> enqueuePos;
+    char pad1[64];
+    std::atomic<size_t> dequeuePos;
+    char pad2[64];
+    
+    explicit LockFreeRing(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1),
+        enqueuePos(0), dequeuePos(0) {
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    bool TryPush(T& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & mask];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // pieno
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    bool TryPop(T& out) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & mask];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(slot.value);
+                    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // vuoto
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    size_t ApproxSize() const {
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : 0;
+    }
+};
+
+struct LogRecord {
+    std::string message;
+    FILETIME time;
+    bool detailed;
+    
+    LogRecord() : detailed(false) { time.dwLowDateTime = 0; time.dwHighDateTime = 0; }
+};
+
+LockFreeRing<LogRecord> logRing(LOG_RING_CAPACITY);
+std::atomic<size_t> logRecordsDropped{0};
+std::atomic<bool> logWriterStarted{false};
+std::atomic<bool> logWriterStop{false};
+std::atomic<unsigned int> logConfigGeneration{0};
+std::once_flag logStartOnce;
+std::thread logWriterThread;
+HANDLE logWakeEvent = NULL;
+
 // Struttura per pattern e comandi (senza atomic per evitare problemi di move)
 struct PatternCommandPair {
     std::string folderPath;
@@ -132,10 +346,25 @@ struct PatternCommandPair {
     std::regex compiledRegex;
     std::string patternName;
     
+    // Micro-batch (quarto campo del pattern): batchMaxFiles <= 1 = un processo per file
+    enum BatchInput { BatchInputListFile, BatchInputStdin };
+    int batchMaxFiles;
+    int batchMaxWaitMs;
+    BatchInput batchInput;
+    // Worker residenti (workers=N): N processi sempre attivi, un percorso per riga
+    int residentWorkers;
+    int residentTimeoutMs;
+    // Azione integrata (comando "builtin:azione=destinazione") al posto di un processo
+    enum BuiltinAction { BuiltinNone, BuiltinMove, BuiltinCopy, BuiltinArchive, BuiltinRename, BuiltinDelete };
+    BuiltinAction builtinAction;
+    std::string builtinTarget;
+    
     PatternCommandPair(const std::string& folder, const std::string& pattern, 
                       const std::string& cmd, const std::string& name = "") 
         : folderPath(folder), patternRegex(pattern), command(cmd), 
-          compiledRegex(pattern, std::regex_constants::icase), patternName(name) {
+          compiledRegex(pattern, std::regex_constants::icase), patternName(name),
+          batchMaxFiles(0), batchMaxWaitMs(DEFAULT_BATCH_WAIT_MS), batchInput(BatchInputListFile),
+          residentWorkers(0), residentTimeoutMs(BATCH_TIMEOUT), builtinAction(BuiltinNone) {
         // Inizializza contatori pattern
         std::lock_guard<std::mutex> lock(patternStatsMutex);
         patternMatchCounts[patternName] = 0;
@@ -145,2515 +374,9415 @@ struct PatternCommandPair {
 
 std::vector<PatternCommandPair> patternCommandPairs;
 
-// Gestione dei file processati con thread safety
-std::set<std::string> processedFiles;
-std::set<std::string> recentlyIgnoredFiles;
+// ====== MATCHER MULTI-PATTERN (NFA DI THOMPSON + DFA LAZY) ======
+// Tutti i pattern di una cartella vengono compilati in un unico automa: un NFA di
+// Thompson per il sottoinsieme ECMAScript usato nei pattern (letterali, '.', classi,
+// \d \w \s, gruppi, alternative, quantificatori, ^ e $), simulato come DFA costruito
+// in modo lazy e messo in cache. Una sola passata sul nome file restituisce l'insieme
+// dei pattern corrispondenti in tempo lineare, senza backtracking. I pattern con
+// costrutti non supportati (backreference, lookaround, \b) restano su std::regex.
+
+struct RegexNode {
+    enum Type { Empty, CharSet, Concat, Alternate, Repeat, AssertBegin, AssertEnd };
+    Type type;
+    int setIndex;
+    int minRepeat;
+    int maxRepeat;  // -1 = illimitato
+    std::vector<std::unique_ptr<RegexNode>> children;
+    
+    explicit RegexNode(Type t) : type(t), setIndex(-1), minRepeat(0), maxRepeat(0) {}
+};
 
-// Struttura per monitoraggio cartella
-struct FolderMonitor {
-    std::string folderPath;
-    std::string normalizedPath;
-    std::vector<int> patternIndices;
-    std::atomic<bool> active;
-    std::atomic<bool> stopRequested;
-    std::thread workerThread;
-    HANDLE directoryHandle;
-    std::atomic<size_t> filesDetected{0};
-    std::atomic<size_t> filesProcessed{0};
+// Parser del sottoinsieme ECMAScript; lancia std::runtime_error sui costrutti non supportati
+struct RegexSubsetParser {
+    const std::string& pattern;
+    size_t pos;
+    bool icase;
+    std::vector<std::bitset<256>>& sets;
     
-    FolderMonitor(const std::string& path) : folderPath(path), active(false), 
-        stopRequested(false), directoryHandle(INVALID_HANDLE_VALUE) {
-        normalizedPath = path;
-        std::replace(normalizedPath.begin(), normalizedPath.end(), '/', '\\');
-        if (!normalizedPath.empty() && normalizedPath.back() == '\\') {
-            normalizedPath.pop_back();
-        }
-        std::transform(normalizedPath.begin(), normalizedPath.end(), normalizedPath.begin(), ::toupper);
+    RegexSubsetParser(const std::string& p, bool ic, std::vector<std::bitset<256>>& s)
+        : pattern(p), pos(0), icase(ic), sets(s) {}
+    
+    std::unique_ptr<RegexNode> Parse() {
+        std::unique_ptr<RegexNode> node = ParseAlternation();
+        if (pos != pattern.length()) throw std::runtime_error("parentesi non bilanciate");
+        return node;
     }
     
-    ~FolderMonitor() {
-        StopMonitoring();
-        if (directoryHandle != INVALID_HANDLE_VALUE) {
-            CloseHandle(directoryHandle);
+    bool AtEnd() const { return pos >= pattern.length(); }
+    char Peek() const { return pattern[pos]; }
+    
+    void AddChar(std::bitset<256>& set, unsigned char c) const {
+        set.set(c);
+        if (icase) {
+            set.set(static_cast<unsigned char>(std::tolower(c)));
+            set.set(static_cast<unsigned char>(std::toupper(c)));
         }
     }
     
-    void StopMonitoring() {
-        stopRequested = true;
-        if (workerThread.joinable()) {
-            workerThread.join();
-        }
+    int NewSet(const std::bitset<256>& set) {
+        sets.push_back(set);
+        return static_cast<int>(sets.size() - 1);
     }
-};
-
-std::map<std::string, std::unique_ptr<FolderMonitor>> folderMonitors;
-
-// Schedulatore
-struct SchedulerTask {
-    std::string name;
-    bool enabled;
-    std::set<int> days;      // 0=Do, 1=Lu, 2=Ma, 3=Me, 4=Gi, 5=Ve, 6=Sa
-    std::set<int> hours;     // 0-23
-    std::set<int> minutes;   // 0-59
-    std::string command;
-    int intervalSeconds;     // 0 = usa trigger giorno/ora/minuto, >0 = ripeti ogni N secondi
-    int lastFiredMinute;
-    int lastFiredHour;
-    int lastFiredDayOfYear;
-    std::string lastExecutionTime;
-    size_t executionCount;
-    std::chrono::steady_clock::time_point lastIntervalRun;
-
-    SchedulerTask() : enabled(true), intervalSeconds(0), lastFiredMinute(-1), lastFiredHour(-1),
-                      lastFiredDayOfYear(-1), executionCount(0) {}
-};
-
-struct SchedulerExecution {
-    std::string taskName;
-    std::string timestamp;
-    std::string command;
-    int exitCode;
-    bool success;
-};
-
-std::vector<SchedulerTask> schedulerTasks;
-std::vector<SchedulerExecution> schedulerHistory;
-#define MAX_SCHEDULER_HISTORY 200
-std::thread schedulerThread;
-
-// Web Server
-std::thread webServerThread;
-std::atomic<bool> webServerRunning{false};
-std::atomic<bool> webServerShouldStop{false};
-
-// ====== DICHIARAZIONI FUNZIONI ======
-
-std::string GetTimestamp();
-void WriteToLog(const std::string& message, bool detailed = false);
-std::string NormalizeFolderPath(const std::string& path);
-std::string EscapeJsonString(const std::string& input);
-bool FileExists(const std::string& filename);
-bool DirectoryExists(const std::string& path);
-bool CreateDirectoryRecursive(const std::string& path);
-bool IsFileInUse(const std::string& filePath);
-bool WaitForFileAvailability(const std::string& filePath, int maxWaitTimeMs = 20000);
-void LoadProcessedFiles();
-void SaveProcessedFiles();
-bool IsFileAlreadyProcessed(const std::string& fullFilePath);
-void MarkFileAsProcessed(const std::string& fullFilePath);
-bool LoadConfiguration();
-std::vector<int> FindMatchingPatterns(const std::string& filename, const std::string& folderPath);
-bool ExecuteCommand(const std::string& command, const std::string& parameter, const std::string& patternName);
-void ScanDirectoryForExistingFiles(const std::string& folderPath, const std::vector<int>& patternIndices);
-void FolderMonitorWorker(FolderMonitor* monitor);
-void StartAllFolderMonitors();
-void StopAllFolderMonitors();
-void UpdateSystemMetrics();
-void MetricsUpdateWorker();
-std::string GetSystemMetricsJson();
-std::string GetDashboardHtml();
-std::string HandleHttpRequest(const std::string& request);
-void WebServerWorker();
-DWORD WINAPI ServiceWorkerThread(LPVOID lpParam);
-void WINAPI ServiceCtrlHandler(DWORD ctrlCode);
-void WINAPI ServiceMain(DWORD argc, LPTSTR *argv);
-BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType);
-
-// Scheduler
-std::string SanitizeFilename(const std::string& name);
-int DayNameToNumber(const std::string& dayName);
-std::string DayNumberToName(int dayNum);
-bool LoadSchedulerTasks();
-bool SaveSchedulerTask(const SchedulerTask& task);
-bool DeleteSchedulerTask(const std::string& name);
-void SchedulerWorker();
-void RecordSchedulerExecution(const std::string& taskName, const std::string& command, int exitCode, bool success);
-std::string GetSchedulerJson();
-std::string GetSchedulerScriptsJson();
-std::string GetSchedulerPageHtml();
-std::string ExtractJsonValue(const std::string& json, const std::string& key);
-std::string GetHttpRequestBody(const std::string& request);
-
-// ====== IMPLEMENTAZIONE FUNZIONI ======
-
-std::string GetTimestamp() {
-    SYSTEMTIME st;
-    GetLocalTime(&st);
     
-    std::ostringstream oss;
-    oss << std::setfill('0') 
-        << st.wYear << "-" 
-        << std::setw(2) << st.wMonth << "-" 
-        << std::setw(2) << st.wDay << " "
-        << std::setw(2) << st.wHour << ":" 
-        << std::setw(2) << st.wMinute << ":" 
-        << std::setw(2) << st.wSecond << "." 
-        << std::setw(3) << st.wMilliseconds;
+    std::unique_ptr<RegexNode> MakeSetNode(const std::bitset<256>& set) {
+        std::unique_ptr<RegexNode> node(new RegexNode(RegexNode::CharSet));
+        node->setIndex = NewSet(set);
+        return node;
+    }
     
-    return oss.str();
-}
-
-void WriteToLog(const std::string& message, bool detailed) {
-    std::lock_guard<std::mutex> lock(logMutex);
+    std::unique_ptr<RegexNode> ParseAlternation() {
+        std::unique_ptr<RegexNode> first = ParseConcat();
+        if (AtEnd() || Peek() != '|') return first;
+        
+        std::unique_ptr<RegexNode> alt(new RegexNode(RegexNode::Alternate));
+        alt->children.push_back(std::move(first));
+        while (!AtEnd() && Peek() == '|') {
+            pos++;
+            alt->children.push_back(ParseConcat());
+        }
+        return alt;
+    }
     
-    std::ofstream logFileStream(logFile.c_str(), std::ios::app);
-    if (logFileStream.is_open()) {
-        logFileStream << GetTimestamp() << " - " << message << std::endl;
-        logFileStream.close();
+    std::unique_ptr<RegexNode> ParseConcat() {
+        std::unique_ptr<RegexNode> concat(new RegexNode(RegexNode::Concat));
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            concat->children.push_back(ParseRepeat());
+        }
+        if (concat->children.empty()) return std::unique_ptr<RegexNode>(new RegexNode(RegexNode::Empty));
+        if (concat->children.size() == 1) return std::move(concat->children[0]);
+        return concat;
     }
     
-    if (detailed && detailedLogging) {
-        std::ofstream detailedLogFileStream(detailedLogFile.c_str(), std::ios::app);
-        if (detailedLogFileStream.is_open()) {
-            detailedLogFileStream << GetTimestamp() << " - [DETAILED] " << message << std::endl;
-            detailedLogFileStream.close();
+    bool ParseBraces(int& minRep, int& maxRep) {
+        // {n}, {n,}, {n,m}; altrimenti '{' e' un letterale
+        size_t p = pos + 1;
+        size_t digitsStart = p;
+        while (p < pattern.length() && std::isdigit(static_cast<unsigned char>(pattern[p]))) p++;
+        if (p == digitsStart || p >= pattern.length()) return false;
+        minRep = std::atoi(pattern.substr(digitsStart, p - digitsStart).c_str());
+        maxRep = minRep;
+        if (pattern[p] == ',') {
+            p++;
+            size_t maxStart = p;
+            while (p < pattern.length() && std::isdigit(static_cast<unsigned char>(pattern[p]))) p++;
+            maxRep = (p == maxStart) ? -1 : std::atoi(pattern.substr(maxStart, p - maxStart).c_str());
         }
+        if (p >= pattern.length() || pattern[p] != '}') return false;
+        if (maxRep != -1 && maxRep < minRep) throw std::runtime_error("intervallo di ripetizione non valido");
+        if (minRep > 1000 || maxRep > 1000) throw std::runtime_error("ripetizione troppo grande");
+        pos = p + 1;
+        return true;
     }
     
-    // Aggiorna attività recente per dashboard
-    {
-        std::lock_guard<std::mutex> metricsLock(metricsMutex);
-        systemMetrics.recentActivity.push_back({message, std::chrono::steady_clock::now()});
-        if (systemMetrics.recentActivity.size() > 20) {
-            systemMetrics.recentActivity.erase(systemMetrics.recentActivity.begin());
+    std::unique_ptr<RegexNode> ParseRepeat() {
+        std::unique_ptr<RegexNode> atom = ParseAtom();
+        if (AtEnd()) return atom;
+        
+        int minRep = 0, maxRep = 0;
+        char c = Peek();
+        if (c == '*') { minRep = 0; maxRep = -1; pos++; }
+        else if (c == '+') { minRep = 1; maxRep = -1; pos++; }
+        else if (c == '?') { minRep = 0; maxRep = 1; pos++; }
+        else if (c == '{' && ParseBraces(minRep, maxRep)) {}
+        else return atom;
+        
+        if (atom->type == RegexNode::AssertBegin || atom->type == RegexNode::AssertEnd) {
+            throw std::runtime_error("quantificatore su asserzione");
+        }
+        
+        // Il quantificatore lazy non cambia l'esito di un match completo
+        if (!AtEnd() && Peek() == '?') pos++;
+        if (!AtEnd() && (Peek() == '*' || Peek() == '+' || Peek() == '?')) {
+            throw std::runtime_error("quantificatore doppio");
         }
+        
+        std::unique_ptr<RegexNode> repeat(new RegexNode(RegexNode::Repeat));
+        repeat->minRepeat = minRep;
+        repeat->maxRepeat = maxRep;
+        repeat->children.push_back(std::move(atom));
+        return repeat;
     }
-}
-
-std::string NormalizeFolderPath(const std::string& path) {
-    std::string normalized = path;
-    std::replace(normalized.begin(), normalized.end(), '/', '\\');
     
-    if (!normalized.empty() && normalized.back() == '\\') {
-        normalized.pop_back();
+    // Escape di classe (\d \w \s e negazioni); false se non e' una classe
+    bool ParseClassEscape(char c, std::bitset<256>& set) const {
+        std::bitset<256> cls;
+        switch (std::tolower(static_cast<unsigned char>(c))) {
+            case 'd':
+                for (int ch = '0'; ch <= '9'; ++ch) cls.set(ch);
+                break;
+            case 'w':
+                for (int ch = '0'; ch <= '9'; ++ch) cls.set(ch);
+                for (int ch = 'a'; ch <= 'z'; ++ch) { cls.set(ch); cls.set(ch - 'a' + 'A'); }
+                cls.set('_');
+                break;
+            case 's':
+                cls.set(' '); cls.set('\t'); cls.set('\n'); cls.set('\v'); cls.set('\f'); cls.set('\r');
+                break;
+            default:
+                return false;
+        }
+        if (std::isupper(static_cast<unsigned char>(c))) cls.flip();
+        set |= cls;
+        return true;
     }
     
-    std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::toupper);
-    return normalized;
-}
-
-std::string EscapeJsonString(const std::string& input) {
-    std::string escaped;
-    escaped.reserve(input.length() + 20); // Pre-alloca spazio extra
+    int HexValue(char c) const {
+        if (c >= '0' && c <= '9') return c - '0';
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
     
-    for (char c : input) {
+    // Escape di carattere singolo (pos sul carattere dopo '\')
+    unsigned char ParseCharEscape() {
+        char c = pattern[pos++];
         switch (c) {
-            case '"': escaped += "\\\""; break;
-            case '\\': escaped += "\\\\"; break;
-            case '\b': escaped += "\\b"; break;
-            case '\f': escaped += "\\f"; break;
-            case '\n': escaped += "\\n"; break;
-            case '\r': escaped += "\\r"; break;
-            case '\t': escaped += "\\t"; break;
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 't': return '\t';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case '0': return '\0';
+            case 'x':
+            case 'u': {
+                size_t digits = (c == 'x') ? 2 : 4;
+                if (pos + digits > pattern.length()) throw std::runtime_error("escape esadecimale incompleto");
+                int value = 0;
+                for (size_t i = 0; i < digits; ++i) {
+                    int h = HexValue(pattern[pos + i]);
+                    if (h < 0) throw std::runtime_error("escape esadecimale non valido");
+                    value = value * 16 + h;
+                }
+                if (value > 255) throw std::runtime_error("carattere fuori dal set a 8 bit");
+                pos += digits;
+                return static_cast<unsigned char>(value);
+            }
+            case 'b': case 'B': case 'c': case 'k':
+                throw std::runtime_error("escape non supportato");
             default:
-                if (c < 0x20) {
-                    // Caratteri di controllo
-                    escaped += "\\u";
-                    escaped += "0000";
-                    escaped[escaped.length()-2] = "0123456789ABCDEF"[(c >> 4) & 0xF];
-                    escaped[escaped.length()-1] = "0123456789ABCDEF"[c & 0xF];
+                if (c >= '1' && c <= '9') throw std::runtime_error("backreference non supportata");
+                return static_cast<unsigned char>(c);
+        }
+    }
+    
+    std::unique_ptr<RegexNode> ParseClass() {
+        // pos dopo '['
+        std::bitset<256> set;
+        bool negate = false;
+        if (!AtEnd() && Peek() == '^') { negate = true; pos++; }
+        
+        while (true) {
+            if (AtEnd()) throw std::runtime_error("classe non terminata");
+            char c = Peek();
+            if (c == ']') { pos++; break; }
+            if (c == '[' && pos + 1 < pattern.length() &&
+                (pattern[pos + 1] == ':' || pattern[pos + 1] == '=' || pattern[pos + 1] == '.')) {
+                throw std::runtime_error("classe POSIX non supportata");
+            }
+            
+            unsigned char lo;
+            pos++;
+            if (c == '\\') {
+                if (AtEnd()) throw std::runtime_error("escape incompleto");
+                if (ParseClassEscape(Peek(), set)) { pos++; continue; }
+                if (Peek() == 'b') { pos++; lo = '\b'; }
+                else lo = ParseCharEscape();
+            } else {
+                lo = static_cast<unsigned char>(c);
+            }
+            
+            if (pos + 1 < pattern.length() && Peek() == '-' && pattern[pos + 1] != ']') {
+                pos++;
+                unsigned char hi;
+                char h = pattern[pos++];
+                if (h == '\\') {
+                    if (AtEnd()) throw std::runtime_error("escape incompleto");
+                    std::bitset<256> dummy;
+                    if (ParseClassEscape(Peek(), dummy)) throw std::runtime_error("intervallo con classe");
+                    hi = ParseCharEscape();
                 } else {
-                    escaped += c;
+                    hi = static_cast<unsigned char>(h);
                 }
-                break;
+                if (hi < lo) throw std::runtime_error("intervallo non valido");
+                for (int ch = lo; ch <= hi; ++ch) AddChar(set, static_cast<unsigned char>(ch));
+            } else {
+                AddChar(set, lo);
+            }
         }
+        
+        if (negate) set.flip();
+        return MakeSetNode(set);
     }
-    return escaped;
-}
+    
+    std::unique_ptr<RegexNode> ParseAtom() {
+        char c = pattern[pos++];
+        switch (c) {
+            case '(': {
+                if (!AtEnd() && Peek() == '?') {
+                    if (pos + 1 < pattern.length() && pattern[pos + 1] == ':') {
+                        pos += 2;
+                    } else {
+                        throw std::runtime_error("lookaround non supportato");
+                    }
+                }
+                std::unique_ptr<RegexNode> inner = ParseAlternation();
+                if (AtEnd() || Peek() != ')') throw std::runtime_error("parentesi non chiusa");
+                pos++;
+                return inner;
+            }
+            case '[':
+                return ParseClass();
+            case '.': {
+                std::bitset<256> set;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+                return MakeSetNode(set);
+            }
+            case '^':
+                return std::unique_ptr<RegexNode>(new RegexNode(RegexNode::AssertBegin));
+            case '$':
+                return std::unique_ptr<RegexNode>(new RegexNode(RegexNode::AssertEnd));
+            case '*': case '+': case '?': case ')':
+                throw std::runtime_error("carattere speciale in posizione non valida");
+            case '\\': {
+                if (AtEnd()) throw std::runtime_error("escape finale");
+                std::bitset<256> set;
+                if (ParseClassEscape(Peek(), set)) {
+                    pos++;
+                    return MakeSetNode(set);
+                }
+                unsigned char literal = ParseCharEscape();
+                AddChar(set, literal);
+                return MakeSetNode(set);
+            }
+            default: {
+                std::bitset<256> set;
+                AddChar(set, static_cast<unsigned char>(c));
+                return MakeSetNode(set);
+            }
+        }
+    }
+};
 
-bool FileExists(const std::string& filename) {
-    DWORD attrs = GetFileAttributes(filename.c_str());
-    return (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
-}
+struct NfaState {
+    enum Type { Char, Split, AssertBegin, AssertEnd, Match };
+    Type type;
+    int setIndex;
+    int out;
+    int out1;
+    int patternId;
+    
+    NfaState(Type t, int o = -1, int o1 = -1) : type(t), setIndex(-1), out(o), out1(o1), patternId(-1) {}
+};
 
-bool DirectoryExists(const std::string& path) {
-    DWORD attrs = GetFileAttributes(path.c_str());
-    return (attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY));
-}
+struct DfaState {
+    std::vector<int> nfaStates;   // stati Char/AssertEnd/Match dopo la chiusura
+    std::vector<int> next;        // per classe di byte, -1 = non ancora calcolata
+    std::vector<int> accepts;     // pattern che corrispondono se l'input termina qui
+    bool acceptsComputed;
+    
+    explicit DfaState(size_t classes) : next(classes, -1), acceptsComputed(false) {}
+};
 
-bool CreateDirectoryRecursive(const std::string& path) {
-    std::string normalizedPath = path;
-    std::replace(normalizedPath.begin(), normalizedPath.end(), '/', '\\');
+struct FolderPatternMatcher {
+    std::vector<int> patternIndices;       // indici globali in patternCommandPairs
+    std::vector<int> automatonPatterns;    // id locale automa -> indice globale
+    std::vector<int> fallbackPatterns;     // indici globali gestiti con std::regex
     
-    if (!normalizedPath.empty() && normalizedPath.back() == '\\') {
-        normalizedPath.pop_back();
-    }
+    std::vector<std::bitset<256>> sets;
+    std::vector<NfaState> nfa;
+    std::vector<int> startStates;
     
-    if (DirectoryExists(normalizedPath)) {
-        return true;
+    // Classi di equivalenza dei byte: byte indistinguibili per tutti i set
+    // condividono la transizione, riducendo la tabella di ogni stato DFA
+    unsigned char byteClass[256];
+    size_t classCount;
+    
+    std::mutex mutex;                       // protegge la cache DFA
+    std::vector<std::unique_ptr<DfaState>> dfa;
+    std::unordered_multimap<size_t, int> dfaIndex;   // hash insieme NFA -> stato DFA
+    size_t cacheBytes;
+    std::vector<unsigned int> marks;
+    std::vector<int> closureStack;          // buffer riusati sotto mutex
+    std::vector<int> movedStates;
+    unsigned int markGeneration;
+    size_t cacheFlushes;
+    
+    FolderPatternMatcher() : classCount(1), cacheBytes(0), markGeneration(0), cacheFlushes(0) {
+        std::fill(byteClass, byteClass + 256, 0);
     }
     
-    size_t pos = normalizedPath.find_last_of('\\');
-    if (pos != std::string::npos) {
-        std::string parentPath = normalizedPath.substr(0, pos);
-        if (!CreateDirectoryRecursive(parentPath)) {
-            return false;
+    void ComputeByteClasses() {
+        // Raffinamento della partizione: ogni set separa i byte che contiene dagli altri
+        std::vector<int> current(256, 0);
+        for (const std::bitset<256>& set : sets) {
+            std::map<std::pair<int, bool>, int> refined;
+            std::vector<int> next(256);
+            for (int b = 0; b < 256; ++b) {
+                std::pair<int, bool> key(current[b], set.test(b));
+                std::map<std::pair<int, bool>, int>::iterator it = refined.find(key);
+                if (it == refined.end()) {
+                    it = refined.insert(std::make_pair(key, static_cast<int>(refined.size()))).first;
+                }
+                next[b] = it->second;
+            }
+            current.swap(next);
+        }
+        
+        classCount = 0;
+        for (int b = 0; b < 256; ++b) {
+            byteClass[b] = static_cast<unsigned char>(current[b]);
+            classCount = std::max(classCount, static_cast<size_t>(current[b]) + 1);
         }
     }
     
-    return CreateDirectory(normalizedPath.c_str(), NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
-}
-
-bool IsFileInUse(const std::string& filePath) {
-    HANDLE hFile = CreateFile(filePath.c_str(), GENERIC_READ, 0, NULL, 
-                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    
-    if (hFile != INVALID_HANDLE_VALUE) {
-        CloseHandle(hFile);
-        return false;
+    int AddState(const NfaState& state) {
+        if (nfa.size() >= MAX_MATCHER_NFA_STATES) throw std::runtime_error("automa troppo grande");
+        nfa.push_back(state);
+        return static_cast<int>(nfa.size() - 1);
     }
     
-    DWORD error = GetLastError();
-    return (error == ERROR_SHARING_VIOLATION || error == ERROR_LOCK_VIOLATION);
-}
-
-bool WaitForFileAvailability(const std::string& filePath, int maxWaitTimeMs) {
-    int waitTime = 0;
-    const int sleepInterval = 250;
-    
-    WriteToLog("Verifica disponibilità file: " + filePath, true);
+    int Compile(const RegexNode* node, int next) {
+        switch (node->type) {
+            case RegexNode::Empty:
+                return next;
+            case RegexNode::CharSet: {
+                NfaState state(NfaState::Char, next);
+                state.setIndex = node->setIndex;
+                return AddState(state);
+            }
+            case RegexNode::Concat:
+                for (size_t i = node->children.size(); i-- > 0;) {
+                    next = Compile(node->children[i].get(), next);
+                }
+                return next;
+            case RegexNode::Alternate: {
+                int current = Compile(node->children.back().get(), next);
+                for (size_t i = node->children.size() - 1; i-- > 0;) {
+                    int branch = Compile(node->children[i].get(), next);
+                    current = AddState(NfaState(NfaState::Split, branch, current));
+                }
+                return current;
+            }
+            case RegexNode::AssertBegin:
+                return AddState(NfaState(NfaState::AssertBegin, next));
+            case RegexNode::AssertEnd:
+                return AddState(NfaState(NfaState::AssertEnd, next));
+            case RegexNode::Repeat: {
+                const RegexNode* child = node->children[0].get();
+                int current = next;
+                if (node->maxRepeat == -1) {
+                    int loop = AddState(NfaState(NfaState::Split, -1, next));
+                    int body = Compile(child, loop);
+                    nfa[loop].out = body;
+                    current = loop;
+                } else {
+                    for (int i = 0; i < node->maxRepeat - node->minRepeat; ++i) {
+                        int body = Compile(child, current);
+                        current = AddState(NfaState(NfaState::Split, body, next));
+                    }
+                }
+                for (int i = 0; i < node->minRepeat; ++i) {
+                    current = Compile(child, current);
+                }
+                return current;
+            }
+        }
+        return next;
+    }
     
-    while (waitTime < maxWaitTimeMs && !globalShutdown) {
-        if (!FileExists(filePath)) {
-            WriteToLog("File non più presente: " + filePath, true);
+    // Aggiunge un pattern all'automa; false se usa costrutti non supportati
+    bool AddPattern(const std::string& regex, int globalIndex) {
+        size_t savedSets = sets.size();
+        size_t savedStates = nfa.size();
+        try {
+            RegexSubsetParser parser(regex, true, sets);
+            std::unique_ptr<RegexNode> ast = parser.Parse();
+            
+            NfaState match(NfaState::Match);
+            match.patternId = static_cast<int>(automatonPatterns.size());
+            int matchState = AddState(match);
+            startStates.push_back(Compile(ast.get(), matchState));
+            automatonPatterns.push_back(globalIndex);
+            dfa.clear();  // classi e cache vanno ricalcolate
+            dfaIndex.clear();
+            return true;
+        } catch (const std::exception&) {
+            sets.resize(savedSets);
+            nfa.erase(nfa.begin() + savedStates, nfa.end());
             return false;
         }
-        
-        if (!IsFileInUse(filePath)) {
-            WriteToLog("File disponibile dopo " + std::to_string(waitTime) + "ms", true);
-            return true;
+    }
+    
+    void Closure(const std::vector<int>& seeds, bool atStart, bool atEnd, std::vector<int>& out) {
+        if (marks.size() < nfa.size()) marks.resize(nfa.size(), 0);
+        if (++markGeneration == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            markGeneration = 1;
         }
         
-        Sleep(sleepInterval);
-        waitTime += sleepInterval;
+        std::vector<int>& stack = closureStack;
+        stack.assign(seeds.rbegin(), seeds.rend());
+        while (!stack.empty()) {
+            int s = stack.back();
+            stack.pop_back();
+            if (s < 0 || marks[s] == markGeneration) continue;
+            marks[s] = markGeneration;
+            
+            const NfaState& state = nfa[s];
+            switch (state.type) {
+                case NfaState::Split:
+                    stack.push_back(state.out1);
+                    stack.push_back(state.out);
+                    break;
+                case NfaState::AssertBegin:
+                    if (atStart) stack.push_back(state.out);
+                    break;
+                case NfaState::AssertEnd:
+                    if (atEnd) stack.push_back(state.out);
+                    else out.push_back(s);  // resta pendente fino a fine input
+                    break;
+                case NfaState::Char:
+                case NfaState::Match:
+                    out.push_back(s);
+                    break;
+            }
+        }
+        std::sort(out.begin(), out.end());
     }
     
-    if (globalShutdown) {
-        WriteToLog("Terminazione richiesta durante attesa file", true);
+    static size_t HashStates(const std::vector<int>& states) {
+        size_t hash = 14695981039346656037ULL & static_cast<size_t>(-1);
+        for (int s : states) {
+            hash ^= static_cast<size_t>(s);
+            hash *= static_cast<size_t>(1099511628211ULL);
+        }
+        return hash;
     }
     
-    return false;
-}
-
-void LoadProcessedFiles() {
-    std::lock_guard<std::mutex> lock(processedFilesMutex);
+    void AccountState(const DfaState& state) {
+        cacheBytes += sizeof(DfaState) + state.nfaStates.size() * sizeof(int) + state.next.size() * sizeof(int);
+    }
     
-    std::ifstream file(processedFilesDb.c_str());
-    std::string line;
+    int Intern(std::vector<int>& states) {
+        size_t hash = HashStates(states);
+        auto range = dfaIndex.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (dfa[it->second]->nfaStates == states) return it->second;
+        }
+        
+        std::unique_ptr<DfaState> state(new DfaState(classCount));
+        state->nfaStates.swap(states);
+        AccountState(*state);
+        dfa.push_back(std::move(state));
+        int index = static_cast<int>(dfa.size() - 1);
+        dfaIndex.insert(std::make_pair(hash, index));
+        return index;
+    }
     
-    processedFiles.clear();
+    void ResetCache() {
+        dfa.clear();
+        dfaIndex.clear();
+        cacheBytes = 0;
+        // Lo stato 0 e' l'iniziale (contesto "inizio input") e non entra nell'indice,
+        // cosi' uno stato successivo con gli stessi stati NFA resta distinto
+        std::unique_ptr<DfaState> initial(new DfaState(classCount));
+        Closure(startStates, true, false, initial->nfaStates);
+        AccountState(*initial);
+        dfa.push_back(std::move(initial));
+    }
     
-    if (file.is_open()) {
-        while (std::getline(file, line)) {
-            if (!line.empty()) {
-                processedFiles.insert(line);
+    int Transition(int& current, unsigned char c) {
+        if (cacheBytes >= MAX_MATCHER_DFA_CACHE_BYTES) {
+            // Cache piena: svuota mantenendo solo lo stato corrente
+            std::vector<int> keep = dfa[current]->nfaStates;
+            ResetCache();
+            current = Intern(keep);
+            cacheFlushes++;
+        }
+        
+        std::vector<int>& moved = movedStates;
+        moved.clear();
+        for (int s : dfa[current]->nfaStates) {
+            const NfaState& state = nfa[s];
+            if (state.type == NfaState::Char && sets[state.setIndex][c]) {
+                moved.push_back(state.out);
             }
         }
-        file.close();
-        WriteToLog("Caricati " + std::to_string(processedFiles.size()) + " file dal database");
-        systemMetrics.totalFilesProcessed = processedFiles.size();
-    } else {
-        WriteToLog("Database file processati non trovato, verrà creato");
+        
+        std::vector<int> closure;
+        closure.reserve(moved.size());
+        Closure(moved, false, false, closure);
+        int target = Intern(closure);
+        dfa[current]->next[byteClass[c]] = target;
+        return target;
     }
-}
-
-void SaveProcessedFiles() {
-    std::lock_guard<std::mutex> lock(processedFilesMutex);
     
-    std::ofstream file(processedFilesDb.c_str());
-    if (file.is_open()) {
-        for (const auto& filename : processedFiles) {
-            file << filename << std::endl;
+    const std::vector<int>& Accepts(int index) {
+        DfaState& state = *dfa[index];
+        if (!state.acceptsComputed) {
+            std::vector<int> pending;
+            for (int s : state.nfaStates) {
+                if (nfa[s].type == NfaState::AssertEnd) pending.push_back(nfa[s].out);
+            }
+            std::vector<int> closure;
+            Closure(pending, index == 0, true, closure);
+            closure.insert(closure.end(), state.nfaStates.begin(), state.nfaStates.end());
+            
+            std::vector<bool> seen(automatonPatterns.size(), false);
+            for (int s : closure) {
+                if (nfa[s].type == NfaState::Match && !seen[nfa[s].patternId]) {
+                    seen[nfa[s].patternId] = true;
+                    state.accepts.push_back(automatonPatterns[nfa[s].patternId]);
+                }
+            }
+            std::sort(state.accepts.begin(), state.accepts.end());
+            state.acceptsComputed = true;
         }
-        file.close();
-        WriteToLog("Salvati " + std::to_string(processedFiles.size()) + " file nel database", true);
-    } else {
-        WriteToLog("ERRORE: Impossibile salvare database file processati");
-        systemMetrics.errorsCount++;
-    }
-}
-
-bool IsFileAlreadyProcessed(const std::string& fullFilePath) {
-    std::lock_guard<std::mutex> lock(processedFilesMutex);
-    return processedFiles.find(fullFilePath) != processedFiles.end();
-}
-
-void MarkFileAsProcessed(const std::string& fullFilePath) {
-    {
-        std::lock_guard<std::mutex> lock(processedFilesMutex);
-        processedFiles.insert(fullFilePath);
+        return state.accepts;
     }
-    SaveProcessedFiles();
-    WriteToLog("File marcato come processato: " + fullFilePath, true);
-    
-    systemMetrics.totalFilesProcessed++;
-    systemMetrics.filesProcessedToday++;
-    systemMetrics.lastFileProcessed = std::chrono::steady_clock::now();
-}
-
-bool LoadConfiguration() {
-    std::lock_guard<std::mutex> lock(configMutex);
-    
-    WriteToLog("Caricamento configurazione da: " + configFile);
     
-    if (!FileExists(configFile)) {
-        WriteToLog("File configurazione non trovato, creazione default");
+    // Indici globali dei pattern dell'automa che corrispondono all'intero nome
+    void MatchAutomaton(const std::string& filename, std::vector<int>& result) {
+        if (startStates.empty()) return;
         
-        std::string configDir = configFile.substr(0, configFile.find_last_of("\\/"));
-        if (!CreateDirectoryRecursive(configDir)) {
-            WriteToLog("ERRORE: Impossibile creare directory configurazione: " + configDir);
-            return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dfa.empty()) {
+            ComputeByteClasses();
+            ResetCache();
         }
         
-        std::ofstream config(configFile.c_str());
-        if (config.is_open()) {
-            config << "# PatternTriggerCommand Configuration - Multi-Folder Support + Web Dashboard\n";
-            config << "# Autore: Umberto Meglio - Supporto: Claude di Anthropic\n\n";
-            config << "[Settings]\n";
-            config << "DefaultMonitoredFolder=" << defaultMonitoredFolder << "\n";
-            config << "LogFile=" << logFile << "\n";
-            config << "DetailedLogFile=" << detailedLogFile << "\n";
-            config << "ProcessedFilesDB=" << processedFilesDb << "\n";
-            config << "DetailedLogging=" << (detailedLogging ? "true" : "false") << "\n";
-            config << "WebServerPort=" << webServerPort << "\n";
-            config << "WebServerEnabled=" << (webServerEnabled ? "true" : "false") << "\n";
-            config << "SchedulerEnabled=" << (schedulerEnabled ? "true" : "false") << "\n";
-            config << "SchedulerFolder=" << schedulerFolder << "\n\n";
-            config << "[Patterns]\n";
-            config << "Pattern1=C:\\Monitored\\Documents|^doc.*\\..*$|C:\\Scripts\\process_doc.bat\n";
-            config << "Pattern2=C:\\Monitored\\Invoices|^invoice.*\\.pdf$|C:\\Scripts\\process_invoice.bat\n";
-            config << "Pattern3=^report.*\\.xlsx$|C:\\Scripts\\process_report.bat\n";
-            config.close();
-            
-            WriteToLog("File configurazione default creato");
-        } else {
-            WriteToLog("ERRORE: Impossibile creare file configurazione");
-            return false;
+        int current = 0;
+        for (size_t i = 0; i < filename.length(); ++i) {
+            unsigned char c = static_cast<unsigned char>(filename[i]);
+            int next = dfa[current]->next[byteClass[c]];
+            if (next < 0) next = Transition(current, c);
+            current = next;
+            if (dfa[current]->nfaStates.empty()) return;  // stato morto
         }
+        
+        const std::vector<int>& accepts = Accepts(current);
+        result.insert(result.end(), accepts.begin(), accepts.end());
     }
+};
+
+// Un matcher per cartella normalizzata, ricostruito a ogni caricamento configurazione
+std::map<std::string, std::unique_ptr<FolderPatternMatcher>> folderMatchers;
+
+// Indice dei file processati: tabella hash a indirizzamento aperto (sondaggio lineare)
+// sulle impronte a 64 bit dei percorsi, con i nomi in un'arena di blocchi da 1 MB e la
+// cartella memorizzata una sola volta. Il confronto ignora maiuscole/minuscole come il
+// file system; il percorso conserva la grafia del primo inserimento. Uno slot da 8 byte
+// (32 bit alti dell'impronta + indice voce) basta a scartare quasi tutti i confronti;
+// una voce costa circa 8 byte di slot per 1,3-2,7 slot, 20 byte di descrittore (con
+// l'istante di registrazione per la retention) e il solo nome file, contro nodo,
+// stringa e allocazioni separate di std::set<std::string>.
+class ProcessedFileIndex {
+public:
+    ProcessedFileIndex() : entryCount(0), liveCount(0), usedSlots(0), arenaUsed(ARENA_BLOCK_SIZE) {}
     
-    std::ifstream config(configFile.c_str());
-    if (!config.is_open()) {
-        WriteToLog("ERRORE: Impossibile aprire file configurazione");
-        return false;
+    bool Contains(const std::string& path) const {
+        return Find(path, Fingerprint(path)) != NOT_FOUND;
     }
     
-    std::string line;
-    std::string currentSection;
-    bool hasPatterns = false;
-    
-    patternCommandPairs.clear();
-    
-    while (std::getline(config, line)) {
-        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+    // recorded: secondi Unix della registrazione, 0 = sconosciuto
+    bool Insert(const std::string& path, unsigned int recorded = 0) {
+        if ((usedSlots + 1) * 4 > slots.size() * 3) Rehash(std::max<size_t>(64, (liveCount + 1) * 2));
         
-        size_t commentPos = line.find('#');
-        if (commentPos != std::string::npos) {
-            line = line.substr(0, commentPos);
+        unsigned long long fingerprint = Fingerprint(path);
+        unsigned int tag = static_cast<unsigned int>(fingerprint >> 32);
+        size_t mask = slots.size() - 1;
+        size_t target = NOT_FOUND;
+        size_t slot = static_cast<size_t>(fingerprint) & mask;
+        for (;; slot = (slot + 1) & mask) {
+            unsigned int entry = slots[slot].entry;
+            if (entry == EMPTY_SLOT) break;
+            if (entry == DELETED_SLOT) {
+                if (target == NOT_FOUND) target = slot;
+            } else if (slots[slot].tag == tag && Matches(EntryAt(entry), path)) {
+                return false;
+            }
         }
-        
-        line.erase(0, line.find_first_not_of(" \t"));
-        line.erase(line.find_last_not_of(" \t") + 1);
-        
-        if (line[0] == '[' && line[line.length() - 1] == ']') {
-            currentSection = line.substr(1, line.length() - 2);
-            continue;
+        if (target == NOT_FOUND) {
+            target = slot;
+            usedSlots++;
         }
         
-        size_t equalPos = line.find('=');
-        if (equalPos == std::string::npos) continue;
-        
-        std::string key = line.substr(0, equalPos);
-        std::string value = line.substr(equalPos + 1);
-        
-        key.erase(0, key.find_first_not_of(" \t"));
-        key.erase(key.find_last_not_of(" \t") + 1);
-        value.erase(0, value.find_first_not_of(" \t"));
-        value.erase(value.find_last_not_of(" \t") + 1);
-        
-        if (currentSection == "Settings") {
-            if (key == "DefaultMonitoredFolder" || key == "MonitoredFolder") {
-                defaultMonitoredFolder = value;
-            } else if (key == "LogFile") {
-                logFile = value;
-            } else if (key == "DetailedLogFile") {
-                detailedLogFile = value;
-            } else if (key == "ProcessedFilesDB") {
-                processedFilesDb = value;
-            } else if (key == "DetailedLogging") {
-                detailedLogging = (value == "true" || value == "1" || value == "yes");
-            } else if (key == "WebServerPort") {
-                webServerPort = std::stoi(value);
-            } else if (key == "WebServerEnabled") {
-                webServerEnabled = (value == "true" || value == "1" || value == "yes");
-            } else if (key == "SchedulerEnabled") {
-                schedulerEnabled = (value == "true" || value == "1" || value == "yes");
-            } else if (key == "SchedulerFolder") {
-                schedulerFolder = value;
-            }
-        } else if (currentSection == "Patterns") {
-            std::vector<std::string> parts;
-            std::string temp = value;
-            
-            size_t pos = 0;
-            while ((pos = temp.find('|')) != std::string::npos) {
-                parts.push_back(temp.substr(0, pos));
-                temp.erase(0, pos + 1);
-            }
-            if (!temp.empty()) {
-                parts.push_back(temp);
-            }
-            
-            std::string folderPath, pattern, command;
-            
-            if (parts.size() == 3) {
-                folderPath = parts[0];
-                pattern = parts[1];
-                command = parts[2];
-            } else if (parts.size() == 2) {
-                folderPath = defaultMonitoredFolder;
-                pattern = parts[0];
-                command = parts[1];
-            } else {
-                WriteToLog("AVVISO: Pattern ignorato, formato non valido: " + value);
-                continue;
-            }
-            
-            folderPath.erase(0, folderPath.find_first_not_of(" \t"));
-            folderPath.erase(folderPath.find_last_not_of(" \t") + 1);
-            pattern.erase(0, pattern.find_first_not_of(" \t"));
-            pattern.erase(pattern.find_last_not_of(" \t") + 1);
-            command.erase(0, command.find_first_not_of(" \t"));
-            command.erase(command.find_last_not_of(" \t") + 1);
-            
-            try {
-                patternCommandPairs.emplace_back(folderPath, pattern, command, key);
-                hasPatterns = true;
-                WriteToLog("Pattern caricato: [" + key + "] '" + folderPath + 
-                          "' | '" + pattern + "' | '" + command + "'", true);
-            } catch (const std::regex_error& e) {
-                WriteToLog("ERRORE: Pattern regex non valido '" + pattern + "': " + e.what());
-                systemMetrics.errorsCount++;
-            }
-        }
+        slots[target].tag = tag;
+        slots[target].entry = static_cast<unsigned int>(entryCount);
+        AppendEntry(path, recorded);
+        liveCount++;
+        return true;
     }
     
-    config.close();
+    // Lo spazio del nome nell'arena resta occupato fino al prossimo Clear
+    bool Erase(const std::string& path) {
+        size_t slot = Find(path, Fingerprint(path));
+        if (slot == NOT_FOUND) return false;
+        EntryAt(slots[slot].entry).length |= ERASED_FLAG;
+        slots[slot].entry = DELETED_SLOT;
+        liveCount--;
+        return true;
+    }
     
-    if (!hasPatterns) {
-        WriteToLog("ERRORE: Nessun pattern valido trovato");
-        return false;
+    void Clear() {
+        std::vector<Slot>().swap(slots);
+        std::vector<std::unique_ptr<Entry[]>>().swap(entryBlocks);
+        entryCount = 0;
+        std::vector<std::unique_ptr<char[]>>().swap(arena);
+        std::vector<std::string>().swap(folders);
+        folderIds.clear();
+        liveCount = 0;
+        usedSlots = 0;
+        arenaUsed = ARENA_BLOCK_SIZE;
     }
     
-    WriteToLog("Configurazione caricata - Pattern: " + std::to_string(patternCommandPairs.size()) + 
-               ", WebServer: " + (webServerEnabled ? "abilitato" : "disabilitato") + 
-               " porta " + std::to_string(webServerPort));
-    return true;
-}
-
-std::vector<int> FindMatchingPatterns(const std::string& filename, const std::string& folderPath) {
-    std::vector<int> matchingPatterns;
-    std::string normalizedFolder = NormalizeFolderPath(folderPath);
+    void Reserve(size_t count) {
+        if ((count + 1) * 4 > slots.size() * 3) Rehash(count + 1);
+    }
     
-    for (size_t i = 0; i < patternCommandPairs.size(); ++i) {
-        if (NormalizeFolderPath(patternCommandPairs[i].folderPath) == normalizedFolder) {
-            try {
-                if (std::regex_match(filename, patternCommandPairs[i].compiledRegex)) {
-                    matchingPatterns.push_back(static_cast<int>(i));
-                    
-                    // Aggiorna contatore match
-                    std::lock_guard<std::mutex> lock(patternStatsMutex);
-                    patternMatchCounts[patternCommandPairs[i].patternName]++;
-                }
-            } catch (const std::regex_error& e) {
-                WriteToLog("ERRORE regex match: " + std::string(e.what()));
-                systemMetrics.errorsCount++;
-            }
-        }
+    size_t Size() const { return liveCount; }
+    
+    bool Lookup(const std::string& path, unsigned int& recorded) const {
+        size_t slot = Find(path, Fingerprint(path));
+        if (slot == NOT_FOUND) return false;
+        recorded = EntryAt(slots[slot].entry).recorded;
+        return true;
     }
     
-    return matchingPatterns;
-}
-
-bool ExecuteCommand(const std::string& command, const std::string& parameter, const std::string& patternName) {
-    if (globalShutdown) return false;
+    // Accesso per posizione (voci cancellate comprese) per le scansioni incrementali
+    size_t EntryCount() const { return entryCount; }
     
-    auto startTime = std::chrono::steady_clock::now();
+    bool EntryAt(size_t index, std::string& path, unsigned int& recorded) const {
+        if (index >= entryCount) return false;
+        const Entry& entry = EntryAt(index);
+        if (entry.length & ERASED_FLAG) return false;
+        const std::string& folder = folders[entry.folder];
+        path.assign(folder);
+        if (!folder.empty()) path += '\\';
+        path.append(arena[entry.block].get() + entry.offset, entry.length);
+        recorded = entry.recorded;
+        return true;
+    }
     
-    if (!FileExists(command)) {
-        WriteToLog("ERRORE: Comando non trovato: " + command);
-        systemMetrics.errorsCount++;
-        return false;
+    template <typename Visitor>
+    void ForEachRecorded(Visitor visit) const {
+        std::string path;
+        unsigned int recorded = 0;
+        for (size_t i = 0; i < entryCount; ++i) {
+            if (EntryAt(i, path, recorded)) visit(path, recorded);
+        }
     }
     
-    if (IsFileAlreadyProcessed(parameter)) {
-        WriteToLog("SALTATO: File già processato: " + parameter);
-        return false;
+    template <typename Visitor>
+    void ForEach(Visitor visit) const {
+        ForEachRecorded([&visit](const std::string& path, unsigned int) { visit(path); });
     }
     
-    if (!WaitForFileAvailability(parameter)) {
-        WriteToLog("ERRORE: File non disponibile: " + parameter);
-        systemMetrics.errorsCount++;
-        return false;
+    // Impronta del percorso senza distinzione maiuscole/minuscole. Fa parte del formato
+    // dell'immagine binaria su disco: cambiarla richiede una nuova versione del formato.
+    static unsigned long long Fingerprint(const std::string& path) {
+        return Mix(FoldHash(path.data(), path.length(), 14695981039346656037ULL));
     }
     
-    std::string commandLine = "\"" + command + "\" \"" + parameter + "\"";
-    WriteToLog("ESECUZIONE [" + patternName + "]: " + commandLine);
+    static bool EqualsFolded(const char* a, const char* b, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            if (a[i] != b[i] && Fold(a[i]) != Fold(b[i])) return false;
+        }
+        return true;
+    }
     
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    ZeroMemory(&pi, sizeof(pi));
+    // Byte allocati dall'indice (slot, descrittori, arena, cartelle)
+    size_t MemoryUsage() const {
+        size_t bytes = slots.capacity() * sizeof(Slot) +
+                       entryBlocks.size() * ENTRY_BLOCK_SIZE * sizeof(Entry) +
+                       arena.size() * ARENA_BLOCK_SIZE;
+        for (const auto& folder : folders) bytes += folder.capacity() + sizeof(std::string) * 2 + sizeof(unsigned int);
+        return bytes;
+    }
     
-    char* cmdline = new char[commandLine.length() + 1];
-    strcpy(cmdline, commandLine.c_str());
+private:
+    struct Entry {
+        unsigned int block;
+        unsigned int offset;
+        unsigned int folder;
+        unsigned int length;  // bit alto = voce cancellata
+        unsigned int recorded;
+    };
     
-    if (!CreateProcess(NULL, cmdline, NULL, NULL, FALSE, 
-                      CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        WriteToLog("ERRORE: CreateProcess fallito: " + std::to_string(GetLastError()));
-        systemMetrics.errorsCount++;
-        delete[] cmdline;
-        return false;
-    }
+    struct Slot {
+        unsigned int tag;    // 32 bit alti dell'impronta
+        unsigned int entry;  // indice voce, EMPTY_SLOT o DELETED_SLOT
+    };
     
-    DWORD waitResult = WaitForSingleObject(pi.hProcess, BATCH_TIMEOUT);
-    bool success = false;
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+    static const size_t ARENA_BLOCK_SIZE = 1 << 20;
+    static const size_t ENTRY_BLOCK_SIZE = 1 << 16;  // voci a blocchi: nessuna copia in crescita
+    static const unsigned int EMPTY_SLOT = 0xFFFFFFFFu;
+    static const unsigned int DELETED_SLOT = 0xFFFFFFFEu;
+    static const unsigned int ERASED_FLAG = 0x80000000u;
     
-    if (waitResult == WAIT_OBJECT_0) {
-        DWORD exitCode;
-        GetExitCodeProcess(pi.hProcess, &exitCode);
-        WriteToLog("COMPLETATO: Codice uscita " + std::to_string(exitCode));
-        MarkFileAsProcessed(parameter);
-        success = true;
-        systemMetrics.commandsExecuted++;
-        
-        // Aggiorna contatore esecuzioni
-        std::lock_guard<std::mutex> lock(patternStatsMutex);
-        patternExecutionCounts[patternName]++;
-        
-    } else if (waitResult == WAIT_TIMEOUT) {
-        WriteToLog("TIMEOUT: Processo terminato forzatamente");
-        TerminateProcess(pi.hProcess, 1);
-        MarkFileAsProcessed(parameter);
-        success = true;
-        systemMetrics.commandsExecuted++;
-        
-        std::lock_guard<std::mutex> lock(patternStatsMutex);
-        patternExecutionCounts[patternName]++;
-        
-    } else {
-        WriteToLog("ERRORE: Attesa processo fallita");
-        TerminateProcess(pi.hProcess, 1);
-        systemMetrics.errorsCount++;
-        success = false;
-    }
+    std::vector<Slot> slots;
+    std::vector<std::unique_ptr<Entry[]>> entryBlocks;
+    size_t entryCount;
+    std::vector<std::unique_ptr<char[]>> arena;
+    std::vector<std::string> folders;
+    std::unordered_map<std::string, unsigned int> folderIds;  // chiave in minuscolo
+    size_t liveCount;
+    size_t usedSlots;  // occupati o cancellati
+    size_t arenaUsed;
     
-    auto endTime = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-    systemMetrics.averageProcessingTime = (systemMetrics.averageProcessingTime + duration) / 2;
+    static char Fold(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
     
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    delete[] cmdline;
+    static unsigned long long FoldHash(const char* data, size_t length, unsigned long long hash) {
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(Fold(data[i]));
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
     
-    if (!globalShutdown) {
-        Sleep(MONITORING_RESTART_DELAY);
+    // Finalizzazione: i bit bassi scelgono lo slot, i 32 alti fanno da etichetta
+    static unsigned long long Mix(unsigned long long hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
     }
     
-    return success;
-}
-
-void ScanDirectoryForExistingFiles(const std::string& folderPath, const std::vector<int>& patternIndices) {
-    WriteToLog("Scansione iniziale cartella: " + folderPath + " (" + std::to_string(patternIndices.size()) + " pattern/s)");
+    // Ricalcolata dai pezzi della voce durante il rehash, senza ricostruire il percorso
+    unsigned long long EntryFingerprint(const Entry& entry) const {
+        const std::string& folder = folders[entry.folder];
+        unsigned long long hash = FoldHash(folder.data(), folder.length(), 14695981039346656037ULL);
+        if (!folder.empty()) hash = FoldHash("\\", 1, hash);
+        return Mix(FoldHash(arena[entry.block].get() + entry.offset, entry.length & ~ERASED_FLAG, hash));
+    }
     
-    int filesFound = 0;
-    int filesProcessed = 0;
-    int filesSkipped = 0;
+    Entry& EntryAt(size_t index) { return entryBlocks[index / ENTRY_BLOCK_SIZE][index % ENTRY_BLOCK_SIZE]; }
+    const Entry& EntryAt(size_t index) const { return entryBlocks[index / ENTRY_BLOCK_SIZE][index % ENTRY_BLOCK_SIZE]; }
     
-    std::string searchPath = folderPath + "\\*.*";
-    WIN32_FIND_DATA findData;
-    HANDLE hFind = FindFirstFile(searchPath.c_str(), &findData);
+    size_t Find(const std::string& path, unsigned long long fingerprint) const {
+        if (slots.empty()) return NOT_FOUND;
+        unsigned int tag = static_cast<unsigned int>(fingerprint >> 32);
+        size_t mask = slots.size() - 1;
+        for (size_t slot = static_cast<size_t>(fingerprint) & mask;; slot = (slot + 1) & mask) {
+            unsigned int entry = slots[slot].entry;
+            if (entry == EMPTY_SLOT) return NOT_FOUND;
+            if (entry != DELETED_SLOT && slots[slot].tag == tag && Matches(EntryAt(entry), path)) return slot;
+        }
+    }
     
-    if (hFind == INVALID_HANDLE_VALUE) {
-        WriteToLog("ERRORE: Impossibile aprire cartella: " + folderPath);
-        systemMetrics.errorsCount++;
-        return;
+    bool Matches(const Entry& entry, const std::string& path) const {
+        const std::string& folder = folders[entry.folder];
+        size_t prefix = folder.empty() ? 0 : folder.length() + 1;
+        if (path.length() != prefix + entry.length) return false;
+        if (prefix > 0 && path[folder.length()] != '\\') return false;
+        return EqualsFolded(arena[entry.block].get() + entry.offset, path.data() + prefix, entry.length) &&
+               EqualsFolded(folder.data(), path.data(), folder.length());
     }
     
-    do {
-        if (globalShutdown) break;
+    void AppendEntry(const std::string& path, unsigned int recorded) {
+        size_t slash = path.find_last_of('\\');
+        std::string folder = (slash != std::string::npos) ? path.substr(0, slash) : std::string();
+        size_t nameStart = (slash != std::string::npos) ? slash + 1 : 0;
+        size_t nameLength = path.length() - nameStart;
         
-        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        std::string key(folder);
+        for (auto& c : key) c = Fold(c);
+        auto known = folderIds.find(key);
+        Entry entry;
+        if (known != folderIds.end()) {
+            entry.folder = known->second;
+        } else {
+            entry.folder = static_cast<unsigned int>(folders.size());
+            folders.push_back(folder);
+            folderIds[key] = entry.folder;
+        }
         
-        filesFound++;
-        std::string filename = findData.cFileName;
-        std::string fullPath = folderPath + "\\" + filename;
+        // I nomi file (max 32767 caratteri) stanno sempre in un blocco
+        if (arenaUsed + nameLength > ARENA_BLOCK_SIZE) {
+            arena.push_back(std::unique_ptr<char[]>(new char[ARENA_BLOCK_SIZE]));
+            arenaUsed = 0;
+        }
+        entry.block = static_cast<unsigned int>(arena.size() - 1);
+        entry.offset = static_cast<unsigned int>(arenaUsed);
+        memcpy(arena.back().get() + arenaUsed, path.data() + nameStart, nameLength);
+        arenaUsed += nameLength;
+        entry.length = static_cast<unsigned int>(nameLength);
+        entry.recorded = recorded;
         
-        // CORREZIONE: Processa TUTTI i file che matchano i pattern, anche se già processati
-        std::vector<int> matchingPatterns = FindMatchingPatterns(filename, folderPath);
+        if (entryCount % ENTRY_BLOCK_SIZE == 0) {
+            entryBlocks.push_back(std::unique_ptr<Entry[]>(new Entry[ENTRY_BLOCK_SIZE]));
+        }
+        EntryAt(entryCount) = entry;
+        entryCount++;
+    }
+    
+    void Rehash(size_t minimumEntries) {
+        size_t capacity = 64;
+        while (capacity * 3 < minimumEntries * 4) capacity <<= 1;
         
-        if (!matchingPatterns.empty()) {
-            bool alreadyProcessed = IsFileAlreadyProcessed(fullPath);
-            
-            if (!alreadyProcessed) {
-                WriteToLog("File NON processato trovato: " + fullPath);
-                
-                for (int patternIndex : matchingPatterns) {
-                    if (ExecuteCommand(patternCommandPairs[patternIndex].command, 
-                                     fullPath, patternCommandPairs[patternIndex].patternName)) {
-                        filesProcessed++;
-                        WriteToLog("File processato durante scansione: " + fullPath);
-                    }
-                    if (globalShutdown) break;
-                }
-            } else {
-                filesSkipped++;
-                WriteToLog("File già processato saltato: " + fullPath, true);
-            }
+        Slot empty;
+        empty.tag = 0;
+        empty.entry = EMPTY_SLOT;
+        std::vector<Slot> resized(capacity, empty);
+        size_t mask = capacity - 1;
+        for (const auto& old : slots) {
+            if (old.entry == EMPTY_SLOT || old.entry == DELETED_SLOT) continue;
+            size_t slot = static_cast<size_t>(EntryFingerprint(EntryAt(old.entry))) & mask;
+            while (resized[slot].entry != EMPTY_SLOT) slot = (slot + 1) & mask;
+            resized[slot] = old;
+        }
+        slots.swap(resized);
+        usedSlots = liveCount;
+    }
+};
+
+// Immagine binaria del database file processati, mappata in sola lettura: le ricerche
+// leggono direttamente la tabella hash su disco, senza parsing ne' copia in memoria.
+// Layout (little-endian, campi allineati a 8 byte):
+//   intestazione | heap stringhe | tabella cartelle | tabella voci | tabella slot | istanti
+// Heap: nomi file e cartelle senza terminatore. Cartella: offset nell'heap + lunghezza.
+// Voce: offset del nome, indice cartella, lunghezza nome. Slot: 32 bit alti
+// dell'impronta + indice voce (0xFFFFFFFF = vuoto), indirizzamento aperto lineare con
+// la stessa impronta di ProcessedFileIndex. Istanti (dalla versione 2): secondi Unix
+// della registrazione, uno per voce. L'intestazione e' scritta per ultima.
+struct ProcessedDbImageHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int headerSize;
+    unsigned long long entryCount;
+    unsigned long long folderCount;
+    unsigned long long slotCount;
+    unsigned long long heapOffset;
+    unsigned long long heapSize;
+    unsigned long long folderOffset;
+    unsigned long long entryOffset;
+    unsigned long long slotOffset;
+    unsigned long long fileSize;
+    unsigned long long timeOffset;  // solo versione 2
+};
+
+struct ProcessedDbImageFolder {
+    unsigned long long offset;
+    unsigned int length;
+    unsigned int reserved;
+};
+
+struct ProcessedDbImageEntry {
+    unsigned long long nameOffset;
+    unsigned int folder;
+    unsigned int length;
+};
+
+struct ProcessedDbImageSlot {
+    unsigned int tag;
+    unsigned int entry;
+};
+
+static const char PROCESSED_DB_IMAGE_MAGIC[8] = {'P', 'T', 'C', 'P', 'R', 'O', 'C', '\x1a'};
+static const unsigned int PROCESSED_DB_IMAGE_VERSION = 2;
+static const unsigned int PROCESSED_DB_IMAGE_V1_HEADER_SIZE = sizeof(ProcessedDbImageHeader) - sizeof(unsigned long long);
+static const unsigned int PROCESSED_DB_IMAGE_EMPTY = 0xFFFFFFFFu;
+
+class ProcessedDbImage {
+public:
+    ProcessedDbImage() : fileHandle(INVALID_HANDLE_VALUE), mapping(NULL), view(NULL), header(NULL),
+                         heap(NULL), folderTable(NULL), entries(NULL), slots(NULL), times(NULL) {}
+    ~ProcessedDbImage() { Close(); }
+    
+    // Mappa il file e ne verifica l'intestazione; nessuna voce viene letta
+    bool Open(const std::string& path, std::string& error) {
+        Close();
+        fileHandle = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            error = "apertura fallita (" + std::to_string(GetLastError()) + ")";
+            return false;
         }
         
-    } while (FindNextFile(hFind, &findData) && !globalShutdown);
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart < static_cast<long long>(PROCESSED_DB_IMAGE_V1_HEADER_SIZE) ||
+            static_cast<unsigned long long>(size.QuadPart) > static_cast<unsigned long long>(static_cast<size_t>(-1))) {
+            error = "dimensione file non valida";
+            Close();
+            return false;
+        }
+        
+        mapping = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        view = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+        if (!view) {
+            error = "mappatura fallita (" + std::to_string(GetLastError()) + ")";
+            Close();
+            return false;
+        }
+        
+        header = reinterpret_cast<const ProcessedDbImageHeader*>(view);
+        if (!Validate(static_cast<unsigned long long>(size.QuadPart), error)) {
+            Close();
+            return false;
+        }
+        heap = view + header->heapOffset;
+        folderTable = reinterpret_cast<const ProcessedDbImageFolder*>(view + header->folderOffset);
+        entries = reinterpret_cast<const ProcessedDbImageEntry*>(view + header->entryOffset);
+        slots = reinterpret_cast<const ProcessedDbImageSlot*>(view + header->slotOffset);
+        times = header->version >= 2 ? reinterpret_cast<const unsigned int*>(view + header->timeOffset) : NULL;
+        return true;
+    }
     
-    FindClose(hFind);
+    void Close() {
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+        view = NULL;
+        header = NULL;
+        heap = NULL;
+        folderTable = NULL;
+        entries = NULL;
+        slots = NULL;
+        times = NULL;
+    }
     
-    WriteToLog("Scansione iniziale completata: " + folderPath + 
-               " - Trovati: " + std::to_string(filesFound) +
-               ", Nuovi processati: " + std::to_string(filesProcessed) + 
-               ", Già processati: " + std::to_string(filesSkipped));
-}
-
-void FolderMonitorWorker(FolderMonitor* monitor) {
-    WriteToLog("Avvio monitoraggio worker per: " + monitor->folderPath);
-    monitor->active = true;
-    systemMetrics.activeThreads++;
+    bool IsOpen() const { return view != NULL; }
+    size_t Size() const { return header ? static_cast<size_t>(header->entryCount) : 0; }
+    const ProcessedDbImageHeader* Header() const { return header; }
     
-    monitor->directoryHandle = CreateFile(monitor->folderPath.c_str(), FILE_LIST_DIRECTORY,
-                                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                                         NULL, OPEN_EXISTING, 
-                                         FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    bool Contains(const std::string& path) const {
+        return FindEntry(path) != PROCESSED_DB_IMAGE_EMPTY;
+    }
     
-    if (monitor->directoryHandle == INVALID_HANDLE_VALUE) {
-        WriteToLog("ERRORE: Impossibile aprire directory: " + monitor->folderPath + 
-                  " Error: " + std::to_string(GetLastError()));
-        monitor->active = false;
-        systemMetrics.activeThreads--;
-        systemMetrics.errorsCount++;
-        return;
+    // Istante 0 per le immagini di versione 1, senza istanti
+    bool Lookup(const std::string& path, unsigned int& recorded) const {
+        unsigned int entry = FindEntry(path);
+        if (entry == PROCESSED_DB_IMAGE_EMPTY) return false;
+        recorded = times ? times[entry] : 0;
+        return true;
     }
     
-    BYTE buffer[4096];
-    DWORD bytesRead = 0;
+    bool EntryAt(size_t index, std::string& path, unsigned int& recorded) const {
+        if (!EntryPath(index, path)) return false;
+        recorded = times ? times[index] : 0;
+        return true;
+    }
     
-    while (!monitor->stopRequested && !globalShutdown) {
-        // CORREZIONE: Controlla se handle è ancora valido
-        if (monitor->directoryHandle == INVALID_HANDLE_VALUE) {
-            WriteToLog("Handle directory chiuso - terminazione thread: " + monitor->folderPath, true);
-            break;
+    template <typename Visitor>
+    void ForEachRecorded(Visitor visit) const {
+        std::string path;
+        unsigned int recorded = 0;
+        for (size_t i = 0; i < Size(); ++i) {
+            if (EntryAt(i, path, recorded)) visit(path, recorded);
         }
-        
-        BOOL result = ReadDirectoryChangesW(
-            monitor->directoryHandle,
-            buffer,
-            sizeof(buffer),
-            FALSE,
-            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
-            &bytesRead,
-            NULL,
-            NULL
-        );
-        
-        if (!result) {
-            DWORD error = GetLastError();
-            if (error == ERROR_OPERATION_ABORTED || error == ERROR_INVALID_HANDLE || error == ERROR_ACCESS_DENIED) {
-                WriteToLog("Monitoraggio interrotto per: " + monitor->folderPath + " (Error: " + std::to_string(error) + ")", true);
-                break;
-            } else {
-                WriteToLog("ERRORE ReadDirectoryChangesW: " + std::to_string(error) + 
-                          " per cartella: " + monitor->folderPath);
-                systemMetrics.errorsCount++;
-                
-                // CORREZIONE: Non loop infinito su errori persistenti
-                if (monitor->stopRequested || globalShutdown) break;
-                Sleep(1000);
-                continue;
-            }
+    }
+    
+    template <typename Visitor>
+    void ForEach(Visitor visit) const {
+        ForEachRecorded([&visit](const std::string& path, unsigned int) { visit(path); });
+    }
+    
+    // Lunghezza media della sequenza di sondaggio delle voci (scorre solo la tabella slot)
+    double AverageProbeLength() const {
+        if (!header || header->entryCount == 0) return 0.0;
+        size_t mask = static_cast<size_t>(header->slotCount) - 1;
+        unsigned long long total = 0;
+        std::string path;
+        for (size_t slot = 0; slot <= mask; ++slot) {
+            unsigned int entry = slots[slot].entry;
+            if (entry == PROCESSED_DB_IMAGE_EMPTY || !EntryPath(entry, path)) continue;
+            size_t home = static_cast<size_t>(ProcessedFileIndex::Fingerprint(path)) & mask;
+            total += ((slot - home) & mask) + 1;
         }
-        
-        if (bytesRead == 0 || monitor->stopRequested || globalShutdown) {
-            continue;
+        return static_cast<double>(total) / header->entryCount;
+    }
+    
+private:
+    HANDLE fileHandle;
+    HANDLE mapping;
+    const char* view;
+    const ProcessedDbImageHeader* header;
+    const char* heap;
+    const ProcessedDbImageFolder* folderTable;
+    const ProcessedDbImageEntry* entries;
+    const ProcessedDbImageSlot* slots;
+    const unsigned int* times;
+    
+    static bool InRange(unsigned long long offset, unsigned long long length, unsigned long long limit) {
+        return offset <= limit && length <= limit - offset;
+    }
+    
+    // Controlli a costo costante (piu' le cartelle, poche): i limiti di ogni voce
+    // vengono verificati quando la voce viene letta
+    bool Validate(unsigned long long fileSize, std::string& error) const {
+        if (memcmp(header->magic, PROCESSED_DB_IMAGE_MAGIC, sizeof(PROCESSED_DB_IMAGE_MAGIC)) != 0) {
+            error = "firma non riconosciuta";
+            return false;
         }
-        
-        FILE_NOTIFY_INFORMATION* fni = (FILE_NOTIFY_INFORMATION*)buffer;
-        
-        do {
-            if (monitor->stopRequested || globalShutdown) break;
-            
-            char filename[MAX_PATH];
-            int filenameLength = WideCharToMultiByte(CP_ACP, 0, fni->FileName, 
-                                                   fni->FileNameLength / sizeof(WCHAR),
-                                                   filename, sizeof(filename), NULL, NULL);
-            filename[filenameLength] = '\0';
-            
-            std::string strFilename(filename);
-            std::string fullPath = monitor->folderPath + "\\" + strFilename;
-            
-            if (fni->Action == FILE_ACTION_ADDED || 
-                fni->Action == FILE_ACTION_RENAMED_NEW_NAME || 
-                fni->Action == FILE_ACTION_MODIFIED) {
-                
-                WriteToLog("Evento file: " + strFilename + " in " + monitor->folderPath, true);
-                monitor->filesDetected++;
-                
-                Sleep(500);
-                
-                std::vector<int> matchingPatterns = FindMatchingPatterns(strFilename, monitor->folderPath);
-                
-                if (!matchingPatterns.empty() && !IsFileAlreadyProcessed(fullPath)) {
-                    WriteToLog("File corrispondente rilevato: " + fullPath);
-                    
-                    for (int patternIndex : matchingPatterns) {
-                        if (ExecuteCommand(patternCommandPairs[patternIndex].command, 
-                                         fullPath, patternCommandPairs[patternIndex].patternName)) {
-                            WriteToLog("Comando eseguito per: " + fullPath, true);
-                            monitor->filesProcessed++;
-                        }
-                        if (monitor->stopRequested || globalShutdown) break;
-                    }
-                }
+        if (header->version < 1 || header->version > PROCESSED_DB_IMAGE_VERSION) {
+            error = "versione " + std::to_string(header->version) + " non supportata";
+            return false;
+        }
+        unsigned long long headerSize = header->version >= 2 ? sizeof(ProcessedDbImageHeader) : PROCESSED_DB_IMAGE_V1_HEADER_SIZE;
+        unsigned long long slotCount = header->slotCount;
+        unsigned long long tablesEnd = header->slotOffset + slotCount * sizeof(ProcessedDbImageSlot);
+        if (fileSize < headerSize || header->headerSize != headerSize || header->fileSize != fileSize ||
+            header->entryCount >= PROCESSED_DB_IMAGE_EMPTY || header->folderCount >= PROCESSED_DB_IMAGE_EMPTY ||
+            (slotCount & (slotCount - 1)) != 0 || (slotCount == 0 && header->entryCount > 0) ||
+            slotCount < header->entryCount + (header->entryCount > 0 ? 1 : 0) ||
+            header->folderOffset % 8 != 0 || header->entryOffset % 8 != 0 || header->slotOffset % 8 != 0 ||
+            header->folderCount > fileSize / sizeof(ProcessedDbImageFolder) ||
+            header->entryCount > fileSize / sizeof(ProcessedDbImageEntry) ||
+            slotCount > fileSize / sizeof(ProcessedDbImageSlot) ||
+            !InRange(header->heapOffset, header->heapSize, fileSize) ||
+            !InRange(header->folderOffset, header->folderCount * sizeof(ProcessedDbImageFolder), fileSize) ||
+            !InRange(header->entryOffset, header->entryCount * sizeof(ProcessedDbImageEntry), fileSize) ||
+            !InRange(header->slotOffset, slotCount * sizeof(ProcessedDbImageSlot), fileSize) ||
+            header->heapOffset != headerSize ||
+            header->folderOffset < header->heapOffset + header->heapSize ||
+            header->entryOffset != header->folderOffset + header->folderCount * sizeof(ProcessedDbImageFolder) ||
+            header->slotOffset != header->entryOffset + header->entryCount * sizeof(ProcessedDbImageEntry) ||
+            (header->version == 1 && fileSize != tablesEnd) ||
+            (header->version >= 2 && (header->timeOffset != tablesEnd ||
+                                      fileSize != tablesEnd + header->entryCount * sizeof(unsigned int)))) {
+            error = "intestazione non coerente";
+            return false;
+        }
+        const ProcessedDbImageFolder* folders = reinterpret_cast<const ProcessedDbImageFolder*>(view + header->folderOffset);
+        for (unsigned long long i = 0; i < header->folderCount; ++i) {
+            if (!InRange(folders[i].offset, folders[i].length, header->heapSize)) {
+                error = "tabella cartelle non coerente";
+                return false;
             }
-            
-            if (fni->NextEntryOffset == 0) break;
-            fni = (FILE_NOTIFY_INFORMATION*)((BYTE*)fni + fni->NextEntryOffset);
-            
-        } while (!monitor->stopRequested && !globalShutdown);
-        
-        // CORREZIONE: Check più frequenti per essere più reattivo
-        Sleep(50);
+        }
+        return true;
     }
     
-    // CORREZIONE: Cleanup sicuro dell'handle
-    if (monitor->directoryHandle != INVALID_HANDLE_VALUE) {
-        CloseHandle(monitor->directoryHandle);
-        monitor->directoryHandle = INVALID_HANDLE_VALUE;
+    unsigned int FindEntry(const std::string& path) const {
+        if (!header || header->slotCount == 0) return PROCESSED_DB_IMAGE_EMPTY;
+        unsigned long long fingerprint = ProcessedFileIndex::Fingerprint(path);
+        unsigned int tag = static_cast<unsigned int>(fingerprint >> 32);
+        size_t mask = static_cast<size_t>(header->slotCount) - 1;
+        // Il writer lascia sempre slot vuoti, ma Validate non scorre la tabella (l'apertura
+        // resta O(1)): su un file danneggiato senza slot vuoti il sondaggio si ferma dopo
+        // un giro completo invece di girare per sempre sotto processedFilesMutex
+        size_t slot = static_cast<size_t>(fingerprint) & mask;
+        for (size_t probe = 0; probe <= mask; ++probe, slot = (slot + 1) & mask) {
+            unsigned int entry = slots[slot].entry;
+            if (entry == PROCESSED_DB_IMAGE_EMPTY) return PROCESSED_DB_IMAGE_EMPTY;
+            if (slots[slot].tag == tag && Matches(entry, path)) return entry;
+        }
+        return PROCESSED_DB_IMAGE_EMPTY;
     }
     
-    monitor->active = false;
-    systemMetrics.activeThreads--;
-    WriteToLog("Worker monitoraggio terminato per: " + monitor->folderPath);
-}
-
-void StartAllFolderMonitors() {
-    std::map<std::string, std::vector<int>> folderPatterns;
-    for (size_t i = 0; i < patternCommandPairs.size(); ++i) {
-        std::string normalizedFolder = NormalizeFolderPath(patternCommandPairs[i].folderPath);
-        folderPatterns[normalizedFolder].push_back(static_cast<int>(i));
+    bool EntryValid(const ProcessedDbImageEntry& entry) const {
+        return entry.folder < header->folderCount && InRange(entry.nameOffset, entry.length, header->heapSize);
     }
     
-    WriteToLog("Avvio monitoraggio per " + std::to_string(folderPatterns.size()) + " cartelle");
+    bool EntryPath(size_t index, std::string& path) const {
+        if (index >= Size()) return false;
+        const ProcessedDbImageEntry& entry = entries[index];
+        if (!EntryValid(entry)) return false;
+        const ProcessedDbImageFolder& folder = folderTable[entry.folder];
+        path.assign(heap + folder.offset, folder.length);
+        if (folder.length > 0) path += '\\';
+        path.append(heap + entry.nameOffset, entry.length);
+        return true;
+    }
     
-    for (const auto& folderGroup : folderPatterns) {
-        if (globalShutdown) break;
+    bool Matches(unsigned int index, const std::string& path) const {
+        if (index >= Size()) return false;
+        const ProcessedDbImageEntry& entry = entries[index];
+        if (!EntryValid(entry)) return false;
+        const ProcessedDbImageFolder& folder = folderTable[entry.folder];
+        size_t prefix = folder.length > 0 ? folder.length + 1 : 0;
+        if (path.length() != prefix + entry.length) return false;
+        if (prefix > 0 && path[folder.length] != '\\') return false;
+        return ProcessedFileIndex::EqualsFolded(heap + entry.nameOffset, path.data() + prefix, entry.length) &&
+               ProcessedFileIndex::EqualsFolded(heap + folder.offset, path.data(), folder.length);
+    }
+};
+
+// Scrittura in streaming di un'immagine: l'heap va su disco a blocchi mentre le voci
+// arrivano; in memoria restano solo descrittori, istanti e slot (28 byte circa per voce).
+// Le voci devono essere gia' univoche (senza distinzione maiuscole/minuscole).
+class ProcessedDbImageWriter {
+public:
+    ProcessedDbImageWriter() : fileHandle(INVALID_HANDLE_VALUE), position(0), heapSize(0), failed(false) {}
+    ~ProcessedDbImageWriter() { Abort(); }
+    
+    bool Open(const std::string& path, size_t expectedEntries) {
+        fileHandle = CreateFile(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
         
-        std::string originalFolder = patternCommandPairs[folderGroup.second[0]].folderPath;
+        size_t capacity = 64;
+        while (capacity * 3 < (expectedEntries + 1) * 4) capacity <<= 1;
+        ProcessedDbImageSlot empty;
+        empty.tag = 0;
+        empty.entry = PROCESSED_DB_IMAGE_EMPTY;
+        slots.assign(capacity, empty);
+        entries.reserve(expectedEntries);
+        times.reserve(expectedEntries);
+        buffer.reserve(1 << 20);
         
-        if (!DirectoryExists(originalFolder)) {
-            if (!CreateDirectoryRecursive(originalFolder)) {
-                WriteToLog("ERRORE: Impossibile creare directory: " + originalFolder);
-                systemMetrics.errorsCount++;
-                continue;
-            }
+        // Intestazione provvisoria azzerata: un file interrotto non ha la firma
+        ProcessedDbImageHeader placeholder;
+        memset(&placeholder, 0, sizeof(placeholder));
+        Append(&placeholder, sizeof(placeholder));
+        return true;
+    }
+    
+    void Add(const std::string& path, unsigned int recorded) {
+        if (entries.size() + 1 >= PROCESSED_DB_IMAGE_EMPTY) {
+            failed = true;
+            return;
         }
+        // Crescita oltre la stima: la tabella slot viene ricostruita dalle impronte salvate
+        if ((entries.size() + 1) * 4 > slots.size() * 3) Grow();
         
-        // CORREZIONE: Scansione iniziale di TUTTI i file esistenti
-        WriteToLog("=== SCANSIONE INIZIALE CARTELLA: " + originalFolder + " ===");
-        ScanDirectoryForExistingFiles(originalFolder, folderGroup.second);
-        
-        if (globalShutdown) break;
+        size_t slash = path.find_last_of('\\');
+        std::string folder = (slash != std::string::npos) ? path.substr(0, slash) : std::string();
+        size_t nameStart = (slash != std::string::npos) ? slash + 1 : 0;
         
-        std::unique_ptr<FolderMonitor> monitor(new FolderMonitor(originalFolder));
-        monitor->patternIndices = folderGroup.second;
+        std::string key(folder);
+        for (auto& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        ProcessedDbImageEntry entry;
+        auto known = folderIds.find(key);
+        if (known != folderIds.end()) {
+            entry.folder = known->second;
+        } else {
+            ProcessedDbImageFolder descriptor;
+            descriptor.offset = AppendHeap(folder.data(), folder.length());
+            descriptor.length = static_cast<unsigned int>(folder.length());
+            descriptor.reserved = 0;
+            entry.folder = static_cast<unsigned int>(folders.size());
+            folders.push_back(descriptor);
+            folderIds[key] = entry.folder;
+        }
+        entry.length = static_cast<unsigned int>(path.length() - nameStart);
+        entry.nameOffset = AppendHeap(path.data() + nameStart, entry.length);
         
-        monitor->workerThread = std::thread(FolderMonitorWorker, monitor.get());
+        unsigned long long fingerprint = ProcessedFileIndex::Fingerprint(path);
+        fingerprints.push_back(fingerprint);
+        Place(fingerprint, static_cast<unsigned int>(entries.size()));
+        entries.push_back(entry);
+        times.push_back(recorded);
+    }
+    
+    // Scrive tabelle e intestazione; restituisce false se una scrittura e' fallita
+    bool Finish() {
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
         
-        WriteToLog("Monitor avviato per: " + originalFolder);
+        ProcessedDbImageHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, PROCESSED_DB_IMAGE_MAGIC, sizeof(header.magic));
+        header.version = PROCESSED_DB_IMAGE_VERSION;
+        header.headerSize = sizeof(header);
+        header.entryCount = entries.size();
+        header.folderCount = folders.size();
+        header.slotCount = entries.empty() ? 0 : slots.size();
+        header.heapOffset = sizeof(header);
+        header.heapSize = heapSize;
         
-        folderMonitors[folderGroup.first] = std::move(monitor);
+        Pad();
+        header.folderOffset = position;
+        Append(folders.data(), folders.size() * sizeof(ProcessedDbImageFolder));
+        header.entryOffset = header.folderOffset + folders.size() * sizeof(ProcessedDbImageFolder);
+        Append(entries.data(), entries.size() * sizeof(ProcessedDbImageEntry));
+        header.slotOffset = header.entryOffset + entries.size() * sizeof(ProcessedDbImageEntry);
+        if (!entries.empty()) Append(slots.data(), slots.size() * sizeof(ProcessedDbImageSlot));
+        header.timeOffset = header.slotOffset + header.slotCount * sizeof(ProcessedDbImageSlot);
+        Append(times.data(), times.size() * sizeof(unsigned int));
+        Flush();
+        header.fileSize = header.timeOffset + times.size() * sizeof(unsigned int);
         
-        Sleep(500);
+        LARGE_INTEGER start;
+        start.QuadPart = 0;
+        DWORD written = 0;
+        bool ok = !failed && SetFilePointerEx(fileHandle, start, NULL, FILE_BEGIN) &&
+                  WriteFile(fileHandle, &header, sizeof(header), &written, NULL) && written == sizeof(header) &&
+                  FlushFileBuffers(fileHandle);
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+        return ok;
     }
     
-    WriteToLog("Tutti i monitor avviati. Thread attivi: " + std::to_string(folderMonitors.size()));
-}
-
-void StopAllFolderMonitors() {
-    WriteToLog("Arresto di tutti i monitor cartelle...");
-    
-    // Fase 1: Segnala stop a tutti
-    for (auto& monitorPair : folderMonitors) {
-        monitorPair.second->stopRequested = true;
-        
-        // CORREZIONE: Chiudi handle directory per forzare uscita da ReadDirectoryChangesW
-        if (monitorPair.second->directoryHandle != INVALID_HANDLE_VALUE) {
-            CloseHandle(monitorPair.second->directoryHandle);
-            monitorPair.second->directoryHandle = INVALID_HANDLE_VALUE;
+    void Abort() {
+        if (fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
         }
     }
     
-    // Fase 2: Attendi terminazione con timeout
-    const int THREAD_TIMEOUT_MS = 3000;
-    auto startTime = GetTickCount();
+    size_t Count() const { return entries.size(); }
     
-    for (auto& monitorPair : folderMonitors) {
-        if (monitorPair.second->workerThread.joinable()) {
-            try {
-                // Calcola tempo rimanente
-                DWORD elapsed = GetTickCount() - startTime;
-                if (elapsed >= THREAD_TIMEOUT_MS) {
-                    WriteToLog("TIMEOUT: Terminazione forzata thread " + monitorPair.first);
-                    // Non fare join, lascia che il thread muoia
-                    monitorPair.second->workerThread.detach();
-                } else {
-                    // Prova join con timeout simulato
-                    bool joined = false;
-                    auto joinStart = GetTickCount();
-                    
-                    while (GetTickCount() - joinStart < 1000 && !joined) {
-                        if (monitorPair.second->workerThread.joinable()) {
-                            try {
-                                // Non c'è join_for in C++11, usa detach se necessario
-                                if (!monitorPair.second->active) {
-                                    monitorPair.second->workerThread.join();
-                                    joined = true;
-                                } else {
-                                    Sleep(100);
-                                }
-                            } catch (...) {
-                                WriteToLog("ERRORE join thread " + monitorPair.first);
-                                monitorPair.second->workerThread.detach();
-                                joined = true;
-                            }
-                        } else {
-                            joined = true;
-                        }
-                    }
-                    
-                    if (!joined) {
-                        WriteToLog("TIMEOUT join: Detach forzato thread " + monitorPair.first);
-                        monitorPair.second->workerThread.detach();
-                    }
-                }
-            } catch (const std::exception& e) {
-                WriteToLog("ERRORE durante join thread: " + std::string(e.what()));
-                monitorPair.second->workerThread.detach();
-            }
-        }
+private:
+    HANDLE fileHandle;
+    std::string buffer;
+    unsigned long long position;  // byte accodati al file finora
+    unsigned long long heapSize;
+    bool failed;
+    std::vector<ProcessedDbImageFolder> folders;
+    std::unordered_map<std::string, unsigned int> folderIds;
+    std::vector<ProcessedDbImageEntry> entries;
+    std::vector<unsigned int> times;
+    std::vector<unsigned long long> fingerprints;
+    std::vector<ProcessedDbImageSlot> slots;
+    
+    unsigned long long AppendHeap(const char* data, size_t length) {
+        unsigned long long offset = heapSize;
+        heapSize += length;
+        Append(data, length);
+        return offset;
     }
     
-    folderMonitors.clear();
-    WriteToLog("Tutti i monitor sono stati fermati");
-}
-
-void UpdateSystemMetrics() {
-    PROCESS_MEMORY_COUNTERS pmc;
-    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
-        systemMetrics.memoryUsageMB = pmc.WorkingSetSize / (1024 * 1024);
+    void Append(const void* data, size_t length) {
+        buffer.append(static_cast<const char*>(data), length);
+        position += length;
+        if (buffer.length() >= (1 << 20)) Flush();
     }
     
-    systemMetrics.activeThreads = 0;
-    for (const auto& monitor : folderMonitors) {
-        if (monitor.second->active) {
-            systemMetrics.activeThreads++;
-        }
+    // Allinea a 8 byte le tabelle che seguono l'heap
+    void Pad() {
+        static const char zeros[8] = {0};
+        size_t end = static_cast<size_t>(position % 8);
+        if (end != 0) Append(zeros, 8 - end);
     }
     
-    if (webServerRunning) systemMetrics.activeThreads++;
-}
-
-void MetricsUpdateWorker() {
-    WriteToLog("Avvio thread aggiornamento metriche");
-
-    while (!globalShutdown) {
-        UpdateSystemMetrics();
-        // Sleep frazionato per rispondere rapidamente a globalShutdown
-        for (int i = 0; i < 50 && !globalShutdown; ++i) {
-            Sleep(100);
+    void Flush() {
+        if (buffer.empty()) return;
+        DWORD written = 0;
+        if (failed || !WriteFile(fileHandle, buffer.data(), static_cast<DWORD>(buffer.length()), &written, NULL) ||
+            written != buffer.length()) {
+            failed = true;
         }
+        buffer.clear();
     }
-
-    WriteToLog("Thread aggiornamento metriche terminato");
-}
-
-std::string GetSystemMetricsJson() {
-    std::lock_guard<std::mutex> lock(metricsMutex);
     
-    auto now = std::chrono::steady_clock::now();
-    auto uptimeSeconds = std::chrono::duration_cast<std::chrono::seconds>(now - systemMetrics.serviceStartTime).count();
-    auto lastActivitySeconds = systemMetrics.lastFileProcessed != std::chrono::steady_clock::time_point{} ?
-        std::chrono::duration_cast<std::chrono::seconds>(now - systemMetrics.lastFileProcessed).count() : -1;
+    void Place(unsigned long long fingerprint, unsigned int entry) {
+        size_t mask = slots.size() - 1;
+        size_t slot = static_cast<size_t>(fingerprint) & mask;
+        while (slots[slot].entry != PROCESSED_DB_IMAGE_EMPTY) slot = (slot + 1) & mask;
+        slots[slot].tag = static_cast<unsigned int>(fingerprint >> 32);
+        slots[slot].entry = entry;
+    }
     
-    std::ostringstream json;
-    json << "{\n";
-    json << "  \"totalFilesProcessed\": " << systemMetrics.totalFilesProcessed.load() << ",\n";
-    json << "  \"filesProcessedToday\": " << systemMetrics.filesProcessedToday.load() << ",\n";
-    json << "  \"activeThreads\": " << systemMetrics.activeThreads.load() << ",\n";
-    json << "  \"memoryUsageMB\": " << systemMetrics.memoryUsageMB.load() << ",\n";
-    json << "  \"averageProcessingTime\": " << systemMetrics.averageProcessingTime.load() << ",\n";
-    json << "  \"commandsExecuted\": " << systemMetrics.commandsExecuted.load() << ",\n";
-    json << "  \"errorsCount\": " << systemMetrics.errorsCount.load() << ",\n";
-    json << "  \"uptimeSeconds\": " << uptimeSeconds << ",\n";
-    json << "  \"lastActivitySeconds\": " << lastActivitySeconds << ",\n";
-    json << "  \"foldersMonitored\": " << folderMonitors.size() << ",\n";
-    json << "  \"patternsConfigured\": " << patternCommandPairs.size() << ",\n";
-    json << "  \"webServerRunning\": " << (webServerRunning ? "true" : "false") << ",\n";
-    json << "  \"schedulerEnabled\": " << (schedulerEnabled ? "true" : "false") << ",\n";
-    json << "  \"schedulerTasks\": " << schedulerTasks.size() << ",\n";
-    json << "  \"folders\": [\n";
+    void Grow() {
+        ProcessedDbImageSlot empty;
+        empty.tag = 0;
+        empty.entry = PROCESSED_DB_IMAGE_EMPTY;
+        slots.assign(slots.size() * 2, empty);
+        for (size_t i = 0; i < fingerprints.size(); ++i) Place(fingerprints[i], static_cast<unsigned int>(i));
+    }
+};
+
+// Istante di registrazione delle voci: secondi Unix (32 bit senza segno, fino al 2106)
+unsigned int ProcessedTimestampNow() {
+    return static_cast<unsigned int>(std::time(NULL));
+}
+
+// Vista logica del database: immagine mappata (sola lettura) + overlay in memoria con i
+// file aggiunti dopo l'immagine + voci dell'immagine rimosse. L'overlay contiene solo
+// le differenze, cioe' il journal, e viene riassorbito a ogni compattazione. Una voce
+// dell'immagine rimossa e registrata di nuovo resta rimossa e torna tra le aggiunte,
+// con il nuovo istante di registrazione.
+class ProcessedFileStore {
+public:
+    ProcessedFileStore() : generation(0) {}
     
-    bool first = true;
-    for (const auto& monitor : folderMonitors) {
-        if (!first) json << ",\n";
-        json << "    {\n";
-        json << "      \"path\": \"" << EscapeJsonString(monitor.second->folderPath) << "\",\n";
-        json << "      \"active\": " << (monitor.second->active ? "true" : "false") << ",\n";
-        json << "      \"filesDetected\": " << monitor.second->filesDetected.load() << ",\n";
-        json << "      \"filesProcessed\": " << monitor.second->filesProcessed.load() << "\n";
-        json << "    }";
-        first = false;
+    bool Contains(const std::string& path) const {
+        unsigned int recorded = 0;
+        return Lookup(path, recorded);
     }
     
-    json << "\n  ],\n";
-    json << "  \"patterns\": [\n";
+    bool Lookup(const std::string& path, unsigned int& recorded) const {
+        if (added.Lookup(path, recorded)) return true;
+        return image.Lookup(path, recorded) && !removed.Contains(path);
+    }
     
-    first = true;
-    std::lock_guard<std::mutex> patternLock(patternStatsMutex);
-    for (const auto& pattern : patternCommandPairs) {
-        if (!first) json << ",\n";
-        json << "    {\n";
-        json << "      \"name\": \"" << EscapeJsonString(pattern.patternName) << "\",\n";
-        json << "      \"folder\": \"" << EscapeJsonString(pattern.folderPath) << "\",\n";
-        json << "      \"regex\": \"" << EscapeJsonString(pattern.patternRegex) << "\",\n";
-        json << "      \"matchCount\": " << patternMatchCounts[pattern.patternName] << ",\n";
-        json << "      \"executionCount\": " << patternExecutionCounts[pattern.patternName] << "\n";
-        json << "    }";
-        first = false;
+    bool Insert(const std::string& path, unsigned int recorded = 0) {
+        if (Contains(path)) return false;
+        return added.Insert(path, recorded);
     }
     
-    json << "\n  ],\n";
-    json << "  \"recentActivity\": [\n";
+    bool Erase(const std::string& path) {
+        bool erased = added.Erase(path);
+        if (image.Contains(path) && removed.Insert(path)) erased = true;
+        return erased;
+    }
     
-    first = true;
-    for (const auto& activity : systemMetrics.recentActivity) {
-        if (!first) json << ",\n";
-        auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(activity.second.time_since_epoch()).count();
-        json << "    {\n";
-        json << "      \"message\": \"" << EscapeJsonString(activity.first) << "\",\n";
-        json << "      \"timestamp\": " << timestamp << "\n";
-        json << "    }";
-        first = false;
+    // Chiude anche l'immagine
+    void Clear() {
+        image.Close();
+        added.Clear();
+        removed.Clear();
+        generation++;
     }
     
-    json << "\n  ]\n";
-    json << "}";
+    size_t Size() const { return image.Size() - removed.Size() + added.Size(); }
     
-    return json.str();
-}
-
-// ====== IMPLEMENTAZIONE SCHEDULATORE ======
-
-std::string SanitizeFilename(const std::string& name) {
-    std::string safe;
-    for (char c : name) {
-        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-') {
-            safe += c;
-        } else if (c == ' ') {
-            safe += '_';
-        }
+    template <typename Visitor>
+    void ForEachRecorded(Visitor visit) const {
+        const ProcessedFileIndex& skip = removed;
+        image.ForEachRecorded([&skip, &visit](const std::string& path, unsigned int recorded) {
+            if (!skip.Contains(path)) visit(path, recorded);
+        });
+        added.ForEachRecorded(visit);
     }
-    return safe.empty() ? "unnamed" : safe;
-}
-
-int DayNameToNumber(const std::string& dayName) {
-    if (dayName == "Do" || dayName == "do" || dayName == "DO") return 0;
-    if (dayName == "Lu" || dayName == "lu" || dayName == "LU") return 1;
-    if (dayName == "Ma" || dayName == "ma" || dayName == "MA") return 2;
-    if (dayName == "Me" || dayName == "me" || dayName == "ME") return 3;
-    if (dayName == "Gi" || dayName == "gi" || dayName == "GI") return 4;
-    if (dayName == "Ve" || dayName == "ve" || dayName == "VE") return 5;
-    if (dayName == "Sa" || dayName == "sa" || dayName == "SA") return 6;
-    return -1;
-}
-
-std::string DayNumberToName(int dayNum) {
-    switch (dayNum) {
-        case 0: return "Do";
-        case 1: return "Lu";
-        case 2: return "Ma";
-        case 3: return "Me";
-        case 4: return "Gi";
-        case 5: return "Ve";
-        case 6: return "Sa";
-        default: return "?";
+    
+    template <typename Visitor>
+    void ForEach(Visitor visit) const {
+        ForEachRecorded([&visit](const std::string& path, unsigned int) { visit(path); });
     }
-}
+    
+    ProcessedDbImage image;
+    ProcessedFileIndex added;
+    ProcessedFileIndex removed;
+    size_t generation;  // incrementata a ogni sostituzione dell'immagine
+};
 
-std::string GetHttpRequestBody(const std::string& request) {
-    size_t bodyStart = request.find("\r\n\r\n");
-    if (bodyStart == std::string::npos) return "";
-    return request.substr(bodyStart + 4);
-}
+// Gestione dei file processati con thread safety
+ProcessedFileStore processedFiles;
+std::set<std::string> recentlyIgnoredFiles;
+HANDLE processedJournalHandle = INVALID_HANDLE_VALUE;
+std::atomic<size_t> processedJournalRecords{0};
+std::atomic<size_t> processedEvictedExpired{0};
+std::atomic<size_t> processedEvictedMissing{0};
+std::atomic<unsigned long long> processedBytesReclaimed{0};
+
+// Statistiche per cartella condivise tra watcher ed esecutori (sopravvivono al monitor)
+struct FolderStats {
+    std::atomic<size_t> filesProcessed{0};
+    std::atomic<size_t> queueDepth{0};
+    std::atomic<size_t> jobsCompleted{0};
+    std::atomic<unsigned long long> totalWaitMs{0};
+    std::atomic<size_t> maxWaitMs{0};
+    std::atomic<size_t> eventsReceived{0};
+    std::atomic<size_t> eventsCoalesced{0};
+    std::atomic<size_t> overflows{0};
+    std::atomic<size_t> reconciliations{0};
+    std::atomic<size_t> filesReconciled{0};
+};
 
-std::string ExtractJsonValue(const std::string& json, const std::string& key) {
-    std::string searchKey = "\"" + key + "\"";
-    size_t keyPos = json.find(searchKey);
-    if (keyPos == std::string::npos) return "";
+// Stato di un file al momento in cui e' stato valutato
+struct FileStamp {
+    unsigned long long size;
+    unsigned long long lastWrite;
+};
 
-    size_t colonPos = json.find(':', keyPos + searchKey.length());
-    if (colonPos == std::string::npos) return "";
+// Istantanea dei file gia' chiusi di una cartella (vedi ISTANTANEE CARTELLE)
+struct FolderSnapshot {
+    std::mutex mutex;
+    std::unordered_map<unsigned long long, FileStamp> entries;  // hash nome maiuscolo -> stato
+    unsigned long long patternHash;
+    bool dirty;
+    
+    FolderSnapshot() : patternHash(0), dirty(false) {}
+};
 
-    size_t valueStart = json.find_first_not_of(" \t\n\r", colonPos + 1);
-    if (valueStart == std::string::npos) return "";
+std::mutex folderSnapshotsMutex;
+std::map<std::string, std::shared_ptr<FolderSnapshot>> folderSnapshots;  // chiave: cartella normalizzata
 
-    if (json[valueStart] == '"') {
-        std::string result;
-        for (size_t i = valueStart + 1; i < json.length(); ++i) {
-            if (json[i] == '\\' && i + 1 < json.length()) {
-                result += json[i + 1];
-                ++i;
-            } else if (json[i] == '"') {
-                break;
-            } else {
-                result += json[i];
-            }
+// Struttura per monitoraggio cartella
+struct FolderMonitor;
+typedef void (*FolderEventCallback)(FolderMonitor* monitor, DWORD action, const std::string& filename);
+
+struct FolderMonitor {
+    std::string folderPath;
+    std::string normalizedPath;
+    std::vector<int> patternIndices;
+    std::atomic<bool> active;
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> ioPending;       // ReadDirectoryChangesW overlapped in corso
+    HANDLE directoryHandle;
+    OVERLAPPED overlapped;
+    std::vector<BYTE> notifyBuffer;    // allocato su heap, allineato a DWORD
+    FolderEventCallback eventCallback;
+    std::atomic<size_t> filesDetected{0};
+    std::shared_ptr<FolderStats> stats;
+    FolderPatternMatcher* matcher;     // posseduto da folderMatchers
+    int debounceMs;
+    std::atomic<bool> reconcilePending{false};
+    
+    FolderMonitor(const std::string& path) : folderPath(path), active(false), 
+        stopRequested(false), ioPending(false), directoryHandle(INVALID_HANDLE_VALUE),
+        notifyBuffer(static_cast<size_t>(notificationBufferKB) * 1024), eventCallback(NULL), 
+        stats(std::make_shared<FolderStats>()), matcher(NULL), debounceMs(DEFAULT_DEBOUNCE_MS) {
+        ZeroMemory(&overlapped, sizeof(overlapped));
+        normalizedPath = path;
+        std::replace(normalizedPath.begin(), normalizedPath.end(), '/', '\\');
+        if (!normalizedPath.empty() && normalizedPath.back() == '\\') {
+            normalizedPath.pop_back();
         }
-        return result;
-    } else {
-        size_t valueEnd = json.find_first_of(",} \t\n\r", valueStart);
-        if (valueEnd == std::string::npos) return json.substr(valueStart);
-        return json.substr(valueStart, valueEnd - valueStart);
+        std::transform(normalizedPath.begin(), normalizedPath.end(), normalizedPath.begin(), ::toupper);
     }
-}
+    
+    ~FolderMonitor() {
+        stopRequested = true;
+        if (directoryHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(directoryHandle);
+        }
+    }
+};
 
-bool LoadSchedulerTasks() {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    schedulerTasks.clear();
+std::map<std::string, std::unique_ptr<FolderMonitor>> folderMonitors;
 
-    if (!DirectoryExists(schedulerFolder)) {
-        CreateDirectoryRecursive(schedulerFolder);
-        WriteToLog("Creata cartella schedulatore: " + schedulerFolder);
+// Motore watcher: tutte le cartelle condividono una completion port servita da un pool fisso
+HANDLE watcherCompletionPort = NULL;
+std::vector<std::thread> watcherPoolThreads;
+std::atomic<int> watcherThreadsRunning{0};
+
+// Coda limitata multi-produttore/multi-consumatore: Push blocca quando piena
+// (backpressure verso i watcher), Pop blocca quando vuota. Close sblocca tutti.
+template <typename T>
+struct BoundedQueue {
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    
+    explicit BoundedQueue(size_t cap = DEFAULT_EXECUTOR_QUEUE_SIZE) : capacity(cap > 0 ? cap : 1), closed(false) {}
+    
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
         return true;
     }
-
-    WIN32_FIND_DATA findData;
-    std::string searchPath = schedulerFolder + "\\*.sch";
-    HANDLE hFind = FindFirstFile(searchPath.c_str(), &findData);
-
-    if (hFind == INVALID_HANDLE_VALUE) {
-        WriteToLog("Nessun task schedulato trovato in: " + schedulerFolder);
+    
+    bool Pop(T& out) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (closed) return false;
+        out = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
         return true;
     }
+    
+    void Open(size_t cap) {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = cap > 0 ? cap : 1;
+        items.clear();
+        closed = false;
+    }
+    
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+    
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+};
 
-    do {
-        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
-
-        std::string filePath = schedulerFolder + "\\" + findData.cFileName;
-        std::ifstream file(filePath.c_str());
-        if (!file.is_open()) continue;
+// Esito di un processo figlio consegnato dal supervisore processi
+struct ProcessExit {
+    HANDLE process;     // valido solo durante la callback
+    DWORD exitCode;     // STILL_ACTIVE se timedOut o waitFailed
+    bool timedOut;
+    bool waitFailed;
+    long long durationMs;
+};
 
-        SchedulerTask task;
-        std::string line;
+typedef std::function<void(const ProcessExit&)> ProcessExitCallback;
 
-        while (std::getline(file, line)) {
-            if (line.empty() || line[0] == '#') continue;
+// File in attesa in un gruppo di micro-batch
+struct BatchEntry {
+    std::string fullPath;
+    std::shared_ptr<FolderStats> stats;
+    bool executed;
+    
+    BatchEntry(const std::string& path, const std::shared_ptr<FolderStats>& folderStats)
+        : fullPath(path), stats(folderStats), executed(false) {}
+};
 
-            size_t eqPos = line.find('=');
-            if (eqPos == std::string::npos) continue;
+// Job di esecuzione prodotto dai watcher e consumato dal pool esecutori.
+// Con batch non vuoto il job e' un gruppo scaduto accodato dal thread micro-batch
+struct ExecutionJob {
+    std::string fullPath;
+    int patternIndex;
+    std::shared_ptr<FolderStats> stats;
+    std::chrono::steady_clock::time_point enqueuedAt;
+    std::vector<BatchEntry> batch;
+    
+    ExecutionJob() : patternIndex(-1) {}
+};
 
-            std::string key = line.substr(0, eqPos);
-            std::string value = line.substr(eqPos + 1);
+BoundedQueue<ExecutionJob> executorQueue;
+std::vector<std::thread> executorThreads;
+std::atomic<int> executorThreadsRunning{0};
+std::mutex pendingJobsMutex;
+std::set<std::string> pendingJobKeys;  // path|pattern gia' in coda o in esecuzione
 
-            key.erase(0, key.find_first_not_of(" \t"));
-            key.erase(key.find_last_not_of(" \t") + 1);
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t") + 1);
+// Gruppi micro-batch in accumulo, per indice pattern
+struct PendingBatch {
+    std::vector<BatchEntry> entries;
+    std::chrono::steady_clock::time_point deadline;  // fissata dal primo file del gruppo
+};
 
-            if (key == "Name") {
-                task.name = value;
-            } else if (key == "Enabled") {
-                task.enabled = (value == "true" || value == "1");
-            } else if (key == "Days") {
-                std::istringstream ss(value);
-                std::string day;
-                while (std::getline(ss, day, ',')) {
-                    day.erase(0, day.find_first_not_of(" \t"));
-                    day.erase(day.find_last_not_of(" \t") + 1);
-                    int dayNum = DayNameToNumber(day);
-                    if (dayNum >= 0) task.days.insert(dayNum);
-                }
-            } else if (key == "Hours") {
-                std::istringstream ss(value);
-                std::string hour;
-                while (std::getline(ss, hour, ',')) {
-                    hour.erase(0, hour.find_first_not_of(" \t"));
-                    hour.erase(hour.find_last_not_of(" \t") + 1);
-                    try {
-                        int h = std::stoi(hour);
-                        if (h >= 0 && h <= 23) task.hours.insert(h);
-                    } catch (...) {}
-                }
-            } else if (key == "Minutes") {
-                std::istringstream ss(value);
-                std::string minute;
-                while (std::getline(ss, minute, ',')) {
-                    minute.erase(0, minute.find_first_not_of(" \t"));
-                    minute.erase(minute.find_last_not_of(" \t") + 1);
-                    try {
-                        int m = std::stoi(minute);
-                        if (m >= 0 && m <= 59) task.minutes.insert(m);
-                    } catch (...) {}
-                }
-            } else if (key == "Command") {
-                task.command = value;
-            } else if (key == "Interval") {
-                try { task.intervalSeconds = std::stoi(value); } catch (...) { task.intervalSeconds = 0; }
-            }
-        }
+std::mutex batchMutex;
+std::condition_variable batchCondition;
+std::map<int, PendingBatch> pendingBatches;
+bool batcherRunning = false;  // protetto da batchMutex
+std::thread batcherThread;
+
+// Stadio di debounce: entry per percorso e timer wheel delle scadenze
+struct DebounceEntry {
+    std::string fullPath;
+    std::string filename;
+    FolderPatternMatcher* matcher;
+    std::shared_ptr<FolderStats> stats;
+    std::chrono::steady_clock::time_point deadline;  // spostata in avanti a ogni nuovo evento
+    
+    DebounceEntry() : matcher(NULL) {}
+};
 
-        file.close();
+std::mutex debounceMutex;
+std::condition_variable debounceCondition;
+std::unordered_map<std::string, DebounceEntry> debounceEntries;  // chiave: percorso maiuscolo
+std::vector<std::vector<std::pair<std::string, unsigned long long>>> debounceWheel;  // chiave, tick di scadenza
+std::chrono::steady_clock::time_point debounceEpoch;
+unsigned long long debounceCurrentTick = 0;
+bool debounceRunning = false;          // protetto da debounceMutex
+std::thread debounceThread;
+std::atomic<size_t> eventsCoalescedTotal{0};
+
+// Riconciliazione cartelle dopo overflow del buffer di notifica
+std::mutex reconcileMutex;
+std::condition_variable reconcileCondition;
+std::deque<FolderMonitor*> reconcileQueue;
+std::atomic<bool> reconcileRunning{false};
+std::thread reconcileThread;
+std::atomic<size_t> notificationOverflowsTotal{0};
+
+// Schedulatore (SchedulerTask e la coda delle scadenze sono in PatternTriggerCore.h)
+struct SchedulerExecution {
+    std::string taskName;
+    std::string timestamp;
+    std::string command;
+    int exitCode;
+    bool success;
+};
 
-        if (!task.name.empty() && !task.command.empty()) {
-            task.lastIntervalRun = std::chrono::steady_clock::now();
-            schedulerTasks.push_back(task);
-            WriteToLog("Task schedulato caricato: " + task.name, true);
-        }
-    } while (FindNextFile(hFind, &findData));
+std::vector<SchedulerTask> schedulerTasks;
+std::vector<SchedulerExecution> schedulerHistory;
+#define MAX_SCHEDULER_HISTORY 200
+std::thread schedulerThread;
+std::condition_variable schedulerCondition;   // task modificati o arresto (con schedulerMutex)
+unsigned long long schedulerRevision = 0;     // incrementato a ogni modifica dei task
 
-    FindClose(hFind);
+// Web Server
+std::thread webServerThread;
+std::atomic<bool> webServerRunning{false};
+std::atomic<bool> webServerShouldStop{false};
+std::atomic<int> httpActiveConnections{0};
+std::atomic<size_t> httpRequestsServed{0};
 
-    WriteToLog("Task schedulati caricati: " + std::to_string(schedulerTasks.size()));
-    return true;
-}
+// Eventi per /api/events: i produttori accodano, il thread del web server distribuisce
+enum ServerEventTopic { TopicMetrics = 1, TopicActivity = 2, TopicScheduler = 4, TopicAll = 7 };
 
-bool SaveSchedulerTask(const SchedulerTask& task) {
-    if (task.name.empty()) return false;
+struct ServerEvent {
+    int topic;
+    std::string name;
+    std::string data;
+};
 
-    if (!DirectoryExists(schedulerFolder)) {
-        CreateDirectoryRecursive(schedulerFolder);
-    }
+std::mutex serverEventMutex;
+std::deque<ServerEvent> serverEventQueue;
+std::atomic<bool> serverEventsLost{false};
+std::atomic<int> serverEventSubscribers{0};
 
-    std::string filename = SanitizeFilename(task.name) + ".sch";
-    std::string filePath = schedulerFolder + "\\" + filename;
+// ====== DICHIARAZIONI FUNZIONI ======
 
-    std::ofstream file(filePath.c_str());
-    if (!file.is_open()) {
-        WriteToLog("ERRORE: Impossibile salvare task schedulato: " + filePath);
-        return false;
-    }
-
-    file << "# PatternTriggerCommand - Task Schedulato\n";
-    file << "Name=" << task.name << "\n";
-    file << "Enabled=" << (task.enabled ? "true" : "false") << "\n";
-
-    file << "Days=";
-    bool first = true;
-    for (int d : task.days) {
-        if (!first) file << ",";
-        file << DayNumberToName(d);
-        first = false;
-    }
-    file << "\n";
-
-    file << "Hours=";
-    first = true;
-    for (int h : task.hours) {
-        if (!first) file << ",";
-        file << h;
-        first = false;
-    }
-    file << "\n";
+std::string GetTimestamp();
+void FormatTimestamp(const SYSTEMTIME& st, char* out);
+void WriteToLog(const std::string& message, bool detailed = false);
+void StartLogger();
+void StopLogger();
+void RequestLogReopen();
+std::string NormalizeFolderPath(const std::string& path);
+std::string EscapeJsonString(const std::string& input);
+bool FileExists(const std::string& filename);
+bool DirectoryExists(const std::string& path);
+bool CreateDirectoryRecursive(const std::string& path);
+bool IsFileInUse(const std::string& filePath);
+bool WaitForFileAvailability(const std::string& filePath, int maxWaitTimeMs = 20000);
+void LoadProcessedFiles();
+void SaveProcessedFiles();
+bool IsFileAlreadyProcessed(const std::string& fullFilePath);
+void MarkFileAsProcessed(const std::string& fullFilePath, const std::vector<std::string>& keys);
+void MarkFilesAsProcessed(const std::vector<std::string>& fullFilePaths, const std::vector<std::string>& keys);
+bool RecordProcessedFile(const std::string& fullFilePath);
+size_t RecordProcessedFiles(const std::vector<std::string>& fullFilePaths);
+void UnmarkFileAsProcessed(const std::string& fullFilePath);
+void ForgetProcessedKey(const std::string& key);
+bool CompactProcessedFiles();
+void ProcessedDbCompactionWorker();
+bool LoadConfiguration();
+void ApplyPatternOptions(PatternCommandPair& pair, const std::string& options);
+bool ParseBuiltinAction(PatternCommandPair& pair);
+bool ExecuteBuiltinAction(const PatternCommandPair& pair, const std::string& fullPath, bool& fileRemains);
+std::vector<int> FindMatchingPatterns(const std::string& filename, const std::string& folderPath);
+void BuildFolderMatchers();
+FolderPatternMatcher* FindFolderMatcher(const std::string& normalizedFolder);
+std::vector<int> MatchFolderPatterns(FolderPatternMatcher* matcher, const std::string& filename);
+bool ExecuteCommand(const std::string& command, const std::string& parameter, const std::string& patternName);
+bool StartCommand(const std::string& command, const std::string& parameter, const std::string& patternName,
+                  std::function<void(bool)> onDone);
+bool StartBatchCommand(const PatternCommandPair& pair, std::vector<std::string> files,
+                       std::function<void(bool, const std::vector<std::string>&)> onDone);
+bool AcquireProcessSlot();
+void ReleaseProcessSlot();
+void SuperviseProcess(const PROCESS_INFORMATION& pi, DWORD timeoutMs, bool ownsSlot, ProcessExitCallback onExit);
+void WaitForSupervisedProcesses(DWORD timeoutMs);
+void ScanDirectoryForExistingFiles(const std::string& folderPath, const std::vector<int>& patternIndices,
+                                   FolderMonitor* monitor = NULL);
+bool StartWatcherEngine(int threadCount);
+void StopWatcherEngine();
+void WatcherPoolWorker();
+bool AttachFolderMonitor(FolderMonitor* monitor);
+bool ArmFolderMonitor(FolderMonitor* monitor);
+void DispatchFolderNotifications(FolderMonitor* monitor, DWORD bytesTransferred);
+void ProcessFolderEvent(FolderMonitor* monitor, DWORD action, const std::string& filename);
+bool StartExecutorPool(int threadCount, int queueSize);
+void StopExecutorPool();
+void ExecutorWorker();
+bool EnqueueExecutionJob(const std::string& fullPath, int patternIndex, const std::shared_ptr<FolderStats>& stats);
+void ReleaseExecutionJobKey(const std::string& fullPath, int patternIndex);
+bool LaunchExecutionJob(const ExecutionJob& job);
+bool ExecuteResidentCommand(int patternIndex, const std::string& fullPath);
+void StopResidentWorkers();
+bool StartBatcher();
+void StopBatcher();
+void BatchFlushWorker();
+bool AddToPatternBatch(const ExecutionJob& job, std::vector<BatchEntry>& ready);
+void RunPatternBatch(int patternIndex, std::vector<BatchEntry>& entries);
+void CompletePatternBatch(int patternIndex, const std::vector<BatchEntry>& entries, bool success);
+bool StartDebouncer();
+void StopDebouncer();
+void DebounceWorker();
+void SubmitFileEvent(FolderMonitor* monitor, const std::string& filename);
+void DispatchReadyFile(const std::string& fullPath, const std::string& filename,
+                       FolderPatternMatcher* matcher, const std::shared_ptr<FolderStats>& stats);
+void HandleNotificationOverflow(FolderMonitor* monitor);
+void QueueFolderReconciliation(FolderMonitor* monitor);
+bool StartReconciler();
+void StopReconciler();
+void ReconcileWorker();
+void ReconcileFolder(FolderMonitor* monitor);
+double ElapsedMs(const std::chrono::steady_clock::time_point& start);
+unsigned long long HashFileName(const char* name);
+unsigned long long ComputePatternSetHash(const std::vector<int>& patternIndices);
+FileStamp MakeFileStamp(const WIN32_FIND_DATA& findData);
+std::shared_ptr<FolderSnapshot> GetFolderSnapshot(const std::string& normalizedFolder);
+bool LoadFolderSnapshot(const std::string& normalizedFolder, unsigned long long patternHash,
+                        std::unordered_map<unsigned long long, FileStamp>& entries);
+void RecordSnapshotEntry(const std::string& fullPath);
+void SaveAllFolderSnapshots();
+void DeleteAllFolderSnapshots();
+void StartAllFolderMonitors();
+void StopAllFolderMonitors();
+void UpdateSystemMetrics();
+void MetricsUpdateWorker();
+std::shared_ptr<const MetricsSnapshot> CurrentMetricsSnapshot();
+std::string GetSystemMetricsJson();
+std::string GetDashboardHtml();
+HttpBuffer HandleHttpRequest(const HttpRequest& request);
+void WebServerWorker();
+void ServeHttpConnections(SOCKET serverSocket, const std::atomic<bool>& stopRequested);
+void PublishServerEvent(int topic, const char* name, const std::string& data);
+DWORD WINAPI ServiceWorkerThread(LPVOID lpParam);
+void WINAPI ServiceCtrlHandler(DWORD ctrlCode);
+void WINAPI ServiceMain(DWORD argc, LPTSTR *argv);
+BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType);
 
-    file << "Minutes=";
-    first = true;
-    for (int m : task.minutes) {
-        if (!first) file << ",";
-        file << m;
-        first = false;
-    }
-    file << "\n";
+// Scheduler
+std::string SanitizeFilename(const std::string& name);
+int DayNameToNumber(const std::string& dayName);
+std::string DayNumberToName(int dayNum);
+bool LoadSchedulerTasks();
+bool SaveSchedulerTask(const SchedulerTask& task);
+bool DeleteSchedulerTask(const std::string& name);
+void SchedulerWorker();
+void RecordSchedulerExecution(const std::string& taskName, const std::string& command, int exitCode, bool success);
+std::string GetSchedulerJson();
+std::string GetSchedulerScriptsJson();
+std::string GetSchedulerPageHtml();
 
-    file << "Command=" << task.command << "\n";
-    file << "Interval=" << task.intervalSeconds << "\n";
-    file.close();
+// ====== IMPLEMENTAZIONE FUNZIONI ======
 
-    WriteToLog("Task schedulato salvato: " + task.name);
-    return true;
+// Formatta "YYYY-MM-DD hh:mm:ss.mmm" (23 caratteri + terminatore)
+void FormatTimestamp(const SYSTEMTIME& st, char* out) {
+    snprintf(out, 24, "%04u-%02u-%02u %02u:%02u:%02u.%03u",
+             st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
 }
 
-bool DeleteSchedulerTask(const std::string& name) {
-    // Trova e rimuovi il file .sch corrispondente
-    std::string filename = SanitizeFilename(name) + ".sch";
-    std::string filePath = schedulerFolder + "\\" + filename;
-
-    if (DeleteFile(filePath.c_str())) {
-        std::lock_guard<std::mutex> lock(schedulerMutex);
-        schedulerTasks.erase(
-            std::remove_if(schedulerTasks.begin(), schedulerTasks.end(),
-                [&name](const SchedulerTask& t) { return t.name == name; }),
-            schedulerTasks.end()
-        );
-        WriteToLog("Task schedulato eliminato: " + name);
-        return true;
-    }
-
-    WriteToLog("ERRORE: Impossibile eliminare task: " + name);
-    return false;
+std::string GetTimestamp() {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    
+    char buffer[24];
+    FormatTimestamp(st, buffer);
+    return std::string(buffer, 23);
 }
 
-void RecordSchedulerExecution(const std::string& taskName, const std::string& command, int exitCode, bool success) {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    SchedulerExecution exec;
-    exec.taskName = taskName;
-    exec.timestamp = GetTimestamp();
-    exec.command = command;
-    exec.exitCode = exitCode;
-    exec.success = success;
-    schedulerHistory.push_back(exec);
-    if (schedulerHistory.size() > MAX_SCHEDULER_HISTORY) {
-        schedulerHistory.erase(schedulerHistory.begin());
+// ====== LOGGER ASINCRONO ======
+// I produttori (WriteToLog) non prendono lock e non toccano il disco: catturano
+// l'istante (GetSystemTimeAsFileTime) e inseriscono il record in un ring buffer
+// lock-free limitato. Un solo thread writer svuota il ring a blocchi, formatta i
+// timestamp con una cache per millisecondo e scrive con handle sempre aperti.
+// Politica di overflow: con ring pieno il record piu' recente viene scartato e
+// contato; il writer registra poi quanti messaggi sono andati persi.
+
+// Cache del timestamp: ricalcola la data solo al cambio di secondo,
+// al cambio di millisecondo aggiorna solo le ultime tre cifre
+struct CachedTimestampFormatter {
+    unsigned long long cachedSecond;
+    unsigned long long cachedMillisecond;
+    char text[24];
+    
+    CachedTimestampFormatter() : cachedSecond(~0ULL), cachedMillisecond(~0ULL) { text[0] = '\0'; }
+    
+    const char* Format(const FILETIME& utc) {
+        ULARGE_INTEGER ticks;
+        ticks.LowPart = utc.dwLowDateTime;
+        ticks.HighPart = utc.dwHighDateTime;
+        unsigned long long ms = ticks.QuadPart / 10000ULL;
+        
+        if (ms == cachedMillisecond) return text;
+        
+        if (ms / 1000ULL != cachedSecond) {
+            FILETIME local;
+            SYSTEMTIME st;
+            FileTimeToLocalFileTime(&utc, &local);
+            FileTimeToSystemTime(&local, &st);
+            FormatTimestamp(st, text);
+            cachedSecond = ms / 1000ULL;
+        } else {
+            unsigned int millis = static_cast<unsigned int>(ms % 1000ULL);
+            text[20] = static_cast<char>('0' + millis / 100);
+            text[21] = static_cast<char>('0' + (millis / 10) % 10);
+            text[22] = static_cast<char>('0' + millis % 10);
+        }
+        cachedMillisecond = ms;
+        return text;
     }
-}
-
-void SchedulerExecuteTask(const std::string& cmd, const std::string& taskName) {
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    ZeroMemory(&pi, sizeof(pi));
-
-    std::string cmdLine = "cmd.exe /C \"" + cmd + "\"";
-
-    if (CreateProcess(NULL, const_cast<LPSTR>(cmdLine.c_str()),
-                     NULL, NULL, FALSE, CREATE_NO_WINDOW,
-                     NULL, NULL, &si, &pi)) {
-        WaitForSingleObject(pi.hProcess, BATCH_TIMEOUT);
-
-        DWORD exitCode = 0;
-        GetExitCodeProcess(pi.hProcess, &exitCode);
-
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
+};
 
-        WriteToLog("Schedulatore: Task '" + taskName +
-                 "' completato con codice: " + std::to_string(exitCode));
-        RecordSchedulerExecution(taskName, cmd, static_cast<int>(exitCode), exitCode == 0);
-    } else {
-        DWORD err = GetLastError();
-        WriteToLog("ERRORE Schedulatore: Impossibile eseguire task '" +
-                 taskName + "': " + std::to_string(err));
-        RecordSchedulerExecution(taskName, cmd, static_cast<int>(err), false);
-    }
+HANDLE OpenLogForAppend(const std::string& path) {
+    return CreateFile(path.c_str(), FILE_APPEND_DATA,
+                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                      NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
 }
 
-void SchedulerWorker() {
-    WriteToLog("Avvio thread schedulatore");
+void WriteLogBatch(HANDLE handle, const std::string& batch) {
+    if (handle == INVALID_HANDLE_VALUE || batch.empty()) return;
+    DWORD written = 0;
+    WriteFile(handle, batch.data(), static_cast<DWORD>(batch.length()), &written, NULL);
+}
 
-    while (!globalShutdown) {
-        if (!schedulerEnabled) {
-            for (int i = 0; i < 150 && !globalShutdown; ++i) Sleep(100);
-            continue;
+void LogWriterWorker() {
+    CachedTimestampFormatter formatter;
+    HANDLE logHandle = INVALID_HANDLE_VALUE;
+    HANDLE detailedHandle = INVALID_HANDLE_VALUE;
+    unsigned int openedGeneration = ~0u;
+    bool writeDetailed = true;
+    
+    std::string batch;
+    std::string detailedBatch;
+    std::vector<std::string> activity;
+    batch.reserve(64 * 1024);
+    detailedBatch.reserve(64 * 1024);
+    
+    LogRecord record;
+    
+    while (true) {
+        bool stopping = logWriterStop.load();
+        
+        // Riapre i file se la configurazione ha cambiato i percorsi
+        if (openedGeneration != logConfigGeneration.load()) {
+            std::string mainPath, detailedPath;
+            {
+                std::lock_guard<std::mutex> lock(configMutex);
+                openedGeneration = logConfigGeneration.load();
+                mainPath = logFile;
+                detailedPath = detailedLogFile;
+                writeDetailed = detailedLogging;
+            }
+            if (logHandle != INVALID_HANDLE_VALUE) CloseHandle(logHandle);
+            if (detailedHandle != INVALID_HANDLE_VALUE) CloseHandle(detailedHandle);
+            logHandle = OpenLogForAppend(mainPath);
+            detailedHandle = writeDetailed ? OpenLogForAppend(detailedPath) : INVALID_HANDLE_VALUE;
         }
-
-        SYSTEMTIME st;
-        GetLocalTime(&st);
-
-        int currentDay = st.wDayOfWeek;
-        int currentHour = st.wHour;
-        int currentMinute = st.wMinute;
-        int currentDayOfYear = st.wDay + st.wMonth * 31;
-        auto now = std::chrono::steady_clock::now();
-
-        {
-            std::lock_guard<std::mutex> lock(schedulerMutex);
-            for (auto& task : schedulerTasks) {
-                if (!task.enabled) continue;
-
-                bool shouldFire = false;
-
-                if (task.intervalSeconds > 0) {
-                    // Modalita' intervallo: ripeti ogni N secondi
-                    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - task.lastIntervalRun).count();
-                    if (elapsed >= task.intervalSeconds) {
-                        shouldFire = true;
-                        task.lastIntervalRun = now;
-                    }
-                } else {
-                    // Modalita' trigger giorno/ora/minuto
-                    if (task.lastFiredDayOfYear == currentDayOfYear &&
-                        task.lastFiredHour == currentHour &&
-                        task.lastFiredMinute == currentMinute) {
-                        continue;
-                    }
-
-                    if (task.days.count(currentDay) &&
-                        task.hours.count(currentHour) &&
-                        task.minutes.count(currentMinute)) {
-                        shouldFire = true;
-                        task.lastFiredDayOfYear = currentDayOfYear;
-                        task.lastFiredHour = currentHour;
-                        task.lastFiredMinute = currentMinute;
-                    }
-                }
-
-                if (shouldFire) {
-                    WriteToLog("Schedulatore: Esecuzione task '" + task.name + "' - Comando: " + task.command);
-                    task.lastExecutionTime = GetTimestamp();
-                    task.executionCount++;
-
-                    std::string cmd = task.command;
-                    std::string taskName = task.name;
-                    std::thread(SchedulerExecuteTask, cmd, taskName).detach();
+        
+        size_t dropped = logRecordsDropped.exchange(0);
+        if (dropped > 0) {
+            FILETIME now;
+            GetSystemTimeAsFileTime(&now);
+            batch += formatter.Format(now);
+            batch += " - AVVISO: " + std::to_string(dropped) + " messaggi di log scartati (buffer pieno)\r\n";
+        }
+        
+        size_t drained = 0;
+        while (drained < LOG_WRITER_BATCH && logRing.TryPop(record)) {
+            const char* ts = formatter.Format(record.time);
+            batch.append(ts, 23);
+            batch += " - ";
+            batch += record.message;
+            batch += "\r\n";
+            
+            if (record.detailed && writeDetailed) {
+                detailedBatch.append(ts, 23);
+                detailedBatch += " - [DETAILED] ";
+                detailedBatch += record.message;
+                detailedBatch += "\r\n";
+            }
+            
+            activity.push_back(std::move(record.message));
+            drained++;
+        }
+        
+        WriteLogBatch(logHandle, batch);
+        WriteLogBatch(detailedHandle, detailedBatch);
+        batch.clear();
+        detailedBatch.clear();
+        
+        // Aggiorna attività recente per dashboard (un solo lock per blocco)
+        if (!activity.empty()) {
+            auto now = std::chrono::steady_clock::now();
+            size_t first = activity.size() > MAX_RECENT_ACTIVITY ? activity.size() - MAX_RECENT_ACTIVITY : 0;
+            
+            // Un solo evento per blocco, con le stesse righe che entrano nella dashboard
+            if (serverEventSubscribers.load() > 0) {
+                long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+                JsonWriter lines(false);
+                lines.BeginArray();
+                for (size_t i = first; i < activity.size(); ++i) {
+                    lines.BeginObject().Key("message").String(activity[i]).Key("timestamp").Int(timestamp).EndObject();
                 }
+                lines.EndArray();
+                PublishServerEvent(TopicActivity, "activity", lines.Text());
+            }
+            
+            std::lock_guard<std::mutex> metricsLock(metricsMutex);
+            for (size_t i = first; i < activity.size(); ++i) {
+                systemMetrics.recentActivity.push_back(std::make_pair(std::move(activity[i]), now));
+            }
+            while (systemMetrics.recentActivity.size() > MAX_RECENT_ACTIVITY) {
+                systemMetrics.recentActivity.pop_front();
             }
+            systemMetrics.recentActivityGeneration++;
+            activity.clear();
         }
-
-        // Sleep frazionato per rispondere rapidamente a globalShutdown
-        for (int i = 0; i < 150 && !globalShutdown; ++i) Sleep(100);
+        
+        if (drained == LOG_WRITER_BATCH) continue;  // ring ancora pieno, nessuna attesa
+        if (stopping) break;
+        
+        WaitForSingleObject(logWakeEvent, LOG_FLUSH_INTERVAL);
     }
-
-    WriteToLog("Thread schedulatore terminato");
+    
+    if (logHandle != INVALID_HANDLE_VALUE) CloseHandle(logHandle);
+    if (detailedHandle != INVALID_HANDLE_VALUE) CloseHandle(detailedHandle);
 }
 
-std::string GetSchedulerJson() {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-
-    std::ostringstream json;
-    json << "{\n";
-    json << "  \"enabled\": " << (schedulerEnabled ? "true" : "false") << ",\n";
-    json << "  \"folder\": \"" << EscapeJsonString(schedulerFolder) << "\",\n";
-    json << "  \"tasks\": [\n";
+void StartLogger() {
+    logWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    logWriterThread = std::thread(LogWriterWorker);
+    logWriterStarted = true;
+    atexit(StopLogger);
+}
 
-    bool first = true;
-    for (const auto& task : schedulerTasks) {
-        if (!first) json << ",\n";
-        json << "    {\n";
-        json << "      \"name\": \"" << EscapeJsonString(task.name) << "\",\n";
-        json << "      \"enabled\": " << (task.enabled ? "true" : "false") << ",\n";
-        json << "      \"intervalSeconds\": " << task.intervalSeconds << ",\n";
-
-        json << "      \"days\": \"";
-        bool innerFirst = true;
-        for (int d : task.days) {
-            if (!innerFirst) json << ",";
-            json << DayNumberToName(d);
-            innerFirst = false;
-        }
-        json << "\",\n";
-
-        json << "      \"hours\": \"";
-        innerFirst = true;
-        for (int h : task.hours) {
-            if (!innerFirst) json << ",";
-            json << h;
-            innerFirst = false;
-        }
-        json << "\",\n";
-
-        json << "      \"minutes\": \"";
-        innerFirst = true;
-        for (int m : task.minutes) {
-            if (!innerFirst) json << ",";
-            json << m;
-            innerFirst = false;
-        }
-        json << "\",\n";
-
-        json << "      \"command\": \"" << EscapeJsonString(task.command) << "\",\n";
-        json << "      \"lastExecution\": \"" << EscapeJsonString(task.lastExecutionTime) << "\",\n";
-        json << "      \"executionCount\": " << task.executionCount << "\n";
-        json << "    }";
-        first = false;
+// Svuota il ring e ferma il writer; i messaggi successivi vengono scartati
+void StopLogger() {
+    if (!logWriterStarted || logWriterStop.exchange(true)) return;
+    if (logWakeEvent) SetEvent(logWakeEvent);
+    if (logWriterThread.joinable()) logWriterThread.join();
+    if (logWakeEvent) {
+        CloseHandle(logWakeEvent);
+        logWakeEvent = NULL;
     }
+}
 
-    json << "\n  ],\n";
-    json << "  \"history\": [\n";
+// Da chiamare dopo aver cambiato LogFile/DetailedLogFile/DetailedLogging
+void RequestLogReopen() {
+    logConfigGeneration++;
+}
 
-    first = true;
-    for (int i = static_cast<int>(schedulerHistory.size()) - 1; i >= 0; --i) {
-        const auto& exec = schedulerHistory[i];
-        if (!first) json << ",\n";
-        json << "    {\n";
-        json << "      \"taskName\": \"" << EscapeJsonString(exec.taskName) << "\",\n";
-        json << "      \"timestamp\": \"" << EscapeJsonString(exec.timestamp) << "\",\n";
-        json << "      \"command\": \"" << EscapeJsonString(exec.command) << "\",\n";
-        json << "      \"exitCode\": " << exec.exitCode << ",\n";
-        json << "      \"success\": " << (exec.success ? "true" : "false") << "\n";
-        json << "    }";
-        first = false;
+void WriteToLog(const std::string& message, bool detailed) {
+    if (!logWriterStarted) {
+        std::call_once(logStartOnce, StartLogger);
     }
+    
+    LogRecord record;
+    GetSystemTimeAsFileTime(&record.time);
+    record.detailed = detailed;
+    record.message = message;
+    
+    if (!logRing.TryPush(record)) {
+        logRecordsDropped++;
+        return;
+    }
+    
+    // Sveglia anticipata del writer quando il ring si sta riempiendo
+    if (logRing.ApproxSize() > LOG_RING_CAPACITY / 2 && logWakeEvent) {
+        SetEvent(logWakeEvent);
+    }
+}
 
-    json << "\n  ]\n";
-    json << "}";
-
-    return json.str();
+std::string NormalizeFolderPath(const std::string& path) {
+    std::string normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '/', '\\');
+    
+    if (!normalized.empty() && normalized.back() == '\\') {
+        normalized.pop_back();
+    }
+    
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::toupper);
+    return normalized;
 }
 
-std::string GetSchedulerScriptsJson() {
-    std::ostringstream json;
-    json << "[";
+std::string EscapeJsonString(const std::string& input) {
+    std::string escaped;
+    escaped.reserve(input.length() + 20); // Pre-alloca spazio extra
+    JsonWriter::AppendEscaped(escaped, input.data(), input.length());
+    return escaped;
+}
 
-    std::vector<std::string> searchDirs = {"C:\\Scripts", schedulerFolder};
-    bool first = true;
+bool FileExists(const std::string& filename) {
+    DWORD attrs = GetFileAttributes(filename.c_str());
+    return (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY));
+}
 
-    for (const auto& dir : searchDirs) {
-        if (!DirectoryExists(dir)) continue;
+bool DirectoryExists(const std::string& path) {
+    DWORD attrs = GetFileAttributes(path.c_str());
+    return (attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY));
+}
 
-        std::string patterns[] = {"\\*.bat", "\\*.cmd", "\\*.exe", "\\*.ps1"};
-        for (const auto& ext : patterns) {
-            WIN32_FIND_DATA fd;
-            HANDLE hFind = FindFirstFile((dir + ext).c_str(), &fd);
-            if (hFind == INVALID_HANDLE_VALUE) continue;
+bool CreateDirectoryRecursive(const std::string& path) {
+    std::string normalizedPath = path;
+    std::replace(normalizedPath.begin(), normalizedPath.end(), '/', '\\');
+    
+    if (!normalizedPath.empty() && normalizedPath.back() == '\\') {
+        normalizedPath.pop_back();
+    }
+    
+    if (DirectoryExists(normalizedPath)) {
+        return true;
+    }
+    
+    size_t pos = normalizedPath.find_last_of('\\');
+    if (pos != std::string::npos) {
+        std::string parentPath = normalizedPath.substr(0, pos);
+        if (!CreateDirectoryRecursive(parentPath)) {
+            return false;
+        }
+    }
+    
+    return CreateDirectory(normalizedPath.c_str(), NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+}
 
-            do {
-                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
-                if (!first) json << ",";
-                json << "\"" << EscapeJsonString(dir + "\\" + fd.cFileName) << "\"";
-                first = false;
-            } while (FindNextFile(hFind, &fd));
+bool IsFileInUse(const std::string& filePath) {
+    HANDLE hFile = CreateFile(filePath.c_str(), GENERIC_READ, 0, NULL, 
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    
+    if (hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(hFile);
+        return false;
+    }
+    
+    DWORD error = GetLastError();
+    return (error == ERROR_SHARING_VIOLATION || error == ERROR_LOCK_VIOLATION);
+}
 
-            FindClose(hFind);
+bool WaitForFileAvailability(const std::string& filePath, int maxWaitTimeMs) {
+    int waitTime = 0;
+    const int sleepInterval = 250;
+    
+    WriteToLog("Verifica disponibilità file: " + filePath, true);
+    
+    while (waitTime < maxWaitTimeMs && !globalShutdown) {
+        if (!FileExists(filePath)) {
+            WriteToLog("File non più presente: " + filePath, true);
+            return false;
+        }
+        
+        if (!IsFileInUse(filePath)) {
+            WriteToLog("File disponibile dopo " + std::to_string(waitTime) + "ms", true);
+            return true;
+        }
+        
+        Sleep(sleepInterval);
+        waitTime += sleepInterval;
+    }
+    
+    if (globalShutdown) {
+        WriteToLog("Terminazione richiesta durante attesa file", true);
+    }
+    
+    return false;
+}
+
+// ====== DEDUPLICAZIONE ======
+// Con DedupMode=path un file e' processato se il suo percorso e' nel database. Con
+// metadata la chiave e' "percorso|dimensione|data di scrittura": un file nuovo che
+// riusa un vecchio nome viene eseguito. Con content alla chiave metadati si aggiunge
+// "#xxh64:impronta:dimensione", senza percorso: lo stesso contenuto sotto un altro
+// nome, o riscritto identico (FILE_ACTION_MODIFIED senza modifiche reali), viene
+// saltato. Il prefiltro di watcher e scansione usa solo la chiave metadati (una
+// GetFileAttributesEx); l'impronta si calcola nell'esecutore, a file stabile, subito
+// prima di avviare il comando, e le chiavi vengono registrate a comando riuscito
+// anche se nel frattempo il file e' stato spostato.
+
+// XXH64 in streaming (algoritmo xxHash di Yann Collet, BSD): quattro accumulatori
+// indipendenti su blocchi da 32 byte, circa un byte per ciclo per core. Stesso
+// risultato dell'implementazione di riferimento con seme 0.
+class Xxh64 {
+public:
+    Xxh64() : totalLength(0), bufferedLength(0) {
+        acc[0] = PRIME1 + PRIME2;
+        acc[1] = PRIME2;
+        acc[2] = 0;
+        acc[3] = 0 - PRIME1;
+    }
+    
+    void Update(const void* data, size_t length) {
+        const unsigned char* input = static_cast<const unsigned char*>(data);
+        totalLength += length;
+        
+        if (bufferedLength + length < 32) {
+            memcpy(buffer + bufferedLength, input, length);
+            bufferedLength += length;
+            return;
+        }
+        if (bufferedLength > 0) {
+            size_t fill = 32 - bufferedLength;
+            memcpy(buffer + bufferedLength, input, fill);
+            Stripe(buffer);
+            input += fill;
+            length -= fill;
+            bufferedLength = 0;
+        }
+        while (length >= 32) {
+            Stripe(input);
+            input += 32;
+            length -= 32;
+        }
+        memcpy(buffer, input, length);
+        bufferedLength = length;
+    }
+    
+    unsigned long long Digest() const {
+        unsigned long long hash;
+        if (totalLength >= 32) {
+            hash = Rotl(acc[0], 1) + Rotl(acc[1], 7) + Rotl(acc[2], 12) + Rotl(acc[3], 18);
+            for (int i = 0; i < 4; ++i) {
+                hash ^= Round(0, acc[i]);
+                hash = hash * PRIME1 + PRIME4;
+            }
+        } else {
+            hash = PRIME5;
         }
+        hash += totalLength;
+        
+        const unsigned char* tail = buffer;
+        size_t remaining = bufferedLength;
+        for (; remaining >= 8; tail += 8, remaining -= 8) {
+            hash ^= Round(0, Read64(tail));
+            hash = Rotl(hash, 27) * PRIME1 + PRIME4;
+        }
+        if (remaining >= 4) {
+            hash ^= static_cast<unsigned long long>(Read32(tail)) * PRIME1;
+            hash = Rotl(hash, 23) * PRIME2 + PRIME3;
+            tail += 4;
+            remaining -= 4;
+        }
+        for (; remaining > 0; ++tail, --remaining) {
+            hash ^= (*tail) * PRIME5;
+            hash = Rotl(hash, 11) * PRIME1;
+        }
+        
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+    
+private:
+    static const unsigned long long PRIME1 = 0x9E3779B185EBCA87ULL;
+    static const unsigned long long PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static const unsigned long long PRIME3 = 0x165667B19E3779F9ULL;
+    static const unsigned long long PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static const unsigned long long PRIME5 = 0x27D4EB2F165667C5ULL;
+    
+    unsigned long long acc[4];
+    unsigned long long totalLength;
+    unsigned char buffer[32];
+    size_t bufferedLength;
+    
+    static unsigned long long Rotl(unsigned long long value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+    
+    // Letture little-endian non allineate
+    static unsigned long long Read64(const unsigned char* p) {
+        unsigned long long value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    
+    static unsigned int Read32(const unsigned char* p) {
+        unsigned int value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    
+    static unsigned long long Round(unsigned long long accumulator, unsigned long long lane) {
+        accumulator += lane * PRIME2;
+        accumulator = Rotl(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+    
+    void Stripe(const unsigned char* p) {
+        acc[0] = Round(acc[0], Read64(p));
+        acc[1] = Round(acc[1], Read64(p + 8));
+        acc[2] = Round(acc[2], Read64(p + 16));
+        acc[3] = Round(acc[3], Read64(p + 24));
     }
+};
 
-    json << "]";
-    return json.str();
+const char* DedupModeName(DedupMode mode) {
+    switch (mode) {
+        case DedupMetadata: return "metadata";
+        case DedupContent: return "content";
+        default: return "path";
+    }
 }
 
-std::string GetSchedulerPageHtml() {
-    return R"html(<!DOCTYPE html>
-<html lang="it">
-<head>
-<meta charset="UTF-8">
-<meta name="viewport" content="width=device-width, initial-scale=1.0">
-<title>PTC - Schedulatore</title>
-<style>
-:root{--bg:#f5f7fb;--surface:#ffffff;--surface2:#f0f2f5;--border:#d4dae3;--primary:#0087cd;--primary-light:#45a5dc;--primary-bg:rgba(0,135,205,0.08);--green:#009246;--green-bg:rgba(0,146,70,0.1);--red:#ce2b37;--red-bg:rgba(206,43,55,0.1);--warning:#e8952e;--warning-bg:rgba(232,149,46,0.1);--text:#1a2332;--text2:#4a5c72;--text3:#8895a7;--radius:10px;--shadow:0 2px 12px rgba(0,0,0,0.06);}
-*{margin:0;padding:0;box-sizing:border-box;}
-body{font-family:'Segoe UI',system-ui,-apple-system,sans-serif;background:var(--bg);color:var(--text);min-height:100vh;}
-.top-bar{background:linear-gradient(135deg,var(--primary) 0%,#005a8c 100%);padding:14px 24px;display:flex;align-items:center;justify-content:space-between;position:sticky;top:0;z-index:50;box-shadow:0 2px 8px rgba(0,90,140,0.3);}
-.top-bar h1{font-size:1.3em;font-weight:700;color:white;}
-.top-bar a{color:rgba(255,255,255,0.85);text-decoration:none;font-size:0.9em;padding:6px 16px;border:1px solid rgba(255,255,255,0.4);border-radius:20px;transition:all 0.2s;}
-.top-bar a:hover{background:rgba(255,255,255,0.15);color:white;border-color:rgba(255,255,255,0.7);}
-.top-stripe{height:4px;background:linear-gradient(90deg,var(--green) 33%,#ffffff 33%,#ffffff 66%,var(--red) 66%);}
-.main{max-width:1440px;margin:0 auto;padding:20px;}
-.stats{display:grid;grid-template-columns:repeat(auto-fit,minmax(180px,1fr));gap:14px;margin-bottom:24px;}
-.stat-card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:16px 20px;box-shadow:var(--shadow);transition:border-color 0.2s,transform 0.2s;}
-.stat-card:hover{border-color:var(--primary);transform:translateY(-2px);}
-.stat-label{font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;margin-bottom:4px;}
-.stat-value{font-size:1.5em;font-weight:700;color:var(--text);}
-.stat-value.on{color:var(--green);}
-.stat-value.off{color:var(--red);}
-.tabs{display:flex;gap:4px;margin-bottom:20px;background:var(--surface);border-radius:var(--radius);padding:4px;border:1px solid var(--border);box-shadow:var(--shadow);}
-.tab{padding:10px 24px;border-radius:8px;cursor:pointer;font-weight:600;font-size:0.9em;color:var(--text2);transition:all 0.2s;border:none;background:transparent;}
-.tab:hover{color:var(--text);background:var(--surface2);}
-.tab.active{background:var(--primary);color:white;}
-.panel{display:none;}
-.panel.active{display:block;}
-.card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:20px;margin-bottom:16px;box-shadow:var(--shadow);}
-.card-header{display:flex;justify-content:space-between;align-items:center;margin-bottom:16px;}
-.card-title{font-size:1.1em;font-weight:700;color:var(--text);}
-.btn{padding:8px 18px;border:none;border-radius:8px;cursor:pointer;font-size:0.85em;font-weight:600;transition:all 0.15s;display:inline-flex;align-items:center;gap:6px;}
-.btn:hover{transform:translateY(-1px);box-shadow:0 4px 12px rgba(0,0,0,0.15);}
-.btn:active{transform:translateY(0);}
-.btn-primary{background:var(--primary);color:white;}
-.btn-success{background:var(--green);color:white;}
-.btn-warning{background:var(--warning);color:white;}
-.btn-danger{background:var(--red);color:white;}
-.btn-ghost{background:transparent;color:var(--text2);border:1px solid var(--border);}
-.btn-ghost:hover{color:var(--text);border-color:var(--primary);background:var(--primary-bg);}
-.btn-sm{padding:5px 12px;font-size:0.8em;}
-table{width:100%;border-collapse:collapse;}
-th{text-align:left;padding:10px 14px;font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;border-bottom:2px solid var(--border);font-weight:600;background:var(--surface2);}
-td{padding:10px 14px;border-bottom:1px solid var(--border);font-size:0.9em;vertical-align:middle;}
-tr:hover td{background:var(--primary-bg);}
-.badge{display:inline-block;padding:3px 10px;border-radius:20px;font-size:0.78em;font-weight:600;}
-.badge-on{background:var(--green-bg);color:var(--green);}
-.badge-off{background:var(--red-bg);color:var(--red);}
-.badge-interval{background:var(--primary-bg);color:var(--primary);}
-.badge-schedule{background:var(--warning-bg);color:var(--warning);}
-.mono{font-family:'Cascadia Code','Fira Code',monospace;font-size:0.85em;color:var(--primary);background:var(--primary-bg);padding:2px 8px;border-radius:4px;}
-.actions{display:flex;gap:4px;flex-wrap:wrap;}
-.overlay{position:fixed;top:0;left:0;width:100%;height:100%;background:rgba(0,0,0,0.4);display:flex;align-items:center;justify-content:center;z-index:100;backdrop-filter:blur(4px);}
-.modal{background:var(--surface);border:1px solid var(--border);border-radius:14px;padding:28px;width:92%;max-width:640px;max-height:90vh;overflow-y:auto;box-shadow:0 20px 60px rgba(0,0,0,0.2);}
-.modal h2{font-size:1.2em;margin-bottom:20px;color:var(--text);padding-bottom:12px;border-bottom:2px solid var(--primary);}
-.field{margin-bottom:18px;}
-.field label{display:block;font-size:0.85em;font-weight:600;color:var(--text2);margin-bottom:6px;}
-.field input[type=text],.field input[type=number],.field select{width:100%;padding:10px 14px;background:var(--surface);border:1px solid var(--border);border-radius:8px;color:var(--text);font-size:0.95em;transition:border-color 0.2s;}
-.field input:focus,.field select:focus{outline:none;border-color:var(--primary);box-shadow:0 0 0 3px var(--primary-bg);}
-.field select{cursor:pointer;}
-.field .hint{font-size:0.78em;color:var(--text3);margin-top:4px;}
-.days-row{display:flex;gap:6px;flex-wrap:wrap;}
-.day-chip{padding:8px 14px;border-radius:8px;cursor:pointer;font-weight:600;font-size:0.9em;background:var(--surface2);border:2px solid var(--border);color:var(--text2);transition:all 0.15s;user-select:none;}
-.day-chip.on{background:var(--primary-bg);border-color:var(--primary);color:var(--primary);}
-.mode-switch{display:flex;gap:4px;background:var(--surface2);border-radius:8px;padding:4px;margin-bottom:12px;}
-.mode-btn{flex:1;padding:10px;border:none;border-radius:6px;cursor:pointer;font-weight:600;font-size:0.88em;color:var(--text2);background:transparent;transition:all 0.2s;}
-.mode-btn.active{background:var(--primary);color:white;}
-.mode-section{display:none;}
-.mode-section.active{display:block;}
-.modal-actions{display:flex;gap:10px;justify-content:flex-end;margin-top:24px;padding-top:16px;border-top:1px solid var(--border);}
-.history-filters{display:flex;gap:10px;margin-bottom:14px;flex-wrap:wrap;}
-.history-filters input,.history-filters select{padding:8px 12px;background:var(--surface);border:1px solid var(--border);border-radius:8px;color:var(--text);font-size:0.85em;}
-.history-filters input:focus,.history-filters select:focus{outline:none;border-color:var(--primary);}
-.empty-state{text-align:center;padding:40px;color:var(--text3);}
-@media(max-width:768px){.main{padding:12px;}.stats{grid-template-columns:1fr 1fr;}.tabs{flex-wrap:wrap;}.modal{width:96%;padding:20px;}th,td{padding:8px 6px;font-size:0.82em;}.actions{flex-direction:column;}}
-</style>
-</head>
-<body>
-<div class="top-bar">
-    <h1>PTC Schedulatore</h1>
-    <a href="/">Dashboard</a>
-</div>
-<div class="top-stripe"></div>
-<div class="main">
-    <div class="stats">
-        <div class="stat-card"><div class="stat-label">Stato</div><div class="stat-value" id="sStatus">-</div></div>
-        <div class="stat-card"><div class="stat-label">Task Totali</div><div class="stat-value" id="sTotal">-</div></div>
-        <div class="stat-card"><div class="stat-label">Task Attivi</div><div class="stat-value" id="sActive">-</div></div>
-        <div class="stat-card"><div class="stat-label">Esecuzioni Totali</div><div class="stat-value" id="sExecs">-</div></div>
-        <div class="stat-card"><div class="stat-label">Cartella</div><div class="stat-value" id="sFolder" style="font-size:0.7em;word-break:break-all;">-</div></div>
-    </div>
-    <div class="tabs">
-        <button class="tab active" onclick="switchTab('tasks',this)">Task</button>
-        <button class="tab" onclick="switchTab('history',this)">Storico</button>
-    </div>
-    <div id="panel-tasks" class="panel active">
-        <div class="card">
-            <div class="card-header">
-                <span class="card-title">Task Schedulati</span>
-                <button class="btn btn-primary" onclick="openForm()">+ Nuovo Task</button>
-            </div>
-            <div style="overflow-x:auto;">
-            <table>
-                <thead><tr><th>Nome</th><th>Stato</th><th>Tipo</th><th>Programmazione</th><th>Comando</th><th>Ultima Esec.</th><th>#</th><th>Azioni</th></tr></thead>
-                <tbody id="tBody"></tbody>
-            </table>
-            </div>
-            <div id="tEmpty" class="empty-state" style="display:none;">Nessun task configurato. Crea il primo!</div>
-        </div>
-    </div>
-    <div id="panel-history" class="panel">
-        <div class="card">
-            <div class="card-header"><span class="card-title">Storico Esecuzioni</span></div>
-            <div class="history-filters">
-                <input type="text" id="hFilter" placeholder="Filtra per nome task..." oninput="renderHistory()">
-                <select id="hStatus" onchange="renderHistory()"><option value="">Tutti</option><option value="ok">Successo</option><option value="fail">Errore</option></select>
-            </div>
-            <div style="overflow-x:auto;">
-            <table>
-                <thead><tr><th>Data/Ora</th><th>Task</th><th>Comando</th><th>Esito</th><th>Codice</th></tr></thead>
-                <tbody id="hBody"></tbody>
-            </table>
-            </div>
-            <div id="hEmpty" class="empty-state" style="display:none;">Nessuna esecuzione registrata.</div>
-        </div>
-    </div>
-</div>
-<div id="formOverlay" class="overlay" style="display:none;" onclick="if(event.target===this)closeForm()">
-    <div class="modal">
-        <h2 id="fTitle">Nuovo Task</h2>
-        <input type="hidden" id="fOrig" value="">
-        <div class="field">
-            <label>Nome Task</label>
-            <input type="text" id="fName" placeholder="Es: Backup giornaliero">
-        </div>
-        <div class="field">
-            <label>Modalita di Schedulazione</label>
-            <div class="mode-switch">
-                <button class="mode-btn active" onclick="setMode('schedule',this)">Giorno/Ora/Minuto</button>
-                <button class="mode-btn" onclick="setMode('interval',this)">Intervallo (ogni N sec)</button>
-            </div>
-        </div>
-        <div id="modeSchedule" class="mode-section active">
-            <div class="field">
-                <label>Giorni della Settimana</label>
-                <div class="days-row" id="fDays"></div>
-            </div>
-            <div class="field">
-                <label>Ore</label>
-                <input type="text" id="fHours" placeholder="Es: 0,6,12,18">
-                <div class="hint">Inserisci le ore separate da virgola (0-23)</div>
-            </div>
-            <div class="field">
-                <label>Minuti</label>
-                <input type="text" id="fMinutes" placeholder="Es: 0,15,30,45">
-                <div class="hint">Inserisci i minuti separati da virgola (0-59)</div>
-            </div>
-        </div>
-        <div id="modeInterval" class="mode-section">
-            <div class="field">
-                <label>Ripeti ogni (secondi)</label>
-                <input type="number" id="fInterval" min="5" value="60" placeholder="60">
-                <div class="hint">Minimo 5 secondi. Es: 60=ogni minuto, 3600=ogni ora</div>
-            </div>
-        </div>
-        <div class="field">
-            <label>Comando da Eseguire</label>
-            <select id="fScriptSelect" onchange="if(this.value)document.getElementById('fCommand').value=this.value">
-                <option value="">-- Seleziona da elenco --</option>
-            </select>
-            <input type="text" id="fCommand" placeholder="C:\Scripts\myscript.bat" style="margin-top:8px;">
-            <div class="hint">Seleziona un file dall'elenco oppure scrivi il percorso manualmente</div>
-        </div>
-        <div class="modal-actions">
-            <button class="btn btn-ghost" onclick="closeForm()">Annulla</button>
-            <button class="btn btn-primary" onclick="saveTask()">Salva Task</button>
-        </div>
-    </div>
-</div>
-<script>
-var T=[],H=[],scripts=[];
-var curMode="schedule";
-var DAYS=["Lu","Ma","Me","Gi","Ve","Sa","Do"];
-function switchTab(id,el){document.querySelectorAll(".tab").forEach(function(t){t.classList.remove("active")});el.classList.add("active");document.querySelectorAll(".panel").forEach(function(p){p.classList.remove("active")});document.getElementById("panel-"+id).classList.add("active");}
-function setMode(m,el){curMode=m;document.querySelectorAll(".mode-btn").forEach(function(b){b.classList.remove("active")});el.classList.add("active");document.getElementById("modeSchedule").className=m==="schedule"?"mode-section active":"mode-section";document.getElementById("modeInterval").className=m==="interval"?"mode-section active":"mode-section";}
-function initDays(){var c=document.getElementById("fDays");c.innerHTML="";DAYS.forEach(function(d){var chip=document.createElement("div");chip.className="day-chip";chip.textContent=d;chip.setAttribute("data-day",d);chip.onclick=function(){this.classList.toggle("on")};c.appendChild(chip)});}
-function loadData(){
-    fetch("/api/scheduler").then(function(r){return r.json()}).then(function(data){
-        T=data.tasks||[];H=data.history||[];
-        var el=document.getElementById("sStatus");el.textContent=data.enabled?"Attivo":"Disattivo";el.className="stat-value "+(data.enabled?"on":"off");
-        document.getElementById("sTotal").textContent=T.length;
-        document.getElementById("sActive").textContent=T.filter(function(t){return t.enabled}).length;
-        var totalExec=0;T.forEach(function(t){totalExec+=t.executionCount});document.getElementById("sExecs").textContent=totalExec;
-        document.getElementById("sFolder").textContent=data.folder;
-        renderTasks();renderHistory();
-    }).catch(function(){});
-    fetch("/api/scheduler/scripts").then(function(r){return r.json()}).then(function(data){
-        scripts=data||[];
-        var sel=document.getElementById("fScriptSelect");
-        var curr=sel.value;
-        sel.innerHTML="<option value=''>-- Seleziona da elenco ("+scripts.length+" file) --</option>";
-        scripts.forEach(function(s){var o=document.createElement("option");o.value=s;o.textContent=s;sel.appendChild(o)});
-        if(curr)sel.value=curr;
-    }).catch(function(){});
+std::atomic<unsigned long long> dedupBytesHashed{0};
+std::atomic<size_t> dedupContentMatches{0};
+
+struct FileIdentity {
+    unsigned long long size;
+    unsigned long long lastWrite;
+};
+
+bool GetFileIdentity(const std::string& path, FileIdentity& identity) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data)) return false;
+    identity.size = (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    identity.lastWrite = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                         data.ftLastWriteTime.dwLowDateTime;
+    return true;
 }
-function renderTasks(){
-    var tb=document.getElementById("tBody");tb.innerHTML="";
-    document.getElementById("tEmpty").style.display=T.length?"none":"block";
-    T.forEach(function(t){
-        var tr=document.createElement("tr");
-        var isInt=t.intervalSeconds>0;
-        var sched=isInt?("Ogni "+fmtInterval(t.intervalSeconds)):(t.days+" | ore:"+t.hours+" | min:"+t.minutes);
-        var typeB=isInt?"<span class='badge badge-interval'>Intervallo</span>":"<span class='badge badge-schedule'>Programmato</span>";
-        tr.innerHTML="<td><strong>"+esc(t.name)+"</strong></td>"
-            +"<td><span class='badge "+(t.enabled?"badge-on":"badge-off")+"'>"+(t.enabled?"Attivo":"Off")+"</span></td>"
-            +"<td>"+typeB+"</td>"
-            +"<td>"+esc(sched)+"</td>"
-            +"<td><span class='mono'>"+esc(t.command)+"</span></td>"
-            +"<td>"+(t.lastExecution||"<span style='color:var(--text3)'>Mai</span>")+"</td>"
-            +"<td>"+t.executionCount+"</td>"
-            +"<td class='actions'>"
-            +"<button class='btn btn-sm "+(t.enabled?"btn-warning":"btn-success")+"' onclick=\"togTask('"+esc(t.name)+"')\">"+(t.enabled?"Stop":"Avvia")+"</button>"
-            +"<button class='btn btn-sm btn-ghost' onclick=\"editTask('"+esc(t.name)+"')\">Mod</button>"
-            +"<button class='btn btn-sm btn-ghost' onclick=\"dupeTask('"+esc(t.name)+"')\">Dup</button>"
-            +"<button class='btn btn-sm btn-danger' onclick=\"delTask('"+esc(t.name)+"')\">Elim</button>"
-            +"</td>";
-        tb.appendChild(tr);
-    });
+
+static std::string HexValue(unsigned long long value) {
+    char text[17];
+    snprintf(text, sizeof(text), "%llx", value);
+    return text;
 }
-function renderHistory(){
-    var filter=(document.getElementById("hFilter").value||"").toLowerCase();
-    var status=document.getElementById("hStatus").value;
-    var filtered=H.filter(function(e){
-        if(filter&&e.taskName.toLowerCase().indexOf(filter)<0)return false;
-        if(status==="ok"&&!e.success)return false;
-        if(status==="fail"&&e.success)return false;
+
+// "|" non e' ammesso nei nomi file Windows: separa il percorso dai metadati
+std::string MetadataDedupKey(const std::string& path, const FileIdentity& identity) {
+    return path + "|" + HexValue(identity.size) + "|" + HexValue(identity.lastWrite);
+}
+
+std::string ContentDedupKey(unsigned long long hash, unsigned long long size) {
+    char text[64];
+    snprintf(text, sizeof(text), "#xxh64:%016llx:%llx", hash, size);
+    return text;
+}
+
+// Impronta del contenuto con letture sequenziali da 1 MB (anche su share di rete,
+// dove la mappatura in memoria non conviene)
+bool HashFileContent(const std::string& path, unsigned long long& hash) {
+    HANDLE hFile = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    
+    std::unique_ptr<char[]> buffer(new char[DEDUP_HASH_READ_SIZE]);
+    Xxh64 hasher;
+    bool ok = true;
+    unsigned long long total = 0;
+    for (;;) {
+        DWORD read = 0;
+        if (!ReadFile(hFile, buffer.get(), DEDUP_HASH_READ_SIZE, &read, NULL)) {
+            ok = false;
+            break;
+        }
+        if (read == 0) break;
+        hasher.Update(buffer.get(), read);
+        total += read;
+    }
+    CloseHandle(hFile);
+    
+    dedupBytesHashed += total;
+    if (ok) hash = hasher.Digest();
+    return ok;
+}
+
+// Chiave del prefiltro: quella metadati, senza leggere il file (vuota se il file non c'e')
+std::string PrefilterDedupKey(const std::string& fullPath) {
+    if (dedupMode == DedupPath) return fullPath;
+    FileIdentity identity;
+    if (!GetFileIdentity(fullPath, identity)) return std::string();
+    return MetadataDedupKey(fullPath, identity);
+}
+
+// Tutte le chiavi con cui il file va registrato; con content legge l'intero file
+std::vector<std::string> ComputeDedupKeys(const std::string& fullPath) {
+    std::vector<std::string> keys;
+    FileIdentity identity;
+    if (dedupMode == DedupPath || !GetFileIdentity(fullPath, identity)) {
+        keys.push_back(fullPath);
+        return keys;
+    }
+    keys.push_back(MetadataDedupKey(fullPath, identity));
+    
+    unsigned long long hash = 0;
+    if (dedupMode == DedupContent && HashFileContent(fullPath, hash)) {
+        keys.push_back(ContentDedupKey(hash, identity.size));
+    }
+    return keys;
+}
+
+// Controllo definitivo prima di avviare il comando. Un contenuto gia' visto registra
+// subito anche le altre chiavi del file, cosi' i prossimi eventi si fermano al prefiltro
+bool AreDedupKeysProcessed(const std::string& fullPath, const std::vector<std::string>& keys) {
+    size_t known = keys.size();
+    {
+        std::lock_guard<std::mutex> lock(processedFilesMutex);
+        for (size_t i = 0; i < keys.size() && known == keys.size(); ++i) {
+            if (processedFiles.Contains(keys[i])) known = i;
+        }
+    }
+    if (known == keys.size()) return false;
+    
+    if (keys[known][0] == '#') {
+        dedupContentMatches++;
+        WriteToLog("SALTATO: Contenuto già processato: " + fullPath, true);
+        RecordProcessedFiles(keys);
+    } else {
+        WriteToLog("SALTATO: File già processato: " + fullPath);
+    }
+    return true;
+}
+
+// ====== COMPRESSIONE DEFLATE ======
+
+// Compressore DEFLATE (RFC 1951) per le risorse statiche del web server: LZ77 con
+// catene hash su finestra di 32 KB e match pigro, codici di Huffman fissi. Le pagine
+// vengono compresse una sola volta all'avvio, quindi conta il rapporto, non la velocita'
+class DeflateEncoder {
+public:
+    static std::string Compress(const std::string& input) {
+        DeflateEncoder encoder;
+        encoder.PutBits(1, 1);      // BFINAL: blocco unico
+        encoder.PutBits(1, 2);      // BTYPE = 01, Huffman fisso
+        encoder.Encode(reinterpret_cast<const unsigned char*>(input.data()), input.size());
+        encoder.PutLiteral(256);    // fine blocco
+        encoder.FlushBits();
+        return encoder.output;
+    }
+    
+private:
+    static const int WINDOW_SIZE = 32768;
+    static const int HASH_BITS = 15;
+    static const int MIN_MATCH = 3;
+    static const int MAX_MATCH = 258;
+    static const int MAX_CHAIN = 256;
+    
+    std::string output;
+    unsigned int bitBuffer;
+    int bitCount;
+    
+    DeflateEncoder() : bitBuffer(0), bitCount(0) {}
+    
+    void PutBits(unsigned int value, int count) {
+        bitBuffer |= value << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            output += static_cast<char>(bitBuffer & 0xFF);
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+    
+    // I codici di Huffman si scrivono dal bit piu' significativo
+    void PutCode(unsigned int code, int length) {
+        unsigned int reversed = 0;
+        for (int i = 0; i < length; ++i) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        PutBits(reversed, length);
+    }
+    
+    void FlushBits() {
+        if (bitCount > 0) output += static_cast<char>(bitBuffer & 0xFF);
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+    
+    void PutLiteral(int symbol) {
+        if (symbol < 144) PutCode(0x30 + symbol, 8);
+        else if (symbol < 256) PutCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280) PutCode(symbol - 256, 7);
+        else PutCode(0xC0 + symbol - 280, 8);
+    }
+    
+    void PutMatch(int length, int distance) {
+        static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const int distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                             257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                             8193, 12289, 16385, 24577};
+        static const int distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                              7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        
+        int lengthCode = 28;
+        while (lengthBase[lengthCode] > length) --lengthCode;
+        PutLiteral(257 + lengthCode);
+        PutBits(length - lengthBase[lengthCode], lengthExtra[lengthCode]);
+        
+        int distanceCode = 29;
+        while (distanceBase[distanceCode] > distance) --distanceCode;
+        PutCode(distanceCode, 5);
+        PutBits(distance - distanceBase[distanceCode], distanceExtra[distanceCode]);
+    }
+    
+    static unsigned int Hash3(const unsigned char* p) {
+        return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & ((1u << HASH_BITS) - 1);
+    }
+    
+    void Encode(const unsigned char* data, size_t size) {
+        std::vector<int> head(1 << HASH_BITS, -1);
+        std::vector<int> previous(size, -1);
+        
+        auto insert = [&](size_t position) {
+            if (position + MIN_MATCH > size) return;
+            unsigned int hash = Hash3(data + position);
+            previous[position] = head[hash];
+            head[hash] = static_cast<int>(position);
+        };
+        
+        auto longestMatch = [&](size_t position, int& bestDistance) {
+            int bestLength = 0;
+            if (position + MIN_MATCH > size) return 0;
+            int limit = static_cast<int>(std::min<size_t>(MAX_MATCH, size - position));
+            int candidate = previous[position];
+            for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain) {
+                int distance = static_cast<int>(position) - candidate;
+                if (distance > WINDOW_SIZE) break;
+                if (data[candidate + bestLength] == data[position + bestLength]) {
+                    int length = 0;
+                    while (length < limit && data[candidate + length] == data[position + length]) ++length;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = distance;
+                        if (length == limit) break;
+                    }
+                }
+                candidate = previous[candidate];
+            }
+            return bestLength >= MIN_MATCH ? bestLength : 0;
+        };
+        
+        size_t position = 0;
+        while (position < size) {
+            insert(position);
+            int distance = 0;
+            int length = longestMatch(position, distance);
+            
+            // Match pigro: se dal byte successivo parte un match piu' lungo, emette un letterale
+            if (length > 0 && length < MAX_MATCH && position + 1 < size) {
+                insert(position + 1);
+                int nextDistance = 0;
+                int nextLength = longestMatch(position + 1, nextDistance);
+                if (nextLength > length) {
+                    PutLiteral(data[position]);
+                    position++;
+                    length = nextLength;
+                    distance = nextDistance;
+                    for (int i = 1; i < length; ++i) insert(position + i);
+                    PutMatch(length, distance);
+                    position += length;
+                    continue;
+                }
+                for (int i = 2; i < length; ++i) insert(position + i);
+            }
+            else {
+                for (int i = 1; i < length; ++i) insert(position + i);
+            }
+            
+            if (length > 0) {
+                PutMatch(length, distance);
+                position += length;
+            } else {
+                PutLiteral(data[position]);
+                position++;
+            }
+        }
+    }
+};
+
+static unsigned int Crc32(const std::string& data) {
+    static unsigned int table[256];
+    static const bool initialized = [] {
+        for (unsigned int i = 0; i < 256; ++i) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
         return true;
-    });
-    var tb=document.getElementById("hBody");tb.innerHTML="";
-    document.getElementById("hEmpty").style.display=filtered.length?"none":"block";
-    filtered.forEach(function(e){
-        var tr=document.createElement("tr");
-        tr.innerHTML="<td>"+esc(e.timestamp)+"</td>"
-            +"<td><strong>"+esc(e.taskName)+"</strong></td>"
-            +"<td><span class='mono'>"+esc(e.command)+"</span></td>"
-            +"<td><span class='badge "+(e.success?"badge-on":"badge-off")+"'>"+(e.success?"OK":"Errore")+"</span></td>"
-            +"<td>"+e.exitCode+"</td>";
-        tb.appendChild(tr);
-    });
+    }();
+    (void)initialized;
+    unsigned int crc = 0xFFFFFFFFu;
+    for (unsigned char c : data) crc = table[(crc ^ c) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
 }
-function openForm(task){
-    document.getElementById("fTitle").textContent=task?"Modifica Task":"Nuovo Task";
-    document.getElementById("fOrig").value=task?task.name:"";
-    document.getElementById("fName").value=task?task.name:"";
-    document.getElementById("fCommand").value=task?task.command:"";
-    document.getElementById("fScriptSelect").value=task?task.command:"";
-    var isInt=task&&task.intervalSeconds>0;
-    if(isInt){
-        curMode="interval";
-        document.getElementById("fInterval").value=task.intervalSeconds;
-    }else{
-        curMode="schedule";
-        document.getElementById("fHours").value=task?task.hours:"";
-        document.getElementById("fMinutes").value=task?task.minutes:"";
+
+static void AppendLittleEndian32(std::string& out, unsigned int value) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+// Content-Encoding: gzip (RFC 1952)
+std::string GzipCompress(const std::string& input) {
+    std::string out("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x0b", 10);
+    out += DeflateEncoder::Compress(input);
+    AppendLittleEndian32(out, Crc32(input));
+    AppendLittleEndian32(out, static_cast<unsigned int>(input.size()));
+    return out;
+}
+
+// Content-Encoding: deflate, cioe' flusso zlib (RFC 1950)
+std::string ZlibCompress(const std::string& input) {
+    std::string out("\x78\x01", 2);
+    out += DeflateEncoder::Compress(input);
+    unsigned int a = 1, b = 0;
+    for (unsigned char c : input) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
     }
-    var btns=document.querySelectorAll(".mode-btn");
-    btns[0].className="mode-btn"+(curMode==="schedule"?" active":"");
-    btns[1].className="mode-btn"+(curMode==="interval"?" active":"");
-    document.getElementById("modeSchedule").className=curMode==="schedule"?"mode-section active":"mode-section";
-    document.getElementById("modeInterval").className=curMode==="interval"?"mode-section active":"mode-section";
-    initDays();
-    if(task&&task.days){
-        var ad=task.days.split(",");
-        document.querySelectorAll("#fDays .day-chip").forEach(function(c){if(ad.indexOf(c.getAttribute("data-day"))>=0)c.classList.add("on")});
+    unsigned int adler = (b << 16) | a;
+    for (int i = 3; i >= 0; --i) out += static_cast<char>((adler >> (8 * i)) & 0xFF);
+    return out;
+}
+
+// ====== DATABASE FILE PROCESSATI (SNAPSHOT + JOURNAL) ======
+// Il database e' composto da uno snapshot binario (".bin", vedi ProcessedDbImage),
+// mappato in sola lettura all'avvio senza parsing, e da un journal append-only
+// (".journal") con un record per operazione: "+percorso" aggiunta, "-percorso"
+// rimozione. Ogni file marcato costa una sola WriteFile sull'handle persistente del
+// journal; in memoria il journal diventa l'overlay di ProcessedFileStore. La
+// compattazione in background ruota il journal in ".journal.old", scrive una nuova
+// immagine su file temporaneo e la sostituisce atomicamente.
+// Al caricamento: immagine + replay di ".journal.old" + replay di ".journal";
+// un record finale troncato (crash durante la scrittura) viene ignorato.
+// Il formato testuale storico (processedFilesDb, un percorso per riga) viene
+// convertito una sola volta e conservato come ".text.bak".
+// Dalla retention i record di aggiunta portano l'istante: "+percorso<TAB>secondi"
+// (i nomi file non possono contenere caratteri di controllo); senza istante la voce
+// riceve quello della compattazione successiva.
+
+std::string ProcessedJournalPath() {
+    return processedFilesDb + ".journal";
+}
+
+std::string ProcessedJournalOldPath() {
+    return processedFilesDb + ".journal.old";
+}
+
+std::string ProcessedImagePath() {
+    return processedFilesDb + ".bin";
+}
+
+std::string ProcessedTextBackupPath() {
+    return processedFilesDb + ".text.bak";
+}
+
+bool OpenProcessedJournal() {
+    if (processedJournalHandle != INVALID_HANDLE_VALUE) return true;
+    
+    processedJournalHandle = CreateFile(ProcessedJournalPath().c_str(), FILE_APPEND_DATA,
+                                        FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (processedJournalHandle == INVALID_HANDLE_VALUE) {
+        WriteToLog("ERRORE: Impossibile aprire journal file processati: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        return false;
     }
-    document.getElementById("formOverlay").style.display="flex";
+    return true;
 }
-function closeForm(){document.getElementById("formOverlay").style.display="none";}
-function saveTask(){
-    var name=document.getElementById("fName").value.trim();
-    var cmd=document.getElementById("fCommand").value.trim();
-    if(!name){alert("Inserisci un nome per il task");return;}
-    if(!cmd){alert("Inserisci un comando da eseguire");return;}
-    var data={originalName:document.getElementById("fOrig").value,name:name,command:cmd,enabled:"true",intervalSeconds:"0"};
-    if(curMode==="interval"){
-        var iv=parseInt(document.getElementById("fInterval").value)||0;
-        if(iv<5){alert("Intervallo minimo: 5 secondi");return;}
-        data.intervalSeconds=String(iv);
-        data.days="";data.hours="";data.minutes="";
-    }else{
-        var days=[];document.querySelectorAll("#fDays .day-chip.on").forEach(function(c){days.push(c.getAttribute("data-day"))});
-        if(!days.length){alert("Seleziona almeno un giorno");return;}
-        data.days=days.join(",");
-        data.hours=document.getElementById("fHours").value;
-        data.minutes=document.getElementById("fMinutes").value;
-        if(!data.hours){alert("Inserisci almeno un'ora");return;}
-        if(!data.minutes){alert("Inserisci almeno un minuto");return;}
+
+void CloseProcessedJournal() {
+    if (processedJournalHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(processedJournalHandle);
+        processedJournalHandle = INVALID_HANDLE_VALUE;
     }
-    apiPost("/api/scheduler/save",data,function(){closeForm();loadData();});
 }
-function editTask(n){var t=T.find(function(x){return x.name===n});if(t)openForm(t);}
-function dupeTask(n){var t=T.find(function(x){return x.name===n});if(t){var c={};for(var k in t)c[k]=t[k];c.name=t.name+" (copia)";openForm(c);document.getElementById("fOrig").value="";}}
-function togTask(n){apiPost("/api/scheduler/toggle",{name:n},function(){loadData()});}
-function delTask(n){if(!confirm("Eliminare il task '"+n+"'?"))return;apiPost("/api/scheduler/delete",{name:n},function(){loadData()});}
-function apiPost(url,data,cb){
-    var xhr=new XMLHttpRequest();xhr.open("POST",url,true);
-    xhr.setRequestHeader("Content-Type","application/json");
-    xhr.onload=function(){
-        if(xhr.status===200){try{var r=JSON.parse(xhr.responseText);if(r.success){if(cb)cb();}else{alert("Errore: "+(r.error||"Operazione fallita"));}}catch(e){alert("Errore risposta server");}}
-        else{alert("Errore HTTP: "+xhr.status);}
-    };
-    xhr.onerror=function(){alert("Errore di rete");};
-    xhr.send(JSON.stringify(data));
+
+// Richiede processedFilesMutex acquisito
+bool AppendProcessedJournalRecords(const std::string& records, size_t count) {
+    if (!OpenProcessedJournal()) return false;
+    
+    DWORD written = 0;
+    if (!WriteFile(processedJournalHandle, records.data(), static_cast<DWORD>(records.length()), &written, NULL) ||
+        written != records.length()) {
+        WriteToLog("ERRORE: Scrittura journal file processati fallita: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    processedJournalRecords += count;
+    return true;
 }
-function esc(s){if(!s)return"";var d=document.createElement("div");d.appendChild(document.createTextNode(s));return d.innerHTML;}
-function fmtInterval(s){if(s>=86400)return Math.floor(s/86400)+"g "+Math.floor((s%86400)/3600)+"h";if(s>=3600)return Math.floor(s/3600)+"h "+Math.floor((s%3600)/60)+"m";if(s>=60)return Math.floor(s/60)+"m "+s%60+"s";return s+"s";}
-initDays();loadData();setInterval(loadData,5000);
-</script>
-</body>
-</html>)html";
+
+void AppendProcessedJournalRecord(std::string& records, char op, const std::string& fullFilePath, unsigned int recorded) {
+    records += op;
+    records += fullFilePath;
+    if (recorded != 0) {
+        records += '\t';
+        records += std::to_string(recorded);
+    }
+    records += '\n';
 }
 
-std::string GetDashboardHtml() {
-    return R"html(<!DOCTYPE html>
-<html lang="it">
-<head>
-<meta charset="UTF-8">
-<meta name="viewport" content="width=device-width, initial-scale=1.0">
-<title>PTC Dashboard</title>
-<style>
-:root{--bg:#f5f7fb;--surface:#ffffff;--surface2:#f0f2f5;--border:#d4dae3;--primary:#0087cd;--primary-light:#45a5dc;--primary-bg:rgba(0,135,205,0.08);--green:#009246;--green-bg:rgba(0,146,70,0.1);--red:#ce2b37;--red-bg:rgba(206,43,55,0.1);--warning:#e8952e;--warning-bg:rgba(232,149,46,0.1);--text:#1a2332;--text2:#4a5c72;--text3:#8895a7;--radius:10px;--shadow:0 2px 12px rgba(0,0,0,0.06);}
-*{margin:0;padding:0;box-sizing:border-box;}
-body{font-family:'Segoe UI',system-ui,-apple-system,sans-serif;background:var(--bg);color:var(--text);min-height:100vh;}
-.top-bar{background:linear-gradient(135deg,var(--primary) 0%,#005a8c 100%);padding:14px 24px;display:flex;align-items:center;justify-content:space-between;position:sticky;top:0;z-index:50;box-shadow:0 2px 8px rgba(0,90,140,0.3);}
-.top-bar h1{font-size:1.3em;font-weight:700;color:white;}
-.top-bar a{color:rgba(255,255,255,0.85);text-decoration:none;font-size:0.9em;padding:6px 16px;border:1px solid rgba(255,255,255,0.4);border-radius:20px;transition:all 0.2s;}
-.top-bar a:hover{background:rgba(255,255,255,0.15);color:white;border-color:rgba(255,255,255,0.7);}
-.top-stripe{height:4px;background:linear-gradient(90deg,var(--green) 33%,#ffffff 33%,#ffffff 66%,var(--red) 66%);}
-.main{max-width:1440px;margin:0 auto;padding:20px;}
-.stats{display:grid;grid-template-columns:repeat(auto-fit,minmax(160px,1fr));gap:14px;margin-bottom:24px;}
-.stat-card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:16px 20px;box-shadow:var(--shadow);transition:border-color 0.2s,transform 0.2s;}
-.stat-card:hover{border-color:var(--primary);transform:translateY(-2px);}
-.stat-label{font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;margin-bottom:4px;}
-.stat-value{font-size:1.5em;font-weight:700;color:var(--text);}
-.stat-value.on{color:var(--green);}
-.stat-value.off{color:var(--red);}
-.grid2{display:grid;grid-template-columns:1fr 1fr;gap:16px;margin-bottom:16px;}
-.card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:20px;margin-bottom:16px;box-shadow:var(--shadow);}
-.card-title{font-size:1.1em;font-weight:700;color:var(--text);margin-bottom:14px;padding-bottom:10px;border-bottom:2px solid var(--primary);}
-table{width:100%;border-collapse:collapse;}
-th{text-align:left;padding:10px 14px;font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;border-bottom:2px solid var(--border);font-weight:600;background:var(--surface2);}
-td{padding:10px 14px;border-bottom:1px solid var(--border);font-size:0.9em;}
-tr:hover td{background:var(--primary-bg);}
-.badge{display:inline-flex;align-items:center;gap:6px;padding:3px 10px;border-radius:20px;font-size:0.78em;font-weight:600;}
-.badge-on{background:var(--green-bg);color:var(--green);}
-.badge-off{background:var(--red-bg);color:var(--red);}
-.dot{width:8px;height:8px;border-radius:50%;display:inline-block;}
-.dot-on{background:var(--green);box-shadow:0 0 6px var(--green);}
-.dot-off{background:var(--red);}
-.mono{font-family:'Cascadia Code','Fira Code',monospace;font-size:0.85em;color:var(--primary);background:var(--primary-bg);padding:2px 8px;border-radius:4px;}
-.activity-list{max-height:320px;overflow-y:auto;}
-.activity-item{padding:8px 0;border-bottom:1px solid var(--border);display:flex;justify-content:space-between;align-items:flex-start;gap:12px;font-size:0.85em;}
-.activity-item:last-child{border-bottom:none;}
-.activity-msg{color:var(--text2);flex:1;word-break:break-word;}
-.activity-time{color:var(--text3);font-size:0.8em;white-space:nowrap;}
-.loading{text-align:center;padding:60px;color:var(--text2);font-size:1.1em;}
-.error-box{background:var(--red-bg);border:1px solid var(--red);color:var(--red);padding:16px;border-radius:var(--radius);margin:20px 0;}
-@media(max-width:768px){.main{padding:12px;}.stats{grid-template-columns:1fr 1fr;}.grid2{grid-template-columns:1fr;}th,td{padding:8px 6px;font-size:0.82em;}}
-</style>
-</head>
-<body>
-<div class="top-bar">
-    <h1>PTC Dashboard</h1>
-    <a href="/scheduler">Schedulatore</a>
-</div>
-<div class="top-stripe"></div>
-<div class="main">
-    <div id="loading" class="loading">Caricamento dati...</div>
-    <div id="error" class="error-box" style="display:none;"></div>
-    <div id="dashboard" style="display:none;">
-        <div class="stats">
-            <div class="stat-card"><div class="stat-label">File Processati</div><div class="stat-value" id="totalFiles">-</div></div>
-            <div class="stat-card"><div class="stat-label">File Oggi</div><div class="stat-value" id="todayFiles">-</div></div>
-            <div class="stat-card"><div class="stat-label">Comandi Eseguiti</div><div class="stat-value" id="commandsExecuted">-</div></div>
-            <div class="stat-card"><div class="stat-label">Errori</div><div class="stat-value" id="errorsCount">-</div></div>
-            <div class="stat-card"><div class="stat-label">Memoria</div><div class="stat-value" id="memoryUsage">-</div></div>
-            <div class="stat-card"><div class="stat-label">Thread Attivi</div><div class="stat-value" id="activeThreads">-</div></div>
-            <div class="stat-card"><div class="stat-label">Uptime</div><div class="stat-value" id="uptime">-</div></div>
-            <div class="stat-card"><div class="stat-label">Ultima Attivita</div><div class="stat-value" id="lastActivity" style="font-size:0.9em;">-</div></div>
-        </div>
-        <div class="grid2">
-            <div class="card">
-                <div class="card-title">Monitoraggio</div>
-                <table>
-                    <tr><td style="color:var(--text2)">Cartelle Monitorate</td><td style="text-align:right;font-weight:700" id="foldersCount">-</td></tr>
-                    <tr><td style="color:var(--text2)">Pattern Configurati</td><td style="text-align:right;font-weight:700" id="patternsCount">-</td></tr>
-                    <tr><td style="color:var(--text2)">Web Server</td><td style="text-align:right" id="webServerStatus">-</td></tr>
-                    <tr><td style="color:var(--text2)">Schedulatore</td><td style="text-align:right" id="schedulerStatus">-</td></tr>
-                    <tr><td style="color:var(--text2)">Tempo Medio Elaborazione</td><td style="text-align:right;font-weight:700" id="avgProcessing">-</td></tr>
-                </table>
-            </div>
-            <div class="card">
-                <div class="card-title">Attivita Recente</div>
-                <div id="recentActivity" class="activity-list">Caricamento...</div>
-            </div>
-        </div>
-        <div class="card">
-            <div class="card-title">Cartelle Monitorate</div>
-            <div style="overflow-x:auto;">
-            <table>
-                <thead><tr><th>Stato</th><th>Percorso</th><th>File Rilevati</th><th>File Processati</th></tr></thead>
-                <tbody id="foldersTableBody"></tbody>
-            </table>
-            </div>
-        </div>
-        <div class="card">
-            <div class="card-title">Pattern Configurati</div>
-            <div style="overflow-x:auto;">
-            <table>
-                <thead><tr><th>Nome</th><th>Cartella</th><th>Regex</th><th>Match</th><th>Esecuzioni</th></tr></thead>
-                <tbody id="patternsTableBody"></tbody>
-            </table>
-            </div>
-        </div>
-    </div>
-</div>
-<script>
-function fmtUp(s){if(s<0)return"N/A";var d=Math.floor(s/86400),h=Math.floor((s%86400)/3600),m=Math.floor((s%3600)/60);if(d>0)return d+"g "+h+"h "+m+"m";if(h>0)return h+"h "+m+"m";return m+"m";}
-function fmtAgo(s){if(s<0)return"Mai";if(s<60)return s+"s fa";if(s<3600)return Math.floor(s/60)+"m fa";if(s<86400)return Math.floor(s/3600)+"h fa";return Math.floor(s/86400)+"g fa";}
-function fmtTs(ts){var d=new Date(ts*1000);return d.toLocaleTimeString();}
-function esc(s){if(!s)return"";var d=document.createElement("div");d.appendChild(document.createTextNode(s));return d.innerHTML;}
-function update(){
-    var xhr=new XMLHttpRequest();
-    xhr.open("GET","/api/metrics",true);
-    xhr.onload=function(){
-        if(xhr.status!==200)return;
-        var data=JSON.parse(xhr.responseText);
-        document.getElementById("loading").style.display="none";
-        document.getElementById("error").style.display="none";
-        document.getElementById("dashboard").style.display="block";
-        document.getElementById("totalFiles").textContent=data.totalFilesProcessed;
-        document.getElementById("todayFiles").textContent=data.filesProcessedToday;
-        document.getElementById("commandsExecuted").textContent=data.commandsExecuted;
-        document.getElementById("errorsCount").textContent=data.errorsCount;
-        document.getElementById("memoryUsage").textContent=data.memoryUsageMB+" MB";
-        document.getElementById("activeThreads").textContent=data.activeThreads;
-        document.getElementById("avgProcessing").textContent=data.averageProcessingTime+" ms";
-        document.getElementById("uptime").textContent=fmtUp(data.uptimeSeconds);
-        document.getElementById("lastActivity").textContent=fmtAgo(data.lastActivitySeconds);
-        document.getElementById("foldersCount").textContent=data.foldersMonitored;
-        document.getElementById("patternsCount").textContent=data.patternsConfigured;
-        document.getElementById("webServerStatus").innerHTML=data.webServerRunning?"<span class='badge badge-on'><span class='dot dot-on'></span>Attivo</span>":"<span class='badge badge-off'><span class='dot dot-off'></span>Inattivo</span>";
-        document.getElementById("schedulerStatus").innerHTML=data.schedulerEnabled?"<span class='badge badge-on'><span class='dot dot-on'></span>"+data.schedulerTasks+" task</span>":"<span class='badge badge-off'><span class='dot dot-off'></span>Off</span>";
-        var fb=document.getElementById("foldersTableBody");fb.innerHTML="";
-        data.folders.forEach(function(f){
-            var tr=document.createElement("tr");
-            tr.innerHTML="<td><span class='badge "+(f.active?"badge-on":"badge-off")+"'><span class='dot "+(f.active?"dot-on":"dot-off")+"'></span>"+(f.active?"Attivo":"Off")+"</span></td>"
-                +"<td>"+esc(f.path)+"</td><td>"+f.filesDetected+"</td><td>"+f.filesProcessed+"</td>";
-            fb.appendChild(tr);
+bool AppendProcessedJournal(char op, const std::string& fullFilePath, unsigned int recorded = 0) {
+    std::string record;
+    record.reserve(fullFilePath.length() + 16);
+    AppendProcessedJournalRecord(record, op, fullFilePath, recorded);
+    return AppendProcessedJournalRecords(record, 1);
+}
+
+// Applica un journal al set in memoria; restituisce il numero di record applicati
+size_t ReplayProcessedJournal(const std::string& journalPath) {
+    std::ifstream journal(journalPath.c_str(), std::ios::binary);
+    if (!journal.is_open()) return 0;
+    
+    std::string content((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+    journal.close();
+    
+    size_t applied = 0;
+    size_t pos = 0;
+    while (pos < content.length()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) {
+            // Record finale senza terminatore: scrittura interrotta da un crash
+            WriteToLog("AVVISO: Record troncato ignorato nel journal: " + journalPath);
+            break;
+        }
+        
+        size_t lineEnd = end;
+        if (lineEnd > pos && content[lineEnd - 1] == '\r') lineEnd--;
+        
+        if (lineEnd > pos + 1) {
+            char op = content[pos];
+            std::string path = content.substr(pos + 1, lineEnd - pos - 1);
+            unsigned int recorded = 0;
+            size_t tab = path.find('\t');
+            if (tab != std::string::npos) {
+                recorded = static_cast<unsigned int>(strtoul(path.c_str() + tab + 1, NULL, 10));
+                path.erase(tab);
+            }
+            if (op == '+') {
+                processedFiles.Insert(path, recorded);
+                applied++;
+            } else if (op == '-') {
+                processedFiles.Erase(path);
+                applied++;
+            }
+        }
+        pos = end + 1;
+    }
+    
+    return applied;
+}
+
+// Legge uno snapshot nel formato testuale storico
+bool LoadProcessedTextSnapshot(const std::string& path, ProcessedFileIndex& index) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) return false;
+    
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) {
+            index.Insert(line);
+        }
+    }
+    return true;
+}
+
+// Conversione una tantum dal formato testuale all'immagine binaria. I journal non
+// vengono toccati: si riapplicano all'immagine come allo snapshot testuale.
+bool ConvertProcessedTextDb() {
+    ProcessedFileIndex index;
+    if (!LoadProcessedTextSnapshot(processedFilesDb, index)) {
+        WriteToLog("ERRORE: Database testuale non trovato: " + processedFilesDb);
+        return false;
+    }
+    
+    std::string tempPath = ProcessedImagePath() + ".tmp";
+    ProcessedDbImageWriter writer;
+    bool ok = writer.Open(tempPath, index.Size());
+    if (ok) {
+        // Il formato testuale non ha istanti: la retention parte dalla conversione
+        unsigned int now = ProcessedTimestampNow();
+        index.ForEach([&writer, now](const std::string& path) { writer.Add(path, now); });
+        ok = writer.Finish();
+    }
+    if (!ok || !MoveFileEx(tempPath.c_str(), ProcessedImagePath().c_str(),
+                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        WriteToLog("ERRORE: Conversione database file processati fallita: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        DeleteFile(tempPath.c_str());
+        return false;
+    }
+    
+    MoveFileEx(processedFilesDb.c_str(), ProcessedTextBackupPath().c_str(), MOVEFILE_REPLACE_EXISTING);
+    WriteToLog("Database file processati convertito in formato binario: " + std::to_string(writer.Count()) +
+               " voci, originale in " + ProcessedTextBackupPath());
+    return true;
+}
+
+void LoadProcessedFiles() {
+    // Anche la compattazione legge l'immagine: non va chiusa mentre e' in corso
+    std::lock_guard<std::mutex> compactionLock(processedCompactionMutex);
+    std::lock_guard<std::mutex> lock(processedFilesMutex);
+    
+    CloseProcessedJournal();
+    processedFiles.Clear();
+    processedJournalRecords = 0;
+    
+    std::string imagePath = ProcessedImagePath();
+    if (!FileExists(imagePath) && FileExists(processedFilesDb)) {
+        ConvertProcessedTextDb();
+    }
+    
+    bool snapshotFound = false;
+    if (FileExists(imagePath)) {
+        std::string error;
+        snapshotFound = processedFiles.image.Open(imagePath, error);
+        if (!snapshotFound) {
+            WriteToLog("ERRORE: Immagine database file processati non valida (" + error + "): " + imagePath);
+            systemMetrics.errorsCount++;
+        }
+    }
+    if (!snapshotFound && FileExists(processedFilesDb)) {
+        // Conversione non riuscita: snapshot testuale caricato nell'overlay
+        snapshotFound = LoadProcessedTextSnapshot(processedFilesDb, processedFiles.added);
+    }
+    
+    size_t replayed = ReplayProcessedJournal(ProcessedJournalOldPath());
+    replayed += ReplayProcessedJournal(ProcessedJournalPath());
+    processedJournalRecords = replayed;
+    
+    if (snapshotFound || replayed > 0) {
+        WriteToLog("Caricati " + std::to_string(processedFiles.Size()) + " file dal database (" +
+                   std::to_string(replayed) + " record journal)");
+    } else {
+        WriteToLog("Database file processati non trovato, verrà creato");
+    }
+    systemMetrics.totalFilesProcessed = processedFiles.Size();
+    // Il journal viene aperto in append alla prima scrittura
+}
+
+// Scrive uno snapshot completo e tronca il journal
+void SaveProcessedFiles() {
+    CompactProcessedFiles();
+}
+
+bool CompactProcessedFiles() {
+    std::lock_guard<std::mutex> compactionLock(processedCompactionMutex);
+    
+    // L'immagine mappata cambia solo sotto processedCompactionMutex: le fasi senza
+    // processedFilesMutex possono leggerla. Si copia soltanto l'overlay.
+    ProcessedFileIndex added, removed;
+    std::string journalPath = ProcessedJournalPath();
+    std::string oldJournalPath = ProcessedJournalOldPath();
+    std::string imagePath = ProcessedImagePath();
+    
+    // Fase 1 (sotto lock): copia dell'overlay e rotazione del journal
+    {
+        std::lock_guard<std::mutex> lock(processedFilesMutex);
+        added.Reserve(processedFiles.added.Size());
+        processedFiles.added.ForEachRecorded([&added](const std::string& path, unsigned int recorded) {
+            added.Insert(path, recorded);
         });
-        var pb=document.getElementById("patternsTableBody");pb.innerHTML="";
-        data.patterns.forEach(function(p){
-            var tr=document.createElement("tr");
-            tr.innerHTML="<td><strong>"+esc(p.name)+"</strong></td><td>"+esc(p.folder)+"</td>"
-                +"<td><span class='mono'>"+esc(p.regex)+"</span></td><td>"+p.matchCount+"</td><td>"+p.executionCount+"</td>";
-            pb.appendChild(tr);
+        processedFiles.removed.ForEach([&removed](const std::string& path) { removed.Insert(path); });
+        
+        CloseProcessedJournal();
+        if (FileExists(journalPath)) {
+            if (FileExists(oldJournalPath)) {
+                // Compattazione precedente non conclusa: accoda al journal ruotato esistente
+                std::ifstream current(journalPath.c_str(), std::ios::binary);
+                std::ofstream old(oldJournalPath.c_str(), std::ios::binary | std::ios::app);
+                old << current.rdbuf();
+                current.close();
+                old.close();
+                DeleteFile(journalPath.c_str());
+            } else {
+                MoveFileEx(journalPath.c_str(), oldJournalPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+            }
+        }
+        processedJournalRecords = 0;
+        OpenProcessedJournal();
+    }
+    
+    // Fase 2 (senza lock): immagine corrente meno le rimozioni, piu' le aggiunte
+    std::string tempPath = imagePath + ".tmp";
+    const ProcessedDbImage& image = processedFiles.image;
+    ProcessedDbImageWriter writer;
+    bool ok = writer.Open(tempPath, image.Size() - removed.Size() + added.Size());
+    if (ok) {
+        // Le voci senza istante (formati precedenti) ricevono quello della compattazione
+        unsigned int now = ProcessedTimestampNow();
+        image.ForEachRecorded([&writer, &removed, now](const std::string& path, unsigned int recorded) {
+            if (!removed.Contains(path)) writer.Add(path, recorded != 0 ? recorded : now);
         });
-        var ad=document.getElementById("recentActivity");ad.innerHTML="";
-        data.recentActivity.forEach(function(a){
-            var div=document.createElement("div");div.className="activity-item";
-            div.innerHTML="<span class='activity-msg'>"+esc(a.message)+"</span><span class='activity-time'>"+fmtTs(a.timestamp)+"</span>";
-            ad.appendChild(div);
+        added.ForEachRecorded([&writer, now](const std::string& path, unsigned int recorded) {
+            writer.Add(path, recorded != 0 ? recorded : now);
         });
-    };
-    xhr.onerror=function(){
-        document.getElementById("loading").style.display="none";
-        document.getElementById("dashboard").style.display="none";
-        var e=document.getElementById("error");e.textContent="Errore di connessione";e.style.display="block";
-    };
-    xhr.send();
+        ok = writer.Finish();
+    }
+    if (!ok) {
+        // Il journal ruotato resta su disco e verra' riapplicato al caricamento
+        WriteToLog("ERRORE: Impossibile salvare database file processati: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        DeleteFile(tempPath.c_str());
+        return false;
+    }
+    
+    // Fase 3 (sotto lock): sostituzione atomica e nuovo overlay dal solo journal corrente.
+    // Un file mappato non puo' essere sostituito: la vista viene chiusa prima.
+    {
+        std::lock_guard<std::mutex> lock(processedFilesMutex);
+        processedFiles.image.Close();
+        bool replaced = MoveFileEx(tempPath.c_str(), imagePath.c_str(),
+                                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+        DWORD moveError = GetLastError();
+        
+        std::string error;
+        if (!processedFiles.image.Open(imagePath, error)) {
+            WriteToLog("ERRORE: Riapertura immagine database file processati fallita (" + error + ")");
+            systemMetrics.errorsCount++;
+        }
+        if (!replaced) {
+            // Overlay intatto sull'immagine precedente; il journal ruotato resta su disco
+            WriteToLog("ERRORE: Impossibile salvare database file processati: " + std::to_string(moveError));
+            systemMetrics.errorsCount++;
+            DeleteFile(tempPath.c_str());
+            return false;
+        }
+        
+        processedFiles.added.Clear();
+        processedFiles.removed.Clear();
+        processedFiles.generation++;
+        CloseProcessedJournal();
+        ReplayProcessedJournal(journalPath);
+        
+        // Snapshot testuale rimasto da una conversione non riuscita: ormai superato
+        if (FileExists(processedFilesDb)) {
+            MoveFileEx(processedFilesDb.c_str(), ProcessedTextBackupPath().c_str(), MOVEFILE_REPLACE_EXISTING);
+        }
+    }
+    
+    DeleteFile(oldJournalPath.c_str());
+    WriteToLog("Salvati " + std::to_string(writer.Count()) + " file nel database", true);
+    return true;
 }
-update();setInterval(update,2000);
-</script>
-</body>
-</html>)html";
+
+void ProcessedDbCompactionWorker() {
+    WriteToLog("Avvio thread compattazione database file processati");
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    
+    while (!globalShutdown) {
+        if (processedJournalRecords >= static_cast<size_t>(journalCompactThreshold)) {
+            WriteToLog("Compattazione database: " + std::to_string(processedJournalRecords.load()) + 
+                       " record nel journal", true);
+            CompactProcessedFiles();
+        }
+        
+        // Checkpoint periodico delle istantanee cartelle (oltre a quello allo shutdown)
+        if (snapshotCheckpointSeconds > 0 &&
+            std::chrono::steady_clock::now() - lastCheckpoint >= std::chrono::seconds(snapshotCheckpointSeconds)) {
+            SaveAllFolderSnapshots();
+            lastCheckpoint = std::chrono::steady_clock::now();
+        }
+        // Sleep frazionato per rispondere rapidamente a globalShutdown
+        for (int i = 0; i < 50 && !globalShutdown; ++i) {
+            Sleep(100);
+        }
+    }
+    
+    WriteToLog("Thread compattazione database terminato");
 }
 
-std::string HandleHttpRequest(const std::string& request) {
-    std::string response;
-    
-    if (request.find("GET / ") != std::string::npos || request.find("GET /dashboard") != std::string::npos) {
-        std::string html = GetDashboardHtml();
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: text/html; charset=utf-8\r\n";
-        response += "Content-Length: " + std::to_string(html.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "\r\n";
-        response += html;
-    }
-    else if (request.find("GET /scheduler") != std::string::npos) {
-        std::string html = GetSchedulerPageHtml();
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: text/html; charset=utf-8\r\n";
-        response += "Content-Length: " + std::to_string(html.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "\r\n";
-        response += html;
-    }
-    else if (request.find("GET /api/metrics") != std::string::npos) {
-        std::string json = GetSystemMetricsJson();
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: application/json\r\n";
-        response += "Content-Length: " + std::to_string(json.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "Access-Control-Allow-Origin: *\r\n";
-        response += "\r\n";
-        response += json;
-    }
-    else if (request.find("GET /api/scheduler/scripts") != std::string::npos) {
-        std::string json = GetSchedulerScriptsJson();
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: application/json\r\n";
-        response += "Content-Length: " + std::to_string(json.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "Access-Control-Allow-Origin: *\r\n";
-        response += "\r\n";
-        response += json;
-    }
-    else if (request.find("GET /api/scheduler") != std::string::npos) {
-        std::string json = GetSchedulerJson();
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: application/json\r\n";
-        response += "Content-Length: " + std::to_string(json.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "Access-Control-Allow-Origin: *\r\n";
-        response += "\r\n";
-        response += json;
-    }
-    else if (request.find("POST /api/scheduler/save") != std::string::npos) {
-        std::string body = GetHttpRequestBody(request);
-        std::string name = ExtractJsonValue(body, "name");
-        std::string originalName = ExtractJsonValue(body, "originalName");
-        std::string daysStr = ExtractJsonValue(body, "days");
-        std::string hoursStr = ExtractJsonValue(body, "hours");
-        std::string minutesStr = ExtractJsonValue(body, "minutes");
-        std::string command = ExtractJsonValue(body, "command");
-        std::string enabledStr = ExtractJsonValue(body, "enabled");
-        std::string intervalStr = ExtractJsonValue(body, "intervalSeconds");
-
-        std::string resultJson;
-
-        if (name.empty() || command.empty()) {
-            resultJson = "{\"success\": false, \"error\": \"Nome e comando sono obbligatori\"}";
-        } else {
-            // Se il nome originale e' diverso, elimina il vecchio file
-            if (!originalName.empty() && originalName != name) {
-                DeleteSchedulerTask(originalName);
-            }
-
-            SchedulerTask task;
-            task.name = name;
-            task.enabled = (enabledStr != "false");
-            task.command = command;
-            try { task.intervalSeconds = std::stoi(intervalStr); } catch (...) { task.intervalSeconds = 0; }
-
-            // Parse days
-            std::istringstream dss(daysStr);
-            std::string day;
-            while (std::getline(dss, day, ',')) {
-                day.erase(0, day.find_first_not_of(" \t"));
-                day.erase(day.find_last_not_of(" \t") + 1);
-                int d = DayNameToNumber(day);
-                if (d >= 0) task.days.insert(d);
-            }
-
-            // Parse hours
-            std::istringstream hss(hoursStr);
-            std::string hour;
-            while (std::getline(hss, hour, ',')) {
-                hour.erase(0, hour.find_first_not_of(" \t"));
-                hour.erase(hour.find_last_not_of(" \t") + 1);
-                try { int h = std::stoi(hour); if (h >= 0 && h <= 23) task.hours.insert(h); } catch (...) {}
-            }
-
-            // Parse minutes
-            std::istringstream mss(minutesStr);
-            std::string minute;
-            while (std::getline(mss, minute, ',')) {
-                minute.erase(0, minute.find_first_not_of(" \t"));
-                minute.erase(minute.find_last_not_of(" \t") + 1);
-                try { int m = std::stoi(minute); if (m >= 0 && m <= 59) task.minutes.insert(m); } catch (...) {}
-            }
-
-            if (SaveSchedulerTask(task)) {
-                // Ricarica i task dal filesystem
-                LoadSchedulerTasks();
-                resultJson = "{\"success\": true}";
-            } else {
-                resultJson = "{\"success\": false, \"error\": \"Errore salvataggio su disco\"}";
+// Prefiltro di watcher, scansione e coda: con DedupMode diverso da path confronta la
+// chiave metadati, il contenuto viene verificato dall'esecutore (AreDedupKeysProcessed)
+bool IsFileAlreadyProcessed(const std::string& fullFilePath) {
+    std::string key = PrefilterDedupKey(fullFilePath);
+    if (key.empty()) return false;
+    std::lock_guard<std::mutex> lock(processedFilesMutex);
+    return processedFiles.Contains(key);
+}
+
+bool RecordProcessedFile(const std::string& fullFilePath) {
+    unsigned int now = ProcessedTimestampNow();
+    std::lock_guard<std::mutex> lock(processedFilesMutex);
+    if (!processedFiles.Insert(fullFilePath, now)) return false;
+    AppendProcessedJournal('+', fullFilePath, now);
+    return true;
+}
+
+void MarkFileAsProcessed(const std::string& fullFilePath, const std::vector<std::string>& keys) {
+    RecordProcessedFiles(keys);
+    WriteToLog("File marcato come processato: " + fullFilePath, true);
+    
+    systemMetrics.totalFilesProcessed++;
+    systemMetrics.filesProcessedToday++;
+    systemMetrics.lastFileProcessed = std::chrono::steady_clock::now();
+}
+
+// Marca un gruppo di file sotto un solo lock e con una sola scrittura del journal
+size_t RecordProcessedFiles(const std::vector<std::string>& fullFilePaths) {
+    std::string records;
+    size_t added = 0;
+    unsigned int now = ProcessedTimestampNow();
+    
+    std::lock_guard<std::mutex> lock(processedFilesMutex);
+    for (const auto& path : fullFilePaths) {
+        if (!processedFiles.Insert(path, now)) continue;
+        AppendProcessedJournalRecord(records, '+', path, now);
+        added++;
+    }
+    if (added > 0) AppendProcessedJournalRecords(records, added);
+    return added;
+}
+
+void MarkFilesAsProcessed(const std::vector<std::string>& fullFilePaths, const std::vector<std::string>& keys) {
+    RecordProcessedFiles(keys);
+    WriteToLog("Marcati come processati " + std::to_string(fullFilePaths.size()) + " file del batch", true);
+    
+    systemMetrics.totalFilesProcessed += fullFilePaths.size();
+    systemMetrics.filesProcessedToday += fullFilePaths.size();
+    systemMetrics.lastFileProcessed = std::chrono::steady_clock::now();
+}
+
+void ForgetProcessedKey(const std::string& key) {
+    std::lock_guard<std::mutex> lock(processedFilesMutex);
+    if (processedFiles.Erase(key)) {
+        AppendProcessedJournal('-', key);
+    }
+}
+
+// Dimentica il file con tutte le sue chiavi di deduplicazione (comando reprocess)
+void UnmarkFileAsProcessed(const std::string& fullFilePath) {
+    ForgetProcessedKey(fullFilePath);
+    if (dedupMode == DedupPath) return;
+    for (const auto& key : ComputeDedupKeys(fullFilePath)) ForgetProcessedKey(key);
+}
+
+// ====== RETENTION DATABASE FILE PROCESSATI ======
+// Ogni ProcessedSweepIntervalMinutes un passaggio scorre tutte le voci (immagine, poi
+// overlay) a fette di PROCESSED_SWEEP_SLICE: sotto lock si copiano solo percorso e
+// istante, la decisione (registrata da piu' di ProcessedRetentionDays giorni, oppure
+// file non piu' esistente con ProcessedEvictMissing) avviene senza lock e la rimozione
+// verifica sotto lock che la voce non sia stata registrata di nuovo nel frattempo.
+// Le ricerche attendono al massimo una fetta. Le rimozioni vanno nel journal come
+// "-percorso" e lo spazio viene recuperato dalla compattazione successiva.
+
+struct ProcessedSweepCandidate {
+    std::string path;
+    unsigned int recorded;
+    bool expired;
+};
+
+// Byte occupati da una voce nell'immagine: nome, descrittore, slot e istante
+size_t ProcessedEntryFootprint(const std::string& path) {
+    return path.length() + sizeof(ProcessedDbImageEntry) + sizeof(ProcessedDbImageSlot) + sizeof(unsigned int);
+}
+
+// La voce puo' essere una chiave di deduplicazione: "percorso|metadati" o "#impronta"
+// (nessun file associato, resta fino alla scadenza)
+bool ProcessedFileMissing(const std::string& key) {
+    if (!key.empty() && key[0] == '#') return false;
+    std::string path = key.substr(0, key.find('|'));
+    if (GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES) return false;
+    // Share non raggiungibile o accesso negato: nel dubbio la voce resta
+    DWORD error = GetLastError();
+    return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+}
+
+void RunProcessedSweepPass() {
+    unsigned int now = ProcessedTimestampNow();
+    unsigned int retentionSeconds = static_cast<unsigned int>(processedRetentionDays) * 86400u;
+    unsigned int cutoff = (retentionSeconds > 0 && now > retentionSeconds) ? now - retentionSeconds : 0;
+    bool evictMissing = processedEvictMissing;
+    
+    size_t imageCursor = 0;
+    size_t addedCursor = 0;
+    size_t generation = 0;
+    bool started = false;
+    size_t expired = 0;
+    size_t missing = 0;
+    unsigned long long bytes = 0;
+    std::vector<ProcessedSweepCandidate> candidates;
+    candidates.reserve(PROCESSED_SWEEP_SLICE);
+    auto start = std::chrono::steady_clock::now();
+    
+    while (!globalShutdown) {
+        candidates.clear();
+        {
+            std::lock_guard<std::mutex> lock(processedFilesMutex);
+            if (!started || generation != processedFiles.generation) {
+                // Dopo una compattazione l'overlay e' confluito in coda all'immagine, che
+                // mantiene l'ordine: si prosegue dalla stessa posizione. Le voci scalate
+                // indietro dalle rimozioni vengono riviste al passaggio successivo.
+                if (started) addedCursor = 0;
+                generation = processedFiles.generation;
+                started = true;
+            }
+            
+            ProcessedSweepCandidate candidate;
+            candidate.expired = false;
+            const ProcessedDbImage& image = processedFiles.image;
+            while (candidates.size() < PROCESSED_SWEEP_SLICE && imageCursor < image.Size()) {
+                if (image.EntryAt(imageCursor++, candidate.path, candidate.recorded) &&
+                    !processedFiles.removed.Contains(candidate.path)) {
+                    candidates.push_back(candidate);
+                }
+            }
+            const ProcessedFileIndex& added = processedFiles.added;
+            while (candidates.size() < PROCESSED_SWEEP_SLICE && addedCursor < added.EntryCount()) {
+                if (added.EntryAt(addedCursor++, candidate.path, candidate.recorded)) {
+                    candidates.push_back(candidate);
+                }
+            }
+        }
+        if (candidates.empty()) break;
+        
+        // Senza lock: GetFileAttributes puo' costare millisecondi sulle share di rete
+        size_t evicted = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            ProcessedSweepCandidate& candidate = candidates[i];
+            // Istante 0: voce di un formato precedente, ancora senza istante
+            candidate.expired = cutoff > 0 && candidate.recorded != 0 && candidate.recorded < cutoff;
+            if (!candidate.expired && !(evictMissing && ProcessedFileMissing(candidate.path))) continue;
+            if (evicted != i) candidates[evicted] = std::move(candidate);
+            evicted++;
+        }
+        candidates.resize(evicted);
+        
+        if (!candidates.empty()) {
+            std::string records;
+            size_t removedCount = 0;
+            std::lock_guard<std::mutex> lock(processedFilesMutex);
+            for (const auto& candidate : candidates) {
+                unsigned int recorded = 0;
+                if (!processedFiles.Lookup(candidate.path, recorded) || recorded != candidate.recorded) continue;
+                if (!processedFiles.Erase(candidate.path)) continue;
+                AppendProcessedJournalRecord(records, '-', candidate.path, 0);
+                removedCount++;
+                size_t footprint = ProcessedEntryFootprint(candidate.path);
+                bytes += footprint;
+                processedBytesReclaimed += footprint;
+                if (candidate.expired) {
+                    expired++;
+                    processedEvictedExpired++;
+                } else {
+                    missing++;
+                    processedEvictedMissing++;
+                }
+            }
+            if (removedCount > 0) AppendProcessedJournalRecords(records, removedCount);
+        }
+        
+        Sleep(PROCESSED_SWEEP_PAUSE_MS);
+    }
+    
+    if (expired > 0 || missing > 0) {
+        WriteToLog("Retention database: rimosse " + std::to_string(expired) + " voci scadute e " +
+                   std::to_string(missing) + " voci di file non piu' esistenti (" + std::to_string(bytes / 1024) +
+                   " KB) in " + std::to_string(static_cast<long long>(ElapsedMs(start))) + " ms");
+    }
+}
+
+void ProcessedSweepWorker() {
+    WriteToLog("Avvio thread retention database file processati");
+    auto nextPass = std::chrono::steady_clock::now() + std::chrono::seconds(PROCESSED_SWEEP_START_DELAY_SECONDS);
+    
+    while (!globalShutdown) {
+        if ((processedRetentionDays > 0 || processedEvictMissing) && std::chrono::steady_clock::now() >= nextPass) {
+            RunProcessedSweepPass();
+            nextPass = std::chrono::steady_clock::now() + std::chrono::minutes(processedSweepIntervalMinutes);
+        }
+        // Sleep frazionato per rispondere rapidamente a globalShutdown
+        for (int i = 0; i < 10 && !globalShutdown; ++i) {
+            Sleep(100);
+        }
+    }
+    
+    WriteToLog("Thread retention database terminato");
+}
+
+// Opzioni del pattern separate da virgola: batch=N (file per processo), wait=MS (attesa
+// massima del primo file del gruppo), input=list|stdin (come passare la lista al comando),
+// workers=N (worker residenti) e timeout=MS (tempo massimo di risposta del worker)
+void ApplyPatternOptions(PatternCommandPair& pair, const std::string& options) {
+    std::stringstream stream(options);
+    std::string option;
+    
+    while (std::getline(stream, option, ',')) {
+        option.erase(0, option.find_first_not_of(" \t"));
+        option.erase(option.find_last_not_of(" \t") + 1);
+        if (option.empty()) continue;
+        
+        size_t eq = option.find('=');
+        std::string name = option.substr(0, eq);
+        std::string value = (eq != std::string::npos) ? option.substr(eq + 1) : std::string();
+        for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        for (auto& c : value) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        
+        if (name == "batch") {
+            try { pair.batchMaxFiles = std::stoi(value); } catch (...) { pair.batchMaxFiles = 0; }
+            if (pair.batchMaxFiles < 0) pair.batchMaxFiles = 0;
+            if (pair.batchMaxFiles > MAX_BATCH_FILES) pair.batchMaxFiles = MAX_BATCH_FILES;
+        } else if (name == "wait") {
+            try { pair.batchMaxWaitMs = std::stoi(value); } catch (...) { pair.batchMaxWaitMs = DEFAULT_BATCH_WAIT_MS; }
+            if (pair.batchMaxWaitMs < 0) pair.batchMaxWaitMs = 0;
+            if (pair.batchMaxWaitMs > MAX_BATCH_WAIT_MS) pair.batchMaxWaitMs = MAX_BATCH_WAIT_MS;
+        } else if (name == "workers") {
+            try { pair.residentWorkers = std::stoi(value); } catch (...) { pair.residentWorkers = 0; }
+            if (pair.residentWorkers < 0) pair.residentWorkers = 0;
+            if (pair.residentWorkers > MAX_RESIDENT_WORKERS) pair.residentWorkers = MAX_RESIDENT_WORKERS;
+        } else if (name == "timeout") {
+            try { pair.residentTimeoutMs = std::stoi(value); } catch (...) { pair.residentTimeoutMs = BATCH_TIMEOUT; }
+            if (pair.residentTimeoutMs < 100) pair.residentTimeoutMs = 100;
+        } else if (name == "input" && (value == "list" || value == "stdin")) {
+            pair.batchInput = (value == "stdin") ? PatternCommandPair::BatchInputStdin
+                                                 : PatternCommandPair::BatchInputListFile;
+        } else {
+            WriteToLog("AVVISO: Opzione pattern non valida [" + pair.patternName + "]: " + option);
+        }
+    }
+    
+    if (pair.builtinAction != PatternCommandPair::BuiltinNone && (pair.residentWorkers > 0 || pair.batchMaxFiles > 1)) {
+        WriteToLog("AVVISO: Pattern [" + pair.patternName + "] con azione integrata: batch= e workers= ignorati");
+        pair.residentWorkers = 0;
+        pair.batchMaxFiles = 0;
+    }
+    if (pair.residentWorkers > 0 && pair.batchMaxFiles > 1) {
+        WriteToLog("AVVISO: Pattern [" + pair.patternName + "] con workers= e batch=: uso i worker residenti");
+        pair.batchMaxFiles = 0;
+    }
+    if (pair.residentWorkers > 0) {
+        WriteToLog("Pattern [" + pair.patternName + "] con " + std::to_string(pair.residentWorkers) +
+                   " worker residenti, timeout " + std::to_string(pair.residentTimeoutMs) + " ms");
+    }
+    if (pair.batchMaxFiles > 1) {
+        WriteToLog("Pattern [" + pair.patternName + "] in micro-batch: max " + std::to_string(pair.batchMaxFiles) +
+                   " file, attesa max " + std::to_string(pair.batchMaxWaitMs) + " ms, lista " +
+                   (pair.batchInput == PatternCommandPair::BatchInputStdin ? "su stdin" : "su file"));
+    }
+}
+
+bool LoadConfiguration() {
+    std::lock_guard<std::mutex> lock(configMutex);
+    
+    WriteToLog("Caricamento configurazione da: " + configFile);
+    
+    if (!FileExists(configFile)) {
+        WriteToLog("File configurazione non trovato, creazione default");
+        
+        std::string configDir = configFile.substr(0, configFile.find_last_of("\\/"));
+        if (!CreateDirectoryRecursive(configDir)) {
+            WriteToLog("ERRORE: Impossibile creare directory configurazione: " + configDir);
+            return false;
+        }
+        
+        std::ofstream config(configFile.c_str());
+        if (config.is_open()) {
+            config << "# PatternTriggerCommand Configuration - Multi-Folder Support + Web Dashboard\n";
+            config << "# Autore: Umberto Meglio - Supporto: Claude di Anthropic\n\n";
+            config << "[Settings]\n";
+            config << "DefaultMonitoredFolder=" << defaultMonitoredFolder << "\n";
+            config << "LogFile=" << logFile << "\n";
+            config << "DetailedLogFile=" << detailedLogFile << "\n";
+            config << "ProcessedFilesDB=" << processedFilesDb << "\n";
+            config << "DetailedLogging=" << (detailedLogging ? "true" : "false") << "\n";
+            config << "WebServerPort=" << webServerPort << "\n";
+            config << "WebServerEnabled=" << (webServerEnabled ? "true" : "false") << "\n";
+            config << "SchedulerEnabled=" << (schedulerEnabled ? "true" : "false") << "\n";
+            config << "SchedulerFolder=" << schedulerFolder << "\n";
+            config << "WatcherThreads=" << watcherThreadCount << "\n";
+            config << "ScanThreads=" << scanThreadCount << "\n";
+            config << "NotificationBufferKB=" << notificationBufferKB << "\n";
+            config << "ExecutorThreads=" << executorThreadCount << "\n";
+            config << "MaxConcurrentProcesses=" << maxConcurrentProcesses << "\n";
+            config << "ExecutorQueueSize=" << executorQueueSize << "\n";
+            config << "JournalCompactThreshold=" << journalCompactThreshold << "\n";
+            config << "SnapshotCheckpointSeconds=" << snapshotCheckpointSeconds << "\n";
+            config << "ProcessedRetentionDays=" << processedRetentionDays << "\n";
+            config << "ProcessedEvictMissing=" << (processedEvictMissing ? "true" : "false") << "\n";
+            config << "ProcessedSweepIntervalMinutes=" << processedSweepIntervalMinutes << "\n";
+            config << "DedupMode=" << DedupModeName(dedupMode) << "\n";
+            config << "DebounceMs=" << debounceMs << "\n\n";
+            config << "[Debounce]\n";
+            config << "# Periodo di quiete per cartella in ms (sovrascrive DebounceMs)\n";
+            config << "# C:\\Monitored\\Invoices=2000\n\n";
+            config << "[Patterns]\n";
+            config << "Pattern1=C:\\Monitored\\Documents|^doc.*\\..*$|C:\\Scripts\\process_doc.bat\n";
+            config << "Pattern2=C:\\Monitored\\Invoices|^invoice.*\\.pdf$|C:\\Scripts\\process_invoice.bat\n";
+            config << "Pattern3=^report.*\\.xlsx$|C:\\Scripts\\process_report.bat\n";
+            config << "# Micro-batch: Cartella|Pattern|Comando|batch=N,wait=MS,input=list|stdin\n";
+            config << "# Pattern4=C:\\Monitored\\Logs|^.*\\.log$|C:\\Scripts\\import_logs.bat|batch=500,wait=5000\n";
+            config.close();
+            
+            WriteToLog("File configurazione default creato");
+        } else {
+            WriteToLog("ERRORE: Impossibile creare file configurazione");
+            return false;
+        }
+    }
+    
+    std::ifstream config(configFile.c_str());
+    if (!config.is_open()) {
+        WriteToLog("ERRORE: Impossibile aprire file configurazione");
+        return false;
+    }
+    
+    std::string line;
+    std::string currentSection;
+    bool hasPatterns = false;
+    
+    patternCommandPairs.clear();
+    folderDebounceMs.clear();
+    
+    while (std::getline(config, line)) {
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+        
+        size_t commentPos = line.find('#');
+        if (commentPos != std::string::npos) {
+            line = line.substr(0, commentPos);
+        }
+        
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t") + 1);
+        
+        if (line[0] == '[' && line[line.length() - 1] == ']') {
+            currentSection = line.substr(1, line.length() - 2);
+            continue;
+        }
+        
+        size_t equalPos = line.find('=');
+        if (equalPos == std::string::npos) continue;
+        
+        std::string key = line.substr(0, equalPos);
+        std::string value = line.substr(equalPos + 1);
+        
+        key.erase(0, key.find_first_not_of(" \t"));
+        key.erase(key.find_last_not_of(" \t") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t") + 1);
+        
+        if (currentSection == "Settings") {
+            if (key == "DefaultMonitoredFolder" || key == "MonitoredFolder") {
+                defaultMonitoredFolder = value;
+            } else if (key == "LogFile") {
+                logFile = value;
+            } else if (key == "DetailedLogFile") {
+                detailedLogFile = value;
+            } else if (key == "ProcessedFilesDB") {
+                processedFilesDb = value;
+            } else if (key == "DetailedLogging") {
+                detailedLogging = (value == "true" || value == "1" || value == "yes");
+            } else if (key == "WebServerPort") {
+                webServerPort = std::stoi(value);
+            } else if (key == "WebServerEnabled") {
+                webServerEnabled = (value == "true" || value == "1" || value == "yes");
+            } else if (key == "SchedulerEnabled") {
+                schedulerEnabled = (value == "true" || value == "1" || value == "yes");
+            } else if (key == "SchedulerFolder") {
+                schedulerFolder = value;
+            } else if (key == "WatcherThreads") {
+                try { watcherThreadCount = std::stoi(value); } catch (...) { watcherThreadCount = DEFAULT_WATCHER_THREADS; }
+            } else if (key == "ScanThreads") {
+                try { scanThreadCount = std::stoi(value); } catch (...) { scanThreadCount = DEFAULT_SCAN_THREADS; }
+                if (scanThreadCount < 1) scanThreadCount = 1;
+                if (scanThreadCount > MAX_SCAN_THREADS) scanThreadCount = MAX_SCAN_THREADS;
+            } else if (key == "NotificationBufferKB") {
+                try { notificationBufferKB = std::stoi(value); } catch (...) { notificationBufferKB = DEFAULT_NOTIFICATION_BUFFER_KB; }
+                if (notificationBufferKB < 4) notificationBufferKB = 4;
+                if (notificationBufferKB > MAX_NOTIFICATION_BUFFER_KB) notificationBufferKB = MAX_NOTIFICATION_BUFFER_KB;
+            } else if (key == "ExecutorThreads") {
+                try { executorThreadCount = std::stoi(value); } catch (...) { executorThreadCount = DEFAULT_EXECUTOR_THREADS; }
+            } else if (key == "MaxConcurrentProcesses") {
+                try { maxConcurrentProcesses = std::stoi(value); } catch (...) { maxConcurrentProcesses = DEFAULT_MAX_CONCURRENT_PROCESSES; }
+                if (maxConcurrentProcesses < 1) maxConcurrentProcesses = 1;
+                if (maxConcurrentProcesses > MAX_CONCURRENT_PROCESSES_LIMIT) maxConcurrentProcesses = MAX_CONCURRENT_PROCESSES_LIMIT;
+            } else if (key == "ExecutorQueueSize") {
+                try { executorQueueSize = std::stoi(value); } catch (...) { executorQueueSize = DEFAULT_EXECUTOR_QUEUE_SIZE; }
+            } else if (key == "JournalCompactThreshold") {
+                try { journalCompactThreshold = std::stoi(value); } catch (...) { journalCompactThreshold = DEFAULT_JOURNAL_COMPACT_THRESHOLD; }
+                if (journalCompactThreshold < 1) journalCompactThreshold = DEFAULT_JOURNAL_COMPACT_THRESHOLD;
+            } else if (key == "SnapshotCheckpointSeconds") {
+                try { snapshotCheckpointSeconds = std::stoi(value); } catch (...) { snapshotCheckpointSeconds = DEFAULT_SNAPSHOT_CHECKPOINT_SECONDS; }
+                if (snapshotCheckpointSeconds < 0) snapshotCheckpointSeconds = 0;
+            } else if (key == "ProcessedRetentionDays") {
+                try { processedRetentionDays = std::stoi(value); } catch (...) { processedRetentionDays = DEFAULT_PROCESSED_RETENTION_DAYS; }
+                if (processedRetentionDays < 0) processedRetentionDays = 0;
+                if (processedRetentionDays > MAX_PROCESSED_RETENTION_DAYS) processedRetentionDays = MAX_PROCESSED_RETENTION_DAYS;
+            } else if (key == "ProcessedEvictMissing") {
+                processedEvictMissing = (value == "true" || value == "1" || value == "yes");
+            } else if (key == "ProcessedSweepIntervalMinutes") {
+                try { processedSweepIntervalMinutes = std::stoi(value); } catch (...) { processedSweepIntervalMinutes = DEFAULT_PROCESSED_SWEEP_INTERVAL_MINUTES; }
+                if (processedSweepIntervalMinutes < 1) processedSweepIntervalMinutes = 1;
+            } else if (key == "DedupMode") {
+                std::string mode = value;
+                for (auto& c : mode) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                if (mode == "metadata") dedupMode = DedupMetadata;
+                else if (mode == "content") dedupMode = DedupContent;
+                else dedupMode = DedupPath;
+            } else if (key == "DebounceMs") {
+                try { debounceMs = std::stoi(value); } catch (...) { debounceMs = DEFAULT_DEBOUNCE_MS; }
+                if (debounceMs < 0) debounceMs = 0;
+                if (debounceMs > MAX_DEBOUNCE_MS) debounceMs = MAX_DEBOUNCE_MS;
+            }
+        } else if (currentSection == "Debounce") {
+            int folderMs;
+            try { folderMs = std::stoi(value); } catch (...) {
+                WriteToLog("AVVISO: Debounce ignorato, valore non valido: " + key + "=" + value);
+                continue;
+            }
+            if (folderMs < 0) folderMs = 0;
+            if (folderMs > MAX_DEBOUNCE_MS) folderMs = MAX_DEBOUNCE_MS;
+            folderDebounceMs[NormalizeFolderPath(key)] = folderMs;
+        } else if (currentSection == "Patterns") {
+            std::vector<std::string> parts;
+            std::string temp = value;
+            
+            size_t pos = 0;
+            while ((pos = temp.find('|')) != std::string::npos) {
+                parts.push_back(temp.substr(0, pos));
+                temp.erase(0, pos + 1);
+            }
+            if (!temp.empty()) {
+                parts.push_back(temp);
+            }
+            
+            std::string folderPath, pattern, command, options;
+            
+            if (parts.size() == 4) {
+                // Cartella|Pattern|Comando|Opzioni (cartella vuota = cartella default)
+                folderPath = parts[0];
+                pattern = parts[1];
+                command = parts[2];
+                options = parts[3];
+                if (folderPath.find_first_not_of(" \t") == std::string::npos) folderPath = defaultMonitoredFolder;
+            } else if (parts.size() == 3) {
+                folderPath = parts[0];
+                pattern = parts[1];
+                command = parts[2];
+            } else if (parts.size() == 2) {
+                folderPath = defaultMonitoredFolder;
+                pattern = parts[0];
+                command = parts[1];
+            } else {
+                WriteToLog("AVVISO: Pattern ignorato, formato non valido: " + value);
+                continue;
+            }
+            
+            folderPath.erase(0, folderPath.find_first_not_of(" \t"));
+            folderPath.erase(folderPath.find_last_not_of(" \t") + 1);
+            pattern.erase(0, pattern.find_first_not_of(" \t"));
+            pattern.erase(pattern.find_last_not_of(" \t") + 1);
+            command.erase(0, command.find_first_not_of(" \t"));
+            command.erase(command.find_last_not_of(" \t") + 1);
+            
+            try {
+                patternCommandPairs.emplace_back(folderPath, pattern, command, key);
+                if (!ParseBuiltinAction(patternCommandPairs.back())) {
+                    patternCommandPairs.pop_back();
+                    WriteToLog("AVVISO: Pattern ignorato, azione integrata non valida: " + value);
+                    continue;
+                }
+                ApplyPatternOptions(patternCommandPairs.back(), options);
+                hasPatterns = true;
+                WriteToLog("Pattern caricato: [" + key + "] '" + folderPath + 
+                          "' | '" + pattern + "' | '" + command + "'", true);
+            } catch (const std::regex_error& e) {
+                WriteToLog("ERRORE: Pattern regex non valido '" + pattern + "': " + e.what());
+                systemMetrics.errorsCount++;
+            }
+        }
+    }
+    
+    config.close();
+    RequestLogReopen();
+    BuildFolderMatchers();
+    
+    if (!hasPatterns) {
+        WriteToLog("ERRORE: Nessun pattern valido trovato");
+        return false;
+    }
+    
+    WriteToLog("Configurazione caricata - Pattern: " + std::to_string(patternCommandPairs.size()) + 
+               ", WebServer: " + (webServerEnabled ? "abilitato" : "disabilitato") + 
+               " porta " + std::to_string(webServerPort));
+    return true;
+}
+
+void BuildFolderMatchers() {
+    folderMatchers.clear();
+    
+    for (size_t i = 0; i < patternCommandPairs.size(); ++i) {
+        std::string normalizedFolder = NormalizeFolderPath(patternCommandPairs[i].folderPath);
+        std::unique_ptr<FolderPatternMatcher>& matcher = folderMatchers[normalizedFolder];
+        if (!matcher) matcher.reset(new FolderPatternMatcher());
+        
+        int index = static_cast<int>(i);
+        matcher->patternIndices.push_back(index);
+        if (!matcher->AddPattern(patternCommandPairs[i].patternRegex, index)) {
+            matcher->fallbackPatterns.push_back(index);
+            WriteToLog("Pattern [" + patternCommandPairs[i].patternName + 
+                      "] non compilabile nell'automa, uso std::regex: " + patternCommandPairs[i].patternRegex, true);
+        }
+    }
+    
+    for (const auto& entry : folderMatchers) {
+        WriteToLog("Matcher cartella " + entry.first + ": " + 
+                   std::to_string(entry.second->automatonPatterns.size()) + " pattern nell'automa (" +
+                   std::to_string(entry.second->nfa.size()) + " stati NFA), " +
+                   std::to_string(entry.second->fallbackPatterns.size()) + " su std::regex", true);
+    }
+}
+
+FolderPatternMatcher* FindFolderMatcher(const std::string& normalizedFolder) {
+    auto it = folderMatchers.find(normalizedFolder);
+    return it != folderMatchers.end() ? it->second.get() : NULL;
+}
+
+std::vector<int> MatchFolderPatterns(FolderPatternMatcher* matcher, const std::string& filename) {
+    std::vector<int> matchingPatterns;
+    if (!matcher) return matchingPatterns;
+    
+    // Una sola passata per tutti i pattern dell'automa, std::regex solo per i residui
+    matcher->MatchAutomaton(filename, matchingPatterns);
+    
+    for (int index : matcher->fallbackPatterns) {
+        try {
+            if (std::regex_match(filename, patternCommandPairs[index].compiledRegex)) {
+                matchingPatterns.push_back(index);
+            }
+        } catch (const std::regex_error& e) {
+            WriteToLog("ERRORE regex match: " + std::string(e.what()));
+            systemMetrics.errorsCount++;
+        }
+    }
+    if (!matcher->fallbackPatterns.empty()) {
+        std::sort(matchingPatterns.begin(), matchingPatterns.end());
+    }
+    
+    if (!matchingPatterns.empty()) {
+        // Aggiorna contatori match
+        std::lock_guard<std::mutex> lock(patternStatsMutex);
+        for (int index : matchingPatterns) {
+            patternMatchCounts[patternCommandPairs[index].patternName]++;
+        }
+    }
+    
+    return matchingPatterns;
+}
+
+std::vector<int> FindMatchingPatterns(const std::string& filename, const std::string& folderPath) {
+    return MatchFolderPatterns(FindFolderMatcher(NormalizeFolderPath(folderPath)), filename);
+}
+
+// ====== AZIONI INTEGRATE ======
+// Comandi "builtin:azione[=destinazione]" eseguiti direttamente con le API dei file,
+// senza CreateProcess ne' cmd.exe:
+//   move=DIR     sposta il file in DIR, sovrascrivendo
+//   archive=DIR  sposta il file in DIR senza sovrascrivere (suffisso _1, _2, ...)
+//   copy=DIR     copia il file in DIR; il file resta e viene marcato processato
+//   rename=NOME  rinomina il file nella stessa cartella
+//   delete       elimina il file
+// Destinazioni e nomi accettano {yyyy} {yy} {MM} {dd} {HH} {mm} {ss} (ora locale di
+// esecuzione), {name} (nome senza estensione), {ext} (estensione senza punto) e
+// {filename}. Sullo stesso volume lo spostamento e' una semplice rinomina; la copia
+// tra volumi viene usata solo se necessaria. I file spostati o eliminati non entrano
+// nel database dei processati: un nuovo file con lo stesso nome sara' rielaborato.
+
+bool ParseBuiltinAction(PatternCommandPair& pair) {
+    const std::string prefix = "builtin:";
+    if (pair.command.length() < prefix.length()) return true;
+    
+    std::string head = pair.command.substr(0, prefix.length());
+    for (auto& c : head) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (head != prefix) return true;
+    
+    std::string action = pair.command.substr(prefix.length());
+    size_t eq = action.find('=');
+    std::string target = (eq != std::string::npos) ? action.substr(eq + 1) : std::string();
+    action = action.substr(0, eq);
+    for (auto& c : action) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    
+    if (action == "move") pair.builtinAction = PatternCommandPair::BuiltinMove;
+    else if (action == "archive") pair.builtinAction = PatternCommandPair::BuiltinArchive;
+    else if (action == "copy") pair.builtinAction = PatternCommandPair::BuiltinCopy;
+    else if (action == "rename") pair.builtinAction = PatternCommandPair::BuiltinRename;
+    else if (action == "delete") pair.builtinAction = PatternCommandPair::BuiltinDelete;
+    else {
+        WriteToLog("AVVISO: Azione integrata sconosciuta: " + pair.command);
+        return false;
+    }
+    
+    bool needsTarget = (pair.builtinAction != PatternCommandPair::BuiltinDelete);
+    if (needsTarget && target.empty()) {
+        WriteToLog("AVVISO: Azione integrata senza destinazione: " + pair.command);
+        return false;
+    }
+    if (pair.builtinAction == PatternCommandPair::BuiltinRename &&
+        target.find_first_of("\\/") != std::string::npos) {
+        WriteToLog("AVVISO: rename accetta solo un nome file, non un percorso: " + pair.command);
+        return false;
+    }
+    
+    while (target.length() > 1 && (target.back() == '\\' || target.back() == '/')) target.pop_back();
+    pair.builtinTarget = target;
+    return true;
+}
+
+std::string ExpandActionTemplate(const std::string& templ, const std::string& filename, const SYSTEMTIME& st) {
+    size_t dot = filename.find_last_of('.');
+    std::string name = (dot != std::string::npos && dot > 0) ? filename.substr(0, dot) : filename;
+    std::string ext = (dot != std::string::npos && dot > 0) ? filename.substr(dot + 1) : std::string();
+    
+    std::string result;
+    result.reserve(templ.length() + filename.length());
+    
+    for (size_t i = 0; i < templ.length(); ++i) {
+        size_t close = (templ[i] == '{') ? templ.find('}', i) : std::string::npos;
+        if (close == std::string::npos) {
+            result += templ[i];
+            continue;
+        }
+        
+        std::string token = templ.substr(i + 1, close - i - 1);
+        char buffer[8];
+        if (token == "yyyy") { snprintf(buffer, sizeof(buffer), "%04u", static_cast<unsigned>(st.wYear)); result += buffer; }
+        else if (token == "yy") { snprintf(buffer, sizeof(buffer), "%02u", static_cast<unsigned>(st.wYear % 100)); result += buffer; }
+        else if (token == "MM") { snprintf(buffer, sizeof(buffer), "%02u", static_cast<unsigned>(st.wMonth)); result += buffer; }
+        else if (token == "dd") { snprintf(buffer, sizeof(buffer), "%02u", static_cast<unsigned>(st.wDay)); result += buffer; }
+        else if (token == "HH") { snprintf(buffer, sizeof(buffer), "%02u", static_cast<unsigned>(st.wHour)); result += buffer; }
+        else if (token == "mm") { snprintf(buffer, sizeof(buffer), "%02u", static_cast<unsigned>(st.wMinute)); result += buffer; }
+        else if (token == "ss") { snprintf(buffer, sizeof(buffer), "%02u", static_cast<unsigned>(st.wSecond)); result += buffer; }
+        else if (token == "name") result += name;
+        else if (token == "ext") result += ext;
+        else if (token == "filename") result += filename;
+        else {
+            result += templ[i];  // segnaposto sconosciuto: copiato cosi' com'e'
+            continue;
+        }
+        i = close;
+    }
+    
+    return result;
+}
+
+// Rinomina diretta sullo stesso volume; copia + eliminazione solo tra volumi diversi
+bool MoveFileFast(const std::string& source, const std::string& destination, bool replaceExisting) {
+    DWORD flags = replaceExisting ? MOVEFILE_REPLACE_EXISTING : 0;
+    if (MoveFileEx(source.c_str(), destination.c_str(), flags)) return true;
+    if (GetLastError() != ERROR_NOT_SAME_DEVICE) return false;
+    return MoveFileEx(source.c_str(), destination.c_str(), flags | MOVEFILE_COPY_ALLOWED | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+// Esegue l'azione integrata del pattern; fileRemains indica se il file e' ancora
+// nella cartella monitorata (solo copy)
+bool ExecuteBuiltinAction(const PatternCommandPair& pair, const std::string& fullPath, bool& fileRemains) {
+    fileRemains = false;
+    if (globalShutdown) return false;
+    
+    if (IsFileAlreadyProcessed(fullPath)) {
+        WriteToLog("SALTATO: File già processato: " + fullPath);
+        return false;
+    }
+    
+    if (!WaitForFileAvailability(fullPath)) {
+        WriteToLog("ERRORE: File non disponibile: " + fullPath);
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    std::vector<std::string> keys = ComputeDedupKeys(fullPath);
+    if (AreDedupKeysProcessed(fullPath, keys)) return false;
+    
+    auto startTime = std::chrono::steady_clock::now();
+    size_t slash = fullPath.find_last_of('\\');
+    std::string folder = (slash != std::string::npos) ? fullPath.substr(0, slash) : std::string(".");
+    std::string filename = (slash != std::string::npos) ? fullPath.substr(slash + 1) : fullPath;
+    
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    
+    bool success = false;
+    DWORD error = 0;
+    std::string destination;
+    const char* verb = "";
+    
+    switch (pair.builtinAction) {
+        case PatternCommandPair::BuiltinMove:
+        case PatternCommandPair::BuiltinArchive:
+        case PatternCommandPair::BuiltinCopy: {
+            std::string destDir = ExpandActionTemplate(pair.builtinTarget, filename, st);
+            if (!DirectoryExists(destDir) && !CreateDirectoryRecursive(destDir)) {
+                WriteToLog("ERRORE: Impossibile creare directory: " + destDir);
+                break;
+            }
+            destination = destDir + "\\" + filename;
+            
+            if (pair.builtinAction == PatternCommandPair::BuiltinMove) {
+                verb = "move";
+                success = MoveFileFast(fullPath, destination, true);
+            } else if (pair.builtinAction == PatternCommandPair::BuiltinCopy) {
+                verb = "copy";
+                success = CopyFile(fullPath.c_str(), destination.c_str(), FALSE) != FALSE;
+                fileRemains = success;
+            } else {
+                verb = "archive";
+                size_t dot = filename.find_last_of('.');
+                std::string stem = (dot != std::string::npos && dot > 0) ? filename.substr(0, dot) : filename;
+                std::string ext = (dot != std::string::npos && dot > 0) ? filename.substr(dot) : std::string();
+                for (int suffix = 1; suffix <= 1000; ++suffix) {
+                    if (MoveFileFast(fullPath, destination, false)) {
+                        success = true;
+                        break;
+                    }
+                    DWORD err = GetLastError();
+                    if (err != ERROR_ALREADY_EXISTS && err != ERROR_FILE_EXISTS) break;
+                    destination = destDir + "\\" + stem + "_" + std::to_string(suffix) + ext;
+                }
+            }
+            break;
+        }
+        case PatternCommandPair::BuiltinRename: {
+            verb = "rename";
+            destination = folder + "\\" + ExpandActionTemplate(pair.builtinTarget, filename, st);
+            // Il nuovo nome genera un evento nella stessa cartella: va marcato prima,
+            // altrimenti un pattern che lo riconosce lo rielaborerebbe. La rinomina
+            // conserva dimensione e data, quindi anche la chiave metadati e' nota
+            std::string destinationKey = destination;
+            FileIdentity identity;
+            if (dedupMode != DedupPath && GetFileIdentity(fullPath, identity)) {
+                destinationKey = MetadataDedupKey(destination, identity);
+            }
+            RecordProcessedFile(destinationKey);
+            success = MoveFileEx(fullPath.c_str(), destination.c_str(), 0) != FALSE;
+            if (!success) {
+                error = GetLastError();
+                ForgetProcessedKey(destinationKey);
+            }
+            break;
+        }
+        case PatternCommandPair::BuiltinDelete:
+            verb = "delete";
+            success = DeleteFile(fullPath.c_str()) != FALSE;
+            break;
+        default:
+            break;
+    }
+    
+    if (!success) {
+        if (error == 0) error = GetLastError();
+        WriteToLog("ERRORE: Azione integrata " + std::string(verb) + " fallita per " + fullPath +
+                   (destination.empty() ? "" : " -> " + destination) + ": " + std::to_string(error));
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    WriteToLog("AZIONE [" + pair.patternName + "]: " + verb + " " + fullPath +
+               (destination.empty() ? "" : " -> " + destination));
+    
+    if (fileRemains) {
+        MarkFileAsProcessed(fullPath, keys);
+    } else {
+        // Il file non c'e' piu': resta solo l'impronta, per riconoscere lo stesso contenuto
+        std::vector<std::string> contentKeys;
+        for (const auto& key : keys) {
+            if (key[0] == '#') contentKeys.push_back(key);
+        }
+        if (!contentKeys.empty()) RecordProcessedFiles(contentKeys);
+        systemMetrics.totalFilesProcessed++;
+        systemMetrics.filesProcessedToday++;
+        systemMetrics.lastFileProcessed = std::chrono::steady_clock::now();
+    }
+    systemMetrics.commandsExecuted++;
+    {
+        std::lock_guard<std::mutex> lock(patternStatsMutex);
+        patternExecutionCounts[pair.patternName]++;
+    }
+    
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    systemMetrics.averageProcessingTime = (systemMetrics.averageProcessingTime + duration) / 2;
+    return true;
+}
+
+// ====== SUPERVISORE PROCESSI ======
+// I processi figli non tengono piu' un thread fermo in WaitForSingleObject: l'handle
+// viene registrato con RegisterWaitForSingleObject e la callback di uscita gira sui
+// thread di attesa del sistema (un thread serve fino a 63 handle). Migliaia di figli
+// in volo costano quindi pochi thread. Il numero di comandi dei pattern in esecuzione
+// e' limitato da MaxConcurrentProcesses: gli esecutori attendono uno slot libero.
+
+struct SupervisedProcess {
+    HANDLE process;
+    HANDLE thread;
+    HANDLE waitHandle;
+    bool ownsSlot;
+    ProcessExitCallback onExit;
+    std::chrono::steady_clock::time_point startedAt;
+    std::atomic<int> references{2};  // registrazione + callback: l'ultimo libera
+};
+
+// Serializza gli avvii che ereditano handle: un figlio non deve ricevere per errore
+// l'estremita' di pipe destinata a un altro (EOF mai recapitato)
+std::mutex inheritableHandlesMutex;
+
+std::mutex processSlotMutex;
+std::condition_variable processSlotCondition;
+int processSlotsInUse = 0;  // protetto da processSlotMutex
+std::atomic<size_t> supervisedProcessCount{0};
+
+bool AcquireProcessSlot() {
+    std::unique_lock<std::mutex> lock(processSlotMutex);
+    while (!globalShutdown && processSlotsInUse >= maxConcurrentProcesses) {
+        processSlotCondition.wait_for(lock, std::chrono::milliseconds(200));
+    }
+    if (globalShutdown) return false;
+    processSlotsInUse++;
+    return true;
+}
+
+void ReleaseProcessSlot() {
+    {
+        std::lock_guard<std::mutex> lock(processSlotMutex);
+        if (processSlotsInUse > 0) processSlotsInUse--;
+    }
+    processSlotCondition.notify_one();
+}
+
+void ReleaseSupervisedProcess(SupervisedProcess* child) {
+    if (--child->references > 0) return;
+    
+    // Callback gia' eseguita: UnregisterWait non blocca e la registrazione e' conclusa
+    if (child->waitHandle != NULL) UnregisterWait(child->waitHandle);
+    CloseHandle(child->process);
+    CloseHandle(child->thread);
+    delete child;
+}
+
+void CompleteSupervisedProcess(SupervisedProcess* child, bool timedOut, bool waitFailed) {
+    ProcessExit exit;
+    exit.process = child->process;
+    exit.exitCode = STILL_ACTIVE;
+    exit.timedOut = timedOut;
+    exit.waitFailed = waitFailed;
+    exit.durationMs = static_cast<long long>(ElapsedMs(child->startedAt));
+    if (!timedOut && !waitFailed) GetExitCodeProcess(child->process, &exit.exitCode);
+    
+    try {
+        child->onExit(exit);
+    } catch (const std::exception& e) {
+        WriteToLog("ERRORE: Eccezione nella callback di uscita processo: " + std::string(e.what()));
+        systemMetrics.errorsCount++;
+    }
+    
+    if (child->ownsSlot) ReleaseProcessSlot();
+    supervisedProcessCount--;
+}
+
+void CALLBACK SupervisedProcessExited(PVOID context, BOOLEAN timerOrWaitFired) {
+    SupervisedProcess* child = static_cast<SupervisedProcess*>(context);
+    CompleteSupervisedProcess(child, timerOrWaitFired != FALSE, false);
+    ReleaseSupervisedProcess(child);
+}
+
+// Prende in carico handle di processo e thread (e lo slot, se ownsSlot) e chiama
+// onExit una sola volta all'uscita o allo scadere di timeoutMs. Al timeout il processo
+// e' ancora vivo: decide la callback se terminarlo tramite ProcessExit::process
+void SuperviseProcess(const PROCESS_INFORMATION& pi, DWORD timeoutMs, bool ownsSlot, ProcessExitCallback onExit) {
+    SupervisedProcess* child = new SupervisedProcess();
+    child->process = pi.hProcess;
+    child->thread = pi.hThread;
+    child->waitHandle = NULL;
+    child->ownsSlot = ownsSlot;
+    child->onExit = std::move(onExit);
+    child->startedAt = std::chrono::steady_clock::now();
+    supervisedProcessCount++;
+    
+    if (!RegisterWaitForSingleObject(&child->waitHandle, pi.hProcess, SupervisedProcessExited,
+                                     child, timeoutMs, WT_EXECUTEONLYONCE)) {
+        // Senza registrazione si torna all'attesa sul thread chiamante
+        WriteToLog("AVVISO: RegisterWaitForSingleObject fallito (" + std::to_string(GetLastError()) +
+                   "), attesa sincrona");
+        child->waitHandle = NULL;
+        DWORD waitResult = WaitForSingleObject(pi.hProcess, timeoutMs);
+        CompleteSupervisedProcess(child, waitResult == WAIT_TIMEOUT, waitResult == WAIT_FAILED);
+        child->references = 1;
+    }
+    
+    ReleaseSupervisedProcess(child);
+}
+
+// Attesa limitata dei figli ancora in volo allo shutdown; gli altri restano orfani
+void WaitForSupervisedProcesses(DWORD timeoutMs) {
+    DWORD startTime = GetTickCount();
+    while (supervisedProcessCount > 0 && GetTickCount() - startTime < timeoutMs) {
+        Sleep(50);
+    }
+    if (supervisedProcessCount > 0) {
+        WriteToLog("TIMEOUT: " + std::to_string(supervisedProcessCount.load()) + " processi ancora in esecuzione allo shutdown");
+    }
+}
+
+// Avvia il comando per il file senza attenderlo: onDone(success) viene chiamato una
+// sola volta all'uscita del processo. false (senza callback) se il processo non parte
+bool StartCommand(const std::string& command, const std::string& parameter, const std::string& patternName,
+                  std::function<void(bool)> onDone) {
+    if (globalShutdown) return false;
+    
+    if (!FileExists(command)) {
+        WriteToLog("ERRORE: Comando non trovato: " + command);
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    if (IsFileAlreadyProcessed(parameter)) {
+        WriteToLog("SALTATO: File già processato: " + parameter);
+        return false;
+    }
+    
+    if (!WaitForFileAvailability(parameter)) {
+        WriteToLog("ERRORE: File non disponibile: " + parameter);
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    std::vector<std::string> keys = ComputeDedupKeys(parameter);
+    if (AreDedupKeysProcessed(parameter, keys)) return false;
+    
+    if (!AcquireProcessSlot()) return false;
+    
+    std::string commandLine = "\"" + command + "\" \"" + parameter + "\"";
+    WriteToLog("ESECUZIONE [" + patternName + "]: " + commandLine);
+    
+    STARTUPINFO si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;
+    ZeroMemory(&pi, sizeof(pi));
+    
+    std::vector<char> cmdline(commandLine.begin(), commandLine.end());
+    cmdline.push_back('\0');
+    
+    if (!CreateProcess(NULL, &cmdline[0], NULL, NULL, FALSE, 
+                      CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
+        WriteToLog("ERRORE: CreateProcess fallito: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        ReleaseProcessSlot();
+        return false;
+    }
+    
+    SuperviseProcess(pi, BATCH_TIMEOUT, true, [parameter, keys, patternName, onDone](const ProcessExit& exit) {
+        bool success = false;
+        
+        if (exit.timedOut) {
+            WriteToLog("TIMEOUT: Processo terminato forzatamente");
+            TerminateProcess(exit.process, 1);
+            MarkFileAsProcessed(parameter, keys);
+            success = true;
+        } else if (exit.waitFailed) {
+            WriteToLog("ERRORE: Attesa processo fallita");
+            TerminateProcess(exit.process, 1);
+            systemMetrics.errorsCount++;
+        } else {
+            WriteToLog("COMPLETATO: Codice uscita " + std::to_string(exit.exitCode));
+            MarkFileAsProcessed(parameter, keys);
+            success = true;
+        }
+        
+        if (success) {
+            systemMetrics.commandsExecuted++;
+            std::lock_guard<std::mutex> lock(patternStatsMutex);
+            patternExecutionCounts[patternName]++;
+        }
+        systemMetrics.averageProcessingTime = (systemMetrics.averageProcessingTime + exit.durationMs) / 2;
+        
+        if (onDone) onDone(success);
+    });
+    
+    return true;
+}
+
+// Variante bloccante per gli strumenti da riga di comando (reprocess)
+bool ExecuteCommand(const std::string& command, const std::string& parameter, const std::string& patternName) {
+    HANDLE doneEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (doneEvent == NULL) return false;
+    
+    bool result = false;
+    if (!StartCommand(command, parameter, patternName, [&result, doneEvent](bool success) {
+            result = success;
+            SetEvent(doneEvent);
+        })) {
+        CloseHandle(doneEvent);
+        return false;
+    }
+    
+    WaitForSingleObject(doneEvent, INFINITE);
+    CloseHandle(doneEvent);
+    return result;
+}
+
+std::string BatchListDirectory() {
+    size_t pos = processedFilesDb.find_last_of("\\/");
+    std::string baseDir = (pos != std::string::npos) ? processedFilesDb.substr(0, pos) : std::string(".");
+    return baseDir + "\\batches";
+}
+
+// Avvia il comando una sola volta per un gruppo di file: la lista (un percorso per
+// riga) arriva come file di testo passato per argomento oppure sullo stdin del processo.
+// Con codice di uscita 0 tutti i file del gruppo vengono marcati processati con una sola
+// scrittura del journal; con qualsiasi altro esito nessuno, e restano da rivalutare.
+// onDone riceve l'esito e i file effettivamente passati al comando; false (senza
+// callback) se il processo non parte
+bool StartBatchCommand(const PatternCommandPair& pair, std::vector<std::string> files,
+                       std::function<void(bool, const std::vector<std::string>&)> onDone) {
+    if (globalShutdown) return false;
+    
+    if (!FileExists(pair.command)) {
+        WriteToLog("ERRORE: Comando non trovato: " + pair.command);
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    std::vector<std::string> ready;
+    std::vector<std::string> keys;
+    ready.reserve(files.size());
+    for (const auto& file : files) {
+        if (globalShutdown) return false;
+        if (IsFileAlreadyProcessed(file)) {
+            WriteToLog("SALTATO: File già processato: " + file, true);
+            continue;
+        }
+        if (!WaitForFileAvailability(file)) {
+            WriteToLog("ERRORE: File non disponibile: " + file);
+            systemMetrics.errorsCount++;
+            continue;
+        }
+        std::vector<std::string> fileKeys = ComputeDedupKeys(file);
+        if (AreDedupKeysProcessed(file, fileKeys)) continue;
+        keys.insert(keys.end(), fileKeys.begin(), fileKeys.end());
+        ready.push_back(file);
+    }
+    files.swap(ready);
+    if (files.empty()) return false;
+    
+    if (!AcquireProcessSlot()) return false;
+    
+    std::string list;
+    for (const auto& file : files) {
+        list += file;
+        list += "\r\n";
+    }
+    
+    std::string commandLine = "\"" + pair.command + "\"";
+    std::string listPath;
+    HANDLE stdinRead = NULL;
+    HANDLE stdinWrite = NULL;
+    bool useStdin = (pair.batchInput == PatternCommandPair::BatchInputStdin);
+    
+    if (useStdin) {
+        // Pipe dimensionata sull'intera lista: la scrittura non attende il comando.
+        // Il lato lettura diventa ereditabile solo durante CreateProcess
+        if (!CreatePipe(&stdinRead, &stdinWrite, NULL, static_cast<DWORD>(list.length()))) {
+            WriteToLog("ERRORE: CreatePipe fallito: " + std::to_string(GetLastError()));
+            systemMetrics.errorsCount++;
+            ReleaseProcessSlot();
+            return false;
+        }
+    } else {
+        std::string listDir = BatchListDirectory();
+        if (!DirectoryExists(listDir)) CreateDirectoryRecursive(listDir);
+        listPath = listDir + "\\" + SanitizeFilename(pair.patternName) + "_" +
+                   std::to_string(GetCurrentThreadId()) + "_" + std::to_string(GetTickCount()) + ".lst";
+        
+        HANDLE hList = CreateFile(listPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        DWORD written = 0;
+        bool listOk = hList != INVALID_HANDLE_VALUE &&
+                      WriteFile(hList, list.data(), static_cast<DWORD>(list.length()), &written, NULL) &&
+                      written == list.length();
+        if (hList != INVALID_HANDLE_VALUE) CloseHandle(hList);
+        if (!listOk) {
+            WriteToLog("ERRORE: Impossibile scrivere lista batch: " + listPath);
+            systemMetrics.errorsCount++;
+            DeleteFile(listPath.c_str());
+            ReleaseProcessSlot();
+            return false;
+        }
+        commandLine += " \"" + listPath + "\"";
+    }
+    
+    WriteToLog("ESECUZIONE BATCH [" + pair.patternName + "]: " + commandLine + " (" +
+               std::to_string(files.size()) + " file" + (useStdin ? ", lista su stdin)" : ")"));
+    
+    STARTUPINFO si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;
+    if (useStdin) {
+        si.dwFlags |= STARTF_USESTDHANDLES;
+        si.hStdInput = stdinRead;
+        si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    }
+    ZeroMemory(&pi, sizeof(pi));
+    
+    std::vector<char> cmdline(commandLine.begin(), commandLine.end());
+    cmdline.push_back('\0');
+    
+    BOOL created = FALSE;
+    if (useStdin) {
+        std::lock_guard<std::mutex> lock(inheritableHandlesMutex);
+        SetHandleInformation(stdinRead, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+        created = CreateProcess(NULL, &cmdline[0], NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+        CloseHandle(stdinRead);
+    } else {
+        created = CreateProcess(NULL, &cmdline[0], NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+    }
+    
+    if (!created) {
+        WriteToLog("ERRORE: CreateProcess fallito: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        if (useStdin) CloseHandle(stdinWrite);
+        if (!listPath.empty()) DeleteFile(listPath.c_str());
+        ReleaseProcessSlot();
+        return false;
+    }
+    
+    if (useStdin) {
+        // Chiudere la pipe segnala fine lista; se il comando esce senza leggerla la scrittura fallisce
+        DWORD written = 0;
+        WriteFile(stdinWrite, list.data(), static_cast<DWORD>(list.length()), &written, NULL);
+        CloseHandle(stdinWrite);
+    }
+    
+    std::string patternName = pair.patternName;
+    SuperviseProcess(pi, BATCH_TIMEOUT, true, [patternName, files, keys, listPath, onDone](const ProcessExit& exit) {
+        bool success = false;
+        
+        if (exit.timedOut) {
+            WriteToLog("TIMEOUT: Processo batch terminato forzatamente, file non marcati");
+            TerminateProcess(exit.process, 1);
+        } else if (exit.waitFailed) {
+            WriteToLog("ERRORE: Attesa processo batch fallita");
+            TerminateProcess(exit.process, 1);
+        } else {
+            WriteToLog("COMPLETATO BATCH: Codice uscita " + std::to_string(exit.exitCode) + 
+                       " (" + std::to_string(files.size()) + " file)");
+            success = (exit.exitCode == 0);
+        }
+        
+        if (success) {
+            MarkFilesAsProcessed(files, keys);
+            systemMetrics.commandsExecuted++;
+            std::lock_guard<std::mutex> lock(patternStatsMutex);
+            patternExecutionCounts[patternName] += files.size();
+        } else {
+            systemMetrics.errorsCount++;
+        }
+        systemMetrics.averageProcessingTime = (systemMetrics.averageProcessingTime + exit.durationMs) / 2;
+        
+        if (!listPath.empty()) DeleteFile(listPath.c_str());
+        if (onDone) onDone(success, files);
+    });
+    
+    return true;
+}
+
+void ScanDirectoryForExistingFiles(const std::string& folderPath, const std::vector<int>& patternIndices,
+                                   FolderMonitor* monitor) {
+    WriteToLog("Scansione iniziale cartella: " + folderPath + " (" + std::to_string(patternIndices.size()) + " pattern/s)");
+    auto startTime = std::chrono::steady_clock::now();
+    
+    int filesFound = 0;
+    int filesQueued = 0;
+    int filesDeferred = 0;
+    int filesSkipped = 0;
+    int filesUnchanged = 0;
+    std::string normalizedFolder = NormalizeFolderPath(folderPath);
+    FolderPatternMatcher* matcher = FindFolderMatcher(normalizedFolder);
+    
+    // I file invariati rispetto all'istantanea salvata non vengono rivalutati
+    unsigned long long patternHash = ComputePatternSetHash(patternIndices);
+    std::unordered_map<unsigned long long, FileStamp> previous;
+    bool hasSnapshot = LoadFolderSnapshot(normalizedFolder, patternHash, previous);
+    std::unordered_map<unsigned long long, FileStamp> current;
+    current.reserve(previous.size() + 64);
+    
+    // Con il watcher gia' armato i file scritti di recente passano dal debounce:
+    // potrebbero essere ancora in copia e il loro evento e' comunque in arrivo
+    std::shared_ptr<FolderStats> stats = monitor ? monitor->stats : std::shared_ptr<FolderStats>();
+    ULARGE_INTEGER settledBefore;
+    settledBefore.QuadPart = 0;
+    if (monitor) {
+        FILETIME nowFt;
+        GetSystemTimeAsFileTime(&nowFt);
+        settledBefore.LowPart = nowFt.dwLowDateTime;
+        settledBefore.HighPart = nowFt.dwHighDateTime;
+        settledBefore.QuadPart -= static_cast<unsigned long long>(monitor->debounceMs) * 10000ULL;
+    }
+    
+    std::string searchPath = folderPath + "\\*";
+    WIN32_FIND_DATA findData;
+    HANDLE hFind = FindFirstFileEx(searchPath.c_str(), FindExInfoBasic, &findData,
+                                   FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    
+    if (hFind == INVALID_HANDLE_VALUE) {
+        WriteToLog("ERRORE: Impossibile aprire cartella: " + folderPath);
+        systemMetrics.errorsCount++;
+        return;
+    }
+    
+    do {
+        if (globalShutdown || (monitor && monitor->stopRequested)) break;
+        
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        
+        filesFound++;
+        FileStamp stamp = MakeFileStamp(findData);
+        unsigned long long nameHash = HashFileName(findData.cFileName);
+        
+        auto known = previous.find(nameHash);
+        if (known != previous.end() && known->second.size == stamp.size && known->second.lastWrite == stamp.lastWrite) {
+            current[nameHash] = stamp;
+            filesUnchanged++;
+            continue;
+        }
+        
+        std::string filename = findData.cFileName;
+        std::string fullPath = folderPath + "\\" + filename;
+        
+        // CORREZIONE: Processa TUTTI i file che matchano i pattern, anche se già processati
+        std::vector<int> matchingPatterns = MatchFolderPatterns(matcher, filename);
+        
+        if (matchingPatterns.empty()) {
+            current[nameHash] = stamp;
+            continue;
+        }
+        
+        bool alreadyProcessed = IsFileAlreadyProcessed(fullPath);
+        
+        if (!alreadyProcessed) {
+            WriteToLog("File NON processato trovato: " + fullPath);
+            
+            // Nessuna esecuzione inline: il file segue il percorso normale degli eventi.
+            // Non entra nell'istantanea, ci pensa l'esecutore a comando riuscito
+            if (monitor && stamp.lastWrite > settledBefore.QuadPart) {
+                SubmitFileEvent(monitor, filename);
+                filesDeferred++;
+            } else {
+                for (int patternIndex : matchingPatterns) {
+                    if (EnqueueExecutionJob(fullPath, patternIndex, stats)) filesQueued++;
+                    if (globalShutdown) break;
+                }
+            }
+        } else {
+            filesSkipped++;
+            current[nameHash] = stamp;
+            WriteToLog("File già processato saltato: " + fullPath, true);
+        }
+        
+    } while (FindNextFile(hFind, &findData) && !globalShutdown);
+    
+    FindClose(hFind);
+    
+    if (!globalShutdown && !(monitor && monitor->stopRequested)) {
+        // Le voci registrate nel frattempo dagli esecutori restano valide
+        std::shared_ptr<FolderSnapshot> snapshot = GetFolderSnapshot(normalizedFolder);
+        std::lock_guard<std::mutex> lock(snapshot->mutex);
+        for (const auto& entry : snapshot->entries) current.insert(entry);
+        snapshot->entries.swap(current);
+        snapshot->patternHash = patternHash;
+        snapshot->dirty = true;
+    }
+    
+    WriteToLog("Scansione iniziale completata: " + folderPath + 
+               " - Trovati: " + std::to_string(filesFound) +
+               ", Invariati da istantanea: " + std::to_string(filesUnchanged) +
+               (hasSnapshot ? "" : " (nessuna istantanea)") +
+               ", Accodati: " + std::to_string(filesQueued) +
+               ", In debounce: " + std::to_string(filesDeferred) + 
+               ", Già processati: " + std::to_string(filesSkipped) +
+               ", Durata: " + std::to_string(static_cast<long long>(ElapsedMs(startTime))) + " ms");
+}
+
+// ====== MOTORE WATCHER (I/O OVERLAPPED + COMPLETION PORT) ======
+// Tutte le cartelle condividono una sola completion port. Un pool fisso di thread
+// (WatcherThreads) serve i completamenti di ReadDirectoryChangesW di ogni cartella,
+// invece di un thread bloccato per cartella. Per cartella c'e' al massimo una lettura
+// pendente: la lettura viene riarmata dopo il dispatch, quindi gli eventi di una
+// stessa cartella restano serializzati e nel frattempo il kernel li bufferizza.
+
+bool StartWatcherEngine(int threadCount) {
+    if (watcherCompletionPort != NULL) return true;
+    
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_WATCHER_THREADS) threadCount = MAX_WATCHER_THREADS;
+    
+    watcherCompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, threadCount);
+    if (watcherCompletionPort == NULL) {
+        WriteToLog("ERRORE: CreateIoCompletionPort fallito: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    for (int i = 0; i < threadCount; ++i) {
+        watcherPoolThreads.push_back(std::thread(WatcherPoolWorker));
+    }
+    
+    WriteToLog("Motore watcher avviato con " + std::to_string(threadCount) + " thread");
+    return true;
+}
+
+void StopWatcherEngine() {
+    if (watcherCompletionPort == NULL) return;
+    
+    for (size_t i = 0; i < watcherPoolThreads.size(); ++i) {
+        PostQueuedCompletionStatus(watcherCompletionPort, 0, WATCHER_SHUTDOWN_KEY, NULL);
+    }
+    
+    // I comandi girano nel pool esecutori. L'unica attesa lunga possibile per un thread
+    // del pool sarebbe executorQueue.Push su coda piena, che si sblocca solo con
+    // StopExecutorPool (chiamato dopo): per questo gli eventi passano sempre dal thread
+    // di debounce e qui restano solo i mutex di debounce e riconciliazione. Attesa
+    // comunque limitata, poi detach
+    const DWORD POOL_TIMEOUT_MS = 3000;
+    DWORD startTime = GetTickCount();
+    while (watcherThreadsRunning > 0 && GetTickCount() - startTime < POOL_TIMEOUT_MS) {
+        Sleep(50);
+    }
+    
+    bool allJoined = (watcherThreadsRunning == 0);
+    for (auto& t : watcherPoolThreads) {
+        if (!t.joinable()) continue;
+        if (allJoined) {
+            t.join();
+        } else {
+            t.detach();
+        }
+    }
+    watcherPoolThreads.clear();
+    
+    if (allJoined) {
+        CloseHandle(watcherCompletionPort);
+    } else {
+        // I thread staccati usano ancora la porta: non chiuderla sotto di loro
+        WriteToLog("TIMEOUT: Detach forzato thread motore watcher");
+    }
+    watcherCompletionPort = NULL;
+    WriteToLog("Motore watcher arrestato", true);
+}
+
+bool AttachFolderMonitor(FolderMonitor* monitor) {
+    monitor->directoryHandle = CreateFile(monitor->folderPath.c_str(), FILE_LIST_DIRECTORY,
+                                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                         NULL, OPEN_EXISTING, 
+                                         FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    
+    if (monitor->directoryHandle == INVALID_HANDLE_VALUE) {
+        WriteToLog("ERRORE: Impossibile aprire directory: " + monitor->folderPath + 
+                  " Error: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    // La chiave di completamento e' il puntatore al monitor
+    if (CreateIoCompletionPort(monitor->directoryHandle, watcherCompletionPort,
+                               reinterpret_cast<ULONG_PTR>(monitor), 0) == NULL) {
+        WriteToLog("ERRORE: Associazione completion port fallita per: " + monitor->folderPath + 
+                  " Error: " + std::to_string(GetLastError()));
+        CloseHandle(monitor->directoryHandle);
+        monitor->directoryHandle = INVALID_HANDLE_VALUE;
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    if (!ArmFolderMonitor(monitor)) {
+        CloseHandle(monitor->directoryHandle);
+        monitor->directoryHandle = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    
+    monitor->active = true;
+    WriteToLog("Avvio monitoraggio per: " + monitor->folderPath);
+    return true;
+}
+
+bool ArmFolderMonitor(FolderMonitor* monitor) {
+    if (monitor->stopRequested || globalShutdown || monitor->directoryHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    ZeroMemory(&monitor->overlapped, sizeof(monitor->overlapped));
+    monitor->ioPending = true;
+    
+    BOOL result = ReadDirectoryChangesW(
+        monitor->directoryHandle,
+        &monitor->notifyBuffer[0],
+        static_cast<DWORD>(monitor->notifyBuffer.size()),
+        FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
+        NULL,
+        &monitor->overlapped,
+        NULL
+    );
+    
+    if (!result) {
+        monitor->ioPending = false;
+        DWORD error = GetLastError();
+        
+        if (error == ERROR_INVALID_PARAMETER && 
+            monitor->notifyBuffer.size() > NETWORK_NOTIFICATION_BUFFER_KB * 1024) {
+            // Le share di rete non accettano buffer oltre 64 KB: riduci e riprova
+            WriteToLog("AVVISO: Buffer notifiche ridotto a " + std::to_string(NETWORK_NOTIFICATION_BUFFER_KB) + 
+                      " KB per cartella di rete: " + monitor->folderPath);
+            monitor->notifyBuffer.assign(NETWORK_NOTIFICATION_BUFFER_KB * 1024, 0);
+            return ArmFolderMonitor(monitor);
+        }
+        
+        if (!monitor->stopRequested && !globalShutdown) {
+            WriteToLog("ERRORE ReadDirectoryChangesW: " + std::to_string(error) + 
+                      " per cartella: " + monitor->folderPath);
+            systemMetrics.errorsCount++;
+        }
+        return false;
+    }
+    
+    return true;
+}
+
+void WatcherPoolWorker() {
+    watcherThreadsRunning++;
+    
+    while (true) {
+        DWORD bytesTransferred = 0;
+        ULONG_PTR completionKey = 0;
+        LPOVERLAPPED overlapped = NULL;
+        
+        BOOL ok = GetQueuedCompletionStatus(watcherCompletionPort, &bytesTransferred,
+                                            &completionKey, &overlapped, INFINITE);
+        
+        if (completionKey == WATCHER_SHUTDOWN_KEY) break;
+        if (overlapped == NULL) {
+            // Errore sulla porta stessa (es. chiusa): nessun completamento da gestire
+            if (!ok) break;
+            continue;
+        }
+        
+        FolderMonitor* monitor = reinterpret_cast<FolderMonitor*>(completionKey);
+        
+        if (!ok) {
+            DWORD error = GetLastError();
+            monitor->ioPending = false;
+            
+            if (error == ERROR_OPERATION_ABORTED || error == ERROR_INVALID_HANDLE || 
+                error == ERROR_ACCESS_DENIED || monitor->stopRequested || globalShutdown) {
+                WriteToLog("Monitoraggio interrotto per: " + monitor->folderPath + " (Error: " + std::to_string(error) + ")", true);
+                monitor->active = false;
+                continue;
+            }
+            
+            if (error == ERROR_NOTIFY_ENUM_DIR) {
+                // Overflow segnalato come errore: stesso trattamento del completamento vuoto
+                if (!ArmFolderMonitor(monitor)) monitor->active = false;
+                HandleNotificationOverflow(monitor);
+                continue;
+            }
+            
+            WriteToLog("ERRORE ReadDirectoryChangesW: " + std::to_string(error) + 
+                      " per cartella: " + monitor->folderPath);
+            systemMetrics.errorsCount++;
+            if (!ArmFolderMonitor(monitor)) monitor->active = false;
+            continue;
+        }
+        
+        if (monitor->stopRequested || globalShutdown) {
+            monitor->ioPending = false;
+            monitor->active = false;
+            continue;
+        }
+        
+        // bytesTransferred == 0: buffer di notifica in overflow, eventi persi
+        bool overflow = (bytesTransferred == 0);
+        if (!overflow) {
+            DispatchFolderNotifications(monitor, bytesTransferred);
+        }
+        
+        monitor->ioPending = false;
+        if (!ArmFolderMonitor(monitor)) {
+            monitor->active = false;
+        }
+        
+        // Riarmato prima della riconciliazione: nessun evento cade nel mezzo
+        if (overflow) HandleNotificationOverflow(monitor);
+    }
+    
+    watcherThreadsRunning--;
+}
+
+void DispatchFolderNotifications(FolderMonitor* monitor, DWORD bytesTransferred) {
+    BYTE* base = &monitor->notifyBuffer[0];
+    FILE_NOTIFY_INFORMATION* fni = (FILE_NOTIFY_INFORMATION*)base;
+    
+    do {
+        if (monitor->stopRequested || globalShutdown) break;
+        
+        char filename[MAX_PATH];
+        int filenameLength = WideCharToMultiByte(CP_ACP, 0, fni->FileName, 
+                                               fni->FileNameLength / sizeof(WCHAR),
+                                               filename, sizeof(filename) - 1, NULL, NULL);
+        filename[filenameLength] = '\0';
+        
+        if (monitor->eventCallback) {
+            monitor->eventCallback(monitor, fni->Action, std::string(filename));
+        }
+        
+        if (fni->NextEntryOffset == 0) break;
+        fni = (FILE_NOTIFY_INFORMATION*)((BYTE*)fni + fni->NextEntryOffset);
+        
+    } while ((BYTE*)fni < base + bytesTransferred);
+}
+
+void ProcessFolderEvent(FolderMonitor* monitor, DWORD action, const std::string& strFilename) {
+    if (action != FILE_ACTION_ADDED && 
+        action != FILE_ACTION_RENAMED_NEW_NAME && 
+        action != FILE_ACTION_MODIFIED) {
+        return;
+    }
+    
+    WriteToLog("Evento file: " + strFilename + " in " + monitor->folderPath, true);
+    monitor->filesDetected++;
+    
+    // Siamo su un thread della completion port: l'evento viene solo registrato nel
+    // debounce. Matching, controllo DB e accodamento agli esecutori avvengono una
+    // volta sola, quando il file e' quieto, nel thread di debounce
+    SubmitFileEvent(monitor, strFilename);
+}
+
+// ====== DEBOUNCE EVENTI ======
+// Una copia o un salvataggio generano raffiche di ADDED/MODIFIED/RENAMED sullo stesso
+// file: vengono accorpati per percorso finche' il file resta quieto per il periodo
+// della sua cartella, poi un solo evento "pronto" passa a matching e coda esecutori.
+// Le scadenze stanno in una timer wheel servita da un thread: un nuovo evento sposta
+// solo la scadenza, l'entry viene ricollocata quando il suo slot scatta.
+
+unsigned long long DebounceTickCeil(const std::chrono::steady_clock::time_point& t) {
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(t - debounceEpoch).count();
+    if (ms < 0) ms = 0;
+    return static_cast<unsigned long long>((ms + DEBOUNCE_TICK_MS - 1) / DEBOUNCE_TICK_MS);
+}
+
+unsigned long long DebounceTickFloor(const std::chrono::steady_clock::time_point& t) {
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(t - debounceEpoch).count();
+    if (ms < 0) ms = 0;
+    return static_cast<unsigned long long>(ms / DEBOUNCE_TICK_MS);
+}
+
+// Richiede debounceMutex
+void ScheduleDebounceEntry(const std::string& key, const std::chrono::steady_clock::time_point& deadline) {
+    unsigned long long tick = DebounceTickCeil(deadline);
+    if (tick <= debounceCurrentTick) tick = debounceCurrentTick + 1;
+    debounceWheel[tick % DEBOUNCE_WHEEL_SLOTS].push_back(std::make_pair(key, tick));
+}
+
+bool StartDebouncer() {
+    std::lock_guard<std::mutex> lock(debounceMutex);
+    if (debounceRunning) return true;
+    
+    debounceWheel.assign(DEBOUNCE_WHEEL_SLOTS, std::vector<std::pair<std::string, unsigned long long>>());
+    debounceEntries.clear();
+    debounceEpoch = std::chrono::steady_clock::now();
+    debounceCurrentTick = 0;
+    debounceRunning = true;
+    debounceThread = std::thread(DebounceWorker);
+    
+    WriteToLog("Debounce eventi avviato: quiete predefinita " + std::to_string(debounceMs) + " ms, " +
+               std::to_string(folderDebounceMs.size()) + " override per cartella");
+    return true;
+}
+
+void StopDebouncer() {
+    {
+        std::lock_guard<std::mutex> lock(debounceMutex);
+        if (!debounceRunning) return;
+        debounceRunning = false;
+    }
+    debounceCondition.notify_all();
+    if (debounceThread.joinable()) debounceThread.join();
+    
+    size_t discarded = 0;
+    {
+        std::lock_guard<std::mutex> lock(debounceMutex);
+        discarded = debounceEntries.size();
+        debounceEntries.clear();
+        debounceWheel.clear();
+    }
+    if (discarded > 0) {
+        WriteToLog("Debounce: " + std::to_string(discarded) + 
+                   " file in attesa non inviati (ripresi dalla scansione al prossimo avvio)");
+    }
+}
+
+void DebounceWorker() {
+    std::vector<DebounceEntry> ready;
+    std::unique_lock<std::mutex> lock(debounceMutex);
+    
+    while (debounceRunning) {
+        if (debounceEntries.empty()) {
+            debounceCondition.wait(lock);
+            continue;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        unsigned long long nowTick = DebounceTickFloor(now);
+        
+        while (debounceCurrentTick < nowTick) {
+            ++debounceCurrentTick;
+            std::vector<std::pair<std::string, unsigned long long>>& slot = debounceWheel[debounceCurrentTick % DEBOUNCE_WHEEL_SLOTS];
+            if (slot.empty()) continue;
+            
+            std::vector<std::pair<std::string, unsigned long long>> due;
+            due.swap(slot);
+            for (auto& item : due) {
+                if (item.second > debounceCurrentTick) {
+                    slot.push_back(item);  // scade in un giro successivo della ruota
+                    continue;
+                }
+                
+                auto it = debounceEntries.find(item.first);
+                if (it == debounceEntries.end()) continue;
+                
+                if (it->second.deadline > now) {
+                    // Nuovi eventi nel frattempo: riprogramma alla scadenza aggiornata
+                    ScheduleDebounceEntry(item.first, it->second.deadline);
+                    continue;
+                }
+                
+                ready.push_back(std::move(it->second));
+                debounceEntries.erase(it);
+            }
+        }
+        
+        if (!ready.empty()) {
+            // Il dispatch puo' bloccare sulla coda esecutori: mai sotto lock
+            lock.unlock();
+            for (const DebounceEntry& entry : ready) {
+                if (globalShutdown) break;
+                DispatchReadyFile(entry.fullPath, entry.filename, entry.matcher, entry.stats);
+            }
+            ready.clear();
+            lock.lock();
+            continue;
+        }
+        
+        debounceCondition.wait_for(lock, std::chrono::milliseconds(DEBOUNCE_TICK_MS));
+    }
+}
+
+// Non blocca mai: anche con DebounceMs=0 il file passa dalla ruota (scadenza al tick
+// successivo), cosi' l'attesa su una coda esecutori piena resta al thread di debounce
+// e non ferma i thread della completion port
+void SubmitFileEvent(FolderMonitor* monitor, const std::string& filename) {
+    std::string fullPath = monitor->folderPath + "\\" + filename;
+    monitor->stats->eventsReceived++;
+    
+    std::string key = fullPath;
+    std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+    
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = now + std::chrono::milliseconds(monitor->debounceMs);
+    
+    std::lock_guard<std::mutex> lock(debounceMutex);
+    if (!debounceRunning) {
+        // Solo durante l'arresto: il file viene ripreso dalla scansione al prossimo avvio
+        return;
+    }
+    
+    auto it = debounceEntries.find(key);
+    if (it != debounceEntries.end()) {
+        it->second.deadline = deadline;
+        monitor->stats->eventsCoalesced++;
+        eventsCoalescedTotal++;
+        return;
+    }
+    
+    if (debounceEntries.empty()) {
+        // Ruota vuota: riallinea il tick corrente invece di recuperare il tempo di inattivita'
+        debounceCurrentTick = DebounceTickFloor(now);
+    }
+    
+    DebounceEntry entry;
+    entry.fullPath = fullPath;
+    entry.filename = filename;
+    entry.matcher = monitor->matcher;
+    entry.stats = monitor->stats;
+    entry.deadline = deadline;
+    bool wasEmpty = debounceEntries.empty();
+    debounceEntries[key] = std::move(entry);
+    ScheduleDebounceEntry(key, deadline);
+    if (wasEmpty) debounceCondition.notify_one();
+}
+
+void DispatchReadyFile(const std::string& fullPath, const std::string& filename,
+                       FolderPatternMatcher* matcher, const std::shared_ptr<FolderStats>& stats) {
+    std::vector<int> matchingPatterns = MatchFolderPatterns(matcher, filename);
+    
+    if (matchingPatterns.empty() || IsFileAlreadyProcessed(fullPath)) {
+        // Nulla da eseguire: il file entra nell'istantanea della cartella
+        RecordSnapshotEntry(fullPath);
+        return;
+    }
+    
+    WriteToLog("File corrispondente rilevato: " + fullPath);
+    
+    // L'esecuzione avviene nel pool esecutori: il chiamante torna subito
+    for (int patternIndex : matchingPatterns) {
+        EnqueueExecutionJob(fullPath, patternIndex, stats);
+        if (globalShutdown) break;
+    }
+}
+
+// ====== ISTANTANEE CARTELLE ======
+// Per ogni cartella si conserva, su disco e in memoria, l'elenco dei file gia'
+// "chiusi" (nessun pattern corrispondente oppure gia' processati) come hash del nome,
+// dimensione e data di scrittura. All'avvio e nella riconciliazione i file invariati
+// rispetto all'istantanea saltano matching e lookup nel database. I file corrispondenti
+// ma non ancora processati non entrano mai nell'istantanea, cosi' vengono rivalutati.
+// Formato: SnapshotHeader seguito da entryCount SnapshotRecord; l'hash dei pattern
+// della cartella invalida l'istantanea quando la configurazione cambia.
+
+struct SnapshotHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int reserved;
+    unsigned long long folderHash;
+    unsigned long long patternHash;
+    unsigned long long entryCount;
+    unsigned long long checksum;
+};
+
+struct SnapshotRecord {
+    unsigned long long nameHash;
+    unsigned long long size;
+    unsigned long long lastWrite;
+};
+
+unsigned long long HashBytes(const void* data, size_t length, unsigned long long hash = 14695981039346656037ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Hash case-insensitive del nome file (il file system non distingue maiuscole)
+unsigned long long HashFileName(const char* name) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const char* p = name; *p; ++p) {
+        hash ^= static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(*p)));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+unsigned long long ComputePatternSetHash(const std::vector<int>& patternIndices) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int index : patternIndices) {
+        const std::string& regex = patternCommandPairs[index].patternRegex;
+        hash = HashBytes(regex.data(), regex.length(), hash);
+        hash = HashBytes("\n", 1, hash);
+    }
+    return hash;
+}
+
+FileStamp MakeFileStamp(const WIN32_FIND_DATA& findData) {
+    FileStamp stamp;
+    stamp.size = (static_cast<unsigned long long>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+    stamp.lastWrite = (static_cast<unsigned long long>(findData.ftLastWriteTime.dwHighDateTime) << 32) |
+                      findData.ftLastWriteTime.dwLowDateTime;
+    return stamp;
+}
+
+std::string FolderSnapshotDirectory() {
+    size_t pos = processedFilesDb.find_last_of("\\/");
+    std::string baseDir = (pos != std::string::npos) ? processedFilesDb.substr(0, pos) : std::string(".");
+    return baseDir + "\\snapshots";
+}
+
+std::string FolderSnapshotPath(const std::string& normalizedFolder) {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') 
+         << HashBytes(normalizedFolder.data(), normalizedFolder.length()) << ".snap";
+    return FolderSnapshotDirectory() + "\\" + name.str();
+}
+
+std::shared_ptr<FolderSnapshot> GetFolderSnapshot(const std::string& normalizedFolder) {
+    std::lock_guard<std::mutex> lock(folderSnapshotsMutex);
+    std::shared_ptr<FolderSnapshot>& snapshot = folderSnapshots[normalizedFolder];
+    if (!snapshot) snapshot = std::make_shared<FolderSnapshot>();
+    return snapshot;
+}
+
+std::shared_ptr<FolderSnapshot> FindFolderSnapshot(const std::string& normalizedFolder) {
+    std::lock_guard<std::mutex> lock(folderSnapshotsMutex);
+    auto it = folderSnapshots.find(normalizedFolder);
+    return it != folderSnapshots.end() ? it->second : std::shared_ptr<FolderSnapshot>();
+}
+
+// Registra un file ormai chiuso nell'istantanea della sua cartella (se monitorata)
+void RecordSnapshotEntry(const std::string& fullPath) {
+    size_t pos = fullPath.find_last_of('\\');
+    if (pos == std::string::npos) return;
+    
+    std::shared_ptr<FolderSnapshot> snapshot = FindFolderSnapshot(NormalizeFolderPath(fullPath.substr(0, pos)));
+    if (!snapshot) return;
+    
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(fullPath.c_str(), GetFileExInfoStandard, &data)) return;
+    
+    FileStamp stamp;
+    stamp.size = (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    stamp.lastWrite = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                      data.ftLastWriteTime.dwLowDateTime;
+    unsigned long long nameHash = HashFileName(fullPath.c_str() + pos + 1);
+    
+    std::lock_guard<std::mutex> lock(snapshot->mutex);
+    snapshot->entries[nameHash] = stamp;
+    snapshot->dirty = true;
+}
+
+bool LoadFolderSnapshot(const std::string& normalizedFolder, unsigned long long patternHash,
+                        std::unordered_map<unsigned long long, FileStamp>& entries) {
+    std::string path = FolderSnapshotPath(normalizedFolder);
+    HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    
+    SnapshotHeader header;
+    DWORD bytesRead = 0;
+    bool valid = ReadFile(file, &header, sizeof(header), &bytesRead, NULL) && bytesRead == sizeof(header) &&
+                 memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == SNAPSHOT_VERSION &&
+                 header.folderHash == HashBytes(normalizedFolder.data(), normalizedFolder.length()) &&
+                 header.entryCount <= MAX_SNAPSHOT_ENTRIES;
+    
+    if (valid && header.patternHash != patternHash) {
+        WriteToLog("Istantanea ignorata (pattern cambiati): " + normalizedFolder, true);
+        valid = false;
+    }
+    
+    std::vector<SnapshotRecord> records;
+    if (valid) {
+        records.resize(static_cast<size_t>(header.entryCount));
+        DWORD expected = static_cast<DWORD>(records.size() * sizeof(SnapshotRecord));
+        valid = records.empty() ||
+                (ReadFile(file, &records[0], expected, &bytesRead, NULL) && bytesRead == expected);
+    }
+    CloseHandle(file);
+    
+    if (valid && !records.empty() &&
+        HashBytes(&records[0], records.size() * sizeof(SnapshotRecord)) != header.checksum) {
+        valid = false;
+    }
+    if (!valid) {
+        WriteToLog("Istantanea non utilizzabile, scansione completa: " + normalizedFolder, true);
+        return false;
+    }
+    
+    entries.reserve(records.size());
+    for (const SnapshotRecord& record : records) {
+        FileStamp stamp;
+        stamp.size = record.size;
+        stamp.lastWrite = record.lastWrite;
+        entries[record.nameHash] = stamp;
+    }
+    return true;
+}
+
+bool WriteFolderSnapshot(const std::string& normalizedFolder, FolderSnapshot& snapshot) {
+    SnapshotHeader header;
+    ZeroMemory(&header, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.folderHash = HashBytes(normalizedFolder.data(), normalizedFolder.length());
+    
+    // Copia sotto lock, scrittura su disco senza lock
+    std::vector<SnapshotRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(snapshot.mutex);
+        header.patternHash = snapshot.patternHash;
+        records.reserve(snapshot.entries.size());
+        for (const auto& entry : snapshot.entries) {
+            SnapshotRecord record;
+            record.nameHash = entry.first;
+            record.size = entry.second.size;
+            record.lastWrite = entry.second.lastWrite;
+            records.push_back(record);
+        }
+        snapshot.dirty = false;
+    }
+    header.entryCount = records.size();
+    header.checksum = records.empty() ? 14695981039346656037ULL :
+                      HashBytes(&records[0], records.size() * sizeof(SnapshotRecord));
+    
+    std::string path = FolderSnapshotPath(normalizedFolder);
+    std::string tempPath = path + ".tmp";
+    CreateDirectoryRecursive(FolderSnapshotDirectory());
+    
+    HANDLE file = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        WriteToLog("ERRORE: Impossibile scrivere istantanea: " + tempPath + " Error: " + std::to_string(GetLastError()));
+        std::lock_guard<std::mutex> lock(snapshot.mutex);
+        snapshot.dirty = true;
+        return false;
+    }
+    
+    DWORD written = 0;
+    DWORD recordBytes = static_cast<DWORD>(records.size() * sizeof(SnapshotRecord));
+    bool ok = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header);
+    if (ok && recordBytes > 0) {
+        ok = WriteFile(file, &records[0], recordBytes, &written, NULL) && written == recordBytes;
+    }
+    if (ok) ok = FlushFileBuffers(file) != FALSE;
+    CloseHandle(file);
+    
+    if (!ok || !MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        WriteToLog("ERRORE: Salvataggio istantanea fallito per: " + normalizedFolder);
+        DeleteFile(tempPath.c_str());
+        std::lock_guard<std::mutex> lock(snapshot.mutex);
+        snapshot.dirty = true;
+        return false;
+    }
+    return true;
+}
+
+void SaveAllFolderSnapshots() {
+    std::vector<std::pair<std::string, std::shared_ptr<FolderSnapshot>>> dirty;
+    {
+        std::lock_guard<std::mutex> lock(folderSnapshotsMutex);
+        for (const auto& entry : folderSnapshots) {
+            std::lock_guard<std::mutex> snapshotLock(entry.second->mutex);
+            if (entry.second->dirty) dirty.push_back(entry);
+        }
+    }
+    
+    for (const auto& entry : dirty) {
+        if (WriteFolderSnapshot(entry.first, *entry.second)) {
+            WriteToLog("Istantanea salvata: " + entry.first, true);
+        }
+    }
+}
+
+void DeleteAllFolderSnapshots() {
+    std::string directory = FolderSnapshotDirectory();
+    WIN32_FIND_DATA findData;
+    HANDLE hFind = FindFirstFile((directory + "\\*.snap").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return;
+    do {
+        DeleteFile((directory + "\\" + findData.cFileName).c_str());
+    } while (FindNextFile(hFind, &findData));
+    FindClose(hFind);
+}
+
+// ====== RICONCILIAZIONE DOPO OVERFLOW ======
+// Se il buffer di ReadDirectoryChangesW va in overflow il kernel scarta gli eventi
+// e completa con 0 byte: la cartella viene accodata a un thread di riconciliazione
+// che la rilegge e la confronta con l'istantanea della cartella (hash del nome,
+// dimensione, data di scrittura). Solo i file nuovi o cambiati proseguono verso
+// matching e DB; quelli gia' stabili vanno subito al dispatch, gli altri dal debounce.
+
+void HandleNotificationOverflow(FolderMonitor* monitor) {
+    monitor->stats->overflows++;
+    notificationOverflowsTotal++;
+    systemMetrics.errorsCount++;
+    WriteToLog("AVVISO: Overflow buffer notifiche (" + std::to_string(monitor->notifyBuffer.size() / 1024) + 
+               " KB) per cartella: " + monitor->folderPath + ", eventi persi - riconciliazione pianificata");
+    QueueFolderReconciliation(monitor);
+}
+
+void QueueFolderReconciliation(FolderMonitor* monitor) {
+    std::lock_guard<std::mutex> lock(reconcileMutex);
+    if (!reconcileRunning) return;
+    
+    // Piu' overflow ravvicinati producono una sola scansione
+    if (monitor->reconcilePending.exchange(true)) return;
+    reconcileQueue.push_back(monitor);
+    reconcileCondition.notify_one();
+}
+
+bool StartReconciler() {
+    std::lock_guard<std::mutex> lock(reconcileMutex);
+    if (reconcileRunning) return true;
+    
+    reconcileQueue.clear();
+    reconcileRunning = true;
+    reconcileThread = std::thread(ReconcileWorker);
+    return true;
+}
+
+void StopReconciler() {
+    {
+        std::lock_guard<std::mutex> lock(reconcileMutex);
+        if (!reconcileRunning) return;
+        reconcileRunning = false;
+        for (FolderMonitor* monitor : reconcileQueue) monitor->reconcilePending = false;
+        reconcileQueue.clear();
+    }
+    reconcileCondition.notify_all();
+    if (reconcileThread.joinable()) reconcileThread.join();
+}
+
+void ReconcileWorker() {
+    std::unique_lock<std::mutex> lock(reconcileMutex);
+    
+    while (reconcileRunning) {
+        if (reconcileQueue.empty()) {
+            reconcileCondition.wait(lock);
+            continue;
+        }
+        
+        FolderMonitor* monitor = reconcileQueue.front();
+        reconcileQueue.pop_front();
+        
+        lock.unlock();
+        // Azzerato prima della scansione: un overflow durante la scansione la ripete
+        monitor->reconcilePending = false;
+        ReconcileFolder(monitor);
+        lock.lock();
+    }
+}
+
+void ReconcileFolder(FolderMonitor* monitor) {
+    auto startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<FolderSnapshot> snapshot = GetFolderSnapshot(monitor->normalizedPath);
+    
+    std::string searchPath = monitor->folderPath + "\\*";
+    WIN32_FIND_DATA findData;
+    HANDLE hFind = FindFirstFileEx(searchPath.c_str(), FindExInfoBasic, &findData,
+                                   FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        WriteToLog("ERRORE: Riconciliazione impossibile per cartella: " + monitor->folderPath + 
+                   " Error: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        return;
+    }
+    
+    // File scritti prima di questo istante sono considerati gia' stabili
+    FILETIME nowFt;
+    GetSystemTimeAsFileTime(&nowFt);
+    ULARGE_INTEGER settledBefore;
+    settledBefore.LowPart = nowFt.dwLowDateTime;
+    settledBefore.HighPart = nowFt.dwHighDateTime;
+    settledBefore.QuadPart -= static_cast<unsigned long long>(monitor->debounceMs) * 10000ULL;
+    
+    std::unordered_set<unsigned long long> present;
+    size_t files = 0;
+    size_t candidates = 0;
+    size_t unchanged = 0;
+    bool interrupted = false;
+    
+    do {
+        if (monitor->stopRequested || globalShutdown || !reconcileRunning) {
+            interrupted = true;
+            break;
+        }
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        
+        files++;
+        FileStamp stamp = MakeFileStamp(findData);
+        unsigned long long nameHash = HashFileName(findData.cFileName);
+        present.insert(nameHash);
+        
+        bool same = false;
+        {
+            std::lock_guard<std::mutex> lock(snapshot->mutex);
+            auto previous = snapshot->entries.find(nameHash);
+            same = previous != snapshot->entries.end() &&
+                   previous->second.size == stamp.size && previous->second.lastWrite == stamp.lastWrite;
+        }
+        if (same) {
+            unchanged++;
+            continue;
+        }
+        
+        candidates++;
+        std::string filename = findData.cFileName;
+        if (stamp.lastWrite <= settledBefore.QuadPart) {
+            DispatchReadyFile(monitor->folderPath + "\\" + filename, filename, monitor->matcher, monitor->stats);
+        } else {
+            SubmitFileEvent(monitor, filename);
+        }
+    } while (FindNextFile(hFind, &findData));
+    
+    FindClose(hFind);
+    
+    if (interrupted) return;
+    
+    // Le voci dei file spariti non servono piu'
+    {
+        std::lock_guard<std::mutex> lock(snapshot->mutex);
+        for (auto it = snapshot->entries.begin(); it != snapshot->entries.end();) {
+            if (present.count(it->first) == 0) {
+                it = snapshot->entries.erase(it);
+                snapshot->dirty = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    monitor->stats->reconciliations++;
+    monitor->stats->filesReconciled += candidates;
+    
+    WriteToLog("Riconciliazione completata: " + monitor->folderPath + 
+               " - File: " + std::to_string(files) +
+               ", Nuovi/modificati: " + std::to_string(candidates) +
+               ", Invariati: " + std::to_string(unchanged) +
+               ", Durata: " + std::to_string(static_cast<long long>(ElapsedMs(startTime))) + " ms");
+}
+
+// ====== POOL ESECUTORI ======
+// I watcher non eseguono piu' comandi: accodano job in una coda limitata consumata
+// da ExecutorThreads thread. Le attese file bloccano solo un esecutore, mai il
+// rilevamento eventi di una cartella; l'attesa dei processi e' del supervisore.
+
+bool StartExecutorPool(int threadCount, int queueSize) {
+    if (!executorThreads.empty()) return true;
+    
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_EXECUTOR_THREADS) threadCount = MAX_EXECUTOR_THREADS;
+    if (queueSize < 1) queueSize = DEFAULT_EXECUTOR_QUEUE_SIZE;
+    
+    executorQueue.Open(static_cast<size_t>(queueSize));
+    
+    for (int i = 0; i < threadCount; ++i) {
+        executorThreads.push_back(std::thread(ExecutorWorker));
+    }
+    
+    WriteToLog("Pool esecutori avviato: " + std::to_string(threadCount) + 
+               " thread, coda max " + std::to_string(queueSize));
+    return true;
+}
+
+void StopExecutorPool() {
+    if (executorThreads.empty()) return;
+    
+    // I job ancora in coda non sono marcati come processati: verranno ripresi
+    // dalla scansione iniziale al prossimo avvio
+    executorQueue.Close();
+    
+    const DWORD POOL_TIMEOUT_MS = 3000;
+    DWORD startTime = GetTickCount();
+    while (executorThreadsRunning > 0 && GetTickCount() - startTime < POOL_TIMEOUT_MS) {
+        Sleep(50);
+    }
+    
+    bool allStopped = (executorThreadsRunning == 0);
+    for (auto& t : executorThreads) {
+        if (!t.joinable()) continue;
+        if (allStopped) {
+            t.join();
+        } else {
+            t.detach();
+        }
+    }
+    executorThreads.clear();
+    
+    if (!allStopped) {
+        WriteToLog("TIMEOUT: Detach forzato thread esecutori");
+    }
+    
+    std::lock_guard<std::mutex> lock(pendingJobsMutex);
+    pendingJobKeys.clear();
+    WriteToLog("Pool esecutori arrestato", true);
+}
+
+bool EnqueueExecutionJob(const std::string& fullPath, int patternIndex, const std::shared_ptr<FolderStats>& stats) {
+    std::string jobKey = fullPath + "|" + std::to_string(patternIndex);
+    {
+        std::lock_guard<std::mutex> lock(pendingJobsMutex);
+        if (pendingJobKeys.count(jobKey)) {
+            WriteToLog("Job gia' in coda: " + fullPath, true);
+            return false;
+        }
+        // L'esecutore marca il file processato prima di rilasciare la chiave: scansione
+        // iniziale ed eventi live che arrivano sullo stesso file non lo eseguono due volte
+        if (IsFileAlreadyProcessed(fullPath)) {
+            WriteToLog("Job non accodato, file gia' processato: " + fullPath, true);
+            return false;
+        }
+        pendingJobKeys.insert(jobKey);
+    }
+    
+    ExecutionJob job;
+    job.fullPath = fullPath;
+    job.patternIndex = patternIndex;
+    job.stats = stats;
+    job.enqueuedAt = std::chrono::steady_clock::now();
+    
+    if (stats) stats->queueDepth++;
+    
+    if (!executorQueue.Push(std::move(job))) {
+        if (stats) stats->queueDepth--;
+        std::lock_guard<std::mutex> lock(pendingJobsMutex);
+        pendingJobKeys.erase(jobKey);
+        return false;
+    }
+    
+    return true;
+}
+
+void ReleaseExecutionJobKey(const std::string& fullPath, int patternIndex) {
+    std::lock_guard<std::mutex> lock(pendingJobsMutex);
+    pendingJobKeys.erase(fullPath + "|" + std::to_string(patternIndex));
+}
+
+// Avvia il comando del job: l'esecutore torna subito libero, l'uscita del processo
+// viene gestita dal supervisore. false se il processo non e' partito
+bool LaunchExecutionJob(const ExecutionJob& job) {
+    const PatternCommandPair& pair = patternCommandPairs[job.patternIndex];
+    std::string fullPath = job.fullPath;
+    int patternIndex = job.patternIndex;
+    std::shared_ptr<FolderStats> stats = job.stats;
+    
+    return StartCommand(pair.command, fullPath, pair.patternName, [fullPath, patternIndex, stats](bool success) {
+        if (success) {
+            WriteToLog("Comando eseguito per: " + fullPath, true);
+            RecordSnapshotEntry(fullPath);
+            if (stats) stats->filesProcessed++;
+        }
+        if (stats) stats->jobsCompleted++;
+        ReleaseExecutionJobKey(fullPath, patternIndex);
+    });
+}
+
+void ExecutorWorker() {
+    executorThreadsRunning++;
+    
+    ExecutionJob job;
+    while (executorQueue.Pop(job)) {
+        auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - job.enqueuedAt).count();
+        
+        if (job.stats) {
+            job.stats->queueDepth--;
+            job.stats->totalWaitMs += static_cast<unsigned long long>(waited);
+            size_t currentMax = job.stats->maxWaitMs.load();
+            while (static_cast<size_t>(waited) > currentMax &&
+                   !job.stats->maxWaitMs.compare_exchange_weak(currentMax, static_cast<size_t>(waited))) {
+            }
+        }
+        
+        bool validPattern = job.patternIndex >= 0 && 
+                            job.patternIndex < static_cast<int>(patternCommandPairs.size());
+        
+        if (!job.batch.empty()) {
+            // Gruppo micro-batch scaduto, accodato dal thread di flush
+            if (validPattern) {
+                RunPatternBatch(job.patternIndex, job.batch);
+            } else {
+                CompletePatternBatch(job.patternIndex, job.batch, false);
+            }
+            job = ExecutionJob();
+            continue;
+        }
+        
+        if (!globalShutdown && validPattern && patternCommandPairs[job.patternIndex].batchMaxFiles > 1) {
+            // La chiave del file resta occupata fino alla chiusura del gruppo
+            std::vector<BatchEntry> ready;
+            if (AddToPatternBatch(job, ready)) RunPatternBatch(job.patternIndex, ready);
+            job = ExecutionJob();
+            continue;
+        }
+        
+        if (!globalShutdown && validPattern &&
+            patternCommandPairs[job.patternIndex].builtinAction != PatternCommandPair::BuiltinNone) {
+            // Azione integrata: operazione sui file direttamente nell'esecutore
+            bool fileRemains = false;
+            if (ExecuteBuiltinAction(patternCommandPairs[job.patternIndex], job.fullPath, fileRemains)) {
+                if (fileRemains) RecordSnapshotEntry(job.fullPath);
+                if (job.stats) job.stats->filesProcessed++;
+            }
+            if (job.stats) job.stats->jobsCompleted++;
+            ReleaseExecutionJobKey(job.fullPath, job.patternIndex);
+            job = ExecutionJob();
+            continue;
+        }
+        
+        if (!globalShutdown && validPattern && patternCommandPairs[job.patternIndex].residentWorkers > 0) {
+            if (ExecuteResidentCommand(job.patternIndex, job.fullPath)) {
+                WriteToLog("Comando eseguito per: " + job.fullPath, true);
+                RecordSnapshotEntry(job.fullPath);
+                if (job.stats) job.stats->filesProcessed++;
+            }
+            if (job.stats) job.stats->jobsCompleted++;
+            ReleaseExecutionJobKey(job.fullPath, job.patternIndex);
+            job = ExecutionJob();
+            continue;
+        }
+        
+        if (!globalShutdown && validPattern && LaunchExecutionJob(job)) {
+            // Completamento e rilascio della chiave nella callback del supervisore
+            job = ExecutionJob();
+            continue;
+        }
+        
+        if (job.stats) job.stats->jobsCompleted++;
+        
+        ReleaseExecutionJobKey(job.fullPath, job.patternIndex);
+        job = ExecutionJob();
+    }
+    
+    executorThreadsRunning--;
+}
+
+// ====== MICRO-BATCH PER PATTERN ======
+// I pattern con opzione batch= non lanciano un processo per file: gli esecutori
+// accumulano i file in un gruppo per pattern, eseguito quando raggiunge batch= file
+// oppure quando il primo file ha atteso wait= ms (scadenza gestita da un thread
+// dedicato che accoda il gruppo come job). Le chiavi di deduplica dei file restano
+// occupate finche' il gruppo non e' concluso.
+
+bool StartBatcher() {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    if (batcherRunning) return true;
+    
+    bool anyBatched = false;
+    for (const auto& pair : patternCommandPairs) {
+        if (pair.batchMaxFiles > 1) anyBatched = true;
+    }
+    if (!anyBatched) return true;
+    
+    batcherRunning = true;
+    batcherThread = std::thread(BatchFlushWorker);
+    WriteToLog("Micro-batch pattern avviato");
+    return true;
+}
+
+void StopBatcher() {
+    std::map<int, PendingBatch> dropped;
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        if (!batcherRunning) return;
+        batcherRunning = false;
+        dropped.swap(pendingBatches);
+    }
+    batchCondition.notify_all();
+    if (batcherThread.joinable()) batcherThread.join();
+    
+    // I file dei gruppi non eseguiti non sono marcati: li riprende la scansione iniziale
+    size_t droppedFiles = 0;
+    for (auto& batch : dropped) {
+        droppedFiles += batch.second.entries.size();
+        CompletePatternBatch(batch.first, batch.second.entries, false);
+    }
+    if (droppedFiles > 0) {
+        WriteToLog("Micro-batch arrestato, " + std::to_string(droppedFiles) + " file in attesa rinviati");
+    }
+}
+
+void BatchFlushWorker() {
+    std::unique_lock<std::mutex> lock(batchMutex);
+    while (batcherRunning) {
+        auto now = std::chrono::steady_clock::now();
+        auto nextDeadline = now + std::chrono::seconds(1);
+        
+        std::vector<ExecutionJob> expired;
+        for (auto it = pendingBatches.begin(); it != pendingBatches.end();) {
+            if (it->second.deadline <= now) {
+                ExecutionJob job;
+                job.patternIndex = it->first;
+                job.batch.swap(it->second.entries);
+                job.enqueuedAt = now;
+                expired.push_back(std::move(job));
+                it = pendingBatches.erase(it);
+            } else {
+                if (it->second.deadline < nextDeadline) nextDeadline = it->second.deadline;
+                ++it;
+            }
+        }
+        
+        if (!expired.empty()) {
+            // Push puo' attendere spazio in coda: mai sotto batchMutex
+            lock.unlock();
+            for (auto& job : expired) {
+                int patternIndex = job.patternIndex;
+                std::vector<BatchEntry> entries = job.batch;
+                if (!executorQueue.Push(std::move(job))) {
+                    CompletePatternBatch(patternIndex, entries, false);
+                }
+            }
+            lock.lock();
+            continue;
+        }
+        
+        batchCondition.wait_until(lock, nextDeadline);
+    }
+}
+
+// Aggiunge il file al gruppo del pattern; true se il gruppo e' pieno e va eseguito subito
+bool AddToPatternBatch(const ExecutionJob& job, std::vector<BatchEntry>& ready) {
+    const PatternCommandPair& pair = patternCommandPairs[job.patternIndex];
+    
+    std::lock_guard<std::mutex> lock(batchMutex);
+    if (!batcherRunning) {
+        ready.push_back(BatchEntry(job.fullPath, job.stats));
+        return true;
+    }
+    
+    PendingBatch& batch = pendingBatches[job.patternIndex];
+    if (batch.entries.empty()) {
+        batch.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(pair.batchMaxWaitMs);
+        batchCondition.notify_one();
+    }
+    batch.entries.push_back(BatchEntry(job.fullPath, job.stats));
+    
+    if (batch.entries.size() < static_cast<size_t>(pair.batchMaxFiles)) return false;
+    
+    ready.swap(batch.entries);
+    pendingBatches.erase(job.patternIndex);
+    return true;
+}
+
+void RunPatternBatch(int patternIndex, std::vector<BatchEntry>& entries) {
+    if (entries.empty()) return;
+    
+    std::shared_ptr<std::vector<BatchEntry>> group = std::make_shared<std::vector<BatchEntry>>();
+    group->swap(entries);
+    
+    std::vector<std::string> files;
+    files.reserve(group->size());
+    for (const auto& entry : *group) files.push_back(entry.fullPath);
+    
+    bool launched = !globalShutdown &&
+        StartBatchCommand(patternCommandPairs[patternIndex], files,
+                          [patternIndex, group](bool success, const std::vector<std::string>& executedFiles) {
+            if (success) {
+                std::set<std::string> executed(executedFiles.begin(), executedFiles.end());
+                for (auto& entry : *group) {
+                    entry.executed = executed.count(entry.fullPath) > 0;
+                }
+            }
+            CompletePatternBatch(patternIndex, *group, success);
+        });
+    
+    if (!launched) CompletePatternBatch(patternIndex, *group, false);
+}
+
+void CompletePatternBatch(int patternIndex, const std::vector<BatchEntry>& entries, bool success) {
+    for (const auto& entry : entries) {
+        if (success && entry.executed) {
+            RecordSnapshotEntry(entry.fullPath);
+            if (entry.stats) entry.stats->filesProcessed++;
+        }
+        if (entry.stats) entry.stats->jobsCompleted++;
+        ReleaseExecutionJobKey(entry.fullPath, patternIndex);
+    }
+}
+
+// ====== WORKER RESIDENTI ======
+// I pattern con opzione workers=N non avviano un processo per file: il servizio tiene
+// N processi del comando sempre attivi e a ogni file scrive il percorso su una riga
+// dello stdin di un worker libero, leggendo una riga di esito dallo stdout ("OK..." =
+// successo, qualsiasi altra riga = errore). Stdin e stdout del worker sono i due lati
+// di una named pipe overlapped, cosi' ogni richiesta ha un timeout (timeout=MS).
+// Un worker che muore viene riavviato (con backoff se continua a cadere) e la richiesta
+// ripetuta una volta; un worker che supera il timeout viene terminato e riavviato.
+
+struct ResidentWorker {
+    HANDLE process;
+    HANDLE pipe;
+    HANDLE ioEvent;
+    std::string pending;  // byte letti oltre l'ultima riga di esito
+    bool busy;
+    
+    ResidentWorker() : process(NULL), pipe(INVALID_HANDLE_VALUE), ioEvent(NULL), busy(false) {}
+};
+
+struct ResidentWorkerPool {
+    int patternIndex;
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::vector<std::unique_ptr<ResidentWorker>> workers;
+    int consecutiveFailures;
+    std::chrono::steady_clock::time_point nextStartAllowed;
+    
+    ResidentWorkerPool() : patternIndex(-1), consecutiveFailures(0) {}
+};
+
+std::mutex residentPoolsMutex;
+std::map<int, std::unique_ptr<ResidentWorkerPool>> residentPools;
+std::atomic<unsigned int> residentPipeCounter{0};
+std::atomic<size_t> residentRestartsTotal{0};
+
+enum ResidentRequestResult { ResidentReplied, ResidentTimedOut, ResidentBroken };
+
+ResidentWorkerPool* GetResidentPool(int patternIndex) {
+    std::lock_guard<std::mutex> lock(residentPoolsMutex);
+    std::unique_ptr<ResidentWorkerPool>& pool = residentPools[patternIndex];
+    if (!pool) {
+        pool.reset(new ResidentWorkerPool());
+        pool->patternIndex = patternIndex;
+        for (int i = 0; i < patternCommandPairs[patternIndex].residentWorkers; ++i) {
+            pool->workers.push_back(std::unique_ptr<ResidentWorker>(new ResidentWorker()));
+        }
+    }
+    return pool.get();
+}
+
+void CloseResidentWorker(ResidentWorker& worker, bool graceful) {
+    if (worker.pipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(worker.pipe);  // EOF sullo stdin: il worker puo' terminare da solo
+        worker.pipe = INVALID_HANDLE_VALUE;
+    }
+    if (worker.process != NULL) {
+        if (!graceful || WaitForSingleObject(worker.process, 2000) != WAIT_OBJECT_0) {
+            TerminateProcess(worker.process, 1);
+        }
+        CloseHandle(worker.process);
+        worker.process = NULL;
+    }
+    if (worker.ioEvent != NULL) {
+        CloseHandle(worker.ioEvent);
+        worker.ioEvent = NULL;
+    }
+    worker.pending.clear();
+}
+
+void NoteResidentFailure(ResidentWorkerPool& pool) {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.consecutiveFailures++;
+    int shift = std::min(pool.consecutiveFailures, 7);
+    pool.nextStartAllowed = std::chrono::steady_clock::now() + std::chrono::milliseconds(250 << shift);
+}
+
+bool StartResidentWorker(ResidentWorkerPool& pool, ResidentWorker& worker) {
+    const PatternCommandPair& pair = patternCommandPairs[pool.patternIndex];
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.consecutiveFailures > 0 && std::chrono::steady_clock::now() < pool.nextStartAllowed) {
+            WriteToLog("Worker residente [" + pair.patternName + "] in attesa di riavvio (backoff)", true);
+            return false;
+        }
+    }
+    
+    if (!FileExists(pair.command)) {
+        WriteToLog("ERRORE: Comando non trovato: " + pair.command);
+        systemMetrics.errorsCount++;
+        NoteResidentFailure(pool);
+        return false;
+    }
+    
+    std::string pipeName = "\\\\.\\pipe\\PatternTriggerCommand_" + std::to_string(GetCurrentProcessId()) +
+                           "_" + std::to_string(residentPipeCounter++);
+    
+    worker.ioEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    worker.pipe = CreateNamedPipe(pipeName.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                  PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                  1, 64 * 1024, 64 * 1024, 0, NULL);
+    if (worker.ioEvent == NULL || worker.pipe == INVALID_HANDLE_VALUE) {
+        WriteToLog("ERRORE: Impossibile creare pipe worker residente: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        CloseResidentWorker(worker, false);
+        NoteResidentFailure(pool);
+        return false;
+    }
+    
+    STARTUPINFO si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
+    si.wShowWindow = SW_HIDE;
+    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    ZeroMemory(&pi, sizeof(pi));
+    
+    std::string commandLine = "\"" + pair.command + "\"";
+    std::vector<char> cmdline(commandLine.begin(), commandLine.end());
+    cmdline.push_back('\0');
+    
+    BOOL created = FALSE;
+    {
+        // Il lato client della pipe e' l'unico handle ereditabile aperto durante l'avvio
+        std::lock_guard<std::mutex> lock(inheritableHandlesMutex);
+        SECURITY_ATTRIBUTES sa;
+        sa.nLength = sizeof(sa);
+        sa.lpSecurityDescriptor = NULL;
+        sa.bInheritHandle = TRUE;
+        HANDLE client = CreateFile(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, &sa, OPEN_EXISTING, 0, NULL);
+        if (client != INVALID_HANDLE_VALUE) {
+            si.hStdInput = client;
+            si.hStdOutput = client;
+            created = CreateProcess(NULL, &cmdline[0], NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+            CloseHandle(client);
+        }
+    }
+    
+    if (!created) {
+        WriteToLog("ERRORE: Avvio worker residente [" + pair.patternName + "] fallito: " + std::to_string(GetLastError()));
+        systemMetrics.errorsCount++;
+        CloseResidentWorker(worker, false);
+        NoteResidentFailure(pool);
+        return false;
+    }
+    
+    CloseHandle(pi.hThread);
+    worker.process = pi.hProcess;
+    WriteToLog("Worker residente avviato [" + pair.patternName + "]: " + commandLine, true);
+    return true;
+}
+
+// Operazione overlapped sulla pipe del worker con attesa limitata
+ResidentRequestResult ResidentPipeIo(ResidentWorker& worker, bool writing, char* buffer, DWORD length,
+                                     DWORD& transferred, const std::chrono::steady_clock::time_point& deadline) {
+    OVERLAPPED ov;
+    ZeroMemory(&ov, sizeof(ov));
+    ov.hEvent = worker.ioEvent;
+    ResetEvent(worker.ioEvent);
+    
+    BOOL ok = writing ? WriteFile(worker.pipe, buffer, length, NULL, &ov)
+                      : ReadFile(worker.pipe, buffer, length, NULL, &ov);
+    if (!ok && GetLastError() != ERROR_IO_PENDING) return ResidentBroken;
+    
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+    DWORD waitMs = remaining > 0 ? static_cast<DWORD>(remaining) : 0;
+    
+    if (WaitForSingleObject(worker.ioEvent, waitMs) != WAIT_OBJECT_0) {
+        CancelIo(worker.pipe);
+        GetOverlappedResult(worker.pipe, &ov, &transferred, TRUE);
+        return ResidentTimedOut;
+    }
+    
+    if (!GetOverlappedResult(worker.pipe, &ov, &transferred, FALSE) || transferred == 0) return ResidentBroken;
+    return ResidentReplied;
+}
+
+ResidentRequestResult SendResidentRequest(ResidentWorker& worker, const std::string& fullPath,
+                                          int timeoutMs, std::string& status) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    
+    std::string request = fullPath + "\r\n";
+    size_t sent = 0;
+    while (sent < request.length()) {
+        DWORD written = 0;
+        ResidentRequestResult result = ResidentPipeIo(worker, true, &request[sent],
+                                                      static_cast<DWORD>(request.length() - sent), written, deadline);
+        if (result != ResidentReplied) return result;
+        sent += written;
+    }
+    
+    char buffer[4096];
+    size_t newline;
+    while ((newline = worker.pending.find('\n')) == std::string::npos) {
+        if (worker.pending.length() > 64 * 1024) return ResidentBroken;  // nessuna riga di esito
+        DWORD received = 0;
+        ResidentRequestResult result = ResidentPipeIo(worker, false, buffer, sizeof(buffer), received, deadline);
+        if (result != ResidentReplied) return result;
+        worker.pending.append(buffer, received);
+    }
+    
+    status = worker.pending.substr(0, newline);
+    worker.pending.erase(0, newline + 1);
+    if (!status.empty() && status.back() == '\r') status.pop_back();
+    return ResidentReplied;
+}
+
+ResidentWorker* AcquireResidentWorker(ResidentWorkerPool& pool) {
+    std::unique_lock<std::mutex> lock(pool.mutex);
+    while (!globalShutdown) {
+        for (auto& worker : pool.workers) {
+            if (!worker->busy) {
+                worker->busy = true;
+                return worker.get();
+            }
+        }
+        pool.idle.wait_for(lock, std::chrono::milliseconds(200));
+    }
+    return NULL;
+}
+
+void ReleaseResidentWorker(ResidentWorkerPool& pool, ResidentWorker* worker) {
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        worker->busy = false;
+    }
+    pool.idle.notify_one();
+}
+
+// Esegue il file su un worker residente del pattern (bloccante per l'esecutore,
+// limitato da timeout=). Con esito "OK" il file viene marcato processato
+bool ExecuteResidentCommand(int patternIndex, const std::string& fullPath) {
+    const PatternCommandPair& pair = patternCommandPairs[patternIndex];
+    
+    if (IsFileAlreadyProcessed(fullPath)) {
+        WriteToLog("SALTATO: File già processato: " + fullPath);
+        return false;
+    }
+    
+    if (!WaitForFileAvailability(fullPath)) {
+        WriteToLog("ERRORE: File non disponibile: " + fullPath);
+        systemMetrics.errorsCount++;
+        return false;
+    }
+    
+    std::vector<std::string> keys = ComputeDedupKeys(fullPath);
+    if (AreDedupKeysProcessed(fullPath, keys)) return false;
+    
+    ResidentWorkerPool* pool = GetResidentPool(patternIndex);
+    ResidentWorker* worker = AcquireResidentWorker(*pool);
+    if (worker == NULL) return false;
+    
+    auto startTime = std::chrono::steady_clock::now();
+    WriteToLog("ESECUZIONE RESIDENTE [" + pair.patternName + "]: " + fullPath);
+    
+    std::string status;
+    bool replied = false;
+    for (int attempt = 0; attempt < 2 && !replied && !globalShutdown; ++attempt) {
+        if (worker->process == NULL && !StartResidentWorker(*pool, *worker)) break;
+        
+        ResidentRequestResult result = SendResidentRequest(*worker, fullPath, pair.residentTimeoutMs, status);
+        if (result == ResidentReplied) {
+            replied = true;
+        } else if (result == ResidentTimedOut) {
+            WriteToLog("TIMEOUT: Worker residente [" + pair.patternName + "] terminato dopo " +
+                       std::to_string(pair.residentTimeoutMs) + " ms");
+            CloseResidentWorker(*worker, false);
+            NoteResidentFailure(*pool);
+            residentRestartsTotal++;
+            break;
+        } else {
+            // Worker caduto (anche tra una richiesta e l'altra): riavvio e un nuovo tentativo
+            WriteToLog("AVVISO: Worker residente [" + pair.patternName + "] non risponde, riavvio");
+            CloseResidentWorker(*worker, false);
+            NoteResidentFailure(*pool);
+            residentRestartsTotal++;
+        }
+    }
+    
+    if (replied) {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->consecutiveFailures = 0;
+    }
+    ReleaseResidentWorker(*pool, worker);
+    
+    bool success = replied && status.compare(0, 2, "OK") == 0;
+    if (success) {
+        WriteToLog("COMPLETATO RESIDENTE: " + status, true);
+        MarkFileAsProcessed(fullPath, keys);
+        systemMetrics.commandsExecuted++;
+        std::lock_guard<std::mutex> lock(patternStatsMutex);
+        patternExecutionCounts[pair.patternName]++;
+    } else {
+        WriteToLog("ERRORE: Worker residente [" + pair.patternName + "] " +
+                   (replied ? "ha risposto: " + status : std::string("senza risposta")) + " per " + fullPath);
+        systemMetrics.errorsCount++;
+    }
+    
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    systemMetrics.averageProcessingTime = (systemMetrics.averageProcessingTime + duration) / 2;
+    
+    return success;
+}
+
+void StopResidentWorkers() {
+    std::lock_guard<std::mutex> lock(residentPoolsMutex);
+    size_t stopped = 0;
+    
+    for (auto& poolPair : residentPools) {
+        ResidentWorkerPool& pool = *poolPair.second;
+        bool anyBusy = false;
+        std::lock_guard<std::mutex> poolLock(pool.mutex);
+        for (auto& worker : pool.workers) {
+            if (worker->busy) {
+                // Esecutore ancora in richiesta (detach dopo timeout): si termina il
+                // processo, gli handle restano a chi li sta usando
+                if (worker->process != NULL) TerminateProcess(worker->process, 1);
+                anyBusy = true;
+            } else if (worker->pipe != INVALID_HANDLE_VALUE) {
+                // Prima l'EOF a tutti i worker, poi l'attesa: terminano in parallelo
+                CloseHandle(worker->pipe);
+                worker->pipe = INVALID_HANDLE_VALUE;
+            }
+        }
+        for (auto& worker : pool.workers) {
+            if (!worker->busy && worker->process != NULL) {
+                CloseResidentWorker(*worker, true);
+                stopped++;
+            }
+        }
+        if (anyBusy) poolPair.second.release();
+    }
+    residentPools.clear();
+    
+    if (stopped > 0) {
+        WriteToLog("Worker residenti arrestati: " + std::to_string(stopped));
+    }
+}
+
+// ====== SCANSIONE INIZIALE PARALLELA ======
+// La scansione parte solo quando tutti i watcher sono armati: un file depositato
+// durante la scansione arriva comunque come evento e la deduplica di
+// EnqueueExecutionJob evita la doppia esecuzione. Le cartelle sono distribuite
+// round-robin su una coda per thread; un thread che esaurisce la propria coda ruba
+// dal fondo di quelle altrui, cosi' una cartella enorme non blocca le altre.
+
+struct ScanTask {
+    std::string folderPath;
+    std::vector<int> patternIndices;
+    FolderMonitor* monitor;  // NULL se il watcher della cartella non e' stato armato
+    
+    ScanTask() : monitor(NULL) {}
+};
+
+struct ScanWorkerQueue {
+    std::mutex mutex;
+    std::deque<ScanTask> tasks;
+};
+
+std::vector<std::unique_ptr<ScanWorkerQueue>> scanQueues;
+std::vector<std::thread> scanThreads;
+std::atomic<bool> scanStopRequested{false};
+std::atomic<size_t> initialScansPending{0};
+std::chrono::steady_clock::time_point initialScanStart;
+
+bool TakeScanTask(size_t self, ScanTask& task) {
+    {
+        ScanWorkerQueue& own = *scanQueues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    
+    for (size_t offset = 1; offset < scanQueues.size(); ++offset) {
+        ScanWorkerQueue& victim = *scanQueues[(self + offset) % scanQueues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void InitialScanWorker(size_t self) {
+    ScanTask task;
+    while (!globalShutdown && !scanStopRequested && TakeScanTask(self, task)) {
+        WriteToLog("=== SCANSIONE INIZIALE CARTELLA: " + task.folderPath + " ===");
+        ScanDirectoryForExistingFiles(task.folderPath, task.patternIndices, task.monitor);
+        
+        if (--initialScansPending == 0) {
+            WriteToLog("Scansioni iniziali completate in " +
+                       std::to_string(static_cast<long long>(ElapsedMs(initialScanStart))) + " ms");
+        }
+        task = ScanTask();
+    }
+}
+
+void StartInitialScans(std::vector<ScanTask>& tasks) {
+    if (tasks.empty()) return;
+    
+    size_t threadCount = std::min(static_cast<size_t>(scanThreadCount), tasks.size());
+    if (threadCount < 1) threadCount = 1;
+    
+    scanStopRequested = false;
+    scanQueues.clear();
+    for (size_t i = 0; i < threadCount; ++i) {
+        scanQueues.push_back(std::unique_ptr<ScanWorkerQueue>(new ScanWorkerQueue()));
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        scanQueues[i % threadCount]->tasks.push_back(std::move(tasks[i]));
+    }
+    
+    initialScansPending = tasks.size();
+    initialScanStart = std::chrono::steady_clock::now();
+    
+    for (size_t i = 0; i < threadCount; ++i) {
+        scanThreads.push_back(std::thread(InitialScanWorker, i));
+    }
+    
+    WriteToLog("Scansioni iniziali avviate: " + std::to_string(tasks.size()) + " cartelle su " +
+               std::to_string(threadCount) + " thread");
+}
+
+void StopInitialScans() {
+    scanStopRequested = true;
+    
+    // La scansione in corso si interrompe al file successivo (stopRequested del monitor)
+    for (auto& t : scanThreads) {
+        if (t.joinable()) t.join();
+    }
+    scanThreads.clear();
+    scanQueues.clear();
+    initialScansPending = 0;
+}
+
+void StartAllFolderMonitors() {
+    std::map<std::string, std::vector<int>> folderPatterns;
+    for (size_t i = 0; i < patternCommandPairs.size(); ++i) {
+        std::string normalizedFolder = NormalizeFolderPath(patternCommandPairs[i].folderPath);
+        folderPatterns[normalizedFolder].push_back(static_cast<int>(i));
+    }
+    
+    WriteToLog("Avvio monitoraggio per " + std::to_string(folderPatterns.size()) + " cartelle");
+    
+    StartExecutorPool(executorThreadCount, executorQueueSize);
+    StartBatcher();
+    StartDebouncer();
+    StartReconciler();
+    
+    if (!StartWatcherEngine(watcherThreadCount)) {
+        WriteToLog("ERRORE: Motore watcher non avviato, monitoraggio disabilitato");
+        return;
+    }
+    
+    // Fase 1: arma tutti i watcher prima di qualsiasi scansione
+    std::vector<ScanTask> scanTasks;
+    for (const auto& folderGroup : folderPatterns) {
+        if (globalShutdown) break;
+        
+        std::string originalFolder = patternCommandPairs[folderGroup.second[0]].folderPath;
+        
+        if (!DirectoryExists(originalFolder)) {
+            if (!CreateDirectoryRecursive(originalFolder)) {
+                WriteToLog("ERRORE: Impossibile creare directory: " + originalFolder);
+                systemMetrics.errorsCount++;
+                continue;
+            }
+        }
+        
+        // L'istantanea deve esistere prima dei primi eventi registrati dagli esecutori
+        GetFolderSnapshot(folderGroup.first);
+        
+        ScanTask task;
+        task.folderPath = originalFolder;
+        task.patternIndices = folderGroup.second;
+        
+        std::unique_ptr<FolderMonitor> monitor(new FolderMonitor(originalFolder));
+        monitor->patternIndices = folderGroup.second;
+        monitor->matcher = FindFolderMatcher(folderGroup.first);
+        auto debounceOverride = folderDebounceMs.find(folderGroup.first);
+        monitor->debounceMs = debounceOverride != folderDebounceMs.end() ? debounceOverride->second : debounceMs;
+        monitor->eventCallback = ProcessFolderEvent;
+        
+        // CORREZIONE: Scansione iniziale di TUTTI i file esistenti, anche se il watcher fallisce
+        if (AttachFolderMonitor(monitor.get())) {
+            WriteToLog("Monitor avviato per: " + originalFolder);
+            task.monitor = monitor.get();
+            std::lock_guard<std::mutex> lock(folderMonitorsMutex);
+            folderMonitors[folderGroup.first] = std::move(monitor);
+        }
+        
+        scanTasks.push_back(std::move(task));
+    }
+    
+    WriteToLog("Tutti i monitor avviati. Cartelle: " + std::to_string(folderMonitors.size()) + 
+               ", thread watcher: " + std::to_string(watcherPoolThreads.size()) +
+               ", thread esecutori: " + std::to_string(executorThreads.size()));
+    
+    // Fase 2: scansioni iniziali in parallelo, con i watcher gia' attivi
+    if (!globalShutdown) StartInitialScans(scanTasks);
+}
+
+void StopAllFolderMonitors() {
+    WriteToLog("Arresto di tutti i monitor cartelle...");
+    
+    // Fase 1: Segnala stop a tutti e chiudi gli handle: le letture pendenti
+    // completano con ERROR_OPERATION_ABORTED sulla completion port
+    for (auto& monitorPair : folderMonitors) {
+        monitorPair.second->stopRequested = true;
+        
+        if (monitorPair.second->directoryHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(monitorPair.second->directoryHandle);
+            monitorPair.second->directoryHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+    
+    // Fase 2: Attendi che tutte le letture annullate siano state consegnate al pool,
+    // altrimenti il kernel scriverebbe su OVERLAPPED/buffer gia' liberati
+    const int THREAD_TIMEOUT_MS = 3000;
+    auto startTime = GetTickCount();
+    bool drained = false;
+    
+    while (!drained && GetTickCount() - startTime < THREAD_TIMEOUT_MS) {
+        drained = true;
+        for (const auto& monitorPair : folderMonitors) {
+            if (monitorPair.second->ioPending) {
+                drained = false;
+                break;
+            }
+        }
+        if (!drained) Sleep(50);
+    }
+    
+    // Fase 3: Ferma le scansioni iniziali, il pool di thread watcher, la riconciliazione,
+    // il debounce e poi gli esecutori
+    StopInitialScans();
+    StopWatcherEngine();
+    StopReconciler();
+    StopDebouncer();
+    StopBatcher();
+    StopExecutorPool();
+    StopResidentWorkers();
+    WaitForSupervisedProcesses(3000);
+    
+    if (!drained) {
+        // Memoria ancora referenziata da I/O pendente: meglio perderla che corromperla
+        WriteToLog("TIMEOUT: I/O pendente su alcune cartelle, rilascio monitor differito");
+        for (auto& monitorPair : folderMonitors) {
+            if (monitorPair.second->ioPending) {
+                monitorPair.second.release();
+            }
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(folderMonitorsMutex);
+        folderMonitors.clear();
+    }
+    WriteToLog("Tutti i monitor sono stati fermati");
+}
+
+void UpdateSystemMetrics() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        systemMetrics.memoryUsageMB = pmc.WorkingSetSize / (1024 * 1024);
+    }
+    
+    systemMetrics.activeThreads = static_cast<size_t>(watcherThreadsRunning.load() + executorThreadsRunning.load());
+    
+    if (webServerRunning) systemMetrics.activeThreads++;
+}
+
+// Serializza le metriche copiando lo stato condiviso sotto lock brevi e mai annidati,
+// cosi' il percorso caldo (logger, esecutori) non attende la serializzazione
+static std::string BuildSystemMetricsJson() {
+    auto now = std::chrono::steady_clock::now();
+    long long uptimeSeconds;
+    long long lastActivitySeconds;
+    std::vector<std::pair<std::string, std::chrono::steady_clock::time_point>> activities;
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        uptimeSeconds = std::chrono::duration_cast<std::chrono::seconds>(now - systemMetrics.serviceStartTime).count();
+        lastActivitySeconds = systemMetrics.lastFileProcessed != std::chrono::steady_clock::time_point{} ?
+            std::chrono::duration_cast<std::chrono::seconds>(now - systemMetrics.lastFileProcessed).count() : -1;
+        activities.assign(systemMetrics.recentActivity.begin(), systemMetrics.recentActivity.end());
+    }
+    
+    struct PatternRow {
+        std::string name;
+        std::string folder;
+        std::string regex;
+        size_t matchCount;
+        size_t executionCount;
+    };
+    std::vector<PatternRow> patterns;
+    {
+        std::lock_guard<std::mutex> lock(configMutex);
+        for (const auto& pattern : patternCommandPairs) {
+            PatternRow row;
+            row.name = pattern.patternName;
+            row.folder = pattern.folderPath;
+            row.regex = pattern.patternRegex;
+            row.matchCount = 0;
+            row.executionCount = 0;
+            patterns.push_back(row);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(patternStatsMutex);
+        for (auto& row : patterns) {
+            auto matches = patternMatchCounts.find(row.name);
+            auto executions = patternExecutionCounts.find(row.name);
+            row.matchCount = matches != patternMatchCounts.end() ? matches->second : 0;
+            row.executionCount = executions != patternExecutionCounts.end() ? executions->second : 0;
+        }
+    }
+    
+    size_t taskCount;
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        taskCount = schedulerTasks.size();
+    }
+    
+    std::unique_lock<std::mutex> foldersLock(folderMonitorsMutex);
+    
+    JsonWriter json(true, 2048 + patterns.size() * 192 + activities.size() * 128);
+    json.BeginObject();
+    json.Key("totalFilesProcessed").UInt(systemMetrics.totalFilesProcessed.load());
+    json.Key("filesProcessedToday").UInt(systemMetrics.filesProcessedToday.load());
+    json.Key("activeThreads").UInt(systemMetrics.activeThreads.load());
+    json.Key("memoryUsageMB").UInt(systemMetrics.memoryUsageMB.load());
+    json.Key("averageProcessingTime").UInt(systemMetrics.averageProcessingTime.load());
+    json.Key("commandsExecuted").UInt(systemMetrics.commandsExecuted.load());
+    json.Key("errorsCount").UInt(systemMetrics.errorsCount.load());
+    json.Key("uptimeSeconds").Int(uptimeSeconds);
+    json.Key("lastActivitySeconds").Int(lastActivitySeconds);
+    json.Key("foldersMonitored").UInt(folderMonitors.size());
+    json.Key("patternsConfigured").UInt(patterns.size());
+    json.Key("webServerRunning").Bool(webServerRunning);
+    json.Key("schedulerEnabled").Bool(schedulerEnabled);
+    json.Key("schedulerTasks").UInt(taskCount);
+    json.Key("executorThreads").Int(executorThreadsRunning.load());
+    json.Key("executorQueueDepth").UInt(executorQueue.Size());
+    json.Key("eventsCoalesced").UInt(eventsCoalescedTotal.load());
+    json.Key("initialScansPending").Int(initialScansPending.load());
+    json.Key("processesRunning").Int(supervisedProcessCount.load());
+    json.Key("residentWorkerRestarts").UInt(residentRestartsTotal.load());
+    json.Key("notificationOverflows").UInt(notificationOverflowsTotal.load());
+    json.Key("processedEvictedExpired").UInt(processedEvictedExpired.load());
+    json.Key("processedEvictedMissing").UInt(processedEvictedMissing.load());
+    json.Key("processedBytesReclaimed").UInt(processedBytesReclaimed.load());
+    json.Key("dedupMode").String(DedupModeName(dedupMode));
+    json.Key("dedupContentMatches").UInt(dedupContentMatches.load());
+    json.Key("dedupBytesHashed").UInt(dedupBytesHashed.load());
+    json.Key("httpActiveConnections").Int(httpActiveConnections.load());
+    json.Key("httpRequestsServed").UInt(httpRequestsServed.load());
+    
+    json.Key("folders").BeginArray();
+    for (const auto& monitor : folderMonitors) {
+        const FolderStats& stats = *monitor.second->stats;
+        size_t jobsCompleted = stats.jobsCompleted.load();
+        json.BeginObject();
+        json.Key("path").String(monitor.second->folderPath);
+        json.Key("active").Bool(monitor.second->active);
+        json.Key("filesDetected").UInt(monitor.second->filesDetected.load());
+        json.Key("filesProcessed").UInt(stats.filesProcessed.load());
+        json.Key("eventsReceived").UInt(stats.eventsReceived.load());
+        json.Key("eventsCoalesced").UInt(stats.eventsCoalesced.load());
+        json.Key("debounceMs").Int(monitor.second->debounceMs);
+        json.Key("overflows").UInt(stats.overflows.load());
+        json.Key("reconciliations").UInt(stats.reconciliations.load());
+        json.Key("filesReconciled").UInt(stats.filesReconciled.load());
+        json.Key("queueDepth").UInt(stats.queueDepth.load());
+        json.Key("jobsCompleted").UInt(jobsCompleted);
+        json.Key("avgWaitMs").UInt(jobsCompleted > 0 ? stats.totalWaitMs.load() / jobsCompleted : 0);
+        json.Key("maxWaitMs").UInt(stats.maxWaitMs.load());
+        json.EndObject();
+    }
+    json.EndArray();
+    
+    foldersLock.unlock();
+    
+    json.Key("patterns").BeginArray();
+    for (const auto& pattern : patterns) {
+        json.BeginObject();
+        json.Key("name").String(pattern.name);
+        json.Key("folder").String(pattern.folder);
+        json.Key("regex").String(pattern.regex);
+        json.Key("matchCount").UInt(pattern.matchCount);
+        json.Key("executionCount").UInt(pattern.executionCount);
+        json.EndObject();
+    }
+    json.EndArray();
+    
+    json.Key("recentActivity").BeginArray();
+    for (const auto& activity : activities) {
+        auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(activity.second.time_since_epoch()).count();
+        json.BeginObject();
+        json.Key("message").String(activity.first);
+        json.Key("timestamp").Int(timestamp);
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    
+    return json.Take();
+}
+
+// Impronta economica dei contatori: se cambia, l'istantanea viene ripubblicata
+// subito invece di attendere METRICS_UPDATE_INTERVAL. httpRequestsServed e' escluso,
+// altrimenti ogni richiesta di metriche invaliderebbe la successiva
+static unsigned long long MetricsChangeSignature() {
+    std::vector<unsigned long long> values;
+    values.push_back(systemMetrics.totalFilesProcessed.load());
+    values.push_back(systemMetrics.filesProcessedToday.load());
+    values.push_back(systemMetrics.commandsExecuted.load());
+    values.push_back(systemMetrics.errorsCount.load());
+    values.push_back(systemMetrics.activeThreads.load());
+    values.push_back(systemMetrics.memoryUsageMB.load());
+    values.push_back(systemMetrics.recentActivityGeneration.load());
+    values.push_back(executorQueue.Size());
+    values.push_back(eventsCoalescedTotal.load());
+    values.push_back(initialScansPending.load());
+    values.push_back(supervisedProcessCount.load());
+    values.push_back(residentRestartsTotal.load());
+    values.push_back(notificationOverflowsTotal.load());
+    values.push_back(processedEvictedExpired.load() + processedEvictedMissing.load());
+    values.push_back(dedupContentMatches.load());
+    values.push_back(static_cast<unsigned long long>(httpActiveConnections.load()));
+    {
+        std::lock_guard<std::mutex> lock(folderMonitorsMutex);
+        values.push_back(folderMonitors.size());
+        for (const auto& monitor : folderMonitors) {
+            values.push_back(monitor.second->filesDetected.load());
+            values.push_back(monitor.second->stats->eventsReceived.load());
+            values.push_back(monitor.second->stats->queueDepth.load());
+            values.push_back(monitor.second->active ? 1 : 0);
+        }
+    }
+    
+    Xxh64 hasher;
+    hasher.Update(values.data(), values.size() * sizeof(unsigned long long));
+    return hasher.Digest();
+}
+
+// Costruisce e pubblica una nuova istantanea; se il documento non e' cambiato
+// resta quella precedente, con lo stesso ETag
+static std::shared_ptr<const MetricsSnapshot> PublishMetricsSnapshot() {
+    std::string json = BuildSystemMetricsJson();
+    std::shared_ptr<const MetricsSnapshot> previous = std::atomic_load(&metricsSnapshot);
+    if (previous && previous->json == json) return previous;
+    
+    Xxh64 hasher;
+    hasher.Update(json.data(), json.size());
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%016llx\"", hasher.Digest());
+    
+    std::shared_ptr<MetricsSnapshot> snapshot = std::make_shared<MetricsSnapshot>();
+    snapshot->etag = etag;
+    snapshot->generation = previous ? previous->generation + 1 : 1;
+    std::string response = "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: application/json\r\n";
+    response += "Content-Length: " + std::to_string(json.length()) + "\r\n";
+    response += "Cache-Control: no-cache\r\n";
+    response += "ETag: " + snapshot->etag + "\r\n";
+    response += "Access-Control-Allow-Origin: *\r\n";
+    response += "\r\n";
+    response += json;
+    std::string notModified = "HTTP/1.1 304 Not Modified\r\n";
+    notModified += "Cache-Control: no-cache\r\n";
+    notModified += "ETag: " + snapshot->etag + "\r\n";
+    notModified += "Access-Control-Allow-Origin: *\r\n";
+    notModified += "\r\n";
+    snapshot->response = std::make_shared<const std::string>(std::move(response));
+    snapshot->notModified = std::make_shared<const std::string>(std::move(notModified));
+    snapshot->json.swap(json);
+    
+    std::shared_ptr<const MetricsSnapshot> published = snapshot;
+    std::atomic_store(&metricsSnapshot, published);
+    return published;
+}
+
+// Istantanea corrente; senza il thread di pubblicazione (comandi da riga di
+// comando, benchmark) viene ricostruita a ogni richiesta
+std::shared_ptr<const MetricsSnapshot> CurrentMetricsSnapshot() {
+    if (metricsPublisherRunning) {
+        std::shared_ptr<const MetricsSnapshot> snapshot = std::atomic_load(&metricsSnapshot);
+        if (snapshot) return snapshot;
+    }
+    return PublishMetricsSnapshot();
+}
+
+std::string GetSystemMetricsJson() {
+    return CurrentMetricsSnapshot()->json;
+}
+
+// Aggiorna le metriche di processo e pubblica l'istantanea di /api/metrics: subito
+// quando i contatori cambiano, altrimenti ogni METRICS_UPDATE_INTERVAL
+void MetricsUpdateWorker() {
+    WriteToLog("Avvio thread aggiornamento metriche");
+    
+    UpdateSystemMetrics();
+    PublishMetricsSnapshot();
+    metricsPublisherRunning = true;
+    unsigned long long lastSignature = MetricsChangeSignature();
+    DWORD lastPublish = GetTickCount();
+    
+    while (!globalShutdown) {
+        Sleep(METRICS_CHANGE_CHECK_INTERVAL);
+        if (globalShutdown) break;
+        
+        DWORD now = GetTickCount();
+        bool periodic = now - lastPublish >= METRICS_UPDATE_INTERVAL;
+        if (periodic) UpdateSystemMetrics();
+        unsigned long long signature = MetricsChangeSignature();
+        if (periodic || signature != lastSignature) {
+            PublishMetricsSnapshot();
+            lastSignature = signature;
+            lastPublish = now;
+        }
+    }
+    
+    metricsPublisherRunning = false;
+    WriteToLog("Thread aggiornamento metriche terminato");
+}
+
+// ====== IMPLEMENTAZIONE SCHEDULATORE ======
+
+std::string SanitizeFilename(const std::string& name) {
+    std::string safe;
+    for (char c : name) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-') {
+            safe += c;
+        } else if (c == ' ') {
+            safe += '_';
+        }
+    }
+    return safe.empty() ? "unnamed" : safe;
+}
+
+int DayNameToNumber(const std::string& dayName) {
+    if (dayName == "Do" || dayName == "do" || dayName == "DO") return 0;
+    if (dayName == "Lu" || dayName == "lu" || dayName == "LU") return 1;
+    if (dayName == "Ma" || dayName == "ma" || dayName == "MA") return 2;
+    if (dayName == "Me" || dayName == "me" || dayName == "ME") return 3;
+    if (dayName == "Gi" || dayName == "gi" || dayName == "GI") return 4;
+    if (dayName == "Ve" || dayName == "ve" || dayName == "VE") return 5;
+    if (dayName == "Sa" || dayName == "sa" || dayName == "SA") return 6;
+    return -1;
+}
+
+std::string DayNumberToName(int dayNum) {
+    switch (dayNum) {
+        case 0: return "Do";
+        case 1: return "Lu";
+        case 2: return "Ma";
+        case 3: return "Me";
+        case 4: return "Gi";
+        case 5: return "Ve";
+        case 6: return "Sa";
+        default: return "?";
+    }
+}
+
+// ====== CODA DELLO SCHEDULATORE ======
+// SchedulerDeadline e SchedulerQueue sono in PatternTriggerCore.h
+
+// Da chiamare con schedulerMutex acquisito dopo ogni modifica a schedulerTasks:
+// il thread dello schedulatore ricostruisce la coda al risveglio
+static void SchedulerTasksChanged() {
+    schedulerRevision++;
+    schedulerCondition.notify_all();
+}
+
+bool LoadSchedulerTasks() {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    // Un task salvato nel minuto in cui e' appena scattato non deve ripartire
+    std::map<std::string, time_t> lastFired;
+    for (const auto& task : schedulerTasks) lastFired[task.name] = task.lastFiredTime;
+    schedulerTasks.clear();
+    SchedulerTasksChanged();
+
+    if (!DirectoryExists(schedulerFolder)) {
+        CreateDirectoryRecursive(schedulerFolder);
+        WriteToLog("Creata cartella schedulatore: " + schedulerFolder);
+        return true;
+    }
+
+    WIN32_FIND_DATA findData;
+    std::string searchPath = schedulerFolder + "\\*.sch";
+    HANDLE hFind = FindFirstFile(searchPath.c_str(), &findData);
+
+    if (hFind == INVALID_HANDLE_VALUE) {
+        WriteToLog("Nessun task schedulato trovato in: " + schedulerFolder);
+        return true;
+    }
+
+    do {
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+        std::string filePath = schedulerFolder + "\\" + findData.cFileName;
+        std::ifstream file(filePath.c_str());
+        if (!file.is_open()) continue;
+
+        SchedulerTask task;
+        std::string line;
+
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+
+            size_t eqPos = line.find('=');
+            if (eqPos == std::string::npos) continue;
+
+            std::string key = line.substr(0, eqPos);
+            std::string value = line.substr(eqPos + 1);
+
+            key.erase(0, key.find_first_not_of(" \t"));
+            key.erase(key.find_last_not_of(" \t") + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t") + 1);
+
+            if (key == "Name") {
+                task.name = value;
+            } else if (key == "Enabled") {
+                task.enabled = (value == "true" || value == "1");
+            } else if (key == "Days") {
+                std::istringstream ss(value);
+                std::string day;
+                while (std::getline(ss, day, ',')) {
+                    day.erase(0, day.find_first_not_of(" \t"));
+                    day.erase(day.find_last_not_of(" \t") + 1);
+                    int dayNum = DayNameToNumber(day);
+                    if (dayNum >= 0) task.days.insert(dayNum);
+                }
+            } else if (key == "Hours") {
+                std::istringstream ss(value);
+                std::string hour;
+                while (std::getline(ss, hour, ',')) {
+                    hour.erase(0, hour.find_first_not_of(" \t"));
+                    hour.erase(hour.find_last_not_of(" \t") + 1);
+                    try {
+                        int h = std::stoi(hour);
+                        if (h >= 0 && h <= 23) task.hours.insert(h);
+                    } catch (...) {}
+                }
+            } else if (key == "Minutes") {
+                std::istringstream ss(value);
+                std::string minute;
+                while (std::getline(ss, minute, ',')) {
+                    minute.erase(0, minute.find_first_not_of(" \t"));
+                    minute.erase(minute.find_last_not_of(" \t") + 1);
+                    try {
+                        int m = std::stoi(minute);
+                        if (m >= 0 && m <= 59) task.minutes.insert(m);
+                    } catch (...) {}
+                }
+            } else if (key == "Command") {
+                task.command = value;
+            } else if (key == "Interval") {
+                try { task.intervalSeconds = std::stoi(value); } catch (...) { task.intervalSeconds = 0; }
+            }
+        }
+
+        file.close();
+
+        if (!task.name.empty() && !task.command.empty()) {
+            task.lastIntervalRun = std::chrono::steady_clock::now();
+            auto fired = lastFired.find(task.name);
+            if (fired != lastFired.end()) task.lastFiredTime = fired->second;
+            schedulerTasks.push_back(task);
+            WriteToLog("Task schedulato caricato: " + task.name, true);
+        }
+    } while (FindNextFile(hFind, &findData));
+
+    FindClose(hFind);
+
+    WriteToLog("Task schedulati caricati: " + std::to_string(schedulerTasks.size()));
+    return true;
+}
+
+bool SaveSchedulerTask(const SchedulerTask& task) {
+    if (task.name.empty()) return false;
+
+    if (!DirectoryExists(schedulerFolder)) {
+        CreateDirectoryRecursive(schedulerFolder);
+    }
+
+    std::string filename = SanitizeFilename(task.name) + ".sch";
+    std::string filePath = schedulerFolder + "\\" + filename;
+
+    std::ofstream file(filePath.c_str());
+    if (!file.is_open()) {
+        WriteToLog("ERRORE: Impossibile salvare task schedulato: " + filePath);
+        return false;
+    }
+
+    file << "# PatternTriggerCommand - Task Schedulato\n";
+    file << "Name=" << task.name << "\n";
+    file << "Enabled=" << (task.enabled ? "true" : "false") << "\n";
+
+    file << "Days=";
+    bool first = true;
+    for (int d : task.days) {
+        if (!first) file << ",";
+        file << DayNumberToName(d);
+        first = false;
+    }
+    file << "\n";
+
+    file << "Hours=";
+    first = true;
+    for (int h : task.hours) {
+        if (!first) file << ",";
+        file << h;
+        first = false;
+    }
+    file << "\n";
+
+    file << "Minutes=";
+    first = true;
+    for (int m : task.minutes) {
+        if (!first) file << ",";
+        file << m;
+        first = false;
+    }
+    file << "\n";
+
+    file << "Command=" << task.command << "\n";
+    file << "Interval=" << task.intervalSeconds << "\n";
+    file.close();
+
+    WriteToLog("Task schedulato salvato: " + task.name);
+    return true;
+}
+
+bool DeleteSchedulerTask(const std::string& name) {
+    // Trova e rimuovi il file .sch corrispondente
+    std::string filename = SanitizeFilename(name) + ".sch";
+    std::string filePath = schedulerFolder + "\\" + filename;
+
+    if (DeleteFile(filePath.c_str())) {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        schedulerTasks.erase(
+            std::remove_if(schedulerTasks.begin(), schedulerTasks.end(),
+                [&name](const SchedulerTask& t) { return t.name == name; }),
+            schedulerTasks.end()
+        );
+        SchedulerTasksChanged();
+        WriteToLog("Task schedulato eliminato: " + name);
+        return true;
+    }
+
+    WriteToLog("ERRORE: Impossibile eliminare task: " + name);
+    return false;
+}
+
+void RecordSchedulerExecution(const std::string& taskName, const std::string& command, int exitCode, bool success) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    SchedulerExecution exec;
+    exec.taskName = taskName;
+    exec.timestamp = GetTimestamp();
+    exec.command = command;
+    exec.exitCode = exitCode;
+    exec.success = success;
+    schedulerHistory.push_back(exec);
+    if (schedulerHistory.size() > MAX_SCHEDULER_HISTORY) {
+        schedulerHistory.erase(schedulerHistory.begin());
+    }
+    
+    if (serverEventSubscribers.load() > 0) {
+        JsonWriter event(false);
+        event.BeginObject();
+        event.Key("taskName").String(exec.taskName);
+        event.Key("timestamp").String(exec.timestamp);
+        event.Key("command").String(exec.command);
+        event.Key("exitCode").Int(exec.exitCode);
+        event.Key("success").Bool(exec.success);
+        event.EndObject();
+        PublishServerEvent(TopicScheduler, "execution", event.Text());
+    }
+}
+
+void SchedulerExecuteTask(const std::string& cmd, const std::string& taskName) {
+    STARTUPINFO si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;
+    ZeroMemory(&pi, sizeof(pi));
+
+    std::string cmdLine = "cmd.exe /C \"" + cmd + "\"";
+
+    if (CreateProcess(NULL, const_cast<LPSTR>(cmdLine.c_str()),
+                     NULL, NULL, FALSE, CREATE_NO_WINDOW,
+                     NULL, NULL, &si, &pi)) {
+        // Nessun thread in attesa: l'esito arriva dal supervisore processi.
+        // Allo scadere di BATCH_TIMEOUT il task resta in esecuzione (codice 259)
+        SuperviseProcess(pi, BATCH_TIMEOUT, false, [cmd, taskName](const ProcessExit& exit) {
+            WriteToLog("Schedulatore: Task '" + taskName +
+                     "' completato con codice: " + std::to_string(exit.exitCode));
+            RecordSchedulerExecution(taskName, cmd, static_cast<int>(exit.exitCode), exit.exitCode == 0);
+        });
+    } else {
+        DWORD err = GetLastError();
+        WriteToLog("ERRORE Schedulatore: Impossibile eseguire task '" +
+                 taskName + "': " + std::to_string(err));
+        RecordSchedulerExecution(taskName, cmd, static_cast<int>(err), false);
+    }
+}
+
+// Aggiorna il task eseguito e prepara l'avvio; chiamata con schedulerMutex acquisito
+static void MarkSchedulerTaskFired(SchedulerTask& task, std::vector<std::pair<std::string, std::string>>& fired) {
+    WriteToLog("Schedulatore: Esecuzione task '" + task.name + "' - Comando: " + task.command);
+    task.lastExecutionTime = GetTimestamp();
+    task.executionCount++;
+    if (serverEventSubscribers.load() > 0) {
+        JsonWriter event(false);
+        event.BeginObject();
+        event.Key("name").String(task.name);
+        event.Key("lastExecution").String(task.lastExecutionTime);
+        event.Key("executionCount").Int(task.executionCount);
+        event.EndObject();
+        PublishServerEvent(TopicScheduler, "task", event.Text());
+    }
+    fired.push_back(std::make_pair(task.command, task.name));
+}
+
+// Il thread dorme su schedulerCondition fino alla scadenza piu' vicina, a una modifica
+// dei task o all'arresto. Ogni SCHEDULER_RESYNC_INTERVAL confronta orologio di sistema e
+// steady_clock: se l'ora e' stata cambiata (o e' scattata l'ora legale) la coda viene
+// ricalcolata. Un minuto di calendario raggiunto in anticipo rispetto all'ora di sistema
+// viene rimesso in coda per il tempo mancante, cosi' non scatta mai prima del dovuto
+void SchedulerWorker() {
+    WriteToLog("Avvio thread schedulatore");
+
+    SchedulerQueue queue;
+    unsigned long long builtRevision = 0;
+    bool built = false;
+    SchedulerQueue::SteadyTime steadyAnchor;
+    SchedulerQueue::WallTime wallAnchor;
+    std::vector<std::pair<std::string, std::string>> firedTasks;  // comando, nome
+
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    while (!globalShutdown) {
+        auto now = std::chrono::steady_clock::now();
+        auto wallNow = std::chrono::system_clock::now();
+
+        if (!schedulerEnabled) {
+            schedulerCondition.wait_for(lock, std::chrono::milliseconds(SCHEDULER_RESYNC_INTERVAL));
+            continue;
+        }
+
+        bool clockJumped = false;
+        if (built) {
+            auto expected = wallAnchor + std::chrono::duration_cast<std::chrono::system_clock::duration>(now - steadyAnchor);
+            auto skew = std::chrono::duration_cast<std::chrono::milliseconds>(wallNow - expected).count();
+            clockJumped = skew > SCHEDULER_CLOCK_TOLERANCE_MS || skew < -SCHEDULER_CLOCK_TOLERANCE_MS;
+            if (clockJumped) WriteToLog("Schedulatore: orologio di sistema spostato di " + std::to_string(skew / 1000) + " s, ricalcolo");
+        }
+        if (!built || builtRevision != schedulerRevision || clockJumped) {
+            queue.Rebuild(schedulerTasks, now, wallNow);
+            builtRevision = schedulerRevision;
+            built = true;
+            steadyAnchor = now;
+            wallAnchor = wallNow;
+        }
+
+        while (!queue.Empty() && queue.Top().due <= now) {
+            SchedulerDeadline deadline = queue.Pop();
+            SchedulerTask& task = schedulerTasks[deadline.task];
+
+            if (task.intervalSeconds > 0) {
+                // Prossima scadenza dalla precedente, non dal risveglio: nessuna deriva
+                task.lastIntervalRun = deadline.due;
+                deadline.due += std::chrono::seconds(task.intervalSeconds);
+                if (deadline.due <= now) deadline.due = now + std::chrono::seconds(task.intervalSeconds);
+                MarkSchedulerTaskFired(task, firedTasks);
+                queue.Push(deadline);
+                continue;
+            }
+
+            if (std::chrono::system_clock::from_time_t(deadline.wallTime) > wallNow) {
+                deadline.due = SchedulerQueue::DueFromWall(deadline.wallTime, now, wallNow);
+                queue.Push(deadline);
+                continue;
+            }
+            if (deadline.wallTime > task.lastFiredTime) {
+                task.lastFiredTime = deadline.wallTime;
+                MarkSchedulerTaskFired(task, firedTasks);
+            }
+            // Dopo una sospensione si recupera al piu' il minuto in corso, non quelli persi
+            deadline.wallTime = SchedulerQueue::NextCalendarFire(task, std::max(deadline.wallTime + 60,
+                                                                                SchedulerQueue::CurrentMinute(wallNow)));
+            if (deadline.wallTime == static_cast<time_t>(-1)) continue;
+            deadline.due = SchedulerQueue::DueFromWall(deadline.wallTime, now, wallNow);
+            queue.Push(deadline);
+        }
+
+        // Avvio fuori dal lock: SchedulerExecuteTask non attende il processo
+        if (!firedTasks.empty()) {
+            lock.unlock();
+            for (const auto& fired : firedTasks) {
+                SchedulerExecuteTask(fired.first, fired.second);
+            }
+            firedTasks.clear();
+            lock.lock();
+            continue;
+        }
+
+        auto wakeUp = now + std::chrono::milliseconds(SCHEDULER_RESYNC_INTERVAL);
+        if (!queue.Empty() && queue.Top().due < wakeUp) wakeUp = queue.Top().due;
+        if (builtRevision == schedulerRevision && !globalShutdown) {
+            schedulerCondition.wait_until(lock, wakeUp);
+        }
+    }
+
+    WriteToLog("Thread schedulatore terminato");
+}
+
+// Giorni, ore e minuti restano stringhe separate da virgole, come nel file dei task
+static std::string JoinSchedulerValues(const std::set<int>& values, bool dayNames) {
+    std::string joined;
+    for (int value : values) {
+        if (!joined.empty()) joined += ',';
+        joined += dayNames ? DayNumberToName(value) : std::to_string(value);
+    }
+    return joined;
+}
+
+std::string GetSchedulerJson() {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+
+    JsonWriter json(true, 512 + schedulerTasks.size() * 256 + schedulerHistory.size() * 192);
+    json.BeginObject();
+    json.Key("enabled").Bool(schedulerEnabled);
+    json.Key("folder").String(schedulerFolder);
+
+    json.Key("tasks").BeginArray();
+    for (const auto& task : schedulerTasks) {
+        json.BeginObject();
+        json.Key("name").String(task.name);
+        json.Key("enabled").Bool(task.enabled);
+        json.Key("intervalSeconds").Int(task.intervalSeconds);
+        json.Key("days").String(JoinSchedulerValues(task.days, true));
+        json.Key("hours").String(JoinSchedulerValues(task.hours, false));
+        json.Key("minutes").String(JoinSchedulerValues(task.minutes, false));
+        json.Key("command").String(task.command);
+        json.Key("lastExecution").String(task.lastExecutionTime);
+        json.Key("executionCount").Int(task.executionCount);
+        json.EndObject();
+    }
+    json.EndArray();
+
+    json.Key("history").BeginArray();
+    for (int i = static_cast<int>(schedulerHistory.size()) - 1; i >= 0; --i) {
+        const auto& exec = schedulerHistory[i];
+        json.BeginObject();
+        json.Key("taskName").String(exec.taskName);
+        json.Key("timestamp").String(exec.timestamp);
+        json.Key("command").String(exec.command);
+        json.Key("exitCode").Int(exec.exitCode);
+        json.Key("success").Bool(exec.success);
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+
+    return json.Take();
+}
+
+std::string GetSchedulerScriptsJson() {
+    JsonWriter json(false);
+    json.BeginArray();
+
+    std::vector<std::string> searchDirs = {"C:\\Scripts", schedulerFolder};
+
+    for (const auto& dir : searchDirs) {
+        if (!DirectoryExists(dir)) continue;
+
+        std::string patterns[] = {"\\*.bat", "\\*.cmd", "\\*.exe", "\\*.ps1"};
+        for (const auto& ext : patterns) {
+            WIN32_FIND_DATA fd;
+            HANDLE hFind = FindFirstFile((dir + ext).c_str(), &fd);
+            if (hFind == INVALID_HANDLE_VALUE) continue;
+
+            do {
+                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+                json.String(dir + "\\" + fd.cFileName);
+            } while (FindNextFile(hFind, &fd));
+
+            FindClose(hFind);
+        }
+    }
+
+    json.EndArray();
+    return json.Take();
+}
+
+std::string GetSchedulerPageHtml() {
+    return R"html(<!DOCTYPE html>
+<html lang="it">
+<head>
+<meta charset="UTF-8">
+<meta name="viewport" content="width=device-width, initial-scale=1.0">
+<title>PTC - Schedulatore</title>
+<style>
+:root{--bg:#f5f7fb;--surface:#ffffff;--surface2:#f0f2f5;--border:#d4dae3;--primary:#0087cd;--primary-light:#45a5dc;--primary-bg:rgba(0,135,205,0.08);--green:#009246;--green-bg:rgba(0,146,70,0.1);--red:#ce2b37;--red-bg:rgba(206,43,55,0.1);--warning:#e8952e;--warning-bg:rgba(232,149,46,0.1);--text:#1a2332;--text2:#4a5c72;--text3:#8895a7;--radius:10px;--shadow:0 2px 12px rgba(0,0,0,0.06);}
+*{margin:0;padding:0;box-sizing:border-box;}
+body{font-family:'Segoe UI',system-ui,-apple-system,sans-serif;background:var(--bg);color:var(--text);min-height:100vh;}
+.top-bar{background:linear-gradient(135deg,var(--primary) 0%,#005a8c 100%);padding:14px 24px;display:flex;align-items:center;justify-content:space-between;position:sticky;top:0;z-index:50;box-shadow:0 2px 8px rgba(0,90,140,0.3);}
+.top-bar h1{font-size:1.3em;font-weight:700;color:white;}
+.top-bar a{color:rgba(255,255,255,0.85);text-decoration:none;font-size:0.9em;padding:6px 16px;border:1px solid rgba(255,255,255,0.4);border-radius:20px;transition:all 0.2s;}
+.top-bar a:hover{background:rgba(255,255,255,0.15);color:white;border-color:rgba(255,255,255,0.7);}
+.top-stripe{height:4px;background:linear-gradient(90deg,var(--green) 33%,#ffffff 33%,#ffffff 66%,var(--red) 66%);}
+.main{max-width:1440px;margin:0 auto;padding:20px;}
+.stats{display:grid;grid-template-columns:repeat(auto-fit,minmax(180px,1fr));gap:14px;margin-bottom:24px;}
+.stat-card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:16px 20px;box-shadow:var(--shadow);transition:border-color 0.2s,transform 0.2s;}
+.stat-card:hover{border-color:var(--primary);transform:translateY(-2px);}
+.stat-label{font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;margin-bottom:4px;}
+.stat-value{font-size:1.5em;font-weight:700;color:var(--text);}
+.stat-value.on{color:var(--green);}
+.stat-value.off{color:var(--red);}
+.tabs{display:flex;gap:4px;margin-bottom:20px;background:var(--surface);border-radius:var(--radius);padding:4px;border:1px solid var(--border);box-shadow:var(--shadow);}
+.tab{padding:10px 24px;border-radius:8px;cursor:pointer;font-weight:600;font-size:0.9em;color:var(--text2);transition:all 0.2s;border:none;background:transparent;}
+.tab:hover{color:var(--text);background:var(--surface2);}
+.tab.active{background:var(--primary);color:white;}
+.panel{display:none;}
+.panel.active{display:block;}
+.card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:20px;margin-bottom:16px;box-shadow:var(--shadow);}
+.card-header{display:flex;justify-content:space-between;align-items:center;margin-bottom:16px;}
+.card-title{font-size:1.1em;font-weight:700;color:var(--text);}
+.btn{padding:8px 18px;border:none;border-radius:8px;cursor:pointer;font-size:0.85em;font-weight:600;transition:all 0.15s;display:inline-flex;align-items:center;gap:6px;}
+.btn:hover{transform:translateY(-1px);box-shadow:0 4px 12px rgba(0,0,0,0.15);}
+.btn:active{transform:translateY(0);}
+.btn-primary{background:var(--primary);color:white;}
+.btn-success{background:var(--green);color:white;}
+.btn-warning{background:var(--warning);color:white;}
+.btn-danger{background:var(--red);color:white;}
+.btn-ghost{background:transparent;color:var(--text2);border:1px solid var(--border);}
+.btn-ghost:hover{color:var(--text);border-color:var(--primary);background:var(--primary-bg);}
+.btn-sm{padding:5px 12px;font-size:0.8em;}
+table{width:100%;border-collapse:collapse;}
+th{text-align:left;padding:10px 14px;font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;border-bottom:2px solid var(--border);font-weight:600;background:var(--surface2);}
+td{padding:10px 14px;border-bottom:1px solid var(--border);font-size:0.9em;vertical-align:middle;}
+tr:hover td{background:var(--primary-bg);}
+.badge{display:inline-block;padding:3px 10px;border-radius:20px;font-size:0.78em;font-weight:600;}
+.badge-on{background:var(--green-bg);color:var(--green);}
+.badge-off{background:var(--red-bg);color:var(--red);}
+.badge-interval{background:var(--primary-bg);color:var(--primary);}
+.badge-schedule{background:var(--warning-bg);color:var(--warning);}
+.mono{font-family:'Cascadia Code','Fira Code',monospace;font-size:0.85em;color:var(--primary);background:var(--primary-bg);padding:2px 8px;border-radius:4px;}
+.actions{display:flex;gap:4px;flex-wrap:wrap;}
+.overlay{position:fixed;top:0;left:0;width:100%;height:100%;background:rgba(0,0,0,0.4);display:flex;align-items:center;justify-content:center;z-index:100;backdrop-filter:blur(4px);}
+.modal{background:var(--surface);border:1px solid var(--border);border-radius:14px;padding:28px;width:92%;max-width:640px;max-height:90vh;overflow-y:auto;box-shadow:0 20px 60px rgba(0,0,0,0.2);}
+.modal h2{font-size:1.2em;margin-bottom:20px;color:var(--text);padding-bottom:12px;border-bottom:2px solid var(--primary);}
+.field{margin-bottom:18px;}
+.field label{display:block;font-size:0.85em;font-weight:600;color:var(--text2);margin-bottom:6px;}
+.field input[type=text],.field input[type=number],.field select{width:100%;padding:10px 14px;background:var(--surface);border:1px solid var(--border);border-radius:8px;color:var(--text);font-size:0.95em;transition:border-color 0.2s;}
+.field input:focus,.field select:focus{outline:none;border-color:var(--primary);box-shadow:0 0 0 3px var(--primary-bg);}
+.field select{cursor:pointer;}
+.field .hint{font-size:0.78em;color:var(--text3);margin-top:4px;}
+.days-row{display:flex;gap:6px;flex-wrap:wrap;}
+.day-chip{padding:8px 14px;border-radius:8px;cursor:pointer;font-weight:600;font-size:0.9em;background:var(--surface2);border:2px solid var(--border);color:var(--text2);transition:all 0.15s;user-select:none;}
+.day-chip.on{background:var(--primary-bg);border-color:var(--primary);color:var(--primary);}
+.mode-switch{display:flex;gap:4px;background:var(--surface2);border-radius:8px;padding:4px;margin-bottom:12px;}
+.mode-btn{flex:1;padding:10px;border:none;border-radius:6px;cursor:pointer;font-weight:600;font-size:0.88em;color:var(--text2);background:transparent;transition:all 0.2s;}
+.mode-btn.active{background:var(--primary);color:white;}
+.mode-section{display:none;}
+.mode-section.active{display:block;}
+.modal-actions{display:flex;gap:10px;justify-content:flex-end;margin-top:24px;padding-top:16px;border-top:1px solid var(--border);}
+.history-filters{display:flex;gap:10px;margin-bottom:14px;flex-wrap:wrap;}
+.history-filters input,.history-filters select{padding:8px 12px;background:var(--surface);border:1px solid var(--border);border-radius:8px;color:var(--text);font-size:0.85em;}
+.history-filters input:focus,.history-filters select:focus{outline:none;border-color:var(--primary);}
+.empty-state{text-align:center;padding:40px;color:var(--text3);}
+@media(max-width:768px){.main{padding:12px;}.stats{grid-template-columns:1fr 1fr;}.tabs{flex-wrap:wrap;}.modal{width:96%;padding:20px;}th,td{padding:8px 6px;font-size:0.82em;}.actions{flex-direction:column;}}
+</style>
+</head>
+<body>
+<div class="top-bar">
+    <h1>PTC Schedulatore</h1>
+    <a href="/">Dashboard</a>
+</div>
+<div class="top-stripe"></div>
+<div class="main">
+    <div class="stats">
+        <div class="stat-card"><div class="stat-label">Stato</div><div class="stat-value" id="sStatus">-</div></div>
+        <div class="stat-card"><div class="stat-label">Task Totali</div><div class="stat-value" id="sTotal">-</div></div>
+        <div class="stat-card"><div class="stat-label">Task Attivi</div><div class="stat-value" id="sActive">-</div></div>
+        <div class="stat-card"><div class="stat-label">Esecuzioni Totali</div><div class="stat-value" id="sExecs">-</div></div>
+        <div class="stat-card"><div class="stat-label">Cartella</div><div class="stat-value" id="sFolder" style="font-size:0.7em;word-break:break-all;">-</div></div>
+    </div>
+    <div class="tabs">
+        <button class="tab active" onclick="switchTab('tasks',this)">Task</button>
+        <button class="tab" onclick="switchTab('history',this)">Storico</button>
+    </div>
+    <div id="panel-tasks" class="panel active">
+        <div class="card">
+            <div class="card-header">
+                <span class="card-title">Task Schedulati</span>
+                <button class="btn btn-primary" onclick="openForm()">+ Nuovo Task</button>
+            </div>
+            <div style="overflow-x:auto;">
+            <table>
+                <thead><tr><th>Nome</th><th>Stato</th><th>Tipo</th><th>Programmazione</th><th>Comando</th><th>Ultima Esec.</th><th>#</th><th>Azioni</th></tr></thead>
+                <tbody id="tBody"></tbody>
+            </table>
+            </div>
+            <div id="tEmpty" class="empty-state" style="display:none;">Nessun task configurato. Crea il primo!</div>
+        </div>
+    </div>
+    <div id="panel-history" class="panel">
+        <div class="card">
+            <div class="card-header"><span class="card-title">Storico Esecuzioni</span></div>
+            <div class="history-filters">
+                <input type="text" id="hFilter" placeholder="Filtra per nome task..." oninput="renderHistory()">
+                <select id="hStatus" onchange="renderHistory()"><option value="">Tutti</option><option value="ok">Successo</option><option value="fail">Errore</option></select>
+            </div>
+            <div style="overflow-x:auto;">
+            <table>
+                <thead><tr><th>Data/Ora</th><th>Task</th><th>Comando</th><th>Esito</th><th>Codice</th></tr></thead>
+                <tbody id="hBody"></tbody>
+            </table>
+            </div>
+            <div id="hEmpty" class="empty-state" style="display:none;">Nessuna esecuzione registrata.</div>
+        </div>
+    </div>
+</div>
+<div id="formOverlay" class="overlay" style="display:none;" onclick="if(event.target===this)closeForm()">
+    <div class="modal">
+        <h2 id="fTitle">Nuovo Task</h2>
+        <input type="hidden" id="fOrig" value="">
+        <div class="field">
+            <label>Nome Task</label>
+            <input type="text" id="fName" placeholder="Es: Backup giornaliero">
+        </div>
+        <div class="field">
+            <label>Modalita di Schedulazione</label>
+            <div class="mode-switch">
+                <button class="mode-btn active" onclick="setMode('schedule',this)">Giorno/Ora/Minuto</button>
+                <button class="mode-btn" onclick="setMode('interval',this)">Intervallo (ogni N sec)</button>
+            </div>
+        </div>
+        <div id="modeSchedule" class="mode-section active">
+            <div class="field">
+                <label>Giorni della Settimana</label>
+                <div class="days-row" id="fDays"></div>
+            </div>
+            <div class="field">
+                <label>Ore</label>
+                <input type="text" id="fHours" placeholder="Es: 0,6,12,18">
+                <div class="hint">Inserisci le ore separate da virgola (0-23)</div>
+            </div>
+            <div class="field">
+                <label>Minuti</label>
+                <input type="text" id="fMinutes" placeholder="Es: 0,15,30,45">
+                <div class="hint">Inserisci i minuti separati da virgola (0-59)</div>
+            </div>
+        </div>
+        <div id="modeInterval" class="mode-section">
+            <div class="field">
+                <label>Ripeti ogni (secondi)</label>
+                <input type="number" id="fInterval" min="5" value="60" placeholder="60">
+                <div class="hint">Minimo 5 secondi. Es: 60=ogni minuto, 3600=ogni ora</div>
+            </div>
+        </div>
+        <div class="field">
+            <label>Comando da Eseguire</label>
+            <select id="fScriptSelect" onchange="if(this.value)document.getElementById('fCommand').value=this.value">
+                <option value="">-- Seleziona da elenco --</option>
+            </select>
+            <input type="text" id="fCommand" placeholder="C:\Scripts\myscript.bat" style="margin-top:8px;">
+            <div class="hint">Seleziona un file dall'elenco oppure scrivi il percorso manualmente</div>
+        </div>
+        <div class="modal-actions">
+            <button class="btn btn-ghost" onclick="closeForm()">Annulla</button>
+            <button class="btn btn-primary" onclick="saveTask()">Salva Task</button>
+        </div>
+    </div>
+</div>
+<script>
+var T=[],H=[],scripts=[];
+var curMode="schedule";
+var DAYS=["Lu","Ma","Me","Gi","Ve","Sa","Do"];
+function switchTab(id,el){document.querySelectorAll(".tab").forEach(function(t){t.classList.remove("active")});el.classList.add("active");document.querySelectorAll(".panel").forEach(function(p){p.classList.remove("active")});document.getElementById("panel-"+id).classList.add("active");}
+function setMode(m,el){curMode=m;document.querySelectorAll(".mode-btn").forEach(function(b){b.classList.remove("active")});el.classList.add("active");document.getElementById("modeSchedule").className=m==="schedule"?"mode-section active":"mode-section";document.getElementById("modeInterval").className=m==="interval"?"mode-section active":"mode-section";}
+function initDays(){var c=document.getElementById("fDays");c.innerHTML="";DAYS.forEach(function(d){var chip=document.createElement("div");chip.className="day-chip";chip.textContent=d;chip.setAttribute("data-day",d);chip.onclick=function(){this.classList.toggle("on")};c.appendChild(chip)});}
+function loadData(){
+    fetch("/api/scheduler").then(function(r){return r.json()}).then(function(data){
+        T=data.tasks||[];H=data.history||[];
+        var el=document.getElementById("sStatus");el.textContent=data.enabled?"Attivo":"Disattivo";el.className="stat-value "+(data.enabled?"on":"off");
+        document.getElementById("sFolder").textContent=data.folder;
+        renderSummary();renderTasks();renderHistory();
+    }).catch(function(){});
+    fetch("/api/scheduler/scripts").then(function(r){return r.json()}).then(function(data){
+        scripts=data||[];
+        var sel=document.getElementById("fScriptSelect");
+        var curr=sel.value;
+        sel.innerHTML="<option value=''>-- Seleziona da elenco ("+scripts.length+" file) --</option>";
+        scripts.forEach(function(s){var o=document.createElement("option");o.value=s;o.textContent=s;sel.appendChild(o)});
+        if(curr)sel.value=curr;
+    }).catch(function(){});
+}
+function renderSummary(){
+    document.getElementById("sTotal").textContent=T.length;
+    document.getElementById("sActive").textContent=T.filter(function(t){return t.enabled}).length;
+    var totalExec=0;T.forEach(function(t){totalExec+=t.executionCount});document.getElementById("sExecs").textContent=totalExec;
+}
+function renderTasks(){
+    var tb=document.getElementById("tBody");tb.innerHTML="";
+    document.getElementById("tEmpty").style.display=T.length?"none":"block";
+    T.forEach(function(t){
+        var tr=document.createElement("tr");
+        var isInt=t.intervalSeconds>0;
+        var sched=isInt?("Ogni "+fmtInterval(t.intervalSeconds)):(t.days+" | ore:"+t.hours+" | min:"+t.minutes);
+        var typeB=isInt?"<span class='badge badge-interval'>Intervallo</span>":"<span class='badge badge-schedule'>Programmato</span>";
+        tr.innerHTML="<td><strong>"+esc(t.name)+"</strong></td>"
+            +"<td><span class='badge "+(t.enabled?"badge-on":"badge-off")+"'>"+(t.enabled?"Attivo":"Off")+"</span></td>"
+            +"<td>"+typeB+"</td>"
+            +"<td>"+esc(sched)+"</td>"
+            +"<td><span class='mono'>"+esc(t.command)+"</span></td>"
+            +"<td>"+(t.lastExecution||"<span style='color:var(--text3)'>Mai</span>")+"</td>"
+            +"<td>"+t.executionCount+"</td>"
+            +"<td class='actions'>"
+            +"<button class='btn btn-sm "+(t.enabled?"btn-warning":"btn-success")+"' onclick=\"togTask('"+esc(t.name)+"')\">"+(t.enabled?"Stop":"Avvia")+"</button>"
+            +"<button class='btn btn-sm btn-ghost' onclick=\"editTask('"+esc(t.name)+"')\">Mod</button>"
+            +"<button class='btn btn-sm btn-ghost' onclick=\"dupeTask('"+esc(t.name)+"')\">Dup</button>"
+            +"<button class='btn btn-sm btn-danger' onclick=\"delTask('"+esc(t.name)+"')\">Elim</button>"
+            +"</td>";
+        tb.appendChild(tr);
+    });
+}
+function renderHistory(){
+    var filter=(document.getElementById("hFilter").value||"").toLowerCase();
+    var status=document.getElementById("hStatus").value;
+    var filtered=H.filter(function(e){
+        if(filter&&e.taskName.toLowerCase().indexOf(filter)<0)return false;
+        if(status==="ok"&&!e.success)return false;
+        if(status==="fail"&&e.success)return false;
+        return true;
+    });
+    var tb=document.getElementById("hBody");tb.innerHTML="";
+    document.getElementById("hEmpty").style.display=filtered.length?"none":"block";
+    filtered.forEach(function(e){
+        var tr=document.createElement("tr");
+        tr.innerHTML="<td>"+esc(e.timestamp)+"</td>"
+            +"<td><strong>"+esc(e.taskName)+"</strong></td>"
+            +"<td><span class='mono'>"+esc(e.command)+"</span></td>"
+            +"<td><span class='badge "+(e.success?"badge-on":"badge-off")+"'>"+(e.success?"OK":"Errore")+"</span></td>"
+            +"<td>"+e.exitCode+"</td>";
+        tb.appendChild(tr);
+    });
+}
+function openForm(task){
+    document.getElementById("fTitle").textContent=task?"Modifica Task":"Nuovo Task";
+    document.getElementById("fOrig").value=task?task.name:"";
+    document.getElementById("fName").value=task?task.name:"";
+    document.getElementById("fCommand").value=task?task.command:"";
+    document.getElementById("fScriptSelect").value=task?task.command:"";
+    var isInt=task&&task.intervalSeconds>0;
+    if(isInt){
+        curMode="interval";
+        document.getElementById("fInterval").value=task.intervalSeconds;
+    }else{
+        curMode="schedule";
+        document.getElementById("fHours").value=task?task.hours:"";
+        document.getElementById("fMinutes").value=task?task.minutes:"";
+    }
+    var btns=document.querySelectorAll(".mode-btn");
+    btns[0].className="mode-btn"+(curMode==="schedule"?" active":"");
+    btns[1].className="mode-btn"+(curMode==="interval"?" active":"");
+    document.getElementById("modeSchedule").className=curMode==="schedule"?"mode-section active":"mode-section";
+    document.getElementById("modeInterval").className=curMode==="interval"?"mode-section active":"mode-section";
+    initDays();
+    if(task&&task.days){
+        var ad=task.days.split(",");
+        document.querySelectorAll("#fDays .day-chip").forEach(function(c){if(ad.indexOf(c.getAttribute("data-day"))>=0)c.classList.add("on")});
+    }
+    document.getElementById("formOverlay").style.display="flex";
+}
+function closeForm(){document.getElementById("formOverlay").style.display="none";}
+function saveTask(){
+    var name=document.getElementById("fName").value.trim();
+    var cmd=document.getElementById("fCommand").value.trim();
+    if(!name){alert("Inserisci un nome per il task");return;}
+    if(!cmd){alert("Inserisci un comando da eseguire");return;}
+    var data={originalName:document.getElementById("fOrig").value,name:name,command:cmd,enabled:"true",intervalSeconds:"0"};
+    if(curMode==="interval"){
+        var iv=parseInt(document.getElementById("fInterval").value)||0;
+        if(iv<5){alert("Intervallo minimo: 5 secondi");return;}
+        data.intervalSeconds=String(iv);
+        data.days="";data.hours="";data.minutes="";
+    }else{
+        var days=[];document.querySelectorAll("#fDays .day-chip.on").forEach(function(c){days.push(c.getAttribute("data-day"))});
+        if(!days.length){alert("Seleziona almeno un giorno");return;}
+        data.days=days.join(",");
+        data.hours=document.getElementById("fHours").value;
+        data.minutes=document.getElementById("fMinutes").value;
+        if(!data.hours){alert("Inserisci almeno un'ora");return;}
+        if(!data.minutes){alert("Inserisci almeno un minuto");return;}
+    }
+    apiPost("/api/scheduler/save",data,function(){closeForm();loadData();});
+}
+function editTask(n){var t=T.find(function(x){return x.name===n});if(t)openForm(t);}
+function dupeTask(n){var t=T.find(function(x){return x.name===n});if(t){var c={};for(var k in t)c[k]=t[k];c.name=t.name+" (copia)";openForm(c);document.getElementById("fOrig").value="";}}
+function togTask(n){apiPost("/api/scheduler/toggle",{name:n},function(){loadData()});}
+function delTask(n){if(!confirm("Eliminare il task '"+n+"'?"))return;apiPost("/api/scheduler/delete",{name:n},function(){loadData()});}
+function apiPost(url,data,cb){
+    var xhr=new XMLHttpRequest();xhr.open("POST",url,true);
+    xhr.setRequestHeader("Content-Type","application/json");
+    xhr.onload=function(){
+        if(xhr.status===200){try{var r=JSON.parse(xhr.responseText);if(r.success){if(cb)cb();}else{alert("Errore: "+(r.error||"Operazione fallita"));}}catch(e){alert("Errore risposta server");}}
+        else{alert("Errore HTTP: "+xhr.status);}
+    };
+    xhr.onerror=function(){alert("Errore di rete");};
+    xhr.send(JSON.stringify(data));
+}
+function esc(s){if(!s)return"";var d=document.createElement("div");d.appendChild(document.createTextNode(s));return d.innerHTML;}
+function fmtInterval(s){if(s>=86400)return Math.floor(s/86400)+"g "+Math.floor((s%86400)/3600)+"h";if(s>=3600)return Math.floor(s/3600)+"h "+Math.floor((s%3600)/60)+"m";if(s>=60)return Math.floor(s/60)+"m "+s%60+"s";return s+"s";}
+var poll=null;
+function startPolling(){if(!poll){loadData();poll=setInterval(loadData,5000);}}
+function stopPolling(){if(poll){clearInterval(poll);poll=null;}}
+function connectEvents(){
+    if(!window.EventSource){startPolling();return;}
+    var es=new EventSource("/api/events?topics=scheduler");
+    es.onopen=function(){stopPolling();loadData();};
+    es.addEventListener("task",function(e){
+        var x=JSON.parse(e.data);
+        T.forEach(function(t){if(t.name===x.name){t.lastExecution=x.lastExecution;t.executionCount=x.executionCount;}});
+        renderSummary();renderTasks();
+    });
+    es.addEventListener("execution",function(e){
+        H.unshift(JSON.parse(e.data));if(H.length>200)H.pop();
+        renderHistory();
+    });
+    es.addEventListener("reset",function(){loadData();});
+    es.onerror=function(){startPolling();};
+}
+initDays();connectEvents();
+</script>
+</body>
+</html>)html";
+}
+
+std::string GetDashboardHtml() {
+    return R"html(<!DOCTYPE html>
+<html lang="it">
+<head>
+<meta charset="UTF-8">
+<meta name="viewport" content="width=device-width, initial-scale=1.0">
+<title>PTC Dashboard</title>
+<style>
+:root{--bg:#f5f7fb;--surface:#ffffff;--surface2:#f0f2f5;--border:#d4dae3;--primary:#0087cd;--primary-light:#45a5dc;--primary-bg:rgba(0,135,205,0.08);--green:#009246;--green-bg:rgba(0,146,70,0.1);--red:#ce2b37;--red-bg:rgba(206,43,55,0.1);--warning:#e8952e;--warning-bg:rgba(232,149,46,0.1);--text:#1a2332;--text2:#4a5c72;--text3:#8895a7;--radius:10px;--shadow:0 2px 12px rgba(0,0,0,0.06);}
+*{margin:0;padding:0;box-sizing:border-box;}
+body{font-family:'Segoe UI',system-ui,-apple-system,sans-serif;background:var(--bg);color:var(--text);min-height:100vh;}
+.top-bar{background:linear-gradient(135deg,var(--primary) 0%,#005a8c 100%);padding:14px 24px;display:flex;align-items:center;justify-content:space-between;position:sticky;top:0;z-index:50;box-shadow:0 2px 8px rgba(0,90,140,0.3);}
+.top-bar h1{font-size:1.3em;font-weight:700;color:white;}
+.top-bar a{color:rgba(255,255,255,0.85);text-decoration:none;font-size:0.9em;padding:6px 16px;border:1px solid rgba(255,255,255,0.4);border-radius:20px;transition:all 0.2s;}
+.top-bar a:hover{background:rgba(255,255,255,0.15);color:white;border-color:rgba(255,255,255,0.7);}
+.top-stripe{height:4px;background:linear-gradient(90deg,var(--green) 33%,#ffffff 33%,#ffffff 66%,var(--red) 66%);}
+.main{max-width:1440px;margin:0 auto;padding:20px;}
+.stats{display:grid;grid-template-columns:repeat(auto-fit,minmax(160px,1fr));gap:14px;margin-bottom:24px;}
+.stat-card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:16px 20px;box-shadow:var(--shadow);transition:border-color 0.2s,transform 0.2s;}
+.stat-card:hover{border-color:var(--primary);transform:translateY(-2px);}
+.stat-label{font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;margin-bottom:4px;}
+.stat-value{font-size:1.5em;font-weight:700;color:var(--text);}
+.stat-value.on{color:var(--green);}
+.stat-value.off{color:var(--red);}
+.grid2{display:grid;grid-template-columns:1fr 1fr;gap:16px;margin-bottom:16px;}
+.card{background:var(--surface);border:1px solid var(--border);border-radius:var(--radius);padding:20px;margin-bottom:16px;box-shadow:var(--shadow);}
+.card-title{font-size:1.1em;font-weight:700;color:var(--text);margin-bottom:14px;padding-bottom:10px;border-bottom:2px solid var(--primary);}
+table{width:100%;border-collapse:collapse;}
+th{text-align:left;padding:10px 14px;font-size:0.78em;color:var(--text3);text-transform:uppercase;letter-spacing:0.5px;border-bottom:2px solid var(--border);font-weight:600;background:var(--surface2);}
+td{padding:10px 14px;border-bottom:1px solid var(--border);font-size:0.9em;}
+tr:hover td{background:var(--primary-bg);}
+.badge{display:inline-flex;align-items:center;gap:6px;padding:3px 10px;border-radius:20px;font-size:0.78em;font-weight:600;}
+.badge-on{background:var(--green-bg);color:var(--green);}
+.badge-off{background:var(--red-bg);color:var(--red);}
+.dot{width:8px;height:8px;border-radius:50%;display:inline-block;}
+.dot-on{background:var(--green);box-shadow:0 0 6px var(--green);}
+.dot-off{background:var(--red);}
+.mono{font-family:'Cascadia Code','Fira Code',monospace;font-size:0.85em;color:var(--primary);background:var(--primary-bg);padding:2px 8px;border-radius:4px;}
+.activity-list{max-height:320px;overflow-y:auto;}
+.activity-item{padding:8px 0;border-bottom:1px solid var(--border);display:flex;justify-content:space-between;align-items:flex-start;gap:12px;font-size:0.85em;}
+.activity-item:last-child{border-bottom:none;}
+.activity-msg{color:var(--text2);flex:1;word-break:break-word;}
+.activity-time{color:var(--text3);font-size:0.8em;white-space:nowrap;}
+.loading{text-align:center;padding:60px;color:var(--text2);font-size:1.1em;}
+.error-box{background:var(--red-bg);border:1px solid var(--red);color:var(--red);padding:16px;border-radius:var(--radius);margin:20px 0;}
+@media(max-width:768px){.main{padding:12px;}.stats{grid-template-columns:1fr 1fr;}.grid2{grid-template-columns:1fr;}th,td{padding:8px 6px;font-size:0.82em;}}
+</style>
+</head>
+<body>
+<div class="top-bar">
+    <h1>PTC Dashboard</h1>
+    <a href="/scheduler">Schedulatore</a>
+</div>
+<div class="top-stripe"></div>
+<div class="main">
+    <div id="loading" class="loading">Caricamento dati...</div>
+    <div id="error" class="error-box" style="display:none;"></div>
+    <div id="dashboard" style="display:none;">
+        <div class="stats">
+            <div class="stat-card"><div class="stat-label">File Processati</div><div class="stat-value" id="totalFiles">-</div></div>
+            <div class="stat-card"><div class="stat-label">File Oggi</div><div class="stat-value" id="todayFiles">-</div></div>
+            <div class="stat-card"><div class="stat-label">Comandi Eseguiti</div><div class="stat-value" id="commandsExecuted">-</div></div>
+            <div class="stat-card"><div class="stat-label">Errori</div><div class="stat-value" id="errorsCount">-</div></div>
+            <div class="stat-card"><div class="stat-label">Memoria</div><div class="stat-value" id="memoryUsage">-</div></div>
+            <div class="stat-card"><div class="stat-label">Thread Attivi</div><div class="stat-value" id="activeThreads">-</div></div>
+            <div class="stat-card"><div class="stat-label">Uptime</div><div class="stat-value" id="uptime">-</div></div>
+            <div class="stat-card"><div class="stat-label">Ultima Attivita</div><div class="stat-value" id="lastActivity" style="font-size:0.9em;">-</div></div>
+        </div>
+        <div class="grid2">
+            <div class="card">
+                <div class="card-title">Monitoraggio</div>
+                <table>
+                    <tr><td style="color:var(--text2)">Cartelle Monitorate</td><td style="text-align:right;font-weight:700" id="foldersCount">-</td></tr>
+                    <tr><td style="color:var(--text2)">Pattern Configurati</td><td style="text-align:right;font-weight:700" id="patternsCount">-</td></tr>
+                    <tr><td style="color:var(--text2)">Web Server</td><td style="text-align:right" id="webServerStatus">-</td></tr>
+                    <tr><td style="color:var(--text2)">Schedulatore</td><td style="text-align:right" id="schedulerStatus">-</td></tr>
+                    <tr><td style="color:var(--text2)">Tempo Medio Elaborazione</td><td style="text-align:right;font-weight:700" id="avgProcessing">-</td></tr>
+                </table>
+            </div>
+            <div class="card">
+                <div class="card-title">Attivita Recente</div>
+                <div id="recentActivity" class="activity-list">Caricamento...</div>
+            </div>
+        </div>
+        <div class="card">
+            <div class="card-title">Cartelle Monitorate</div>
+            <div style="overflow-x:auto;">
+            <table>
+                <thead><tr><th>Stato</th><th>Percorso</th><th>File Rilevati</th><th>Eventi Accorpati</th><th>File Processati</th><th>In Coda</th><th>Attesa Media</th><th>Attesa Max</th><th>Overflow</th></tr></thead>
+                <tbody id="foldersTableBody"></tbody>
+            </table>
+            </div>
+        </div>
+        <div class="card">
+            <div class="card-title">Pattern Configurati</div>
+            <div style="overflow-x:auto;">
+            <table>
+                <thead><tr><th>Nome</th><th>Cartella</th><th>Regex</th><th>Match</th><th>Esecuzioni</th></tr></thead>
+                <tbody id="patternsTableBody"></tbody>
+            </table>
+            </div>
+        </div>
+    </div>
+</div>
+<script>
+function fmtUp(s){if(s<0)return"N/A";var d=Math.floor(s/86400),h=Math.floor((s%86400)/3600),m=Math.floor((s%3600)/60);if(d>0)return d+"g "+h+"h "+m+"m";if(h>0)return h+"h "+m+"m";return m+"m";}
+function fmtAgo(s){if(s<0)return"Mai";if(s<60)return s+"s fa";if(s<3600)return Math.floor(s/60)+"m fa";if(s<86400)return Math.floor(s/3600)+"h fa";return Math.floor(s/86400)+"g fa";}
+function fmtTs(ts){var d=new Date(ts*1000);return d.toLocaleTimeString();}
+function esc(s){if(!s)return"";var d=document.createElement("div");d.appendChild(document.createTextNode(s));return d.innerHTML;}
+var M=null,poll=null;
+function render(data){
+    document.getElementById("loading").style.display="none";
+    document.getElementById("error").style.display="none";
+    document.getElementById("dashboard").style.display="block";
+    document.getElementById("totalFiles").textContent=data.totalFilesProcessed;
+    document.getElementById("todayFiles").textContent=data.filesProcessedToday;
+    document.getElementById("commandsExecuted").textContent=data.commandsExecuted;
+    document.getElementById("errorsCount").textContent=data.errorsCount;
+    document.getElementById("memoryUsage").textContent=data.memoryUsageMB+" MB";
+    document.getElementById("activeThreads").textContent=data.activeThreads;
+    document.getElementById("avgProcessing").textContent=data.averageProcessingTime+" ms";
+    document.getElementById("uptime").textContent=fmtUp(data.uptimeSeconds);
+    document.getElementById("lastActivity").textContent=fmtAgo(data.lastActivitySeconds);
+    document.getElementById("foldersCount").textContent=data.foldersMonitored;
+    document.getElementById("patternsCount").textContent=data.patternsConfigured;
+    document.getElementById("webServerStatus").innerHTML=data.webServerRunning?"<span class='badge badge-on'><span class='dot dot-on'></span>Attivo</span>":"<span class='badge badge-off'><span class='dot dot-off'></span>Inattivo</span>";
+    document.getElementById("schedulerStatus").innerHTML=data.schedulerEnabled?"<span class='badge badge-on'><span class='dot dot-on'></span>"+data.schedulerTasks+" task</span>":"<span class='badge badge-off'><span class='dot dot-off'></span>Off</span>";
+    var fb=document.getElementById("foldersTableBody");fb.innerHTML="";
+    data.folders.forEach(function(f){
+        var tr=document.createElement("tr");
+        tr.innerHTML="<td><span class='badge "+(f.active?"badge-on":"badge-off")+"'><span class='dot "+(f.active?"dot-on":"dot-off")+"'></span>"+(f.active?"Attivo":"Off")+"</span></td>"
+            +"<td>"+esc(f.path)+"</td><td>"+f.filesDetected+"</td><td>"+f.eventsCoalesced+" ("+f.debounceMs+" ms)</td><td>"+f.filesProcessed+"</td>"
+            +"<td>"+f.queueDepth+"</td><td>"+f.avgWaitMs+" ms</td><td>"+f.maxWaitMs+" ms</td>"
+            +"<td>"+f.overflows+" ("+f.filesReconciled+" riconciliati)</td>";
+        fb.appendChild(tr);
+    });
+    var pb=document.getElementById("patternsTableBody");pb.innerHTML="";
+    data.patterns.forEach(function(p){
+        var tr=document.createElement("tr");
+        tr.innerHTML="<td><strong>"+esc(p.name)+"</strong></td><td>"+esc(p.folder)+"</td>"
+            +"<td><span class='mono'>"+esc(p.regex)+"</span></td><td>"+p.matchCount+"</td><td>"+p.executionCount+"</td>";
+        pb.appendChild(tr);
+    });
+    var ad=document.getElementById("recentActivity");ad.innerHTML="";
+    data.recentActivity.forEach(function(a){
+        var div=document.createElement("div");div.className="activity-item";
+        div.innerHTML="<span class='activity-msg'>"+esc(a.message)+"</span><span class='activity-time'>"+fmtTs(a.timestamp)+"</span>";
+        ad.appendChild(div);
+    });
+}
+function update(){
+    var xhr=new XMLHttpRequest();
+    xhr.open("GET","/api/metrics",true);
+    xhr.onload=function(){
+        if(xhr.status!==200)return;
+        M=JSON.parse(xhr.responseText);
+        render(M);
+    };
+    xhr.onerror=function(){
+        document.getElementById("loading").style.display="none";
+        document.getElementById("dashboard").style.display="none";
+        var e=document.getElementById("error");e.textContent="Errore di connessione";e.style.display="block";
+    };
+    xhr.send();
+}
+function startPolling(){if(!poll){update();poll=setInterval(update,2000);}}
+function stopPolling(){if(poll){clearInterval(poll);poll=null;}}
+function connectEvents(){
+    if(!window.EventSource){startPolling();return;}
+    var es=new EventSource("/api/events?topics=metrics,activity");
+    es.addEventListener("metrics",function(e){
+        var d=JSON.parse(e.data);
+        if(d.full||!M)M={};
+        for(var k in d.fields)M[k]=d.fields[k];
+        stopPolling();render(M);
+    });
+    es.addEventListener("activity",function(e){
+        if(!M||!M.recentActivity)return;
+        M.recentActivity=M.recentActivity.concat(JSON.parse(e.data)).slice(-20);
+        render(M);
+    });
+    es.onerror=function(){startPolling();};
+}
+connectEvents();
+</script>
+</body>
+</html>)html";
+}
+
+// Risposta completa con Content-Length; le API JSON sono accessibili anche da altre origini
+static std::string BuildHttpResponse(const std::string& status, const std::string& contentType,
+                                     const std::string& body, bool allowCors) {
+    std::string response = "HTTP/1.1 " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + std::to_string(body.length()) + "\r\n";
+    response += "Cache-Control: no-cache\r\n";
+    if (allowCors) response += "Access-Control-Allow-Origin: *\r\n";
+    response += "\r\n";
+    response += body;
+    return response;
+}
+
+static HttpBuffer JsonResponse(const std::string& json, const std::string& status = "200 OK") {
+    return std::make_shared<const std::string>(BuildHttpResponse(status, "application/json", json, true));
+}
+
+// Corpo delle richieste POST: deve essere un oggetto JSON, altrimenti 400 con il motivo
+static bool ParseJsonRequestBody(const HttpRequest& request, JsonDocument& document, HttpBuffer& rejection) {
+    if (document.Parse(request.body) && document[document.Root()].type == JsonDocument::Object) return true;
+    std::string reason = document.Error() != NULL
+        ? std::string(document.Error()) + " (posizione " + std::to_string(document.ErrorOffset()) + ")"
+        : std::string("oggetto atteso");
+    JsonWriter result(false);
+    result.BeginObject().Key("success").Bool(false).Key("error").String("JSON non valido: " + reason).EndObject();
+    rejection = JsonResponse(result.Take(), "400 Bad Request");
+    return false;
+}
+
+// If-None-Match: "*" oppure elenco di ETag; confronto debole come da RFC 7232
+static bool IfNoneMatchHits(const HttpRequest& request, const std::string& etag) {
+    StringRef header = request.Header("if-none-match");
+    size_t start = 0;
+    while (start < header.size) {
+        size_t end = start;
+        while (end < header.size && header.data[end] != ',') ++end;
+        size_t first = start, last = end;
+        while (first < last && (header.data[first] == ' ' || header.data[first] == '\t')) ++first;
+        while (last > first && (header.data[last - 1] == ' ' || header.data[last - 1] == '\t')) --last;
+        StringRef tag(header.data + first, last - first);
+        if (tag.size > 2 && tag.data[0] == 'W' && tag.data[1] == '/') tag = StringRef(tag.data + 2, tag.size - 2);
+        if (tag.Equals("*") || (tag.size == etag.size() && memcmp(tag.data, etag.data(), tag.size) == 0)) return true;
+        start = end + 1;
+    }
+    return false;
+}
+
+// Accept-Encoding: la codifica e' accettata se compare senza q=0
+static bool AcceptsEncoding(const HttpRequest& request, const char* coding) {
+    StringRef header = request.Header("accept-encoding");
+    size_t start = 0;
+    while (start < header.size) {
+        size_t end = start;
+        while (end < header.size && header.data[end] != ',') ++end;
+        size_t first = start;
+        while (first < end && (header.data[first] == ' ' || header.data[first] == '\t')) ++first;
+        size_t nameEnd = first;
+        while (nameEnd < end && header.data[nameEnd] != ';' && header.data[nameEnd] != ' ' && header.data[nameEnd] != '\t') ++nameEnd;
+        if (StringRef(header.data + first, nameEnd - first).EqualsIgnoreCase(coding)) {
+            std::string parameters(header.data + nameEnd, end - nameEnd);
+            parameters.erase(std::remove(parameters.begin(), parameters.end(), ' '), parameters.end());
+            size_t q = parameters.find("q=");
+            return q == std::string::npos || std::strtod(parameters.c_str() + q + 2, NULL) > 0.0;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+// Una rappresentazione di una risorsa statica: 200 e 304 gia' assemblati
+struct StaticAssetVariant {
+    std::string etag;
+    HttpBuffer response;
+    HttpBuffer notModified;
+};
+
+// Pagina costruita una sola volta, in chiaro e pre-compressa gzip/deflate, con
+// ETag forti distinti per codifica
+struct StaticAsset {
+    StaticAssetVariant identity;
+    StaticAssetVariant gzip;
+    StaticAssetVariant deflate;
+    
+    const StaticAssetVariant& Select(const HttpRequest& request) const {
+        if (gzip.response && AcceptsEncoding(request, "gzip")) return gzip;
+        if (deflate.response && AcceptsEncoding(request, "deflate")) return deflate;
+        return identity;
+    }
+};
+
+static StaticAssetVariant BuildStaticAssetVariant(const std::string& body, const std::string& contentType,
+                                                  const std::string& etag, const char* encoding) {
+    StaticAssetVariant variant;
+    variant.etag = etag;
+    std::string headers = "Cache-Control: no-cache\r\n";
+    headers += "ETag: " + etag + "\r\n";
+    headers += "Vary: Accept-Encoding\r\n";
+    if (encoding != NULL) headers += std::string("Content-Encoding: ") + encoding + "\r\n";
+    
+    std::string response = "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + std::to_string(body.length()) + "\r\n";
+    response += headers;
+    response += "\r\n";
+    response += body;
+    variant.response = std::make_shared<const std::string>(std::move(response));
+    variant.notModified = std::make_shared<const std::string>("HTTP/1.1 304 Not Modified\r\n" + headers + "\r\n");
+    return variant;
+}
+
+static StaticAsset BuildStaticAsset(const std::string& body, const std::string& contentType) {
+    Xxh64 hasher;
+    hasher.Update(body.data(), body.size());
+    char tag[24];
+    snprintf(tag, sizeof(tag), "%016llx", hasher.Digest());
+    
+    StaticAsset asset;
+    asset.identity = BuildStaticAssetVariant(body, contentType, "\"" + std::string(tag) + "\"", NULL);
+    std::string gzip = GzipCompress(body);
+    if (gzip.size() < body.size()) {
+        asset.gzip = BuildStaticAssetVariant(gzip, contentType, "\"" + std::string(tag) + "-gz\"", "gzip");
+    }
+    std::string deflate = ZlibCompress(body);
+    if (deflate.size() < body.size()) {
+        asset.deflate = BuildStaticAssetVariant(deflate, contentType, "\"" + std::string(tag) + "-df\"", "deflate");
+    }
+    return asset;
+}
+
+struct StaticPages {
+    StaticAsset dashboard;
+    StaticAsset scheduler;
+};
+
+// Costruite al primo uso (il web server le prepara all'avvio) e mai piu' modificate
+static const StaticPages& GetStaticPages() {
+    static const StaticPages pages = [] {
+        StaticPages built;
+        built.dashboard = BuildStaticAsset(GetDashboardHtml(), "text/html; charset=utf-8");
+        built.scheduler = BuildStaticAsset(GetSchedulerPageHtml(), "text/html; charset=utf-8");
+        return built;
+    }();
+    return pages;
+}
+
+static HttpBuffer ServeStaticAsset(const StaticAsset& asset, const HttpRequest& request) {
+    const StaticAssetVariant& variant = asset.Select(request);
+    return IfNoneMatchHits(request, variant.etag) ? variant.notModified : variant.response;
+}
+
+static HttpBuffer HandleDashboardPage(const HttpRequest& request) {
+    return ServeStaticAsset(GetStaticPages().dashboard, request);
+}
+
+static HttpBuffer HandleSchedulerPage(const HttpRequest& request) {
+    return ServeStaticAsset(GetStaticPages().scheduler, request);
+}
+
+// Nessuna serializzazione per richiesta: si inviano i byte dell'istantanea corrente
+static HttpBuffer HandleMetricsApi(const HttpRequest& request) {
+    std::shared_ptr<const MetricsSnapshot> snapshot = CurrentMetricsSnapshot();
+    return IfNoneMatchHits(request, snapshot->etag) ? snapshot->notModified : snapshot->response;
+}
+
+static HttpBuffer HandleSchedulerScriptsApi(const HttpRequest& /*request*/) {
+    return JsonResponse(GetSchedulerScriptsJson());
+}
+
+static HttpBuffer HandleSchedulerApi(const HttpRequest& /*request*/) {
+    return JsonResponse(GetSchedulerJson());
+}
+
+static HttpBuffer HandleSchedulerSaveApi(const HttpRequest& request) {
+    JsonDocument document;
+    HttpBuffer rejection;
+    if (!ParseJsonRequestBody(request, document, rejection)) return rejection;
+    int root = document.Root();
+    std::string name = document.Text(root, "name");
+    std::string originalName = document.Text(root, "originalName");
+    std::string daysStr = document.Text(root, "days");
+    std::string hoursStr = document.Text(root, "hours");
+    std::string minutesStr = document.Text(root, "minutes");
+    std::string command = document.Text(root, "command");
+    std::string enabledStr = document.Text(root, "enabled");
+    std::string intervalStr = document.Text(root, "intervalSeconds");
+
+    std::string resultJson;
+
+    if (name.empty() || command.empty()) {
+        resultJson = "{\"success\": false, \"error\": \"Nome e comando sono obbligatori\"}";
+    } else {
+        // Se il nome originale e' diverso, elimina il vecchio file
+        if (!originalName.empty() && originalName != name) {
+            DeleteSchedulerTask(originalName);
+        }
+
+        SchedulerTask task;
+        task.name = name;
+        task.enabled = (enabledStr != "false");
+        task.command = command;
+        try { task.intervalSeconds = std::stoi(intervalStr); } catch (...) { task.intervalSeconds = 0; }
+
+        // Parse days
+        std::istringstream dss(daysStr);
+        std::string day;
+        while (std::getline(dss, day, ',')) {
+            day.erase(0, day.find_first_not_of(" \t"));
+            day.erase(day.find_last_not_of(" \t") + 1);
+            int d = DayNameToNumber(day);
+            if (d >= 0) task.days.insert(d);
+        }
+
+        // Parse hours
+        std::istringstream hss(hoursStr);
+        std::string hour;
+        while (std::getline(hss, hour, ',')) {
+            hour.erase(0, hour.find_first_not_of(" \t"));
+            hour.erase(hour.find_last_not_of(" \t") + 1);
+            try { int h = std::stoi(hour); if (h >= 0 && h <= 23) task.hours.insert(h); } catch (...) {}
+        }
+
+        // Parse minutes
+        std::istringstream mss(minutesStr);
+        std::string minute;
+        while (std::getline(mss, minute, ',')) {
+            minute.erase(0, minute.find_first_not_of(" \t"));
+            minute.erase(minute.find_last_not_of(" \t") + 1);
+            try { int m = std::stoi(minute); if (m >= 0 && m <= 59) task.minutes.insert(m); } catch (...) {}
+        }
+
+        if (SaveSchedulerTask(task)) {
+            // Ricarica i task dal filesystem
+            LoadSchedulerTasks();
+            resultJson = "{\"success\": true}";
+        } else {
+            resultJson = "{\"success\": false, \"error\": \"Errore salvataggio su disco\"}";
+        }
+    }
+
+    return JsonResponse(resultJson);
+}
+
+static HttpBuffer HandleSchedulerDeleteApi(const HttpRequest& request) {
+    JsonDocument document;
+    HttpBuffer rejection;
+    if (!ParseJsonRequestBody(request, document, rejection)) return rejection;
+    std::string name = document.Text(document.Root(), "name");
+
+    std::string resultJson;
+    if (!name.empty() && DeleteSchedulerTask(name)) {
+        resultJson = "{\"success\": true}";
+    } else {
+        resultJson = "{\"success\": false, \"error\": \"Task non trovato\"}";
+    }
+
+    return JsonResponse(resultJson);
+}
+
+static HttpBuffer HandleSchedulerToggleApi(const HttpRequest& request) {
+    JsonDocument document;
+    HttpBuffer rejection;
+    if (!ParseJsonRequestBody(request, document, rejection)) return rejection;
+    std::string name = document.Text(document.Root(), "name");
+
+    std::string resultJson = "{\"success\": false, \"error\": \"Task non trovato\"}";
+    SchedulerTask taskCopy;
+    bool found = false;
+
+    if (!name.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(schedulerMutex);
+            for (auto& task : schedulerTasks) {
+                if (task.name == name) {
+                    task.enabled = !task.enabled;
+                    taskCopy = task;
+                    found = true;
+                    SchedulerTasksChanged();
+                    break;
+                }
+            }
+        }
+        if (found) {
+            SaveSchedulerTask(taskCopy);
+            JsonWriter result(false);
+            result.BeginObject().Key("success").Bool(true).Key("enabled").Bool(taskCopy.enabled).EndObject();
+            resultJson = result.Take();
+        }
+    }
+
+    return JsonResponse(resultJson);
+}
+
+typedef HttpBuffer (*HttpHandler)(const HttpRequest& request);
+
+// Tabella delle rotte: chiave "METODO percorso" (senza query string), una sola ricerca hash
+static const std::unordered_map<std::string, HttpHandler>& GetHttpRoutes() {
+    static const std::unordered_map<std::string, HttpHandler> routes = {
+        {"GET /", HandleDashboardPage},
+        {"GET /dashboard", HandleDashboardPage},
+        {"GET /scheduler", HandleSchedulerPage},
+        {"GET /api/metrics", HandleMetricsApi},
+        {"GET /api/scheduler", HandleSchedulerApi},
+        {"GET /api/scheduler/scripts", HandleSchedulerScriptsApi},
+        {"POST /api/scheduler/save", HandleSchedulerSaveApi},
+        {"POST /api/scheduler/delete", HandleSchedulerDeleteApi},
+        {"POST /api/scheduler/toggle", HandleSchedulerToggleApi}
+    };
+    return routes;
+}
+
+HttpBuffer HandleHttpRequest(const HttpRequest& request) {
+    std::string key;
+    key.reserve(request.method.size + 1 + request.path.size);
+    key.append(request.method.data, request.method.size);
+    key += ' ';
+    key.append(request.path.data, request.path.size);
+    
+    const std::unordered_map<std::string, HttpHandler>& routes = GetHttpRoutes();
+    auto route = routes.find(key);
+    if (route != routes.end()) return route->second(request);
+    
+    static const HttpBuffer notFound = std::make_shared<const std::string>(
+        BuildHttpResponse("404 Not Found", "text/plain", "404 Not Found", false));
+    return notFound;
+}
+
+// Connessione servita dal ciclo di readiness: i buffer conservano letture e
+// scritture parziali tra un giro di WSAPoll e il successivo
+struct HttpConnection {
+    SOCKET socket;
+    std::string input;
+    std::deque<HttpBuffer> output;   // risposte condivise, inviate in ordine senza copiarle
+    size_t outputSent;               // byte gia' inviati di output.front()
+    size_t outputBytes;              // byte ancora da inviare
+    DWORD lastActivity;
+    bool closeAfterWrite;
+    HttpRequestParser parser;
+    int eventTopics;         // != 0: connessione trasformata in flusso /api/events
+    
+    explicit HttpConnection(SOCKET s) : socket(s), outputSent(0), outputBytes(0), lastActivity(GetTickCount()),
+                                        closeAfterWrite(false), eventTopics(0) {}
+    
+    void Queue(const HttpBuffer& buffer) {
+        if (!buffer || buffer->empty()) return;
+        output.push_back(buffer);
+        outputBytes += buffer->size();
+    }
+};
+
+// Accoda un evento senza mai attendere i client: il lock copre solo l'inserimento.
+// Se il web server resta indietro si scarta il piu' vecchio e i client ricevono "reset"
+void PublishServerEvent(int topic, const char* name, const std::string& data) {
+    std::lock_guard<std::mutex> lock(serverEventMutex);
+    if (serverEventQueue.size() >= SSE_QUEUE_CAPACITY) {
+        serverEventQueue.pop_front();
+        serverEventsLost = true;
+    }
+    ServerEvent event;
+    event.topic = topic;
+    event.name = name;
+    event.data = data;
+    serverEventQueue.push_back(std::move(event));
+}
+
+// Formato text/event-stream: ogni riga del dato diventa una riga "data:"
+static std::string FormatServerEvent(const std::string& name, const std::string& data) {
+    std::string text = "event: " + name + "\n";
+    size_t lineStart = 0;
+    while (lineStart <= data.size()) {
+        size_t lineEnd = data.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = data.size();
+        text += "data: ";
+        text.append(data, lineStart, lineEnd - lineStart);
+        text += "\n";
+        lineStart = lineEnd + 1;
+    }
+    text += "\n";
+    return text;
+}
+
+// Membri di primo livello di un oggetto JSON come testo grezzo, per confrontare
+// due documenti e inviare solo i campi cambiati
+static bool SplitJsonObjectMembers(const std::string& json, std::map<std::string, std::string>& members) {
+    members.clear();
+    size_t position = json.find_first_not_of(" \t\r\n");
+    if (position == std::string::npos || json[position] != '{') return false;
+    ++position;
+    
+    for (;;) {
+        position = json.find_first_not_of(" \t\r\n,", position);
+        if (position == std::string::npos) return false;
+        if (json[position] == '}') return true;
+        if (json[position] != '"') return false;
+        
+        size_t keyEnd = position + 1;
+        while (keyEnd < json.size() && json[keyEnd] != '"') keyEnd += json[keyEnd] == '\\' ? 2 : 1;
+        if (keyEnd >= json.size()) return false;
+        std::string key = json.substr(position + 1, keyEnd - position - 1);
+        
+        size_t colon = json.find_first_not_of(" \t\r\n", keyEnd + 1);
+        if (colon == std::string::npos || json[colon] != ':') return false;
+        size_t valueStart = json.find_first_not_of(" \t\r\n", colon + 1);
+        if (valueStart == std::string::npos) return false;
+        
+        size_t valueEnd = valueStart;
+        int depth = 0;
+        bool inString = false;
+        for (; valueEnd < json.size(); ++valueEnd) {
+            char c = json[valueEnd];
+            if (inString) {
+                if (c == '\\') ++valueEnd;
+                else if (c == '"') inString = false;
+            }
+            else if (c == '"') inString = true;
+            else if (c == '{' || c == '[') depth++;
+            else if (c == '}' || c == ']') {
+                if (depth == 0) break;
+                depth--;
+            }
+            else if (c == ',' && depth == 0) break;
+        }
+        if (valueEnd >= json.size()) return false;
+        
+        size_t last = json.find_last_not_of(" \t\r\n", valueEnd - 1);
+        members[key] = json.substr(valueStart, last - valueStart + 1);
+        position = valueEnd;
+    }
+}
+
+static std::string MetricsEventData(const std::map<std::string, std::string>& fields, bool full) {
+    JsonWriter data(false);
+    data.BeginObject().Key("full").Bool(full).Key("fields").BeginObject();
+    for (const auto& field : fields) data.Key(field.first).Raw(field.second);
+    data.EndObject().EndObject();
+    return data.Take();
+}
+
+// Distribuzione eventi ai flussi aperti, eseguita dal thread del web server a ogni
+// giro di WSAPoll (al massimo HTTP_POLL_TIMEOUT_MS di ritardo). Le metriche seguono
+// l'istantanea pubblicata: a ogni nuova generazione si inviano solo i campi cambiati;
+// recentActivity viaggia con gli eventi "activity"
+class ServerEventFanout {
+public:
+    ServerEventFanout() : lastMetricsGeneration(0), lastPingTick(GetTickCount()) {}
+    
+    // Intestazioni del flusso e stato iniziale completo: ogni (ri)connessione riparte da qui.
+    // Lo stato e' quello su cui si calcolano i delta successivi, cosi' nessun campo resta indietro
+    void Subscribe(HttpConnection& connection, const HttpRequest& request) {
+        int topics = ParseTopics(request.query);
+        connection.eventTopics = topics;
+        std::string head = "HTTP/1.1 200 OK\r\n";
+        head += "Content-Type: text/event-stream\r\n";
+        head += "Cache-Control: no-cache\r\n";
+        head += "Connection: keep-alive\r\n";
+        head += "Access-Control-Allow-Origin: *\r\n";
+        head += "\r\n";
+        head += "retry: " + std::to_string(SSE_RETRY_MS) + "\n\n";
+        if (topics & TopicMetrics) {
+            if (lastMetrics.empty()) {
+                std::shared_ptr<const MetricsSnapshot> snapshot = CurrentMetricsSnapshot();
+                if (SplitJsonObjectMembers(snapshot->json, lastMetrics)) lastMetricsGeneration = snapshot->generation;
+            }
+            if (!lastMetrics.empty()) head += FormatServerEvent("metrics", MetricsEventData(lastMetrics, true));
+        }
+        connection.Queue(std::make_shared<const std::string>(std::move(head)));
+        serverEventSubscribers++;
+    }
+    
+    void Dispatch(std::vector<HttpConnection>& connections) {
+        int subscribedTopics = 0;
+        for (const auto& connection : connections) subscribedTopics |= connection.eventTopics;
+        
+        std::deque<ServerEvent> pending;
+        {
+            std::lock_guard<std::mutex> lock(serverEventMutex);
+            pending.swap(serverEventQueue);
+        }
+        bool lost = serverEventsLost.exchange(false);
+        if (subscribedTopics == 0) {
+            lastMetrics.clear();
+            return;
+        }
+        
+        for (const auto& event : pending) {
+            if (!(subscribedTopics & event.topic)) continue;
+            Broadcast(connections, event.topic, FormatServerEvent(event.name, event.data));
+        }
+        if (lost) {
+            Broadcast(connections, TopicAll, FormatServerEvent("reset", "{}"));
+            lastMetrics.clear();
+        }
+        
+        std::shared_ptr<const MetricsSnapshot> snapshot;
+        if (subscribedTopics & TopicMetrics) snapshot = CurrentMetricsSnapshot();
+        if (snapshot && (lastMetrics.empty() || snapshot->generation != lastMetricsGeneration)) {
+            lastMetricsGeneration = snapshot->generation;
+            std::map<std::string, std::string> current;
+            if (SplitJsonObjectMembers(snapshot->json, current)) {
+                bool full = lastMetrics.empty();
+                std::map<std::string, std::string> changed;
+                for (const auto& field : current) {
+                    if (field.first == "recentActivity" && !full) continue;
+                    auto previous = lastMetrics.find(field.first);
+                    if (full || previous == lastMetrics.end() || previous->second != field.second) changed.insert(field);
+                }
+                if (!changed.empty()) {
+                    Broadcast(connections, TopicMetrics, FormatServerEvent("metrics", MetricsEventData(changed, full)));
+                }
+                lastMetrics.swap(current);
+            }
+        }
+        
+        // Commento periodico: tiene aperti i proxy e fa emergere i client scomparsi
+        DWORD now = GetTickCount();
+        if (now - lastPingTick >= SSE_PING_INTERVAL_MS) {
+            lastPingTick = now;
+            Broadcast(connections, TopicAll, ": ping\n\n");
+        }
+    }
+    
+private:
+    std::map<std::string, std::string> lastMetrics;
+    unsigned long long lastMetricsGeneration;
+    DWORD lastPingTick;
+    
+    // ?topics=metrics,activity,scheduler (assente = tutti)
+    static int ParseTopics(const StringRef& query) {
+        const char* prefix = "topics=";
+        size_t prefixLength = strlen(prefix);
+        if (query.size < prefixLength || memcmp(query.data, prefix, prefixLength) != 0) return TopicAll;
+        StringRef list(query.data + prefixLength, query.size - prefixLength);
+        int topics = 0;
+        if (list.HasTokenIgnoreCase("metrics")) topics |= TopicMetrics;
+        if (list.HasTokenIgnoreCase("activity")) topics |= TopicActivity;
+        if (list.HasTokenIgnoreCase("scheduler")) topics |= TopicScheduler;
+        return topics != 0 ? topics : TopicAll;
+    }
+    
+    // Un solo buffer per evento, condiviso da tutti i sottoscrittori
+    static void Broadcast(std::vector<HttpConnection>& connections, int topic, const std::string& text) {
+        HttpBuffer buffer = std::make_shared<const std::string>(text);
+        for (auto& connection : connections) {
+            if (!(connection.eventTopics & topic) || connection.socket == INVALID_SOCKET) continue;
+            connection.Queue(buffer);
+        }
+    }
+};
+
+// Le risposte sono condivise e prive di intestazione Connection, che in HTTP/1.1
+// vale keep-alive per default: si copia solo per chiudere o per i client HTTP/1.0
+static HttpBuffer SetHttpConnectionHeader(const HttpBuffer& response, const HttpRequest* request, bool keepAlive) {
+    if (keepAlive && request != NULL && request->version.Equals("HTTP/1.1")) return response;
+    std::string copy = *response;
+    size_t statusEnd = copy.find("\r\n");
+    if (statusEnd == std::string::npos) return response;
+    std::string header = keepAlive
+        ? "Connection: keep-alive\r\nKeep-Alive: timeout=" + std::to_string(HTTP_KEEPALIVE_TIMEOUT_MS / 1000) + "\r\n"
+        : std::string("Connection: close\r\n");
+    copy.insert(statusEnd + 2, header);
+    return std::make_shared<const std::string>(std::move(copy));
+}
+
+// Legge tutto quanto disponibile senza bloccare; false se il client ha chiuso o errore
+static bool ReadHttpConnection(HttpConnection& connection) {
+    char buffer[HTTP_IO_CHUNK];
+    for (;;) {
+        int received = recv(connection.socket, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, received);
+            connection.lastActivity = GetTickCount();
+            // Oltre questa soglia il parser ha gia' deciso: il resto si legge al giro successivo
+            if (connection.input.size() > HTTP_MAX_REQUEST_SIZE + HTTP_MAX_HEADER_SIZE) return true;
+            continue;
+        }
+        if (received == 0) return false;
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+    }
+}
+
+// Scrive quanto il socket accetta; false su errore
+static bool FlushHttpConnection(HttpConnection& connection) {
+    while (!connection.output.empty()) {
+        const std::string& buffer = *connection.output.front();
+        size_t remaining = buffer.size() - connection.outputSent;
+        int chunk = static_cast<int>(std::min<size_t>(remaining, 1 << 20));
+        int sent = send(connection.socket, buffer.data() + connection.outputSent, chunk, 0);
+        if (sent == SOCKET_ERROR) return WSAGetLastError() == WSAEWOULDBLOCK;
+        connection.outputSent += sent;
+        connection.outputBytes -= sent;
+        connection.lastActivity = GetTickCount();
+        if (connection.outputSent == buffer.size()) {
+            connection.output.pop_front();
+            connection.outputSent = 0;
+        }
+    }
+    return true;
+}
+
+// Estrae le richieste complete (anche in pipeline) e accoda le risposte; il buffer
+// viene compattato una sola volta alla fine
+static void ProcessHttpRequests(HttpConnection& connection, ServerEventFanout& fanout) {
+    HttpRequest request;
+    size_t consumed = 0;
+    
+    // Un flusso di eventi non accetta altre richieste: quanto arriva viene ignorato
+    if (connection.eventTopics != 0) {
+        connection.input.clear();
+        return;
+    }
+    
+    while (!connection.closeAfterWrite) {
+        HttpRequestParser::Result result = connection.parser.Parse(
+            connection.input.data() + consumed, connection.input.size() - consumed, request);
+        if (result == HttpRequestParser::NeedMore) break;
+        
+        if (result != HttpRequestParser::Complete) {
+            HttpBuffer response = std::make_shared<const std::string>(result == HttpRequestParser::TooLarge
+                ? BuildHttpResponse("413 Payload Too Large", "text/plain", "413 Payload Too Large", false)
+                : BuildHttpResponse("400 Bad Request", "text/plain", "400 Bad Request", false));
+            connection.Queue(SetHttpConnectionHeader(response, NULL, false));
+            connection.closeAfterWrite = true;
+            consumed = connection.input.size();
+            break;
+        }
+        
+        if (request.method.Equals("GET") && request.path.Equals("/api/events")) {
+            fanout.Subscribe(connection, request);
+            consumed = connection.input.size();
+            httpRequestsServed++;
+            break;
+        }
+        
+        connection.Queue(SetHttpConnectionHeader(HandleHttpRequest(request), &request, request.keepAlive));
+        connection.closeAfterWrite = !request.keepAlive;
+        consumed += connection.parser.MessageLength();
+        connection.parser.Reset();
+        httpRequestsServed++;
+    }
+    
+    if (consumed > 0) connection.input.erase(0, consumed);
+}
+
+static void CloseHttpConnection(HttpConnection& connection) {
+    if (connection.socket == INVALID_SOCKET) return;
+    shutdown(connection.socket, SD_SEND);
+    closesocket(connection.socket);
+    connection.socket = INVALID_SOCKET;
+    httpActiveConnections--;
+    if (connection.eventTopics != 0) serverEventSubscribers--;
+}
+
+// Ciclo di readiness: un solo thread serve molte connessioni non bloccanti, con
+// letture/scritture parziali e keep-alive, senza che un client lento fermi gli altri
+void ServeHttpConnections(SOCKET serverSocket, const std::atomic<bool>& stopRequested) {
+    std::vector<HttpConnection> connections;
+    std::vector<WSAPOLLFD> pollSet;
+    ServerEventFanout fanout;
+    
+    while (!globalShutdown && !stopRequested) {
+        bool listening = connections.size() < HTTP_MAX_CONNECTIONS;
+        pollSet.clear();
+        if (listening) {
+            WSAPOLLFD entry;
+            entry.fd = serverSocket;
+            entry.events = POLLRDNORM;
+            entry.revents = 0;
+            pollSet.push_back(entry);
+        }
+        for (const auto& connection : connections) {
+            WSAPOLLFD entry;
+            entry.fd = connection.socket;
+            // Con una risposta ancora in uscita non si leggono altre richieste
+            entry.events = connection.output.empty() ? POLLRDNORM : POLLWRNORM;
+            entry.revents = 0;
+            pollSet.push_back(entry);
+        }
+        
+        int ready = WSAPoll(pollSet.data(), static_cast<unsigned long>(pollSet.size()), HTTP_POLL_TIMEOUT_MS);
+        if (ready == SOCKET_ERROR) {
+            int error = WSAGetLastError();
+            if (error == WSAEINTR) continue;
+            WriteToLog("ERRORE: WSAPoll fallito: " + std::to_string(error));
+            if (!globalShutdown && !stopRequested) systemMetrics.errorsCount++;
+            break;
+        }
+        
+        size_t offset = listening ? 1 : 0;
+        fanout.Dispatch(connections);
+        for (size_t i = 0; i < connections.size(); ++i) {
+            HttpConnection& connection = connections[i];
+            short revents = ready > 0 ? pollSet[offset + i].revents : 0;
+            bool alive = true;
+            
+            if (revents & (POLLRDNORM | POLLHUP | POLLERR | POLLNVAL)) {
+                alive = !(revents & POLLNVAL) && ReadHttpConnection(connection);
+                if (alive) ProcessHttpRequests(connection, fanout);
+            }
+            if (alive && !connection.output.empty()) {
+                alive = FlushHttpConnection(connection);
+            }
+            if (alive && connection.output.empty() && connection.closeAfterWrite) alive = false;
+            if (alive && connection.eventTopics == 0 && GetTickCount() - connection.lastActivity > HTTP_KEEPALIVE_TIMEOUT_MS) alive = false;
+            if (alive && connection.outputBytes > SSE_MAX_BACKLOG && connection.eventTopics != 0) alive = false;
+            
+            if (!alive) CloseHttpConnection(connection);
+        }
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                         [](const HttpConnection& c) { return c.socket == INVALID_SOCKET; }),
+                          connections.end());
+        
+        if (listening && ready > 0 && (pollSet[0].revents & POLLRDNORM)) {
+            while (connections.size() < HTTP_MAX_CONNECTIONS) {
+                SOCKET clientSocket = accept(serverSocket, NULL, NULL);
+                if (clientSocket == INVALID_SOCKET) {
+                    int error = WSAGetLastError();
+                    if (error != WSAEWOULDBLOCK) {
+                        WriteToLog("ERRORE: Accept fallito: " + std::to_string(error), true);
+                    }
+                    break;
+                }
+                
+                u_long mode = 1;
+                ioctlsocket(clientSocket, FIONBIO, &mode);
+                BOOL noDelay = TRUE;
+                setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (char*)&noDelay, sizeof(noDelay));
+                
+                connections.push_back(HttpConnection(clientSocket));
+                httpActiveConnections++;
+                
+                // La richiesta e' spesso gia' arrivata insieme alla connessione
+                HttpConnection& connection = connections.back();
+                bool alive = ReadHttpConnection(connection);
+                if (alive) {
+                    ProcessHttpRequests(connection, fanout);
+                    alive = FlushHttpConnection(connection);
+                }
+                if (!alive || (connection.output.empty() && connection.closeAfterWrite)) {
+                    CloseHttpConnection(connection);
+                    connections.pop_back();
+                }
+            }
+        }
+    }
+    
+    for (auto& connection : connections) CloseHttpConnection(connection);
+    
+    std::lock_guard<std::mutex> lock(serverEventMutex);
+    serverEventQueue.clear();
+}
+
+void WebServerWorker() {
+    WriteToLog("Avvio web server sulla porta " + std::to_string(webServerPort));
+    
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        WriteToLog("ERRORE: WSAStartup fallito");
+        systemMetrics.errorsCount++;
+        return;
+    }
+    
+    SOCKET serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (serverSocket == INVALID_SOCKET) {
+        WriteToLog("ERRORE: Creazione socket fallita");
+        systemMetrics.errorsCount++;
+        WSACleanup();
+        return;
+    }
+    
+    sockaddr_in serverAddr;
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    serverAddr.sin_port = htons(webServerPort);
+    
+    if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+        WriteToLog("ERRORE: Bind socket fallito sulla porta " + std::to_string(webServerPort));
+        systemMetrics.errorsCount++;
+        closesocket(serverSocket);
+        WSACleanup();
+        return;
+    }
+    
+    if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
+        WriteToLog("ERRORE: Listen socket fallito");
+        systemMetrics.errorsCount++;
+        closesocket(serverSocket);
+        WSACleanup();
+        return;
+    }
+    
+    // Socket non-bloccante: l'attesa avviene in WSAPoll, non in accept
+    u_long mode = 1;
+    ioctlsocket(serverSocket, FIONBIO, &mode);
+    
+    // Pagine statiche renderizzate e compresse prima di accettare connessioni
+    const StaticPages& pages = GetStaticPages();
+    WriteToLog("Pagine statiche pronte: dashboard " + std::to_string(pages.dashboard.identity.response->size()) +
+               " byte (gzip " + std::to_string(pages.dashboard.gzip.response ? pages.dashboard.gzip.response->size() : 0) +
+               "), scheduler " + std::to_string(pages.scheduler.identity.response->size()) +
+               " byte (gzip " + std::to_string(pages.scheduler.gzip.response ? pages.scheduler.gzip.response->size() : 0) + ")");
+    
+    webServerRunning = true;
+    WriteToLog("Web server avviato su http://localhost:" + std::to_string(webServerPort));
+    
+    ServeHttpConnections(serverSocket, webServerShouldStop);
+    
+    webServerRunning = false;
+    closesocket(serverSocket);
+    WSACleanup();
+    WriteToLog("Web server terminato");
+}
+
+DWORD WINAPI ServiceWorkerThread(LPVOID /*lpParam*/) {
+    WriteToLog("=== Servizio PatternTriggerCommand Multi-Folder v3.0 avviato ===");
+    
+    if (!LoadConfiguration()) {
+        WriteToLog("ERRORE FATALE: Impossibile caricare configurazione");
+        return 1;
+    }
+    
+    std::string scriptsDir = "C:\\Scripts";
+    CreateDirectoryRecursive(scriptsDir);
+    
+    LoadProcessedFiles();
+    
+    recentlyIgnoredFiles.clear();
+    
+    // Avvia thread aggiornamento metriche
+    std::thread metricsThread(MetricsUpdateWorker);
+    
+    // Avvia compattazione in background del journal file processati
+    std::thread compactionThread(ProcessedDbCompactionWorker);
+    
+    // Avvia retention in background del database file processati
+    std::thread sweepThread(ProcessedSweepWorker);
+    
+    // Avvia web server se abilitato
+    if (webServerEnabled) {
+        webServerThread = std::thread(WebServerWorker);
+    }
+
+    // Carica e avvia schedulatore
+    LoadSchedulerTasks();
+    if (schedulerEnabled) {
+        schedulerThread = std::thread(SchedulerWorker);
+        WriteToLog("Schedulatore avviato con " + std::to_string(schedulerTasks.size()) + " task");
+    }
+
+    StartAllFolderMonitors();
+
+    WriteToLog("Servizio in esecuzione, attesa terminazione...");
+    if (webServerEnabled) {
+        WriteToLog("Dashboard disponibile su: http://localhost:" + std::to_string(webServerPort));
+    }
+    
+    DWORD lastCleanup = GetTickCount();
+    
+    while (!globalShutdown) {
+        if (WaitForSingleObject(stopEvent, 5000) == WAIT_OBJECT_0) {
+            break;
+        }
+        
+        int activeMonitors = 0;
+        for (const auto& monitorPair : folderMonitors) {
+            if (monitorPair.second->active) activeMonitors++;
+        }
+        WriteToLog("Monitor attivi: " + std::to_string(activeMonitors), true);
+        
+        if (GetTickCount() - lastCleanup > CACHE_CLEANUP_INTERVAL) {
+            recentlyIgnoredFiles.clear();
+            lastCleanup = GetTickCount();
+            WriteToLog("Pulizia cache file ignorati", true);
+        }
+    }
+    
+    WriteToLog("Terminazione richiesta, cleanup in corso...");
+    
+    // CORREZIONE: Arresto MOLTO più aggressivo con timeout brevi
+    
+    // 1. Ferma web server per primo (TIMEOUT: 2 secondi)
+    if (webServerEnabled) {
+        webServerShouldStop = true;
+        WriteToLog("Arresto web server...");
+        
+        auto webStartTime = GetTickCount();
+        bool webStopped = false;
+        
+        while (GetTickCount() - webStartTime < 2000 && !webStopped) {
+            if (!webServerRunning) {
+                webStopped = true;
+            } else {
+                Sleep(100);
+            }
+        }
+        
+        if (webServerThread.joinable()) {
+            if (webStopped) {
+                try {
+                    webServerThread.join();
+                    WriteToLog("Web server arrestato correttamente");
+                } catch (...) {
+                    WriteToLog("ERRORE join web server - detach forzato");
+                    webServerThread.detach();
+                }
+            } else {
+                WriteToLog("TIMEOUT web server - detach forzato");
+                webServerThread.detach();
+            }
+        }
+    }
+    
+    // 2. Ferma schedulatore - globalShutdown gia' impostato, la notifica lo sveglia subito
+    if (schedulerThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(schedulerMutex);
+            schedulerCondition.notify_all();
+        }
+        WriteToLog("Arresto thread schedulatore...");
+        try {
+            schedulerThread.join();
+            WriteToLog("Thread schedulatore arrestato");
+        } catch (...) {
+            WriteToLog("ERRORE join schedulatore - detach forzato");
+            schedulerThread.detach();
+        }
+    }
+
+    // 3. Ferma monitor cartelle
+    WriteToLog("Arresto monitor cartelle...");
+    StopAllFolderMonitors();
+
+    // 4. Ferma thread metriche - globalShutdown gia' impostato, lo sleep frazionato lo sblocca in <100ms
+    if (metricsThread.joinable()) {
+        WriteToLog("Arresto thread metriche...");
+        try {
+            metricsThread.join();
+            WriteToLog("Thread metriche arrestato");
+        } catch (...) {
+            WriteToLog("ERRORE join metriche - detach forzato");
+            metricsThread.detach();
+        }
+    }
+    
+    if (compactionThread.joinable()) {
+        try {
+            compactionThread.join();
+        } catch (...) {
+            compactionThread.detach();
+        }
+    }
+    
+    if (sweepThread.joinable()) {
+        try {
+            sweepThread.join();
+        } catch (...) {
+            sweepThread.detach();
+        }
+    }
+    
+    SaveAllFolderSnapshots();
+    SaveProcessedFiles();
+    CloseProcessedJournal();
+    
+    WriteToLog("=== Servizio PatternTriggerCommand terminato ===");
+    return 0;
+}
+
+void WINAPI ServiceCtrlHandler(DWORD ctrlCode) {
+    switch (ctrlCode) {
+        case SERVICE_CONTROL_STOP:
+        case SERVICE_CONTROL_SHUTDOWN:
+            WriteToLog("Richiesta arresto servizio ricevuta");
+            
+            serviceStatus.dwControlsAccepted = 0;
+            serviceStatus.dwCurrentState = SERVICE_STOP_PENDING;
+            serviceStatus.dwWin32ExitCode = 0;
+            serviceStatus.dwCheckPoint = 1;
+            serviceStatus.dwWaitHint = 5000; // CORREZIONE: Ridotto da 8 a 5 secondi
+            
+            SetServiceStatus(serviceStatusHandle, &serviceStatus);
+            
+            // CORREZIONE: Arresto immediato e aggressivo
+            globalShutdown = true;
+            webServerShouldStop = true;
+            
+            if (stopEvent) {
+                SetEvent(stopEvent);
+            }
+            
+            // CORREZIONE: Forza chiusura handle directory per sbloccare ReadDirectoryChangesW
+            for (auto& monitorPair : folderMonitors) {
+                if (monitorPair.second->directoryHandle != INVALID_HANDLE_VALUE) {
+                    CloseHandle(monitorPair.second->directoryHandle);
+                    monitorPair.second->directoryHandle = INVALID_HANDLE_VALUE;
+                }
+            }
+            
+            break;
+            
+        default:
+            break;
+    }
+}
+
+void WINAPI ServiceMain(DWORD /*argc*/, LPTSTR* /*argv*/) {
+    serviceStatusHandle = RegisterServiceCtrlHandler(SERVICE_NAME, ServiceCtrlHandler);
+    
+    if (serviceStatusHandle == NULL) {
+        WriteToLog("RegisterServiceCtrlHandler fallito");
+        return;
+    }
+    
+    ZeroMemory(&serviceStatus, sizeof(serviceStatus));
+    serviceStatus.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
+    serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN;
+    serviceStatus.dwCurrentState = SERVICE_START_PENDING;
+    serviceStatus.dwWin32ExitCode = 0;
+    serviceStatus.dwServiceSpecificExitCode = 0;
+    serviceStatus.dwCheckPoint = 0;
+    serviceStatus.dwWaitHint = 0;
+    
+    SetServiceStatus(serviceStatusHandle, &serviceStatus);
+    
+    stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (stopEvent == NULL) {
+        WriteToLog("CreateEvent fallito");
+        serviceStatus.dwCurrentState = SERVICE_STOPPED;
+        serviceStatus.dwWin32ExitCode = GetLastError();
+        SetServiceStatus(serviceStatusHandle, &serviceStatus);
+        return;
+    }
+    
+    HANDLE hThread = CreateThread(NULL, 0, ServiceWorkerThread, NULL, 0, NULL);
+    if (hThread == NULL) {
+        WriteToLog("CreateThread fallito");
+        serviceStatus.dwCurrentState = SERVICE_STOPPED;
+        serviceStatus.dwWin32ExitCode = GetLastError();
+        SetServiceStatus(serviceStatusHandle, &serviceStatus);
+        return;
+    }
+    
+    serviceStatus.dwCurrentState = SERVICE_RUNNING;
+    serviceStatus.dwCheckPoint = 0;
+    serviceStatus.dwWaitHint = 0;
+    
+    SetServiceStatus(serviceStatusHandle, &serviceStatus);
+    
+    WriteToLog("Servizio avviato e registrato");
+    
+    WaitForSingleObject(hThread, INFINITE);
+    
+    CloseHandle(hThread);
+    CloseHandle(stopEvent);
+    
+    serviceStatus.dwCurrentState = SERVICE_STOPPED;
+    serviceStatus.dwCheckPoint = 0;
+    serviceStatus.dwWaitHint = 0;
+    
+    SetServiceStatus(serviceStatusHandle, &serviceStatus);
+    WriteToLog("Servizio terminato");
+}
+
+BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType) {
+    if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT) {
+        std::cout << "\nInterruzione richiesta, attendere..." << std::endl;
+        globalShutdown = true;
+        webServerShouldStop = true;
+
+        // Chiudi handle directory per sbloccare ReadDirectoryChangesW
+        for (auto& monitorPair : folderMonitors) {
+            if (monitorPair.second->directoryHandle != INVALID_HANDLE_VALUE) {
+                CloseHandle(monitorPair.second->directoryHandle);
+                monitorPair.second->directoryHandle = INVALID_HANDLE_VALUE;
             }
         }
 
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: application/json\r\n";
-        response += "Content-Length: " + std::to_string(resultJson.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "Access-Control-Allow-Origin: *\r\n";
-        response += "\r\n";
-        response += resultJson;
+        if (stopEvent) {
+            SetEvent(stopEvent);
+        }
+        return TRUE;
     }
-    else if (request.find("POST /api/scheduler/delete") != std::string::npos) {
-        std::string body = GetHttpRequestBody(request);
-        std::string name = ExtractJsonValue(body, "name");
+    return FALSE;
+}
 
-        std::string resultJson;
-        if (!name.empty() && DeleteSchedulerTask(name)) {
-            resultJson = "{\"success\": true}";
-        } else {
-            resultJson = "{\"success\": false, \"error\": \"Task non trovato\"}";
-        }
+// ====== BENCHMARK ======
 
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: application/json\r\n";
-        response += "Content-Length: " + std::to_string(resultJson.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "Access-Control-Allow-Origin: *\r\n";
-        response += "\r\n";
-        response += resultJson;
-    }
-    else if (request.find("POST /api/scheduler/toggle") != std::string::npos) {
-        std::string body = GetHttpRequestBody(request);
-        std::string name = ExtractJsonValue(body, "name");
+std::string GetBenchmarkRoot(const std::string& name) {
+    char tempPath[MAX_PATH];
+    DWORD len = GetTempPath(MAX_PATH, tempPath);
+    std::string root = (len > 0 && len < MAX_PATH) ? std::string(tempPath) : std::string("C:\\PTC\\");
+    if (!root.empty() && root.back() != '\\') root += '\\';
+    return root + "ptc_bench_" + name;
+}
+
+double ElapsedMs(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-        std::string resultJson = "{\"success\": false, \"error\": \"Task non trovato\"}";
-        SchedulerTask taskCopy;
-        bool found = false;
+std::atomic<size_t> benchWatcherEvents{0};
 
-        if (!name.empty()) {
-            {
-                std::lock_guard<std::mutex> lock(schedulerMutex);
-                for (auto& task : schedulerTasks) {
-                    if (task.name == name) {
-                        task.enabled = !task.enabled;
-                        taskCopy = task;
-                        found = true;
-                        break;
-                    }
-                }
+void BenchWatcherCallback(FolderMonitor* /*monitor*/, DWORD action, const std::string& /*filename*/) {
+    if (action == FILE_ACTION_ADDED) benchWatcherEvents++;
+}
+
+// Eventi/secondo del motore watcher al crescere del numero di cartelle
+int RunWatcherBenchmark(int maxFolders, int filesPerFolder) {
+    std::string root = GetBenchmarkRoot("watcher");
+    std::cout << "Benchmark motore watcher - thread: " << watcherThreadCount 
+              << ", file per cartella: " << filesPerFolder 
+              << ", buffer notifiche: " << notificationBufferKB << " KB" << std::endl;
+    std::cout << "Cartelle\tEventi\tTempo(ms)\tEventi/s\tOverflow" << std::endl;
+    
+    for (int folders = 1; folders <= maxFolders; folders *= 4) {
+        std::vector<std::unique_ptr<FolderMonitor>> monitors;
+        std::vector<std::string> paths;
+        
+        if (!StartWatcherEngine(watcherThreadCount)) return 1;
+        benchWatcherEvents = 0;
+        
+        for (int f = 0; f < folders; ++f) {
+            std::string path = root + "\\f" + std::to_string(f);
+            CreateDirectoryRecursive(path);
+            paths.push_back(path);
+            
+            std::unique_ptr<FolderMonitor> monitor(new FolderMonitor(path));
+            monitor->eventCallback = BenchWatcherCallback;
+            if (!AttachFolderMonitor(monitor.get())) {
+                std::cerr << "Impossibile monitorare: " << path << std::endl;
+                continue;
+            }
+            monitors.push_back(std::move(monitor));
+        }
+        
+        size_t expected = static_cast<size_t>(monitors.size()) * filesPerFolder;
+        auto start = std::chrono::steady_clock::now();
+        
+        for (int i = 0; i < filesPerFolder; ++i) {
+            for (size_t f = 0; f < monitors.size(); ++f) {
+                std::string file = paths[f] + "\\bench_" + std::to_string(i) + ".dat";
+                HANDLE h = CreateFile(file.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+                if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
             }
-            if (found) {
-                SaveSchedulerTask(taskCopy);
-                resultJson = "{\"success\": true, \"enabled\": " + std::string(taskCopy.enabled ? "true" : "false") + "}";
+        }
+        
+        size_t overflows = 0;
+        while (benchWatcherEvents < expected && ElapsedMs(start) < 30000) {
+            // Con un overflow gli eventi persi non arriveranno mai
+            overflows = 0;
+            for (const auto& monitor : monitors) overflows += monitor->stats->overflows.load();
+            if (overflows > 0 && ElapsedMs(start) > 2000) break;
+            Sleep(1);
+        }
+        double elapsed = ElapsedMs(start);
+        size_t received = benchWatcherEvents.load();
+        overflows = 0;
+        for (const auto& monitor : monitors) overflows += monitor->stats->overflows.load();
+        
+        std::cout << monitors.size() << "\t\t" << received << "\t" << std::fixed << std::setprecision(1) 
+                  << elapsed << "\t\t" << (elapsed > 0 ? received * 1000.0 / elapsed : 0.0) 
+                  << "\t\t" << overflows << std::endl;
+        
+        for (auto& monitor : monitors) {
+            monitor->stopRequested = true;
+            CloseHandle(monitor->directoryHandle);
+            monitor->directoryHandle = INVALID_HANDLE_VALUE;
+        }
+        for (auto& monitor : monitors) {
+            for (int w = 0; w < 100 && monitor->ioPending; ++w) Sleep(10);
+            if (monitor->ioPending) monitor.release();
+        }
+        StopWatcherEngine();
+        monitors.clear();
+        
+        for (const auto& path : paths) {
+            for (int i = 0; i < filesPerFolder; ++i) {
+                DeleteFile((path + "\\bench_" + std::to_string(i) + ".dat").c_str());
             }
+            RemoveDirectory(path.c_str());
+        }
+    }
+    
+    RemoveDirectory(root.c_str());
+    return 0;
+}
+
+static unsigned long long FileSizeOrZero(const std::string& path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data)) return 0;
+    return (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+}
+
+// Statistiche dell'immagine binaria lette dalla mappatura, senza caricare il database
+int ShowProcessedDbStats() {
+    std::string imagePath = ProcessedImagePath();
+    std::cout << "Database file processati: " << imagePath << std::endl;
+    
+    ProcessedDbImage image;
+    std::string error;
+    if (!image.Open(imagePath, error)) {
+        std::cerr << "Immagine non disponibile: " << error << std::endl;
+        if (FileExists(processedFilesDb)) {
+            std::cerr << "Presente il formato testuale storico: usare convert-db" << std::endl;
         }
+        return 1;
+    }
+    
+    const ProcessedDbImageHeader* header = image.Header();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Formato: binario v" << header->version << std::endl;
+    std::cout << "Voci: " << header->entryCount << " | cartelle: " << header->folderCount << std::endl;
+    std::cout << "Slot: " << header->slotCount << " (riempimento "
+              << (header->slotCount > 0 ? 100.0 * header->entryCount / header->slotCount : 0.0) << "%)"
+              << " | sondaggio medio: " << image.AverageProbeLength() << " slot" << std::endl;
+    std::cout << "Dimensione: " << header->fileSize << " byte (heap stringhe " << header->heapSize << " byte)"
+              << " | " << (header->entryCount > 0 ? static_cast<double>(header->fileSize) / header->entryCount : 0.0)
+              << " B/voce" << std::endl;
+    std::cout << "Journal (overlay): " << FileSizeOrZero(ProcessedJournalPath()) << " byte"
+              << " + ruotato " << FileSizeOrZero(ProcessedJournalOldPath()) << " byte" << std::endl;
+    return 0;
+}
 
-        response = "HTTP/1.1 200 OK\r\n";
-        response += "Content-Type: application/json\r\n";
-        response += "Content-Length: " + std::to_string(resultJson.length()) + "\r\n";
-        response += "Cache-Control: no-cache\r\n";
-        response += "Access-Control-Allow-Origin: *\r\n";
-        response += "\r\n";
-        response += resultJson;
+// Costo per file marcato: riscrittura completa (storico) contro append su journal
+int RunProcessedDbBenchmark(size_t dbEntries, size_t marks) {
+    std::string root = GetBenchmarkRoot("db");
+    CreateDirectoryRecursive(root);
+    processedFilesDb = root + "\\processed.txt";
+    DeleteFile(processedFilesDb.c_str());
+    DeleteFile(ProcessedImagePath().c_str());
+    DeleteFile(ProcessedJournalPath().c_str());
+    DeleteFile(ProcessedJournalOldPath().c_str());
+    
+    std::cout << "Benchmark database file processati - voci: " << dbEntries 
+              << ", file marcati: " << marks << std::endl;
+    
+    {
+        std::lock_guard<std::mutex> lock(processedFilesMutex);
+        processedFiles.Clear();
+        for (size_t i = 0; i < dbEntries; ++i) {
+            processedFiles.Insert("C:\\Monitored\\Archive\\existing_file_" + std::to_string(i) + ".pdf");
+        }
     }
-    else {
-        std::string notFound = "404 Not Found";
-        response = "HTTP/1.1 404 Not Found\r\n";
-        response += "Content-Type: text/plain\r\n";
-        response += "Content-Length: " + std::to_string(notFound.length()) + "\r\n";
-        response += "\r\n";
-        response += notFound;
+    SaveProcessedFiles();
+    
+    // Prima: ogni file riscrive l'intero database. Campionato, poi estrapolato.
+    size_t legacySamples = std::min<size_t>(marks, 20);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < legacySamples; ++i) {
+        std::lock_guard<std::mutex> lock(processedFilesMutex);
+        processedFiles.Insert("C:\\Monitored\\Incoming\\legacy_" + std::to_string(i) + ".pdf");
+        std::ofstream file(processedFilesDb.c_str());
+        processedFiles.ForEach([&file](const std::string& filename) { file << filename << std::endl; });
     }
+    double legacyMs = ElapsedMs(start) / (legacySamples > 0 ? legacySamples : 1);
     
-    return response;
+    start = std::chrono::steady_clock::now();
+    {
+        ProcessedFileIndex parsed;
+        LoadProcessedTextSnapshot(processedFilesDb, parsed);
+    }
+    double textLoadMs = ElapsedMs(start);
+    
+    // Dopo: una append sul journal per file
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < marks; ++i) {
+        RecordProcessedFile("C:\\Monitored\\Incoming\\new_" + std::to_string(i) + ".pdf");
+    }
+    double journalMs = ElapsedMs(start) / (marks > 0 ? marks : 1);
+    
+    start = std::chrono::steady_clock::now();
+    CompactProcessedFiles();
+    double compactMs = ElapsedMs(start);
+    
+    start = std::chrono::steady_clock::now();
+    LoadProcessedFiles();
+    double loadMs = ElapsedMs(start);
+    
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "Prima (riscrittura completa): " << legacyMs << " ms/file (" << legacySamples << " campioni)" << std::endl;
+    std::cout << "Dopo (journal append):        " << journalMs << " ms/file" << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << "Compattazione snapshot:       " << compactMs << " ms" << std::endl;
+    std::cout << "Caricamento testo (storico):  " << textLoadMs << " ms" << std::endl;
+    std::cout << "Mappatura immagine + replay:  " << loadMs << " ms" << std::endl;
+    
+    CloseProcessedJournal();
+    {
+        std::lock_guard<std::mutex> lock(processedFilesMutex);
+        processedFiles.Clear();
+    }
+    DeleteFile(processedFilesDb.c_str());
+    DeleteFile(ProcessedImagePath().c_str());
+    DeleteFile(ProcessedTextBackupPath().c_str());
+    DeleteFile(ProcessedJournalPath().c_str());
+    DeleteFile(ProcessedJournalOldPath().c_str());
+    RemoveDirectory(root.c_str());
+    return 0;
 }
 
-void WebServerWorker() {
-    WriteToLog("Avvio web server sulla porta " + std::to_string(webServerPort));
+// Costo lato produttore di WriteToLog: logger asincrono contro scrittura sincrona storica
+int RunLoggerBenchmark(size_t messages, int threads) {
+    std::cout << "Benchmark logger - messaggi: " << messages << ", thread produttori: " << threads << std::endl;
     
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        WriteToLog("ERRORE: WSAStartup fallito");
-        systemMetrics.errorsCount++;
-        return;
+    // Storico: lock globale + apertura/chiusura file + ostringstream per messaggio (campionato)
+    std::string legacyPath = GetBenchmarkRoot("log_legacy.log");
+    std::mutex legacyMutex;
+    size_t legacySamples = std::min<size_t>(messages, 20000);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < legacySamples; ++i) {
+        std::lock_guard<std::mutex> lock(legacyMutex);
+        std::ofstream stream(legacyPath.c_str(), std::ios::app);
+        SYSTEMTIME st;
+        GetLocalTime(&st);
+        std::ostringstream oss;
+        oss << std::setfill('0') << st.wYear << "-" << std::setw(2) << st.wMonth << "-" << std::setw(2) << st.wDay
+            << " " << std::setw(2) << st.wHour << ":" << std::setw(2) << st.wMinute << ":" << std::setw(2) << st.wSecond
+            << "." << std::setw(3) << st.wMilliseconds;
+        stream << oss.str() << " - Messaggio di benchmark " << i << std::endl;
     }
+    double legacyNs = ElapsedMs(start) * 1e6 / (legacySamples > 0 ? legacySamples : 1);
+    DeleteFile(legacyPath.c_str());
     
-    SOCKET serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket == INVALID_SOCKET) {
-        WriteToLog("ERRORE: Creazione socket fallita");
-        systemMetrics.errorsCount++;
-        WSACleanup();
-        return;
+    // Asincrono: solo il costo di inserimento nel ring
+    size_t droppedBefore = logRecordsDropped.load();
+    size_t perThread = messages / (threads > 0 ? threads : 1);
+    std::vector<std::thread> producers;
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        producers.push_back(std::thread([perThread, t]() {
+            std::string base = "Messaggio di benchmark thread " + std::to_string(t) + " #";
+            for (size_t i = 0; i < perThread; ++i) {
+                WriteToLog(base + std::to_string(i), true);
+            }
+        }));
     }
+    for (auto& p : producers) p.join();
+    double asyncNs = ElapsedMs(start) * 1e6 / (perThread * threads > 0 ? perThread * threads : 1);
+    size_t dropped = logRecordsDropped.load() - droppedBefore;
     
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(webServerPort);
+    start = std::chrono::steady_clock::now();
+    while (logRing.ApproxSize() > 0 && ElapsedMs(start) < 30000) Sleep(1);
+    double drainMs = ElapsedMs(start);
     
-    if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        WriteToLog("ERRORE: Bind socket fallito sulla porta " + std::to_string(webServerPort));
-        systemMetrics.errorsCount++;
-        closesocket(serverSocket);
-        WSACleanup();
-        return;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Sincrono storico:  " << legacyNs << " ns/messaggio (" << legacySamples << " campioni, 1 thread)" << std::endl;
+    std::cout << "Asincrono (ring):  " << asyncNs << " ns/messaggio" << std::endl;
+    std::cout << "Scartati per overflow: " << dropped << " (capacita' ring " << LOG_RING_CAPACITY << ")" << std::endl;
+    std::cout << "Svuotamento writer: " << drainMs << " ms" << std::endl;
+    return 0;
+}
+
+int RunScanBenchmark(int files) {
+    std::string root = GetBenchmarkRoot("scan");
+    CreateDirectoryRecursive(root);
+    std::string normalizedRoot = NormalizeFolderPath(root);
+    std::cout << "Benchmark scansione all'avvio - file: " << files << std::endl;
+    
+    // Archivio di file che non corrispondono ai 20 pattern della cartella
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < files; ++i) {
+        std::string file = root + "\\archivio_" + std::to_string(i) + ".dat";
+        HANDLE h = CreateFile(file.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
     }
+    std::cout << "Creazione file: " << std::fixed << std::setprecision(1) << ElapsedMs(start) << " ms" << std::endl;
     
-    if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
-        WriteToLog("ERRORE: Listen socket fallito");
-        systemMetrics.errorsCount++;
-        closesocket(serverSocket);
-        WSACleanup();
-        return;
+    size_t originalPatterns = patternCommandPairs.size();
+    std::vector<int> indices;
+    for (int p = 0; p < 20; ++p) {
+        patternCommandPairs.emplace_back(root, "^fattura_" + std::to_string(p) + "_.*\\.pdf$", "cmd.exe",
+                                         "BenchScan" + std::to_string(p));
+        indices.push_back(static_cast<int>(patternCommandPairs.size() - 1));
     }
+    BuildFolderMatchers();
+    DeleteFile(FolderSnapshotPath(normalizedRoot).c_str());
     
-    // CORREZIONE: Timeout più aggressivo e non-bloccante
-    DWORD timeout = 500; // 500ms invece di 1 secondo
-    setsockopt(serverSocket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
+    // Storico: FindFirstFile + regex di ogni pattern per ogni file
+    start = std::chrono::steady_clock::now();
+    size_t legacyFiles = 0;
+    WIN32_FIND_DATA findData;
+    HANDLE hFind = FindFirstFile((root + "\\*.*").c_str(), &findData);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            legacyFiles++;
+            std::string filename = findData.cFileName;
+            for (int index : indices) {
+                std::regex_match(filename, patternCommandPairs[index].compiledRegex);
+            }
+        } while (FindNextFile(hFind, &findData));
+        FindClose(hFind);
+    }
+    double legacyMs = ElapsedMs(start);
     
-    // Imposta socket non-bloccante
-    u_long mode = 1;
-    ioctlsocket(serverSocket, FIONBIO, &mode);
+    // Primo avvio: nessuna istantanea, ogni file passa dal matcher
+    start = std::chrono::steady_clock::now();
+    ScanDirectoryForExistingFiles(root, indices);
+    double fullMs = ElapsedMs(start);
     
-    webServerRunning = true;
-    WriteToLog("Web server avviato su http://localhost:" + std::to_string(webServerPort));
+    start = std::chrono::steady_clock::now();
+    SaveAllFolderSnapshots();
+    double saveMs = ElapsedMs(start);
+    
+    // Riavvio: istantanea caricata da disco, i file invariati saltano matching e DB
+    {
+        std::lock_guard<std::mutex> lock(folderSnapshotsMutex);
+        folderSnapshots.erase(normalizedRoot);
+    }
+    start = std::chrono::steady_clock::now();
+    ScanDirectoryForExistingFiles(root, indices);
+    double incrementalMs = ElapsedMs(start);
+    
+    std::cout << "Scansione storica (regex per file):   " << legacyMs << " ms (" << legacyFiles << " file)" << std::endl;
+    std::cout << "Primo avvio (senza istantanea):       " << fullMs << " ms" << std::endl;
+    std::cout << "Salvataggio istantanea:               " << saveMs << " ms" << std::endl;
+    std::cout << "Riavvio (con istantanea):             " << incrementalMs << " ms" << std::endl;
+    
+    {
+        std::lock_guard<std::mutex> lock(folderSnapshotsMutex);
+        folderSnapshots.erase(normalizedRoot);
+    }
+    patternCommandPairs.erase(patternCommandPairs.begin() + originalPatterns, patternCommandPairs.end());
+    BuildFolderMatchers();
+    DeleteFile(FolderSnapshotPath(normalizedRoot).c_str());
+    for (int i = 0; i < files; ++i) {
+        DeleteFile((root + "\\archivio_" + std::to_string(i) + ".dat").c_str());
+    }
+    RemoveDirectory(root.c_str());
+    return 0;
+}
+
+std::string BenchMatchPattern(int i) {
+    char id[16];
+    snprintf(id, sizeof(id), "%04d", i);
+    switch (i % 4) {
+        case 0: return std::string("^FATT_") + id + "_[0-9]{8}\\.pdf$";
+        case 1: return std::string("REPORT_") + id + "_.*\\.(xlsx|csv)";
+        case 2: return std::string("[a-z]+_") + id + "\\.txt";
+        default: return std::string(".*_") + id + "_DEMAT_\\d+\\.xml";
+    }
+}
+
+std::string BenchMatchFilename(int i, int variant) {
+    char id[16];
+    snprintf(id, sizeof(id), "%04d", i);
+    switch (i % 4) {
+        case 0: return std::string("fatt_") + id + "_2024" + std::to_string(1000 + variant) + ".pdf";
+        case 1: return std::string("Report_") + id + "_settimana_" + std::to_string(variant) + ".xlsx";
+        case 2: return std::string("ordini_") + id + ".txt";
+        default: return std::string("LOTTO_") + std::to_string(variant) + "_" + id + "_DEMAT_" + std::to_string(variant * 7) + ".xml";
+    }
+}
+
+int RunMatcherBenchmark(int filenames) {
+    std::cout << "Benchmark matcher multi-pattern - nomi file: " << filenames << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
     
-    while (!globalShutdown && !webServerShouldStop) {
-        SOCKET clientSocket = accept(serverSocket, NULL, NULL);
+    const int patternCounts[] = {10, 100, 1000};
+    for (int patterns : patternCounts) {
+        FolderPatternMatcher matcher;
+        std::vector<std::regex> regexes;
+        for (int i = 0; i < patterns; ++i) {
+            std::string pattern = BenchMatchPattern(i);
+            regexes.push_back(std::regex(pattern, std::regex_constants::icase));
+            if (!matcher.AddPattern(pattern, i)) matcher.fallbackPatterns.push_back(i);
+        }
         
-        if (clientSocket == INVALID_SOCKET) {
-            DWORD error = WSAGetLastError();
-            if (error == WSAEWOULDBLOCK || error == WSAETIMEDOUT) {
-                // CORREZIONE: Check più frequenti
-                Sleep(50);
-                continue;
-            } else {
-                WriteToLog("ERRORE: Accept fallito: " + std::to_string(error));
-                if (!globalShutdown && !webServerShouldStop) {
-                    systemMetrics.errorsCount++;
+        // Meta' dei nomi corrisponde a un pattern, meta' no
+        std::vector<std::string> names;
+        for (int n = 0; n < filenames; ++n) {
+            if (n % 2 == 0) names.push_back(BenchMatchFilename((n / 2) % patterns, n));
+            else names.push_back("scansione_" + std::to_string(n) + "_tmp.dat");
+        }
+        
+        // Storico: regex_match di ogni pattern della cartella per ogni nome
+        size_t legacyMatches = 0;
+        std::vector<std::vector<int>> expected(names.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < names.size(); ++n) {
+            for (int i = 0; i < patterns; ++i) {
+                if (std::regex_match(names[n], regexes[i])) {
+                    expected[n].push_back(i);
+                    legacyMatches++;
                 }
-                break;
             }
         }
+        double legacyUs = ElapsedMs(start) * 1000.0 / names.size();
         
-        if (globalShutdown || webServerShouldStop) {
-            closesocket(clientSocket);
-            break;
+        // Automa: il primo giro costruisce la cache DFA, il secondo la usa
+        size_t mismatches = 0;
+        std::vector<int> result;
+        start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < names.size(); ++n) {
+            result.clear();
+            matcher.MatchAutomaton(names[n], result);
+            if (result != expected[n]) mismatches++;
         }
+        double coldUs = ElapsedMs(start) * 1000.0 / names.size();
         
-        // CORREZIONE: Timeout più aggressivo anche per recv
-        timeout = 1000;
-        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
-        
-        char buffer[4096];
-        int bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        
-        if (bytesReceived > 0) {
-            buffer[bytesReceived] = '\0';
-            std::string request(buffer);
-            std::string response = HandleHttpRequest(request);
-            
-            // CORREZIONE: Timeout anche per send
-            timeout = 1000;
-            setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, sizeof(timeout));
-            send(clientSocket, response.c_str(), response.length(), 0);
+        size_t automatonMatches = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < names.size(); ++n) {
+            result.clear();
+            matcher.MatchAutomaton(names[n], result);
+            automatonMatches += result.size();
         }
+        double warmUs = ElapsedMs(start) * 1000.0 / names.size();
         
-        closesocket(clientSocket);
-        
-        // CORREZIONE: Check più frequenti
-        if (globalShutdown || webServerShouldStop) break;
+        std::cout << "Pattern: " << std::setw(4) << patterns
+                  << " | std::regex: " << legacyUs << " us/file"
+                  << " | automa: " << coldUs << " us/file (cache fredda), " << warmUs << " us/file (cache calda)"
+                  << " | speedup: " << (warmUs > 0 ? legacyUs / warmUs : 0.0) << "x"
+                  << " | stati DFA: " << matcher.dfa.size()
+                  << " | match: " << legacyMatches << "/" << automatonMatches
+                  << " | discrepanze: " << mismatches << std::endl;
     }
-    
-    webServerRunning = false;
-    closesocket(serverSocket);
-    WSACleanup();
-    WriteToLog("Web server terminato");
+    return 0;
 }
 
-DWORD WINAPI ServiceWorkerThread(LPVOID /*lpParam*/) {
-    WriteToLog("=== Servizio PatternTriggerCommand Multi-Folder v3.0 avviato ===");
+// Throughput dell'impronta del contenuto: XXH64 in memoria (contro FNV-1a byte per
+// byte) e da file con le letture sequenziali usate dalla deduplicazione
+int RunHashBenchmark(size_t megabytes) {
+    std::cout << "Benchmark impronta contenuto - dati: " << megabytes << " MB" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
     
-    if (!LoadConfiguration()) {
-        WriteToLog("ERRORE FATALE: Impossibile caricare configurazione");
-        return 1;
+    size_t bytes = megabytes * 1024 * 1024;
+    std::vector<char> data(bytes);
+    unsigned long long seed = 88172645463325252ULL;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        memcpy(&data[i], &seed, 8);
     }
     
-    std::string scriptsDir = "C:\\Scripts";
-    CreateDirectoryRecursive(scriptsDir);
+    auto start = std::chrono::steady_clock::now();
+    Xxh64 hasher;
+    hasher.Update(data.data(), bytes);
+    unsigned long long xxhDigest = hasher.Digest();
+    double xxhMs = ElapsedMs(start);
     
-    LoadProcessedFiles();
+    start = std::chrono::steady_clock::now();
+    unsigned long long fnv = 14695981039346656037ULL;
+    for (size_t i = 0; i < bytes; ++i) {
+        fnv ^= static_cast<unsigned char>(data[i]);
+        fnv *= 1099511628211ULL;
+    }
+    double fnvMs = ElapsedMs(start);
     
-    recentlyIgnoredFiles.clear();
+    std::string path = GetBenchmarkRoot("hash.dat");
+    HANDLE hFile = CreateFile(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    DWORD written = 0;
+    bool fileOk = hFile != INVALID_HANDLE_VALUE;
+    for (size_t offset = 0; fileOk && offset < bytes; offset += DEDUP_HASH_READ_SIZE) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(DEDUP_HASH_READ_SIZE, bytes - offset));
+        fileOk = WriteFile(hFile, &data[offset], chunk, &written, NULL) && written == chunk;
+    }
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
     
-    // Avvia thread aggiornamento metriche
-    std::thread metricsThread(MetricsUpdateWorker);
+    unsigned long long fileDigest = 0;
+    start = std::chrono::steady_clock::now();
+    fileOk = fileOk && HashFileContent(path, fileDigest);
+    double fileMs = ElapsedMs(start);
+    DeleteFile(path.c_str());
     
-    // Avvia web server se abilitato
-    if (webServerEnabled) {
-        webServerThread = std::thread(WebServerWorker);
+    double gigabytes = static_cast<double>(bytes) / 1e9;
+    std::cout << "XXH64 in memoria:        " << (xxhMs > 0 ? gigabytes * 1000.0 / xxhMs : 0.0) << " GB/s" << std::endl;
+    std::cout << "FNV-1a in memoria:       " << (fnvMs > 0 ? gigabytes * 1000.0 / fnvMs : 0.0) << " GB/s"
+              << " | impronta " << HexValue(fnv) << std::endl;
+    if (fileOk) {
+        std::cout << "XXH64 da file (cache):   " << (fileMs > 0 ? gigabytes * 1000.0 / fileMs : 0.0) << " GB/s"
+                  << " | impronte " << (fileDigest == xxhDigest ? "coincidenti" : "DIVERSE") << std::endl;
+    } else {
+        std::cout << "XXH64 da file: impossibile scrivere " << path << std::endl;
     }
+    return 0;
+}
 
-    // Carica e avvia schedulatore
-    LoadSchedulerTasks();
-    if (schedulerEnabled) {
-        schedulerThread = std::thread(SchedulerWorker);
-        WriteToLog("Schedulatore avviato con " + std::to_string(schedulerTasks.size()) + " task");
+// Escape carattere per carattere, com'era prima di JsonWriter: termine di paragone
+static std::string LegacyEscapeJsonString(const std::string& input) {
+    std::string escaped;
+    escaped.reserve(input.length() + 20);
+    for (char c : input) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\b': escaped += "\\b"; break;
+            case '\f': escaped += "\\f"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    escaped += "\\u00";
+                    escaped += "0123456789ABCDEF"[(c >> 4) & 0xF];
+                    escaped += "0123456789ABCDEF"[c & 0xF];
+                } else {
+                    escaped += c;
+                }
+                break;
+        }
     }
+    return escaped;
+}
 
-    StartAllFolderMonitors();
+struct BenchJsonRow {
+    std::string name;
+    std::string folder;
+    std::string regex;
+    std::string message;
+    size_t count;
+};
 
-    WriteToLog("Servizio in esecuzione, attesa terminazione...");
-    if (webServerEnabled) {
-        WriteToLog("Dashboard disponibile su: http://localhost:" + std::to_string(webServerPort));
+static std::string BenchJsonLegacyDocument(const std::vector<BenchJsonRow>& rows) {
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"rows\": " << rows.size() << ",\n";
+    json << "  \"patterns\": [\n";
+    bool first = true;
+    for (const auto& row : rows) {
+        if (!first) json << ",\n";
+        json << "    {\n";
+        json << "      \"name\": \"" << LegacyEscapeJsonString(row.name) << "\",\n";
+        json << "      \"folder\": \"" << LegacyEscapeJsonString(row.folder) << "\",\n";
+        json << "      \"regex\": \"" << LegacyEscapeJsonString(row.regex) << "\",\n";
+        json << "      \"message\": \"" << LegacyEscapeJsonString(row.message) << "\",\n";
+        json << "      \"matchCount\": " << row.count << "\n";
+        json << "    }";
+        first = false;
+    }
+    json << "\n  ]\n";
+    json << "}";
+    return json.str();
+}
+
+static std::string BenchJsonWriterDocument(const std::vector<BenchJsonRow>& rows) {
+    JsonWriter json(true, 64 + rows.size() * 320);
+    json.BeginObject();
+    json.Key("rows").UInt(rows.size());
+    json.Key("patterns").BeginArray();
+    for (const auto& row : rows) {
+        json.BeginObject();
+        json.Key("name").String(row.name);
+        json.Key("folder").String(row.folder);
+        json.Key("regex").String(row.regex);
+        json.Key("message").String(row.message);
+        json.Key("matchCount").UInt(row.count);
+        json.EndObject();
     }
+    json.EndArray();
+    json.EndObject();
+    return json.Take();
+}
+
+// Serializzazione di un documento simile a /api/metrics: ostringstream + escape per
+// carattere contro JsonWriter, in MB/s di JSON prodotto (l'uguaglianza dei due
+// documenti e l'escape su stringhe casuali sono verificati in tests/)
+int RunJsonBenchmark(size_t rowCount) {
+    std::cout << "Benchmark serializzazione JSON - righe: " << rowCount << std::endl;
+#if defined(__SSE2__)
+    std::cout << "Escape: ricerca SSE2 a 16 byte" << std::endl;
+#else
+    std::cout << "Escape: ricerca scalare" << std::endl;
+#endif
+    std::cout << std::fixed << std::setprecision(1);
     
-    DWORD lastCleanup = GetTickCount();
+    std::vector<BenchJsonRow> rows(rowCount);
+    for (size_t i = 0; i < rowCount; ++i) {
+        BenchJsonRow& row = rows[i];
+        row.name = "Fatture_Reparto_" + std::to_string(i % 97);
+        row.folder = "C:\\Dati\\Ingresso\\Reparto" + std::to_string(i % 13) + "\\Documenti ricevuti";
+        row.regex = "^Fattura_\\d{4}_[A-Z]{2}_.*\\.(pdf|xml)$";
+        row.message = "[2024-05-17 10:32:" + std::to_string(10 + i % 50) + "] File processato: fattura_" + std::to_string(i) +
+                      "_cliente_con_nome_molto_lungo_per_la_verifica.pdf - comando completato senza errori";
+        if (i % 10 == 0) row.message += " \"citazione\" citt\xe0\ttab";
+        row.count = i * 7;
+    }
     
-    while (!globalShutdown) {
-        if (WaitForSingleObject(stopEvent, 5000) == WAIT_OBJECT_0) {
-            break;
+    std::string written = BenchJsonWriterDocument(rows);
+    
+    const double minimumMs = 500.0;
+    size_t iterations = 0;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        bytes += BenchJsonLegacyDocument(rows).size();
+        iterations++;
+    } while (ElapsedMs(start) < minimumMs);
+    double legacyMBs = bytes / 1048576.0 / (ElapsedMs(start) / 1000.0);
+    
+    bytes = 0;
+    start = std::chrono::steady_clock::now();
+    do {
+        bytes += BenchJsonWriterDocument(rows).size();
+    } while (ElapsedMs(start) < minimumMs);
+    double writerMBs = bytes / 1048576.0 / (ElapsedMs(start) / 1000.0);
+    
+    // Solo escape, sulle stringhe dei messaggi
+    size_t messageBytes = 0;
+    for (const auto& row : rows) messageBytes += row.message.size();
+    bytes = 0;
+    start = std::chrono::steady_clock::now();
+    do {
+        for (const auto& row : rows) bytes += LegacyEscapeJsonString(row.message).size() > 0 ? row.message.size() : 0;
+    } while (ElapsedMs(start) < minimumMs);
+    double legacyEscapeMBs = bytes / 1048576.0 / (ElapsedMs(start) / 1000.0);
+    
+    bytes = 0;
+    std::string escaped;
+    start = std::chrono::steady_clock::now();
+    do {
+        for (const auto& row : rows) {
+            escaped.clear();
+            JsonWriter::AppendEscaped(escaped, row.message.data(), row.message.size());
+            bytes += row.message.size();
         }
-        
-        int activeMonitors = 0;
-        for (const auto& monitorPair : folderMonitors) {
-            if (monitorPair.second->active) activeMonitors++;
+    } while (ElapsedMs(start) < minimumMs);
+    double writerEscapeMBs = bytes / 1048576.0 / (ElapsedMs(start) / 1000.0);
+    
+    std::cout << "Documento: " << written.size() << " byte, " << iterations << " serializzazioni ostringstream" << std::endl;
+    std::cout << "ostringstream + escape per carattere: " << legacyMBs << " MB/s" << std::endl;
+    std::cout << "JsonWriter:                           " << writerMBs << " MB/s"
+              << " | speedup: " << (legacyMBs > 0 ? writerMBs / legacyMBs : 0.0) << "x" << std::endl;
+    std::cout << "Solo escape (" << messageBytes / 1024 << " KB di messaggi): per carattere " << legacyEscapeMBs
+              << " MB/s, JsonWriter " << writerEscapeMBs << " MB/s" << std::endl;
+    return 0;
+}
+
+static std::vector<std::string> BenchHttpSampleRequests() {
+    std::string json = "{\"name\": \"backup\", \"originalName\": \"\", \"days\": \"Lu,Ma,Me\", "
+                       "\"hours\": \"2\", \"minutes\": \"30\", \"command\": \"C:\\\\Scripts\\\\backup.bat\", "
+                       "\"enabled\": \"true\", \"intervalSeconds\": \"0\"}";
+    std::vector<std::string> samples;
+    samples.push_back("GET /api/metrics HTTP/1.1\r\n"
+                      "Host: localhost:8080\r\n"
+                      "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36\r\n"
+                      "Accept: application/json, text/plain, */*\r\n"
+                      "Accept-Language: it-IT,it;q=0.9,en;q=0.8\r\n"
+                      "Accept-Encoding: gzip, deflate, br\r\n"
+                      "Referer: http://localhost:8080/\r\n"
+                      "Connection: keep-alive\r\n\r\n");
+    samples.push_back("POST /api/scheduler/save HTTP/1.1\r\n"
+                      "Host: localhost:8080\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length: " + std::to_string(json.length()) + "\r\n\r\n" + json);
+    samples.push_back("GET /scheduler?tab=storico HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n");
+    return samples;
+}
+
+// Throughput del parser su richieste in pipeline, intere e consegnate a pezzi
+// da 16 byte (le verifiche di correttezza sono in tests/, target "make test")
+int RunHttpParserBenchmark(size_t requests) {
+    std::vector<std::string> samples = BenchHttpSampleRequests();
+    std::string pipeline;
+    size_t pipelineRequests = 0;
+    while (pipelineRequests < 3000) {
+        pipeline += samples[pipelineRequests % samples.size()];
+        pipelineRequests++;
+    }
+    
+    std::cout << "Benchmark parser HTTP - richieste: " << requests 
+              << ", byte medi per richiesta: " << pipeline.size() / pipelineRequests << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    
+    HttpRequestParser parser;
+    HttpRequest request;
+    size_t parsed = 0, bytes = 0, routed = 0;
+    const std::unordered_map<std::string, HttpHandler>& routes = GetHttpRoutes();
+    std::string key;
+    auto start = std::chrono::steady_clock::now();
+    while (parsed < requests) {
+        size_t consumed = 0;
+        while (consumed < pipeline.size() &&
+               parser.Parse(pipeline.data() + consumed, pipeline.size() - consumed, request) == HttpRequestParser::Complete) {
+            key.assign(request.method.data, request.method.size);
+            key += ' ';
+            key.append(request.path.data, request.path.size);
+            if (routes.find(key) != routes.end()) routed++;
+            consumed += parser.MessageLength();
+            parser.Reset();
+            parsed++;
         }
-        WriteToLog("Monitor attivi: " + std::to_string(activeMonitors), true);
-        
-        if (GetTickCount() - lastCleanup > CACHE_CLEANUP_INTERVAL) {
-            recentlyIgnoredFiles.clear();
-            lastCleanup = GetTickCount();
-            WriteToLog("Pulizia cache file ignorati", true);
+        bytes += consumed;
+    }
+    double wholeMs = ElapsedMs(start);
+    std::cout << "Buffer intero + rotta:   " << (wholeMs > 0 ? parsed * 1000.0 / wholeMs : 0.0) << " richieste/s, "
+              << (wholeMs > 0 ? bytes / 1e3 / wholeMs : 0.0) << " MB/s, "
+              << (parsed > 0 ? wholeMs * 1e6 / parsed : 0.0) << " ns/richiesta"
+              << (routed == parsed ? "" : " (rotte mancanti!)") << std::endl;
+    
+    // A pezzi da 16 byte: la ricerca della fine intestazioni riprende da dove si era fermata
+    size_t incrementalParsed = 0;
+    size_t target = std::max<size_t>(requests / 10, 1);
+    start = std::chrono::steady_clock::now();
+    while (incrementalParsed < target) {
+        for (const auto& sample : samples) {
+            parser.Reset();
+            size_t available = 0;
+            HttpRequestParser::Result result = HttpRequestParser::NeedMore;
+            while (result == HttpRequestParser::NeedMore && available < sample.size()) {
+                available = std::min(available + 16, sample.size());
+                result = parser.Parse(sample.data(), available, request);
+            }
+            incrementalParsed++;
         }
     }
+    double incrementalMs = ElapsedMs(start);
+    std::cout << "Consegna a pezzi da 16B: " << (incrementalMs > 0 ? incrementalParsed * 1000.0 / incrementalMs : 0.0)
+              << " richieste/s" << std::endl;
+    return routed == parsed ? 0 : 1;
+}
+
+// Motore dello schedulatore su task sintetici: costruzione della coda (calcolo della
+// prossima esecuzione per ogni task), una giornata simulata con verifica dei minuti
+// scelti contro un conteggio minuto per minuto, e precisione reale dei risvegli
+int RunSchedulerBenchmark(size_t taskCount) {
+    std::cout << "Benchmark schedulatore - task: " << taskCount << " (70% giorno/ora/minuto, 30% intervallo)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
     
-    WriteToLog("Terminazione richiesta, cleanup in corso...");
+    unsigned long long seed = 88172645463325252ULL;
+    auto next = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
     
-    // CORREZIONE: Arresto MOLTO più aggressivo con timeout brevi
+    auto steadyNow = std::chrono::steady_clock::now();
+    auto wallNow = std::chrono::system_clock::now();
+    std::vector<SchedulerTask> tasks(taskCount);
+    for (size_t i = 0; i < taskCount; ++i) {
+        SchedulerTask& task = tasks[i];
+        task.name = "task" + std::to_string(i);
+        task.command = "rem";
+        task.lastIntervalRun = steadyNow;
+        if (i % 10 < 3) {
+            task.intervalSeconds = static_cast<int>(60 + next() % 3600);
+            continue;
+        }
+        for (int d = 0; d < 7; ++d) if (next() % 2) task.days.insert(d);
+        if (task.days.empty()) task.days.insert(static_cast<int>(next() % 7));
+        for (int n = static_cast<int>(1 + next() % 3); n > 0; --n) task.hours.insert(static_cast<int>(next() % 24));
+        for (int n = static_cast<int>(1 + next() % 4); n > 0; --n) task.minutes.insert(static_cast<int>(next() % 60));
+    }
     
-    // 1. Ferma web server per primo (TIMEOUT: 2 secondi)
-    if (webServerEnabled) {
-        webServerShouldStop = true;
-        WriteToLog("Arresto web server...");
-        
-        auto webStartTime = GetTickCount();
-        bool webStopped = false;
-        
-        while (GetTickCount() - webStartTime < 2000 && !webStopped) {
-            if (!webServerRunning) {
-                webStopped = true;
-            } else {
-                Sleep(100);
-            }
+    SchedulerQueue queue;
+    auto start = std::chrono::steady_clock::now();
+    queue.Rebuild(tasks, steadyNow, wallNow);
+    double buildMs = ElapsedMs(start);
+    std::cout << "Costruzione coda: " << buildMs << " ms (" << (taskCount > 0 ? buildMs * 1000.0 / taskCount : 0.0)
+              << " us/task), scadenze in coda: " << queue.Size() << std::endl;
+    
+    // Giornata simulata: il tempo avanza di scadenza in scadenza, senza attese
+    auto horizon = steadyNow + std::chrono::hours(24);
+    std::vector<size_t> fires(taskCount, 0);
+    size_t totalFires = 0, mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    while (!queue.Empty() && queue.Top().due <= horizon) {
+        SchedulerDeadline deadline = queue.Pop();
+        SchedulerTask& task = tasks[deadline.task];
+        fires[deadline.task]++;
+        totalFires++;
+        if (task.intervalSeconds > 0) {
+            deadline.due += std::chrono::seconds(task.intervalSeconds);
+            queue.Push(deadline);
+            continue;
         }
-        
-        if (webServerThread.joinable()) {
-            if (webStopped) {
-                try {
-                    webServerThread.join();
-                    WriteToLog("Web server arrestato correttamente");
-                } catch (...) {
-                    WriteToLog("ERRORE join web server - detach forzato");
-                    webServerThread.detach();
-                }
-            } else {
-                WriteToLog("TIMEOUT web server - detach forzato");
-                webServerThread.detach();
-            }
+        const struct tm* local = localtime(&deadline.wallTime);
+        if (local == NULL || !task.days.count(local->tm_wday) || !task.hours.count(local->tm_hour) ||
+            !task.minutes.count(local->tm_min) || local->tm_sec != 0 || deadline.wallTime <= task.lastFiredTime) {
+            mismatches++;
         }
+        task.lastFiredTime = deadline.wallTime;
+        deadline.wallTime = SchedulerQueue::NextCalendarFire(task, deadline.wallTime + 60);
+        if (deadline.wallTime == static_cast<time_t>(-1)) continue;
+        deadline.due = SchedulerQueue::DueFromWall(deadline.wallTime, steadyNow, wallNow);
+        queue.Push(deadline);
     }
+    double simulatedMs = ElapsedMs(start);
     
-    // 2. Ferma schedulatore - globalShutdown gia' impostato, lo sleep frazionato lo sblocca in <100ms
-    if (schedulerThread.joinable()) {
-        WriteToLog("Arresto thread schedulatore...");
-        try {
-            schedulerThread.join();
-            WriteToLog("Thread schedulatore arrestato");
-        } catch (...) {
-            WriteToLog("ERRORE join schedulatore - detach forzato");
-            schedulerThread.detach();
+    // Conteggio di riferimento minuto per minuto su un campione di task di calendario
+    time_t firstMinute = SchedulerQueue::CurrentMinute(wallNow);
+    time_t lastMinute = std::chrono::system_clock::to_time_t(wallNow + std::chrono::hours(24));
+    size_t sampled = 0;
+    for (size_t i = 0; i < taskCount && sampled < 100; ++i) {
+        const SchedulerTask& task = tasks[i];
+        if (task.intervalSeconds > 0) continue;
+        size_t expected = 0;
+        for (time_t minute = firstMinute; minute <= lastMinute; minute += 60) {
+            const struct tm* local = localtime(&minute);
+            if (local != NULL && task.days.count(local->tm_wday) && task.hours.count(local->tm_hour) &&
+                task.minutes.count(local->tm_min)) {
+                expected++;
+            }
         }
+        if (expected != fires[i]) mismatches++;
+        sampled++;
     }
-
-    // 3. Ferma monitor cartelle
-    WriteToLog("Arresto monitor cartelle...");
-    StopAllFolderMonitors();
-
-    // 4. Ferma thread metriche - globalShutdown gia' impostato, lo sleep frazionato lo sblocca in <100ms
-    if (metricsThread.joinable()) {
-        WriteToLog("Arresto thread metriche...");
-        try {
-            metricsThread.join();
-            WriteToLog("Thread metriche arrestato");
-        } catch (...) {
-            WriteToLog("ERRORE join metriche - detach forzato");
-            metricsThread.detach();
-        }
+    
+    std::cout << "Giornata simulata: " << totalFires << " esecuzioni in " << simulatedMs << " ms ("
+              << (totalFires > 0 ? simulatedMs * 1e6 / totalFires : 0.0) << " ns/esecuzione)" << std::endl;
+    std::cout << "Verifiche: minuti scelti e conteggi di " << sampled << " task contro la scansione minuto per minuto, "
+              << mismatches << " discordanze" << std::endl;
+    
+    // Precisione reale: task a intervallo di 1 s sfalsati di 5 ms, attesa con wait_until
+    // come nel thread dello schedulatore
+    size_t liveCount = std::min<size_t>(std::max<size_t>(taskCount, 1), 200);
+    std::vector<SchedulerTask> live(liveCount);
+    auto liveStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < liveCount; ++i) {
+        live[i].intervalSeconds = 1;
+        live[i].lastIntervalRun = liveStart - std::chrono::milliseconds(900) + std::chrono::milliseconds(5 * (i % 200));
     }
+    SchedulerQueue liveQueue;
+    liveQueue.Rebuild(live, liveStart, std::chrono::system_clock::now());
     
-    SaveProcessedFiles();
+    std::mutex liveMutex;
+    std::condition_variable liveCondition;
+    std::vector<double> lateness;
+    size_t wakeUps = 0;
+    std::unique_lock<std::mutex> lock(liveMutex);
+    while (ElapsedMs(liveStart) < 3000.0) {
+        auto now = std::chrono::steady_clock::now();
+        while (!liveQueue.Empty() && liveQueue.Top().due <= now) {
+            SchedulerDeadline deadline = liveQueue.Pop();
+            lateness.push_back(std::chrono::duration<double, std::milli>(now - deadline.due).count());
+            deadline.due += std::chrono::seconds(1);
+            liveQueue.Push(deadline);
+        }
+        wakeUps++;
+        liveCondition.wait_until(lock, liveQueue.Top().due);
+    }
+    lock.unlock();
     
-    WriteToLog("=== Servizio PatternTriggerCommand terminato ===");
-    return 0;
+    std::sort(lateness.begin(), lateness.end());
+    double p50 = lateness.empty() ? 0.0 : lateness[lateness.size() / 2];
+    double p99 = lateness.empty() ? 0.0 : lateness[std::min(lateness.size() - 1, lateness.size() * 99 / 100)];
+    double worst = lateness.empty() ? 0.0 : lateness.back();
+    std::cout << "Risvegli reali (" << liveCount << " task, 3 s): " << lateness.size() << " esecuzioni, " << wakeUps
+              << " risvegli, ritardo p50 " << p50 << " ms, p99 " << p99 << " ms, max " << worst << " ms" << std::endl;
+    return mismatches == 0 ? 0 : 1;
 }
 
-void WINAPI ServiceCtrlHandler(DWORD ctrlCode) {
-    switch (ctrlCode) {
-        case SERVICE_CONTROL_STOP:
-        case SERVICE_CONTROL_SHUTDOWN:
-            WriteToLog("Richiesta arresto servizio ricevuta");
-            
-            serviceStatus.dwControlsAccepted = 0;
-            serviceStatus.dwCurrentState = SERVICE_STOP_PENDING;
-            serviceStatus.dwWin32ExitCode = 0;
-            serviceStatus.dwCheckPoint = 1;
-            serviceStatus.dwWaitHint = 5000; // CORREZIONE: Ridotto da 8 a 5 secondi
-            
-            SetServiceStatus(serviceStatusHandle, &serviceStatus);
-            
-            // CORREZIONE: Arresto immediato e aggressivo
-            globalShutdown = true;
-            webServerShouldStop = true;
-            
-            if (stopEvent) {
-                SetEvent(stopEvent);
-            }
-            
-            // CORREZIONE: Forza chiusura handle directory per sbloccare ReadDirectoryChangesW
-            for (auto& monitorPair : folderMonitors) {
-                if (monitorPair.second->directoryHandle != INVALID_HANDLE_VALUE) {
-                    CloseHandle(monitorPair.second->directoryHandle);
-                    monitorPair.second->directoryHandle = INVALID_HANDLE_VALUE;
-                }
+// Estrazione per chiave com'era prima di JsonDocument: termine di paragone
+static std::string LegacyExtractJsonValue(const std::string& json, const std::string& key) {
+    std::string searchKey = "\"" + key + "\"";
+    size_t keyPos = json.find(searchKey);
+    if (keyPos == std::string::npos) return "";
+    size_t colonPos = json.find(':', keyPos + searchKey.length());
+    if (colonPos == std::string::npos) return "";
+    size_t valueStart = json.find_first_not_of(" \t\n\r", colonPos + 1);
+    if (valueStart == std::string::npos) return "";
+    if (json[valueStart] == '"') {
+        std::string result;
+        for (size_t i = valueStart + 1; i < json.length(); ++i) {
+            if (json[i] == '\\' && i + 1 < json.length()) {
+                result += json[i + 1];
+                ++i;
+            } else if (json[i] == '"') {
+                break;
+            } else {
+                result += json[i];
             }
-            
-            break;
-            
-        default:
-            break;
+        }
+        return result;
     }
+    size_t valueEnd = json.find_first_of(",} \t\n\r", valueStart);
+    if (valueEnd == std::string::npos) return json.substr(valueStart);
+    return json.substr(valueStart, valueEnd - valueStart);
 }
 
-void WINAPI ServiceMain(DWORD /*argc*/, LPTSTR* /*argv*/) {
-    serviceStatusHandle = RegisterServiceCtrlHandler(SERVICE_NAME, ServiceCtrlHandler);
+// Corpo di /api/scheduler/save: estrazione per chiave (una scansione per campo)
+// contro una passata di JsonDocument (le verifiche sono in tests/, target "make test")
+int RunJsonParserBenchmark(size_t documents) {
+    const char* fields[] = {"name", "originalName", "days", "hours", "minutes", "command", "enabled", "intervalSeconds"};
+    std::string body = "{\"originalName\": \"backup notturno\", \"name\": \"backup notturno\", "
+                       "\"days\": \"Lu,Ma,Me,Gi,Ve\", \"hours\": \"2,14\", \"minutes\": \"0,30\", "
+                       "\"command\": \"C:\\\\Scripts\\\\backup.bat --dest \\\"\\\\\\\\nas\\\\copie\\\"\", "
+                       "\"enabled\": \"true\", \"intervalSeconds\": \"0\"}";
+    std::cout << "Benchmark parser JSON - documenti: " << documents << ", byte per documento: " << body.size() << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
     
-    if (serviceStatusHandle == NULL) {
-        WriteToLog("RegisterServiceCtrlHandler fallito");
-        return;
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < documents; ++n) {
+        for (const char* field : fields) checksum += LegacyExtractJsonValue(body, field).size();
     }
+    double legacyMs = ElapsedMs(start);
     
-    ZeroMemory(&serviceStatus, sizeof(serviceStatus));
-    serviceStatus.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
-    serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN;
-    serviceStatus.dwCurrentState = SERVICE_START_PENDING;
-    serviceStatus.dwWin32ExitCode = 0;
-    serviceStatus.dwServiceSpecificExitCode = 0;
-    serviceStatus.dwCheckPoint = 0;
-    serviceStatus.dwWaitHint = 0;
+    JsonDocument document;
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < documents; ++n) {
+        if (!document.Parse(body.data(), body.size())) break;
+        for (const char* field : fields) checksum -= document.Text(document.Root(), field).size();
+    }
+    double documentMs = ElapsedMs(start);
     
-    SetServiceStatus(serviceStatusHandle, &serviceStatus);
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < documents; ++n) document.Parse(body.data(), body.size());
+    double parseOnlyMs = ElapsedMs(start);
     
-    stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (stopEvent == NULL) {
-        WriteToLog("CreateEvent fallito");
-        serviceStatus.dwCurrentState = SERVICE_STOPPED;
-        serviceStatus.dwWin32ExitCode = GetLastError();
-        SetServiceStatus(serviceStatusHandle, &serviceStatus);
-        return;
-    }
+    double megabytes = static_cast<double>(body.size()) * documents / 1048576.0;
+    std::cout << "Estrazione per chiave:  " << (legacyMs > 0 ? documents * 1000.0 / legacyMs : 0.0) << " documenti/s, "
+              << (legacyMs > 0 ? megabytes * 1000.0 / legacyMs : 0.0) << " MB/s" << std::endl;
+    std::cout << "JsonDocument + campi:   " << (documentMs > 0 ? documents * 1000.0 / documentMs : 0.0) << " documenti/s, "
+              << (documentMs > 0 ? megabytes * 1000.0 / documentMs : 0.0) << " MB/s" << std::endl;
+    std::cout << "Solo parsing:           " << (parseOnlyMs > 0 ? documents * 1000.0 / parseOnlyMs : 0.0) << " documenti/s, "
+              << (parseOnlyMs > 0 ? megabytes * 1000.0 / parseOnlyMs : 0.0) << " MB/s" << std::endl;
+    // Il comando contiene \" e \\: l'estrazione per chiave li decodifica allo stesso modo,
+    // quindi le lunghezze devono coincidere
+    if (checksum != 0) std::cout << "ATTENZIONE: valori estratti diversi tra i due metodi" << std::endl;
+    return checksum == 0 ? 0 : 1;
+}
+
+// Lunghezza della prima risposta completa nel buffer (intestazioni + corpo secondo
+// Content-Length), 0 se mancano ancora dati
+static size_t BenchHttpResponseLength(const std::string& buffer) {
+    size_t headerEnd = buffer.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) return 0;
     
-    HANDLE hThread = CreateThread(NULL, 0, ServiceWorkerThread, NULL, 0, NULL);
-    if (hThread == NULL) {
-        WriteToLog("CreateThread fallito");
-        serviceStatus.dwCurrentState = SERVICE_STOPPED;
-        serviceStatus.dwWin32ExitCode = GetLastError();
-        SetServiceStatus(serviceStatusHandle, &serviceStatus);
-        return;
+    size_t bodyLength = 0;
+    size_t lengthPos = buffer.find("Content-Length:");
+    if (lengthPos != std::string::npos && lengthPos < headerEnd) {
+        bodyLength = static_cast<size_t>(std::strtoull(buffer.c_str() + lengthPos + 15, NULL, 10));
     }
+    if (buffer.size() - (headerEnd + 4) < bodyLength) return 0;
+    return headerEnd + 4 + bodyLength;
+}
+
+static SOCKET BenchHttpConnect(u_short port) {
+    SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+    BOOL noDelay = TRUE;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char*)&noDelay, sizeof(noDelay));
+    DWORD timeout = 5000;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
     
-    serviceStatus.dwCurrentState = SERVICE_RUNNING;
-    serviceStatus.dwCheckPoint = 0;
-    serviceStatus.dwWaitHint = 0;
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+// Invia una richiesta e attende la risposta completa secondo Content-Length
+static bool BenchHttpExchange(SOCKET s, const std::string& request, std::string& response) {
+    size_t sent = 0;
+    while (sent < request.size()) {
+        int n = send(s, request.data() + sent, static_cast<int>(request.size() - sent), 0);
+        if (n == SOCKET_ERROR) return false;
+        sent += n;
+    }
     
-    SetServiceStatus(serviceStatusHandle, &serviceStatus);
+    response.clear();
+    char buffer[HTTP_IO_CHUNK];
+    while (BenchHttpResponseLength(response) == 0) {
+        int received = recv(s, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        response.append(buffer, received);
+    }
+    return response.compare(0, 12, "HTTP/1.1 200") == 0;
+}
+
+// Richieste/secondo e latenze del web server con client concorrenti sulla loopback:
+// connessioni keep-alive contro una connessione nuova per ogni richiesta
+int RunHttpBenchmark(int connections, int requestsPerConnection, const std::string& path) {
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup fallito" << std::endl;
+        return 1;
+    }
     
-    WriteToLog("Servizio avviato e registrato");
+    SOCKET serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    serverAddr.sin_port = 0;
+    int addrLength = sizeof(serverAddr);
+    if (serverSocket == INVALID_SOCKET ||
+        bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR ||
+        listen(serverSocket, SOMAXCONN) == SOCKET_ERROR ||
+        getsockname(serverSocket, (sockaddr*)&serverAddr, &addrLength) == SOCKET_ERROR) {
+        std::cerr << "Impossibile aprire il socket di ascolto: " << WSAGetLastError() << std::endl;
+        if (serverSocket != INVALID_SOCKET) closesocket(serverSocket);
+        WSACleanup();
+        return 1;
+    }
+    u_long mode = 1;
+    ioctlsocket(serverSocket, FIONBIO, &mode);
+    u_short port = ntohs(serverAddr.sin_port);
     
-    WaitForSingleObject(hThread, INFINITE);
+    std::atomic<bool> stopServer{false};
+    std::thread server(ServeHttpConnections, serverSocket, std::cref(stopServer));
     
-    CloseHandle(hThread);
-    CloseHandle(stopEvent);
+    std::cout << "Benchmark web server - connessioni: " << connections 
+              << ", richieste per connessione: " << requestsPerConnection 
+              << ", percorso: " << path << std::endl;
+    std::cout << "Modalita'\t\tRichieste\tErrori\tRichieste/s\tp50(ms)\tp99(ms)" << std::endl;
     
-    serviceStatus.dwCurrentState = SERVICE_STOPPED;
-    serviceStatus.dwCheckPoint = 0;
-    serviceStatus.dwWaitHint = 0;
+    for (int keepAlive = 1; keepAlive >= 0; --keepAlive) {
+        std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" +
+                              (keepAlive ? "" : "Connection: close\r\n") + "\r\n";
+        std::vector<std::vector<double>> latencies(connections);
+        std::atomic<size_t> failures{0};
+        std::vector<std::thread> clients;
+        
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < connections; ++c) {
+            clients.push_back(std::thread([&, c]() {
+                std::string response;
+                SOCKET s = keepAlive ? BenchHttpConnect(port) : INVALID_SOCKET;
+                for (int r = 0; r < requestsPerConnection; ++r) {
+                    auto requestStart = std::chrono::steady_clock::now();
+                    if (!keepAlive || s == INVALID_SOCKET) {
+                        if (s != INVALID_SOCKET) closesocket(s);
+                        s = BenchHttpConnect(port);
+                    }
+                    if (s == INVALID_SOCKET || !BenchHttpExchange(s, request, response)) {
+                        failures++;
+                        if (s != INVALID_SOCKET) closesocket(s);
+                        s = INVALID_SOCKET;
+                        continue;
+                    }
+                    latencies[c].push_back(ElapsedMs(requestStart));
+                }
+                if (s != INVALID_SOCKET) closesocket(s);
+            }));
+        }
+        for (auto& client : clients) client.join();
+        double elapsed = ElapsedMs(start);
+        
+        std::vector<double> all;
+        for (const auto& perClient : latencies) all.insert(all.end(), perClient.begin(), perClient.end());
+        std::sort(all.begin(), all.end());
+        double p50 = all.empty() ? 0.0 : all[all.size() / 2];
+        double p99 = all.empty() ? 0.0 : all[std::min(all.size() - 1, all.size() * 99 / 100)];
+        
+        std::cout << (keepAlive ? "keep-alive\t\t" : "connessione/richiesta\t") << all.size() << "\t\t" 
+                  << failures.load() << "\t" << std::fixed << std::setprecision(1)
+                  << (elapsed > 0 ? all.size() * 1000.0 / elapsed : 0.0) << "\t\t" 
+                  << std::setprecision(3) << p50 << "\t" << p99 << std::endl;
+    }
     
-    SetServiceStatus(serviceStatusHandle, &serviceStatus);
-    WriteToLog("Servizio terminato");
+    stopServer = true;
+    server.join();
+    closesocket(serverSocket);
+    WSACleanup();
+    return 0;
 }
 
-BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType) {
-    if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT) {
-        std::cout << "\nInterruzione richiesta, attendere..." << std::endl;
-        globalShutdown = true;
-        webServerShouldStop = true;
+// Memoria privata del processo, per misurare il costo per voce delle strutture
+static size_t ProcessPrivateBytes() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PagefileUsage;
+    return 0;
+}
 
-        // Chiudi handle directory per sbloccare ReadDirectoryChangesW
-        for (auto& monitorPair : folderMonitors) {
-            if (monitorPair.second->directoryHandle != INVALID_HANDLE_VALUE) {
-                CloseHandle(monitorPair.second->directoryHandle);
-                monitorPair.second->directoryHandle = INVALID_HANDLE_VALUE;
-            }
-        }
+static std::string BenchIndexPath(size_t n) {
+    return "C:\\Dati\\Ingresso\\lotto_" + std::to_string(n % 1000) + "\\documento_" + std::to_string(n) + ".pdf";
+}
 
-        if (stopEvent) {
-            SetEvent(stopEvent);
+int RunProcessedIndexBenchmark(const std::vector<size_t>& sizes) {
+    std::cout << "Benchmark indice file processati" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    
+    const size_t lookups = 1000000;
+    for (size_t entries : sizes) {
+        std::vector<std::string> hits, misses;
+        hits.reserve(lookups);
+        misses.reserve(lookups);
+        uint64_t seed = 42;
+        for (size_t i = 0; i < lookups; ++i) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            size_t n = static_cast<size_t>(seed >> 33) % entries;
+            hits.push_back(BenchIndexPath(n));
+            misses.push_back(BenchIndexPath(entries + n));
         }
-        return TRUE;
+        
+        double setBytes = 0, setHitNs = 0, setMissNs = 0;
+        {
+            size_t before = ProcessPrivateBytes();
+            std::set<std::string> legacy;
+            for (size_t n = 0; n < entries; ++n) legacy.insert(BenchIndexPath(n));
+            setBytes = static_cast<double>(ProcessPrivateBytes() - before) / entries;
+            
+            size_t found = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& path : hits) found += legacy.count(path);
+            setHitNs = ElapsedMs(start) * 1000000.0 / lookups;
+            start = std::chrono::steady_clock::now();
+            for (const auto& path : misses) found += legacy.count(path);
+            setMissNs = ElapsedMs(start) * 1000000.0 / lookups;
+            if (found != lookups) std::cout << "  std::set: risultati inattesi (" << found << ")" << std::endl;
+        }
+        
+        size_t before = ProcessPrivateBytes();
+        ProcessedFileIndex index;
+        index.Reserve(entries);
+        for (size_t n = 0; n < entries; ++n) index.Insert(BenchIndexPath(n));
+        double indexBytes = static_cast<double>(ProcessPrivateBytes() - before) / entries;
+        
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& path : hits) found += index.Contains(path) ? 1 : 0;
+        double indexHitNs = ElapsedMs(start) * 1000000.0 / lookups;
+        start = std::chrono::steady_clock::now();
+        for (const auto& path : misses) found += index.Contains(path) ? 1 : 0;
+        double indexMissNs = ElapsedMs(start) * 1000000.0 / lookups;
+        if (found != lookups) std::cout << "  indice: risultati inattesi (" << found << ")" << std::endl;
+        
+        std::cout << "Voci: " << std::setw(9) << entries
+                  << " | std::set: " << setBytes << " B/voce, " << setHitNs << " ns (trovato), " << setMissNs << " ns (assente)"
+                  << " | indice: " << indexBytes << " B/voce (" << static_cast<double>(index.MemoryUsage()) / entries << " stimati), "
+                  << indexHitNs << " ns (trovato), " << indexMissNs << " ns (assente)" << std::endl;
     }
-    return FALSE;
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -2782,7 +9911,7 @@ int main(int argc, char* argv[]) {
             LoadProcessedFiles();
             
             std::cout << "=== Status PatternTriggerCommand v3.0 ===" << std::endl;
-            std::cout << "File processati: " << processedFiles.size() << std::endl;
+            std::cout << "File processati: " << processedFiles.Size() << std::endl;
             
             SC_HANDLE schSCManager = OpenSCManager(NULL, NULL, SC_MANAGER_CONNECT);
             if (schSCManager) {
@@ -2837,6 +9966,11 @@ int main(int argc, char* argv[]) {
             std::ofstream file(processedFilesDb.c_str(), std::ios::trunc);
             if (file.is_open()) {
                 file.close();
+                DeleteFile(ProcessedJournalPath().c_str());
+                DeleteFile(ProcessedJournalOldPath().c_str());
+                DeleteFile(ProcessedImagePath().c_str());
+                // Le istantanee presuppongono i file processati: vanno rifatte da zero
+                DeleteAllFolderSnapshots();
                 std::cout << "Database reset completato." << std::endl;
                 WriteToLog("Database reset");
             } else {
@@ -2860,17 +9994,18 @@ int main(int argc, char* argv[]) {
             if (FileExists(fullPath)) {
                 LoadProcessedFiles();
                 
-                {
-                    std::lock_guard<std::mutex> lock(processedFilesMutex);
-                    processedFiles.erase(fullPath);
-                }
-                SaveProcessedFiles();
+                UnmarkFileAsProcessed(fullPath);
                 
                 std::vector<int> matchingPatterns = FindMatchingPatterns(filename, folderPath);
                 if (!matchingPatterns.empty()) {
                     for (int patternIndex : matchingPatterns) {
-                        ExecuteCommand(patternCommandPairs[patternIndex].command, 
-                                     fullPath, patternCommandPairs[patternIndex].patternName);
+                        const PatternCommandPair& pair = patternCommandPairs[patternIndex];
+                        if (pair.builtinAction != PatternCommandPair::BuiltinNone) {
+                            bool fileRemains = false;
+                            ExecuteBuiltinAction(pair, fullPath, fileRemains);
+                        } else {
+                            ExecuteCommand(pair.command, fullPath, pair.patternName);
+                        }
                     }
                     std::cout << "File riprocessato: " << fullPath << std::endl;
                 } else {
@@ -2880,6 +10015,82 @@ int main(int argc, char* argv[]) {
                 std::cerr << "File non trovato: " << fullPath << std::endl;
             }
         }
+        else if (command == "bench-watcher") {
+            LoadConfiguration();
+            int maxFolders = argc > 2 ? std::atoi(argv[2]) : 256;
+            int filesPerFolder = argc > 3 ? std::atoi(argv[3]) : 20;
+            return RunWatcherBenchmark(maxFolders > 0 ? maxFolders : 256, filesPerFolder > 0 ? filesPerFolder : 20);
+        }
+        else if (command == "convert-db") {
+            LoadConfiguration();
+            if (FileExists(ProcessedImagePath()) && !FileExists(processedFilesDb)) {
+                std::cout << "Database gia' in formato binario: " << ProcessedImagePath() << std::endl;
+            } else if (ConvertProcessedTextDb()) {
+                std::cout << "Database convertito: " << ProcessedImagePath() << std::endl;
+            } else {
+                std::cerr << "Conversione database fallita (vedi log)." << std::endl;
+                return 1;
+            }
+        }
+        else if (command == "db-stats") {
+            LoadConfiguration();
+            return ShowProcessedDbStats();
+        }
+        else if (command == "bench-db") {
+            LoadConfiguration();
+            long long entries = argc > 2 ? std::atoll(argv[2]) : 1000000;
+            long long marks = argc > 3 ? std::atoll(argv[3]) : 100000;
+            return RunProcessedDbBenchmark(static_cast<size_t>(entries > 0 ? entries : 1000000),
+                                           static_cast<size_t>(marks > 0 ? marks : 100000));
+        }
+        else if (command == "bench-log") {
+            LoadConfiguration();
+            long long messages = argc > 2 ? std::atoll(argv[2]) : 1000000;
+            int threads = argc > 3 ? std::atoi(argv[3]) : 4;
+            return RunLoggerBenchmark(static_cast<size_t>(messages > 0 ? messages : 1000000), threads > 0 ? threads : 4);
+        }
+        else if (command == "bench-scan") {
+            LoadConfiguration();
+            int files = argc > 2 ? std::atoi(argv[2]) : 300000;
+            return RunScanBenchmark(files > 0 ? files : 300000);
+        }
+        else if (command == "bench-match") {
+            int filenames = argc > 2 ? std::atoi(argv[2]) : 2000;
+            return RunMatcherBenchmark(filenames > 0 ? filenames : 2000);
+        }
+        else if (command == "bench-parse") {
+            long long requests = argc > 2 ? std::atoll(argv[2]) : 1000000;
+            return RunHttpParserBenchmark(static_cast<size_t>(requests > 0 ? requests : 1000000));
+        }
+        else if (command == "bench-scheduler") {
+            long long taskCount = argc > 2 ? std::atoll(argv[2]) : 10000;
+            return RunSchedulerBenchmark(static_cast<size_t>(taskCount > 0 ? taskCount : 10000));
+        }
+        else if (command == "bench-jsonparse") {
+            long long documents = argc > 2 ? std::atoll(argv[2]) : 200000;
+            return RunJsonParserBenchmark(static_cast<size_t>(documents > 0 ? documents : 200000));
+        }
+        else if (command == "bench-http") {
+            int connections = argc > 2 ? std::atoi(argv[2]) : 16;
+            int requests = argc > 3 ? std::atoi(argv[3]) : 500;
+            std::string path = argc > 4 ? argv[4] : "/api/metrics";
+            return RunHttpBenchmark(connections > 0 ? connections : 16, requests > 0 ? requests : 500, path);
+        }
+        else if (command == "bench-hash") {
+            long long megabytes = argc > 2 ? std::atoll(argv[2]) : 256;
+            return RunHashBenchmark(static_cast<size_t>(megabytes > 0 ? megabytes : 256));
+        }
+        else if (command == "bench-json") {
+            long long rows = argc > 2 ? std::atoll(argv[2]) : 1000;
+            return RunJsonBenchmark(static_cast<size_t>(rows > 0 ? rows : 1000));
+        }
+        else if (command == "bench-index") {
+            std::vector<size_t> sizes;
+            long long entries = argc > 2 ? std::atoll(argv[2]) : 0;
+            if (entries > 0) sizes.push_back(static_cast<size_t>(entries));
+            else { sizes.push_back(1000000); sizes.push_back(10000000); }
+            return RunProcessedIndexBenchmark(sizes);
+        }
         else {
             std::cerr << "Comando non riconosciuto: " << command << std::endl;
             std::cerr << "Comandi disponibili:" << std::endl;
@@ -2889,7 +10100,21 @@ int main(int argc, char* argv[]) {
             std::cerr << "  status     - stato servizio" << std::endl;
             std::cerr << "  reset      - reset database" << std::endl;
             std::cerr << "  config     - crea configurazione" << std::endl;
+            std::cerr << "  convert-db - converte il database processati nel formato binario" << std::endl;
+            std::cerr << "  db-stats   - statistiche del database processati senza caricarlo" << std::endl;
             std::cerr << "  reprocess <cartella> <file> - riprocessa file" << std::endl;
+            std::cerr << "  bench-watcher [cartelle] [file] - benchmark motore watcher" << std::endl;
+            std::cerr << "  bench-db [voci] [file] - benchmark database file processati" << std::endl;
+            std::cerr << "  bench-log [messaggi] [thread] - benchmark produttori logger" << std::endl;
+            std::cerr << "  bench-match [nomi] - benchmark matcher multi-pattern" << std::endl;
+            std::cerr << "  bench-index [voci] - benchmark indice file processati" << std::endl;
+            std::cerr << "  bench-hash [MB] - benchmark impronta contenuto (GB/s)" << std::endl;
+            std::cerr << "  bench-http [connessioni] [richieste] [percorso] - load test web server (req/s, p99)" << std::endl;
+            std::cerr << "  bench-parse [richieste] - benchmark parser HTTP" << std::endl;
+            std::cerr << "  bench-scan [file] - benchmark scansione all'avvio con istantanee" << std::endl;
+            std::cerr << "  bench-json [righe] - benchmark serializzazione JSON (MB/s)" << std::endl;
+            std::cerr << "  bench-jsonparse [documenti] - benchmark parser JSON dei corpi API" << std::endl;
+            std::cerr << "  bench-scheduler [task] - benchmark e verifiche coda dello schedulatore" << std::endl;
             return 1;
         }
     }
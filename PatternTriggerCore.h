@@ -0,0 +1,980 @@
+// Componenti portabili di PatternTriggerCommand: nessuna dipendenza da Win32,
+// cosi' possono essere compilati e verificati anche con il compilatore host
+// (vedi tests/PatternTriggerCoreTests.cpp e il target "make test")
+// Autore: Umberto Meglio
+
+#ifndef PATTERN_TRIGGER_CORE_H
+#define PATTERN_TRIGGER_CORE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+#include <cstring>
+#include <cctype>
+#include <ctime>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Limiti delle richieste HTTP
+#define HTTP_MAX_REQUEST_SIZE (1024 * 1024)   // corpo massimo secondo Content-Length
+#define HTTP_MAX_HEADER_SIZE 65536            // riga di richiesta + intestazioni
+#define HTTP_MAX_HEADERS 64
+
+// Limiti dei corpi JSON delle API
+#define JSON_MAX_DOCUMENT_SIZE (64 * 1024)   // corpi JSON delle API
+#define JSON_MAX_DEPTH 32
+#define JSON_MAX_VALUES 4096
+
+// ====== PARSER HTTP ======
+
+// Riferimento non proprietario a una porzione di buffer (in C++11 manca string_view)
+struct StringRef {
+    const char* data;
+    size_t size;
+    
+    StringRef() : data(""), size(0) {}
+    StringRef(const char* d, size_t n) : data(d), size(n) {}
+    
+    bool Empty() const { return size == 0; }
+    std::string ToString() const { return std::string(data, size); }
+    
+    bool Equals(const char* literal) const {
+        size_t length = strlen(literal);
+        return length == size && memcmp(data, literal, length) == 0;
+    }
+    
+    // Confronto con un letterale gia' in minuscolo
+    bool EqualsIgnoreCase(const char* lowerLiteral) const {
+        size_t length = strlen(lowerLiteral);
+        if (length != size) return false;
+        for (size_t i = 0; i < length; ++i) {
+            if (std::tolower(static_cast<unsigned char>(data[i])) != lowerLiteral[i]) return false;
+        }
+        return true;
+    }
+    
+    // Cerca un token (minuscolo) in una lista separata da virgole, es. "Connection: keep-alive, Upgrade"
+    bool HasTokenIgnoreCase(const char* lowerToken) const {
+        size_t start = 0;
+        while (start < size) {
+            size_t end = start;
+            while (end < size && data[end] != ',') ++end;
+            size_t first = start, last = end;
+            while (first < last && (data[first] == ' ' || data[first] == '\t')) ++first;
+            while (last > first && (data[last - 1] == ' ' || data[last - 1] == '\t')) --last;
+            if (StringRef(data + first, last - first).EqualsIgnoreCase(lowerToken)) return true;
+            start = end + 1;
+        }
+        return false;
+    }
+};
+
+struct HttpHeader {
+    StringRef name;
+    StringRef value;
+};
+
+// Richiesta analizzata: tutte le parti puntano nel buffer della connessione e
+// restano valide finche' il buffer non viene modificato
+struct HttpRequest {
+    StringRef method;
+    StringRef target;
+    StringRef path;
+    StringRef query;
+    StringRef version;
+    StringRef body;
+    HttpHeader headers[HTTP_MAX_HEADERS];
+    size_t headerCount;
+    bool keepAlive;
+    
+    HttpRequest() : headerCount(0), keepAlive(false) {}
+    
+    StringRef Header(const char* lowerName) const {
+        for (size_t i = 0; i < headerCount; ++i) {
+            if (headers[i].name.EqualsIgnoreCase(lowerName)) return headers[i].value;
+        }
+        return StringRef();
+    }
+};
+
+// Parser incrementale: a ogni chiamata riprende la ricerca della fine intestazioni
+// da dove si era fermato, analizza riga di richiesta e intestazioni una sola volta
+// (come offset, perche' il buffer puo' essere riallocato mentre arriva il corpo) e
+// attende il corpo indicato da Content-Length. Nessuna copia dei dati.
+class HttpRequestParser {
+public:
+    enum Result { NeedMore, Complete, Invalid, TooLarge };
+    
+    HttpRequestParser() { Reset(); }
+    
+    void Reset() {
+        scanned = 0;
+        headerLength = 0;
+        contentLength = 0;
+        headerCount = 0;
+        keepAlive = false;
+    }
+    
+    // Byte occupati dalla richiesta completa appena restituita
+    size_t MessageLength() const { return headerLength + contentLength; }
+    
+    Result Parse(const char* data, size_t size, HttpRequest& request) {
+        if (headerLength == 0) {
+            size_t end = FindHeaderEnd(data, size);
+            if (end == 0) {
+                return size > HTTP_MAX_HEADER_SIZE ? TooLarge : NeedMore;
+            }
+            if (end > HTTP_MAX_HEADER_SIZE) return TooLarge;
+            headerLength = end;
+            Result head = ParseHead(data);
+            if (head != Complete) {
+                headerLength = 0;
+                return head;
+            }
+        }
+        
+        if (size - headerLength < contentLength) return NeedMore;
+        
+        request.method = Slice(data, method);
+        request.target = Slice(data, target);
+        request.version = Slice(data, version);
+        request.path = request.target;
+        request.query = StringRef();
+        const char* question = static_cast<const char*>(memchr(request.target.data, '?', request.target.size));
+        if (question != NULL) {
+            request.path = StringRef(request.target.data, question - request.target.data);
+            request.query = StringRef(question + 1, request.target.size - request.path.size - 1);
+        }
+        request.headerCount = headerCount;
+        for (size_t i = 0; i < headerCount; ++i) {
+            request.headers[i].name = Slice(data, headerSpans[i].name);
+            request.headers[i].value = Slice(data, headerSpans[i].value);
+        }
+        request.body = StringRef(data + headerLength, contentLength);
+        request.keepAlive = keepAlive;
+        return Complete;
+    }
+    
+private:
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+    
+    struct HeaderSpan {
+        Span name;
+        Span value;
+    };
+    
+    size_t scanned;          // byte gia' esaminati alla ricerca di CRLFCRLF
+    size_t headerLength;     // 0 finche' le intestazioni non sono complete
+    size_t contentLength;
+    Span method;
+    Span target;
+    Span version;
+    HeaderSpan headerSpans[HTTP_MAX_HEADERS];
+    size_t headerCount;
+    bool keepAlive;
+    
+    static StringRef Slice(const char* data, const Span& span) {
+        return StringRef(data + span.offset, span.length);
+    }
+    
+    // Posizione dopo CRLFCRLF, 0 se non ancora arrivata
+    size_t FindHeaderEnd(const char* data, size_t size) {
+        size_t position = scanned > 3 ? scanned - 3 : 0;
+        while (position + 4 <= size) {
+            const char* cr = static_cast<const char*>(memchr(data + position, '\r', size - position));
+            if (cr == NULL) break;
+            position = cr - data;
+            if (position + 4 > size) break;
+            if (memcmp(cr, "\r\n\r\n", 4) == 0) return position + 4;
+            ++position;
+        }
+        scanned = size;
+        return 0;
+    }
+    
+    static bool IsTokenChar(unsigned char c) {
+        return c > 32 && c < 127 && !strchr("()<>@,;:\\\"/[]?={}", c);
+    }
+    
+    Result ParseHead(const char* data) {
+        size_t lineEnd = static_cast<const char*>(memchr(data, '\r', headerLength)) - data;
+        if (data[lineEnd + 1] != '\n') return Invalid;
+        
+        // Riga di richiesta: METODO SP TARGET SP HTTP/1.x
+        size_t position = 0;
+        while (position < lineEnd && IsTokenChar(data[position])) ++position;
+        if (position == 0 || position >= lineEnd || data[position] != ' ') return Invalid;
+        method.offset = 0;
+        method.length = position;
+        
+        target.offset = ++position;
+        while (position < lineEnd && static_cast<unsigned char>(data[position]) > 32 && data[position] != 127) ++position;
+        target.length = position - target.offset;
+        if (target.length == 0 || position >= lineEnd || data[position] != ' ') return Invalid;
+        
+        version.offset = ++position;
+        version.length = lineEnd - position;
+        StringRef versionRef = Slice(data, version);
+        bool http11 = versionRef.Equals("HTTP/1.1");
+        if (!http11 && !versionRef.Equals("HTTP/1.0")) return Invalid;
+        
+        // Intestazioni: NOME ":" OWS VALORE OWS CRLF, senza righe di continuazione
+        bool connectionClose = false;
+        bool connectionKeepAlive = false;
+        bool haveContentLength = false;
+        size_t lineStart = lineEnd + 2;
+        while (lineStart < headerLength - 2) {
+            lineEnd = static_cast<const char*>(memchr(data + lineStart, '\r', headerLength - lineStart)) - data;
+            if (data[lineEnd + 1] != '\n') return Invalid;
+            
+            size_t colon = lineStart;
+            while (colon < lineEnd && IsTokenChar(data[colon])) ++colon;
+            if (colon == lineStart || colon >= lineEnd || data[colon] != ':') return Invalid;
+            if (headerCount >= HTTP_MAX_HEADERS) return TooLarge;
+            
+            size_t valueStart = colon + 1;
+            size_t valueEnd = lineEnd;
+            while (valueStart < valueEnd && (data[valueStart] == ' ' || data[valueStart] == '\t')) ++valueStart;
+            while (valueEnd > valueStart && (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t')) --valueEnd;
+            
+            HeaderSpan& header = headerSpans[headerCount++];
+            header.name.offset = lineStart;
+            header.name.length = colon - lineStart;
+            header.value.offset = valueStart;
+            header.value.length = valueEnd - valueStart;
+            
+            StringRef name = Slice(data, header.name);
+            StringRef value = Slice(data, header.value);
+            if (name.EqualsIgnoreCase("content-length")) {
+                if (value.Empty()) return Invalid;
+                size_t length = 0;
+                for (size_t i = 0; i < value.size; ++i) {
+                    if (value.data[i] < '0' || value.data[i] > '9') return Invalid;
+                    if (length > HTTP_MAX_REQUEST_SIZE) return TooLarge;
+                    length = length * 10 + (value.data[i] - '0');
+                }
+                if (length > HTTP_MAX_REQUEST_SIZE) return TooLarge;
+                if (haveContentLength && length != contentLength) return Invalid;
+                contentLength = length;
+                haveContentLength = true;
+            }
+            else if (name.EqualsIgnoreCase("transfer-encoding")) {
+                return Invalid;   // corpo chunked non supportato
+            }
+            else if (name.EqualsIgnoreCase("connection")) {
+                connectionClose = connectionClose || value.HasTokenIgnoreCase("close");
+                connectionKeepAlive = connectionKeepAlive || value.HasTokenIgnoreCase("keep-alive");
+            }
+            
+            lineStart = lineEnd + 2;
+        }
+        
+        keepAlive = http11 ? !connectionClose : connectionKeepAlive;
+        return Complete;
+    }
+};
+
+// ====== SCRITTURA JSON ======
+
+// Scrittore JSON in streaming su un buffer pre-dimensionato, usato da tutte le API e
+// dagli eventi. Virgole, rientri e chiusure sono gestiti qui; in forma compatta
+// (eventi SSE, risposte brevi) gli elementi sono separati da ", " su una sola riga
+class JsonWriter {
+public:
+    explicit JsonWriter(bool pretty = true, size_t reserve = 1024) : pretty(pretty), afterKey(false) {
+        buffer.reserve(reserve);
+        hasItems.push_back(0);
+    }
+    
+    JsonWriter& BeginObject() { return Open('{'); }
+    JsonWriter& EndObject() { return Close('}'); }
+    JsonWriter& BeginArray() { return Open('['); }
+    JsonWriter& EndArray() { return Close(']'); }
+    
+    // Nomi di chiave scritti cosi' come sono: sono letterali del programma
+    JsonWriter& Key(const char* name, size_t length) {
+        Separate();
+        buffer += '"';
+        buffer.append(name, length);
+        buffer += "\": ";
+        afterKey = true;
+        return *this;
+    }
+    JsonWriter& Key(const char* name) { return Key(name, strlen(name)); }
+    JsonWriter& Key(const std::string& name) { return Key(name.data(), name.size()); }
+    
+    JsonWriter& String(const char* value, size_t length) {
+        Separate();
+        buffer += '"';
+        AppendEscaped(buffer, value, length);
+        buffer += '"';
+        return *this;
+    }
+    JsonWriter& String(const char* value) { return String(value, strlen(value)); }
+    JsonWriter& String(const std::string& value) { return String(value.data(), value.size()); }
+    
+    JsonWriter& Int(long long value) {
+        Separate();
+        if (value < 0) {
+            buffer += '-';
+            AppendDigits(0ULL - static_cast<unsigned long long>(value));
+        } else {
+            AppendDigits(static_cast<unsigned long long>(value));
+        }
+        return *this;
+    }
+    
+    JsonWriter& UInt(unsigned long long value) {
+        Separate();
+        AppendDigits(value);
+        return *this;
+    }
+    
+    JsonWriter& Bool(bool value) {
+        Separate();
+        buffer += value ? "true" : "false";
+        return *this;
+    }
+    
+    // Valore gia' serializzato (membri di un altro documento)
+    JsonWriter& Raw(const std::string& json) {
+        Separate();
+        buffer += json;
+        return *this;
+    }
+    
+    const std::string& Text() const { return buffer; }
+    std::string Take() { return std::move(buffer); }
+    
+    // Escape JSON accodato a out. I tratti senza caratteri speciali vengono copiati in
+    // blocco; con SSE2 la ricerca esamina 16 byte per volta. Come in passato, i byte
+    // >= 0x80 diventano \u00XX (testo nella code page ANSI, non UTF-8)
+    static void AppendEscaped(std::string& out, const char* data, size_t length) {
+        size_t runStart = 0;
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(0x20);
+        while (i + 16 <= length) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            // Confronto con segno: "< 0x20" comprende anche i byte >= 0x80
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                           _mm_cmplt_epi8(chunk, space));
+            int mask = _mm_movemask_epi8(special);
+            if (mask == 0) {
+                i += 16;
+                continue;
+            }
+            i += __builtin_ctz(static_cast<unsigned int>(mask));
+            out.append(data + runStart, i - runStart);
+            AppendEscapedByte(out, data[i]);
+            runStart = ++i;
+        }
+#endif
+        for (; i < length; ++i) {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+            if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') continue;
+            out.append(data + runStart, i - runStart);
+            AppendEscapedByte(out, data[i]);
+            runStart = i + 1;
+        }
+        out.append(data + runStart, length - runStart);
+    }
+    
+private:
+    std::string buffer;
+    bool pretty;
+    bool afterKey;
+    std::vector<char> hasItems;   // per livello aperto: almeno un elemento gia' scritto
+    
+    static void AppendEscapedByte(std::string& out, char c) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char escaped[6] = {'\\', 'u', '0', '0', "0123456789ABCDEF"[(c >> 4) & 0xF], "0123456789ABCDEF"[c & 0xF]};
+                out.append(escaped, sizeof(escaped));
+                break;
+            }
+        }
+    }
+    
+    void AppendDigits(unsigned long long value) {
+        char digits[20];
+        int count = 0;
+        do {
+            digits[sizeof(digits) - 1 - count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        buffer.append(digits + sizeof(digits) - count, count);
+    }
+    
+    void Separate() {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (hasItems.size() == 1) return;
+        if (hasItems.back()) buffer += pretty ? "," : ", ";
+        hasItems.back() = 1;
+        if (pretty) {
+            buffer += '\n';
+            buffer.append((hasItems.size() - 1) * 2, ' ');
+        }
+    }
+    
+    JsonWriter& Open(char bracket) {
+        Separate();
+        buffer += bracket;
+        hasItems.push_back(0);
+        return *this;
+    }
+    
+    JsonWriter& Close(char bracket) {
+        bool items = hasItems.back() != 0;
+        if (hasItems.size() > 1) hasItems.pop_back();
+        if (pretty && items) {
+            buffer += '\n';
+            buffer.append((hasItems.size() - 1) * 2, ' ');
+        }
+        buffer += bracket;
+        return *this;
+    }
+};
+
+// ====== LETTURA JSON ======
+
+// Parser JSON a passata singola per i corpi delle richieste API. Il documento e' un
+// vettore piatto di nodi che puntano nel testo originale: stringhe e chiavi restano
+// riferimenti finche' non vengono lette, gli escape (\uXXXX e coppie surrogate
+// comprese) sono validati durante il parsing. Le stringhe decodificate seguono la
+// convenzione di JsonWriter: un byte per carattere nella code page ANSI, non UTF-8
+class JsonDocument {
+public:
+    enum Type { Null, Bool, Number, String, Array, Object };
+    
+    struct Value {
+        Type type;
+        StringRef text;      // stringa: contenuto tra le virgolette, escape inclusi; altri scalari: il letterale
+        StringRef key;       // nome del membro, se il nodo appartiene a un oggetto
+        bool textEscaped;
+        bool keyEscaped;
+        int firstChild;      // -1 se assente
+        int next;            // fratello successivo, -1 se ultimo
+    };
+    
+    JsonDocument() : begin(NULL), cursor(NULL), end(NULL), error(NULL), errorOffset(0) {}
+    
+    bool Parse(const char* data, size_t length) {
+        values.clear();
+        begin = cursor = data;
+        end = data + length;
+        error = NULL;
+        errorOffset = 0;
+        if (length > JSON_MAX_DOCUMENT_SIZE) return Fail("documento troppo grande");
+        
+        SkipWhitespace();
+        if (ParseValue(0) < 0) return false;
+        SkipWhitespace();
+        if (cursor != end) return Fail("contenuto dopo il valore radice");
+        return true;
+    }
+    bool Parse(const StringRef& text) { return Parse(text.data, text.size); }
+    
+    const char* Error() const { return error; }
+    size_t ErrorOffset() const { return errorOffset; }
+    
+    int Root() const { return values.empty() ? -1 : 0; }
+    const Value& operator[](int index) const { return values[index]; }
+    
+    // Membro di un oggetto per nome; con chiavi duplicate vince l'ultima, come in JSON.parse
+    int Find(int object, const char* name) const {
+        if (object < 0 || values[object].type != Object) return -1;
+        size_t nameLength = strlen(name);
+        int found = -1;
+        std::string decoded;
+        for (int child = values[object].firstChild; child >= 0; child = values[child].next) {
+            const Value& member = values[child];
+            if (!member.keyEscaped) {
+                if (member.key.size == nameLength && memcmp(member.key.data, name, nameLength) == 0) found = child;
+            } else {
+                decoded.clear();
+                DecodeString(member.key, &decoded);
+                if (decoded == name) found = child;
+            }
+        }
+        return found;
+    }
+    
+    // Testo di uno scalare: stringhe decodificate, numeri e letterali cosi' come scritti.
+    // Membro assente, null, array e oggetti danno stringa vuota
+    std::string Text(int object, const char* name) const {
+        int index = Find(object, name);
+        if (index < 0) return std::string();
+        const Value& value = values[index];
+        if (value.type == String) {
+            if (!value.textEscaped) return value.text.ToString();
+            std::string decoded;
+            DecodeString(value.text, &decoded);
+            return decoded;
+        }
+        if (value.type == Number || value.type == Bool) return value.text.ToString();
+        return std::string();
+    }
+    
+    // Decodifica (o solo valida, con out == NULL) il contenuto di una stringa JSON
+    static bool DecodeString(const StringRef& raw, std::string* out) {
+        const char* p = raw.data;
+        const char* stop = raw.data + raw.size;
+        while (p < stop) {
+            const char* run = p;
+            while (p < stop && *p != '\\') ++p;
+            if (out) out->append(run, p - run);
+            if (p == stop) break;
+            if (++p == stop) return false;
+            char c = *p++;
+            switch (c) {
+                case '"': case '\\': case '/': if (out) *out += c; break;
+                case 'b': if (out) *out += '\b'; break;
+                case 'f': if (out) *out += '\f'; break;
+                case 'n': if (out) *out += '\n'; break;
+                case 'r': if (out) *out += '\r'; break;
+                case 't': if (out) *out += '\t'; break;
+                case 'u': {
+                    unsigned int code;
+                    if (!ReadHex4(p, stop, code)) return false;
+                    p += 4;
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        unsigned int low;
+                        if (stop - p < 6 || p[0] != '\\' || p[1] != 'u' || !ReadHex4(p + 2, stop, low) ||
+                            low < 0xDC00 || low > 0xDFFF) {
+                            return false;
+                        }
+                        p += 6;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                        return false;
+                    }
+                    if (out) AppendCodeUnit(*out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+    
+private:
+    std::vector<Value> values;
+    const char* begin;
+    const char* cursor;
+    const char* end;
+    const char* error;
+    size_t errorOffset;
+    
+    bool Fail(const char* message) {
+        if (!error) {
+            error = message;
+            errorOffset = cursor - begin;
+        }
+        return false;
+    }
+    
+    void SkipWhitespace() {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) ++cursor;
+    }
+    
+    static bool ReadHex4(const char* p, const char* stop, unsigned int& code) {
+        if (stop - p < 4) return false;
+        code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = p[i];
+            unsigned int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return false;
+            code = (code << 4) | digit;
+        }
+        return true;
+    }
+    
+    // Inverso di JsonWriter::AppendEscaped, che scrive ogni byte >= 0x80 come \u00XX:
+    // U+0000-U+00FF tornano al byte originale. Gli altri caratteri non hanno un byte
+    // corrispondente e diventano '?', come nella conversione verso la code page ANSI
+    static void AppendCodeUnit(std::string& out, unsigned int code) {
+        out += code <= 0xFF ? static_cast<char>(code) : '?';
+    }
+    
+    // cursor sulla virgoletta di apertura; alla fine e' dopo quella di chiusura
+    bool ParseString(StringRef& content, bool& escaped) {
+        const char* start = ++cursor;
+        escaped = false;
+        while (cursor < end) {
+            unsigned char c = static_cast<unsigned char>(*cursor);
+            if (c == '"') {
+                content = StringRef(start, cursor - start);
+                ++cursor;
+                if (escaped && !DecodeString(content, NULL)) {
+                    cursor = start;
+                    return Fail("sequenza di escape non valida");
+                }
+                return true;
+            }
+            if (c < 0x20) return Fail("carattere di controllo in una stringa");
+            if (c == '\\') {
+                escaped = true;
+                if (++cursor == end) break;
+            }
+            ++cursor;
+        }
+        return Fail("stringa non terminata");
+    }
+    
+    bool ParseNumber() {
+        const char* start = cursor;
+        if (cursor < end && *cursor == '-') ++cursor;
+        if (cursor < end && *cursor == '0') {
+            ++cursor;
+        } else if (cursor < end && *cursor >= '1' && *cursor <= '9') {
+            while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+        } else {
+            return Fail("numero non valido");
+        }
+        if (cursor < end && *cursor == '.') {
+            ++cursor;
+            if (cursor == end || *cursor < '0' || *cursor > '9') return Fail("numero non valido");
+            while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+        }
+        if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+            ++cursor;
+            if (cursor < end && (*cursor == '+' || *cursor == '-')) ++cursor;
+            if (cursor == end || *cursor < '0' || *cursor > '9') return Fail("numero non valido");
+            while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+        }
+        values.back().text = StringRef(start, cursor - start);
+        return true;
+    }
+    
+    bool ParseLiteral(const char* literal, Type type) {
+        size_t length = strlen(literal);
+        if (static_cast<size_t>(end - cursor) < length || memcmp(cursor, literal, length) != 0) {
+            return Fail("valore non valido");
+        }
+        values.back().type = type;
+        values.back().text = StringRef(cursor, length);
+        cursor += length;
+        return true;
+    }
+    
+    // Indice del nodo creato, -1 su errore. Gli indici restano validi anche se il
+    // vettore viene riallocato, i riferimenti no: per questo si usa sempre values[...]
+    int ParseValue(int depth) {
+        if (values.size() >= JSON_MAX_VALUES) { Fail("troppi valori"); return -1; }
+        if (cursor == end) { Fail("valore mancante"); return -1; }
+        
+        int index = static_cast<int>(values.size());
+        Value node;
+        node.type = Null;
+        node.textEscaped = false;
+        node.keyEscaped = false;
+        node.firstChild = -1;
+        node.next = -1;
+        values.push_back(node);
+        
+        switch (*cursor) {
+            case '"': {
+                values[index].type = String;
+                StringRef content;
+                bool escaped;
+                if (!ParseString(content, escaped)) return -1;
+                values[index].text = content;
+                values[index].textEscaped = escaped;
+                return index;
+            }
+            case '{':
+            case '[': {
+                bool object = *cursor == '{';
+                char close = object ? '}' : ']';
+                values[index].type = object ? Object : Array;
+                if (depth >= JSON_MAX_DEPTH) { Fail("annidamento eccessivo"); return -1; }
+                ++cursor;
+                SkipWhitespace();
+                if (cursor < end && *cursor == close) {
+                    ++cursor;
+                    return index;
+                }
+                int last = -1;
+                for (;;) {
+                    StringRef key;
+                    bool keyEscaped = false;
+                    if (object) {
+                        if (cursor == end || *cursor != '"') { Fail("nome di membro atteso"); return -1; }
+                        if (!ParseString(key, keyEscaped)) return -1;
+                        SkipWhitespace();
+                        if (cursor == end || *cursor != ':') { Fail("':' atteso"); return -1; }
+                        ++cursor;
+                        SkipWhitespace();
+                    }
+                    int child = ParseValue(depth + 1);
+                    if (child < 0) return -1;
+                    values[child].key = key;
+                    values[child].keyEscaped = keyEscaped;
+                    if (last < 0) values[index].firstChild = child;
+                    else values[last].next = child;
+                    last = child;
+                    
+                    SkipWhitespace();
+                    if (cursor < end && *cursor == ',') {
+                        ++cursor;
+                        SkipWhitespace();
+                        continue;
+                    }
+                    if (cursor < end && *cursor == close) {
+                        ++cursor;
+                        return index;
+                    }
+                    Fail(object ? "',' o '}' atteso" : "',' o ']' atteso");
+                    return -1;
+                }
+            }
+            case 't': return ParseLiteral("true", Bool) ? index : -1;
+            case 'f': return ParseLiteral("false", Bool) ? index : -1;
+            case 'n': return ParseLiteral("null", Null) ? index : -1;
+            default:
+                values[index].type = Number;
+                return ParseNumber() ? index : -1;
+        }
+    }
+};
+
+// ====== CODA DELLO SCHEDULATORE ======
+
+struct SchedulerTask {
+    std::string name;
+    bool enabled;
+    std::set<int> days;      // 0=Do, 1=Lu, 2=Ma, 3=Me, 4=Gi, 5=Ve, 6=Sa
+    std::set<int> hours;     // 0-23
+    std::set<int> minutes;   // 0-59
+    std::string command;
+    int intervalSeconds;     // 0 = usa trigger giorno/ora/minuto, >0 = ripeti ogni N secondi
+    time_t lastFiredTime;    // ultimo minuto di calendario eseguito (ora locale)
+    std::string lastExecutionTime;
+    size_t executionCount;
+    std::chrono::steady_clock::time_point lastIntervalRun;
+
+    SchedulerTask() : enabled(true), intervalSeconds(0), lastFiredTime(0), executionCount(0) {}
+};
+
+// Prossima esecuzione di un task. I trigger giorno/ora/minuto sono calcolati una sola
+// volta sull'ora locale (wallTime) e convertiti in una scadenza su steady_clock
+struct SchedulerDeadline {
+    std::chrono::steady_clock::time_point due;
+    size_t task;        // indice in schedulerTasks
+    time_t wallTime;    // minuto di calendario, 0 per i task a intervallo
+    
+    bool operator>(const SchedulerDeadline& other) const { return due > other.due; }
+};
+
+// Min-heap delle scadenze: il thread dello schedulatore dorme fino alla prima
+class SchedulerQueue {
+public:
+    typedef std::chrono::steady_clock::time_point SteadyTime;
+    typedef std::chrono::system_clock::time_point WallTime;
+    
+    // Ricostruita da zero quando i task cambiano o l'orologio di sistema salta
+    void Rebuild(const std::vector<SchedulerTask>& tasks, SteadyTime steadyNow, WallTime wallNow) {
+        heap.clear();
+        heap.reserve(tasks.size());
+        time_t after = CurrentMinute(wallNow);
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            const SchedulerTask& task = tasks[i];
+            if (!task.enabled) continue;
+            SchedulerDeadline deadline;
+            deadline.task = i;
+            if (task.intervalSeconds > 0) {
+                deadline.wallTime = 0;
+                deadline.due = task.lastIntervalRun + std::chrono::seconds(task.intervalSeconds);
+                if (deadline.due < steadyNow) deadline.due = steadyNow;
+            } else {
+                deadline.wallTime = NextCalendarFire(task, std::max(after, task.lastFiredTime + 60));
+                if (deadline.wallTime == static_cast<time_t>(-1)) continue;
+                deadline.due = DueFromWall(deadline.wallTime, steadyNow, wallNow);
+            }
+            heap.push_back(deadline);
+        }
+        std::make_heap(heap.begin(), heap.end(), std::greater<SchedulerDeadline>());
+    }
+    
+    bool Empty() const { return heap.empty(); }
+    size_t Size() const { return heap.size(); }
+    const SchedulerDeadline& Top() const { return heap.front(); }
+    
+    SchedulerDeadline Pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<SchedulerDeadline>());
+        SchedulerDeadline deadline = heap.back();
+        heap.pop_back();
+        return deadline;
+    }
+    
+    void Push(const SchedulerDeadline& deadline) {
+        heap.push_back(deadline);
+        std::push_heap(heap.begin(), heap.end(), std::greater<SchedulerDeadline>());
+    }
+    
+    static SteadyTime DueFromWall(time_t wallTime, SteadyTime steadyNow, WallTime wallNow) {
+        WallTime target = std::chrono::system_clock::from_time_t(wallTime);
+        if (target <= wallNow) return steadyNow;
+        return steadyNow + std::chrono::duration_cast<std::chrono::steady_clock::duration>(target - wallNow);
+    }
+    
+    // Inizio del minuto in corso: un trigger del minuto attuale non ancora eseguito
+    // scatta subito, come quando il controllo era periodico
+    static time_t CurrentMinute(WallTime wallNow) {
+        time_t seconds = std::chrono::system_clock::to_time_t(wallNow);
+        return seconds - seconds % 60;
+    }
+    
+    // Primo minuto in ora locale >= after che rispetta giorni, ore e minuti del task;
+    // -1 se la selezione e' vuota. Si esaminano al massimo 8 giorni, con le maschere
+    // di bit al posto delle ricerche negli insiemi. Nei giorni con cambio dell'ora
+    // ogni ora e' risolta in entrambe le interpretazioni (vedi EarliestOnShiftDay)
+    static time_t NextCalendarFire(const SchedulerTask& task, time_t after) {
+        unsigned int dayMask = 0, hourMask = 0;
+        unsigned long long minuteMask = 0;
+        for (int d : task.days) if (d >= 0 && d <= 6) dayMask |= 1u << d;
+        for (int h : task.hours) if (h >= 0 && h <= 23) hourMask |= 1u << h;
+        for (int m : task.minutes) if (m >= 0 && m <= 59) minuteMask |= 1ULL << m;
+        if (dayMask == 0 || hourMask == 0 || minuteMask == 0) return static_cast<time_t>(-1);
+        
+        // localtime del CRT Microsoft usa un buffer per thread
+        const struct tm* local = localtime(&after);
+        if (local == NULL) return static_cast<time_t>(-1);
+        struct tm start = *local;
+        if (start.tm_sec != 0) {
+            start.tm_min += 1;
+            start.tm_sec = 0;
+        }
+        
+        struct tm midnight = start;
+        midnight.tm_hour = 0;
+        midnight.tm_min = 0;
+        midnight.tm_isdst = -1;
+        time_t dayStart = mktime(&midnight);
+        if (dayStart == static_cast<time_t>(-1)) return static_cast<time_t>(-1);
+        
+        for (int dayOffset = 0; dayOffset <= 7; ++dayOffset) {
+            struct tm day = start;
+            day.tm_mday += dayOffset;
+            if (dayOffset > 0) {
+                day.tm_hour = 0;
+                day.tm_min = 0;
+            }
+            day.tm_isdst = -1;
+            if (mktime(&day) == static_cast<time_t>(-1)) return static_cast<time_t>(-1);
+            
+            struct tm nextMidnight = midnight;
+            nextMidnight.tm_mday += dayOffset + 1;
+            nextMidnight.tm_isdst = -1;
+            time_t nextStart = mktime(&nextMidnight);
+            if (nextStart == static_cast<time_t>(-1)) return static_cast<time_t>(-1);
+            bool shiftDay = nextStart - dayStart != 24 * 3600;
+            dayStart = nextStart;
+            
+            if (!(dayMask & (1u << day.tm_wday))) continue;
+            
+            if (shiftDay) {
+                time_t fireTime = EarliestOnShiftDay(day, hourMask, minuteMask, after);
+                if (fireTime != static_cast<time_t>(-1)) return fireTime;
+                continue;
+            }
+            
+            for (int hour = day.tm_hour; hour < 24; ++hour) {
+                if (!(hourMask & (1u << hour))) continue;
+                int firstMinute = hour == day.tm_hour ? day.tm_min : 0;
+                unsigned long long candidates = minuteMask & (~0ULL << firstMinute);
+                if (candidates == 0) continue;
+                
+                struct tm fire = day;
+                fire.tm_hour = hour;
+                fire.tm_min = __builtin_ctzll(candidates);
+                fire.tm_sec = 0;
+                fire.tm_isdst = -1;
+                time_t fireTime = mktime(&fire);
+                if (fireTime != static_cast<time_t>(-1) && fireTime >= after) return fireTime;
+            }
+        }
+        return static_cast<time_t>(-1);
+    }
+    
+    // Giorno con cambio dell'ora. Ogni ora del task viene convertita con tm_isdst a 0 e
+    // a 1: un'interpretazione e' valida se mktime non sposta l'orario. Al ritorno all'ora
+    // solare entrambe lo sono e il minuto scatta in tutte e due le occorrenze; nell'ora
+    // saltata in primavera nessuna lo e' e vale lo spostamento in avanti di mktime.
+    // Dentro un'interpretazione i minuti distano 60 s, quindi bastano due mktime per ora
+    static time_t EarliestOnShiftDay(const struct tm& day, unsigned int hourMask,
+                                     unsigned long long minuteMask, time_t after) {
+        int firstMinute = __builtin_ctzll(minuteMask);
+        time_t best = static_cast<time_t>(-1);
+        for (int hour = 0; hour < 24; ++hour) {
+            if (!(hourMask & (1u << hour))) continue;
+            bool resolved = false;
+            for (int isdst = 0; isdst <= 1; ++isdst) {
+                struct tm fire = day;
+                fire.tm_hour = hour;
+                fire.tm_min = firstMinute;
+                fire.tm_sec = 0;
+                fire.tm_isdst = isdst;
+                time_t base = mktime(&fire);
+                if (base == static_cast<time_t>(-1) || fire.tm_mday != day.tm_mday ||
+                    fire.tm_hour != hour || fire.tm_min != firstMinute) {
+                    continue;
+                }
+                resolved = true;
+                best = EarliestInHour(base, firstMinute, minuteMask, after, best);
+            }
+            if (!resolved) {
+                struct tm fire = day;
+                fire.tm_hour = hour;
+                fire.tm_min = firstMinute;
+                fire.tm_sec = 0;
+                fire.tm_isdst = -1;
+                time_t base = mktime(&fire);
+                if (base != static_cast<time_t>(-1)) best = EarliestInHour(base, firstMinute, minuteMask, after, best);
+            }
+        }
+        return best;
+    }
+    
+    // Primo minuto della maschera >= after, con base = istante di firstMinute
+    static time_t EarliestInHour(time_t base, int firstMinute, unsigned long long minuteMask, time_t after, time_t best) {
+        for (unsigned long long candidates = minuteMask; candidates != 0; candidates &= candidates - 1) {
+            time_t fireTime = base + static_cast<time_t>(__builtin_ctzll(candidates) - firstMinute) * 60;
+            if (fireTime < after) continue;
+            if (best == static_cast<time_t>(-1) || fireTime < best) best = fireTime;
+            break;
+        }
+        return best;
+    }
+    
+private:
+    std::vector<SchedulerDeadline> heap;
+};
+
+#endif // PATTERN_TRIGGER_CORE_H
@@ -0,0 +1,675 @@
+// Test unitari e verifiche casuali dei componenti portabili (PatternTriggerCore.h)
+// Compilati con il compilatore host, anche su Linux: make test
+// Con sanitizer: make test SANITIZE="-fsanitize=address,undefined"
+// Autore: Umberto Meglio
+
+#include "PatternTriggerCore.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <set>
+#include <ctime>
+
+static size_t checksRun = 0;
+static size_t checksFailed = 0;
+
+static void Check(bool condition, const char* expression, const char* file, int line) {
+    checksRun++;
+    if (!condition) {
+        checksFailed++;
+        std::cerr << file << ":" << line << ": verifica fallita: " << expression << std::endl;
+    }
+}
+
+#define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+
+// ====== PARSER HTTP ======
+
+// La richiesta punta nel buffer: il testo resta in vita fino alla chiamata successiva
+static HttpRequestParser::Result ParseHttp(const std::string& text, HttpRequest& request) {
+    static std::string buffer;
+    buffer = text;
+    HttpRequestParser parser;
+    return parser.Parse(buffer.data(), buffer.size(), request);
+}
+
+static HttpRequestParser::Result ParseHttp(const std::string& text) {
+    HttpRequest request;
+    return ParseHttp(text, request);
+}
+
+static std::vector<std::string> HttpSampleRequests() {
+    std::string json = "{\"name\": \"backup\", \"originalName\": \"\", \"days\": \"Lu,Ma,Me\", "
+                       "\"hours\": \"2\", \"minutes\": \"30\", \"command\": \"C:\\\\Scripts\\\\backup.bat\", "
+                       "\"enabled\": \"true\", \"intervalSeconds\": \"0\"}";
+    std::vector<std::string> samples;
+    samples.push_back("GET /api/metrics HTTP/1.1\r\n"
+                      "Host: localhost:8080\r\n"
+                      "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36\r\n"
+                      "Accept: application/json, text/plain, */*\r\n"
+                      "Accept-Encoding: gzip, deflate, br\r\n"
+                      "Connection: keep-alive\r\n\r\n");
+    samples.push_back("POST /api/scheduler/save HTTP/1.1\r\n"
+                      "Host: localhost:8080\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length: " + std::to_string(json.length()) + "\r\n\r\n" + json);
+    samples.push_back("GET /scheduler?tab=storico HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n");
+    samples.push_back("DELETE /api/x HTTP/1.1\r\nContent-Length: 0\r\nConnection: Upgrade, close\r\n\r\n");
+    return samples;
+}
+
+static void TestHttpRequestLine() {
+    HttpRequest request;
+    CHECK(ParseHttp("GET /api/metrics?full=1&x=2 HTTP/1.1\r\nHost: localhost\r\nX-Trace:  abc \t\r\n\r\n", request) ==
+          HttpRequestParser::Complete);
+    CHECK(request.method.Equals("GET"));
+    CHECK(request.target.Equals("/api/metrics?full=1&x=2"));
+    CHECK(request.path.Equals("/api/metrics"));
+    CHECK(request.query.Equals("full=1&x=2"));
+    CHECK(request.version.Equals("HTTP/1.1"));
+    CHECK(request.headerCount == 2);
+    CHECK(request.Header("host").Equals("localhost"));
+    CHECK(request.Header("x-trace").Equals("abc"));   // spazi e tab esterni rimossi
+    CHECK(request.Header("accept").Empty());
+    CHECK(request.body.Empty());
+    
+    CHECK(ParseHttp("GET /? HTTP/1.1\r\n\r\n", request) == HttpRequestParser::Complete);
+    CHECK(request.path.Equals("/"));
+    CHECK(request.query.Empty());
+    CHECK(request.headerCount == 0);
+}
+
+static void TestHttpKeepAlive() {
+    HttpRequest request;
+    CHECK(ParseHttp("GET / HTTP/1.1\r\n\r\n", request) == HttpRequestParser::Complete && request.keepAlive);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\nConnection: close\r\n\r\n", request) == HttpRequestParser::Complete &&
+          !request.keepAlive);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\nconnection: Upgrade, CLOSE\r\n\r\n", request) == HttpRequestParser::Complete &&
+          !request.keepAlive);
+    CHECK(ParseHttp("GET / HTTP/1.0\r\n\r\n", request) == HttpRequestParser::Complete && !request.keepAlive);
+    CHECK(ParseHttp("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", request) == HttpRequestParser::Complete &&
+          request.keepAlive);
+    CHECK(ParseHttp("GET / HTTP/1.0\r\nConnection: keep-alivex\r\n\r\n", request) == HttpRequestParser::Complete &&
+          !request.keepAlive);
+}
+
+static void TestHttpBody() {
+    std::string text = "POST /api/x HTTP/1.1\r\nContent-Length: 5\r\n\r\nhelloGET / HTTP/1.1\r\n\r\n";
+    size_t first = text.find("GET");
+    
+    // Il corpo arriva dopo le intestazioni: NeedMore finche' non e' completo
+    HttpRequestParser parser;
+    HttpRequest request;
+    CHECK(parser.Parse(text.data(), first - 2, request) == HttpRequestParser::NeedMore);
+    CHECK(parser.Parse(text.data(), first, request) == HttpRequestParser::Complete);
+    CHECK(request.body.Equals("hello"));
+    CHECK(parser.MessageLength() == first);
+    
+    // Richiesta successiva in pipeline dallo stesso buffer
+    parser.Reset();
+    CHECK(parser.Parse(text.data() + first, text.size() - first, request) == HttpRequestParser::Complete);
+    CHECK(request.method.Equals("GET"));
+    CHECK(parser.MessageLength() == text.size() - first);
+    
+    // Content-Length ripetuto con lo stesso valore e' ammesso
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length: 2\r\ncontent-length: 2\r\n\r\nok", request) ==
+          HttpRequestParser::Complete);
+    CHECK(request.body.Equals("ok"));
+}
+
+static void TestHttpInvalid() {
+    CHECK(ParseHttp("GET / HTTP/2.0\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("GET /\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("GET  / HTTP/1.1\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp(" GET / HTTP/1.1\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("G(T / HTTP/1.1\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\nHost localhost\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\n: vuoto\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\n folded: x\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length:\r\n\r\n") == HttpRequestParser::Invalid);
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab") ==
+          HttpRequestParser::Invalid);
+    
+    // Dopo un errore il parser non resta a meta': la stessa istanza, azzerata, riparte pulita
+    HttpRequestParser parser;
+    HttpRequest request;
+    std::string bad = "GET / HTTP/9.9\r\n\r\n";
+    std::string good = "GET /ok HTTP/1.1\r\n\r\n";
+    CHECK(parser.Parse(bad.data(), bad.size(), request) == HttpRequestParser::Invalid);
+    parser.Reset();
+    CHECK(parser.Parse(good.data(), good.size(), request) == HttpRequestParser::Complete && request.path.Equals("/ok"));
+}
+
+static void TestHttpLimits() {
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length: " + std::to_string(HTTP_MAX_REQUEST_SIZE + 1) + "\r\n\r\n") ==
+          HttpRequestParser::TooLarge);
+    CHECK(ParseHttp("POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999999\r\n\r\n") ==
+          HttpRequestParser::TooLarge);
+    
+    std::string headers = "GET / HTTP/1.1\r\n";
+    for (int i = 0; i < HTTP_MAX_HEADERS; ++i) headers += "X-H" + std::to_string(i) + ": v\r\n";
+    HttpRequest request;
+    CHECK(ParseHttp(headers + "\r\n", request) == HttpRequestParser::Complete && request.headerCount == HTTP_MAX_HEADERS);
+    CHECK(ParseHttp(headers + "X-Extra: v\r\n\r\n") == HttpRequestParser::TooLarge);
+    
+    // Intestazioni senza fine oltre il limite, e intestazioni complete ma troppo lunghe
+    std::string endless = "GET / HTTP/1.1\r\nX-Long: " + std::string(HTTP_MAX_HEADER_SIZE, 'a');
+    CHECK(ParseHttp(endless) == HttpRequestParser::TooLarge);
+    CHECK(ParseHttp(endless + "\r\n\r\n") == HttpRequestParser::TooLarge);
+    CHECK(ParseHttp("GET / HTTP/1.1\r\nX-Long: " + std::string(1000, 'a')) == HttpRequestParser::NeedMore);
+}
+
+// Confronta due analisi della stessa richiesta (intera e a pezzi)
+static bool SameHttpRequest(const HttpRequest& a, const HttpRequest& b) {
+    if (a.headerCount != b.headerCount || a.keepAlive != b.keepAlive) return false;
+    if (a.method.ToString() != b.method.ToString() || a.target.ToString() != b.target.ToString()) return false;
+    if (a.path.ToString() != b.path.ToString() || a.query.ToString() != b.query.ToString()) return false;
+    if (a.body.ToString() != b.body.ToString()) return false;
+    for (size_t i = 0; i < a.headerCount; ++i) {
+        if (a.headers[i].name.ToString() != b.headers[i].name.ToString()) return false;
+        if (a.headers[i].value.ToString() != b.headers[i].value.ToString()) return false;
+    }
+    return true;
+}
+
+static bool RefInside(const StringRef& ref, const std::string& buffer, size_t length) {
+    if (ref.size == 0) return true;
+    return ref.data >= buffer.data() && ref.data + ref.size <= buffer.data() + length;
+}
+
+// Verifiche casuali del parser: a ogni taglio della richiesta il risultato deve
+// coincidere con l'analisi in un colpo solo, e nessuna mutazione deve produrre
+// riferimenti fuori dal buffer
+static size_t CheckHttpParserRandomized(const std::vector<std::string>& samples, size_t cases) {
+    size_t failures = 0;
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    
+    for (size_t c = 0; c < cases; ++c) {
+        const std::string& sample = samples[next() % samples.size()];
+        HttpRequestParser whole;
+        HttpRequest expected;
+        if (whole.Parse(sample.data(), sample.size(), expected) != HttpRequestParser::Complete ||
+            whole.MessageLength() != sample.size()) {
+            failures++;
+            continue;
+        }
+        
+        // Consegna a pezzi di lunghezza casuale, con una richiesta in coda in pipeline
+        std::string buffer;
+        HttpRequestParser incremental;
+        HttpRequest actual;
+        std::string stream = sample + samples[next() % samples.size()];
+        size_t delivered = 0;
+        HttpRequestParser::Result result = HttpRequestParser::NeedMore;
+        while (result == HttpRequestParser::NeedMore && delivered < stream.size()) {
+            size_t piece = 1 + next() % 48;
+            piece = std::min(piece, stream.size() - delivered);
+            buffer.append(stream, delivered, piece);
+            delivered += piece;
+            result = incremental.Parse(buffer.data(), buffer.size(), actual);
+            if (result == HttpRequestParser::NeedMore && buffer.size() >= sample.size()) break;
+        }
+        if (result != HttpRequestParser::Complete || incremental.MessageLength() != sample.size() ||
+            !SameHttpRequest(expected, actual)) {
+            failures++;
+            continue;
+        }
+        
+        // Mutazioni: byte alterati, inseriti o troncati
+        std::string mutated = sample;
+        int edits = 1 + static_cast<int>(next() % 4);
+        for (int e = 0; e < edits && !mutated.empty(); ++e) {
+            size_t position = next() % mutated.size();
+            switch (next() % 3) {
+                case 0: mutated[position] = static_cast<char>(next() & 0xFF); break;
+                case 1: mutated.insert(position, 1, "\r\n :\t/?"[next() % 7]); break;
+                default: mutated.resize(position); break;
+            }
+        }
+        HttpRequestParser fuzzed;
+        HttpRequest parsed;
+        if (fuzzed.Parse(mutated.data(), mutated.size(), parsed) == HttpRequestParser::Complete) {
+            size_t length = fuzzed.MessageLength();
+            bool inside = length <= mutated.size() && RefInside(parsed.method, mutated, length) &&
+                          RefInside(parsed.target, mutated, length) && RefInside(parsed.body, mutated, length) &&
+                          parsed.headerCount <= HTTP_MAX_HEADERS;
+            for (size_t i = 0; inside && i < parsed.headerCount; ++i) {
+                inside = RefInside(parsed.headers[i].name, mutated, length) &&
+                         RefInside(parsed.headers[i].value, mutated, length);
+            }
+            if (!inside) failures++;
+        }
+    }
+    return failures;
+}
+
+static void TestHttpParserRandomized() {
+    CHECK(CheckHttpParserRandomized(HttpSampleRequests(), 50000) == 0);
+}
+
+// ====== SCRITTURA JSON ======
+
+// Escape carattere per carattere: riferimento per la ricerca a blocchi di AppendEscaped
+static std::string ReferenceEscape(const std::string& input) {
+    std::string escaped;
+    for (char c : input) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\b': escaped += "\\b"; break;
+            case '\f': escaped += "\\f"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80) {
+                    escaped += "\\u00";
+                    escaped += "0123456789ABCDEF"[(c >> 4) & 0xF];
+                    escaped += "0123456789ABCDEF"[c & 0xF];
+                } else {
+                    escaped += c;
+                }
+                break;
+        }
+    }
+    return escaped;
+}
+
+static std::string Escape(const std::string& input) {
+    std::string out;
+    JsonWriter::AppendEscaped(out, input.data(), input.size());
+    return out;
+}
+
+static void TestJsonWriterLayout() {
+    JsonWriter pretty;
+    pretty.BeginObject();
+    pretty.Key("name").String("backup");
+    pretty.Key("days").BeginArray().Int(1).Int(-2).EndArray();
+    pretty.Key("empty").BeginObject().EndObject();
+    pretty.Key("none").BeginArray().EndArray();
+    pretty.Key("raw").Raw("{\"x\": 1}");
+    pretty.Key("enabled").Bool(true);
+    pretty.EndObject();
+    CHECK(pretty.Text() == "{\n"
+                           "  \"name\": \"backup\",\n"
+                           "  \"days\": [\n"
+                           "    1,\n"
+                           "    -2\n"
+                           "  ],\n"
+                           "  \"empty\": {},\n"
+                           "  \"none\": [],\n"
+                           "  \"raw\": {\"x\": 1},\n"
+                           "  \"enabled\": true\n"
+                           "}");
+    
+    JsonWriter compact(false);
+    compact.BeginObject();
+    compact.Key("type").String("file");
+    compact.Key("values").BeginArray().UInt(0).Bool(false).String("a\"b").EndArray();
+    compact.EndObject();
+    CHECK(compact.Text() == "{\"type\": \"file\", \"values\": [0, false, \"a\\\"b\"]}");
+    
+    JsonWriter numbers(false);
+    numbers.BeginArray();
+    numbers.Int(0).Int(-9223372036854775807LL - 1).Int(9223372036854775807LL).UInt(18446744073709551615ULL);
+    numbers.EndArray();
+    CHECK(numbers.Text() == "[0, -9223372036854775808, 9223372036854775807, 18446744073709551615]");
+    CHECK(numbers.Take() == "[0, -9223372036854775808, 9223372036854775807, 18446744073709551615]");
+}
+
+static void TestJsonEscape() {
+    CHECK(Escape("") == "");
+    CHECK(Escape("semplice") == "semplice");
+    CHECK(Escape("C:\\Dati\\\"x\"") == "C:\\\\Dati\\\\\\\"x\\\"");
+    CHECK(Escape("a\nb\tc\r\b\f") == "a\\nb\\tc\\r\\b\\f");
+    CHECK(Escape(std::string("\x01\x1f\0", 3)) == "\\u0001\\u001F\\u0000");
+    CHECK(Escape("citt\xe0") == "citt\\u00E0");   // code page ANSI, non UTF-8
+    // Carattere speciale in ogni posizione di un blocco da 16 e nella coda scalare
+    for (size_t position = 0; position < 40; ++position) {
+        std::string text(40, 'x');
+        text[position] = '"';
+        CHECK(Escape(text) == ReferenceEscape(text));
+    }
+    
+    // Stringhe casuali con tutti i byte possibili, lunghezze a cavallo dei blocchi da 16
+    size_t mismatches = 0;
+    unsigned long long seed = 88172645463325252ULL;
+    for (int n = 0; n < 50000; ++n) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        std::string sample(seed % 70, ' ');
+        for (size_t k = 0; k < sample.size(); ++k) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            // Prevalenza di caratteri puliti, come nei dati reali
+            sample[k] = (seed % 8 == 0) ? static_cast<char>(seed >> 24) : static_cast<char>('a' + (seed >> 24) % 26);
+        }
+        if (Escape(sample) != ReferenceEscape(sample)) mismatches++;
+    }
+    CHECK(mismatches == 0);
+}
+
+// ====== LETTURA JSON ======
+
+// Casi noti (escape, annidamento, chiavi dentro i valori, documenti non validi) e
+// mutazioni casuali di un corpo valido; restituisce il numero di discordanze
+static size_t CheckJsonDocumentCases(const std::string& sample, size_t randomCases) {
+    struct Case {
+        const char* json;
+        bool valid;
+        const char* key;
+        const char* expected;
+    };
+    static const Case cases[] = {
+        {"{\"name\": \"a\\nb\\t\\\"c\\\"\"}", true, "name", "a\nb\t\"c\""},
+        {"{\"command\": \"C:\\\\Scripts\\\\x.bat\"}", true, "command", "C:\\Scripts\\x.bat"},
+        {"{\"name\": \"\\u00e0\\u00E8\\ud83d\\ude00\\u20ac\\/\"}", true, "name", "\xE0\xE8?" "?/"},
+        {"{\"meta\": {\"name\": \"interno\"}, \"name\": \"esterno\"}", true, "name", "esterno"},
+        {"{\"command\": \"echo \\\"name\\\": x\", \"name\": \"vero\"}", true, "name", "vero"},
+        {"{\"n\\u0061me\": \"chiave con escape\"}", true, "name", "chiave con escape"},
+        {"{\"name\": \"primo\", \"name\": \"ultimo\"}", true, "name", "ultimo"},
+        {"{\"enabled\": false, \"intervalSeconds\": -1.5e3}", true, "intervalSeconds", "-1.5e3"},
+        {"{\"enabled\": false}", true, "enabled", "false"},
+        {" { \"days\" : [1, 2, {\"x\": null}] , \"name\":\"\"} ", true, "days", ""},
+        {"{}", true, "name", ""},
+        {"[1, 2]", true, "name", ""},
+        {"", false, "", ""},
+        {"{\"name\": \"x\"", false, "", ""},
+        {"{\"name\": \"x\",}", false, "", ""},
+        {"{\"name\" \"x\"}", false, "", ""},
+        {"{\"a\": 01}", false, "", ""},
+        {"{\"a\": 1.}", false, "", ""},
+        {"{\"a\": -}", false, "", ""},
+        {"{\"a\": tru}", false, "", ""},
+        {"{\"a\": \"\\x\"}", false, "", ""},
+        {"{\"a\": \"\\u12\"}", false, "", ""},
+        {"{\"a\": \"\\ud800\"}", false, "", ""},
+        {"{\"a\": \"\\udc00\"}", false, "", ""},
+        {"{\"a\": \"\\ud800\\u0041\"}", false, "", ""},
+        {"{\"a\": \"tab\there\"}", false, "", ""},
+        {"{\"a\": 1} x", false, "", ""},
+        {"{name: 1}", false, "", ""},
+    };
+    
+    size_t failures = 0;
+    JsonDocument document;
+    for (const auto& c : cases) {
+        bool parsed = document.Parse(c.json, strlen(c.json));
+        if (parsed != c.valid || (parsed && document.Text(document.Root(), c.key) != c.expected)) {
+            std::cout << "Caso fallito: " << c.json << std::endl;
+            failures++;
+        }
+    }
+    std::string deep(JSON_MAX_DEPTH + 1, '[');
+    deep += std::string(JSON_MAX_DEPTH + 1, ']');
+    if (document.Parse(deep.data(), deep.size())) failures++;
+    deep = std::string(JSON_MAX_DEPTH, '[') + std::string(JSON_MAX_DEPTH, ']');
+    if (!document.Parse(deep.data(), deep.size())) failures++;
+    
+    // Ogni prefisso proprio di un oggetto e' incompleto; le mutazioni non devono mai
+    // leggere fuori dal buffer (verificato con make test SANITIZE=...)
+    for (size_t length = 0; length < sample.size(); ++length) {
+        if (document.Parse(sample.data(), length)) failures++;
+    }
+    unsigned long long seed = 88172645463325252ULL;
+    for (size_t n = 0; n < randomCases; ++n) {
+        std::string mutated = sample;
+        for (int edits = 0; edits < 3; ++edits) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            size_t position = seed % mutated.size();
+            char value = "\"\\{}[],:u0aZ \x01\xe9"[(seed >> 32) % 16];
+            switch ((seed >> 40) % 3) {
+                case 0: mutated[position] = value; break;
+                case 1: mutated.insert(position, 1, value); break;
+                default: mutated.erase(position, 1); break;
+            }
+        }
+        std::vector<char> exact(mutated.begin(), mutated.end());
+        if (document.Parse(exact.data(), exact.size()) && document.Root() != 0) failures++;
+    }
+    return failures;
+}
+
+static void TestJsonDocument() {
+    std::string body = "{\"originalName\": \"backup notturno\", \"name\": \"backup notturno\", "
+                       "\"days\": \"Lu,Ma,Me,Gi,Ve\", \"hours\": \"2,14\", \"minutes\": \"0,30\", "
+                       "\"command\": \"C:\\\\Scripts\\\\backup.bat --dest \\\"\\\\\\\\nas\\\\copie\\\"\", "
+                       "\"enabled\": \"true\", \"intervalSeconds\": \"0\"}";
+    JsonDocument document;
+    CHECK(document.Parse(body.data(), body.size()));
+    CHECK(document.Text(document.Root(), "days") == "Lu,Ma,Me,Gi,Ve");
+    CHECK(document.Text(document.Root(), "command") == "C:\\Scripts\\backup.bat --dest \"\\\\nas\\copie\"");
+    CHECK(document.Find(document.Root(), "assente") < 0);
+    
+    // Errore con posizione
+    CHECK(!document.Parse("{\"a\": [1, 2}", 12));
+    CHECK(document.Error() != NULL && document.ErrorOffset() == 11);
+    
+    // Limiti di dimensione e numero di valori
+    std::string large = "\"" + std::string(JSON_MAX_DOCUMENT_SIZE, 'x') + "\"";
+    CHECK(!document.Parse(large.data(), large.size()));
+    std::string many = "[";
+    for (int i = 0; i < JSON_MAX_VALUES; ++i) many += i ? ",0" : "0";
+    many += "]";
+    CHECK(!document.Parse(many.data(), many.size()));
+    
+    CHECK(CheckJsonDocumentCases(body, 50000) == 0);
+}
+
+// Cio' che JsonWriter scrive, JsonDocument deve rileggerlo identico: i nomi dei task
+// arrivano al dashboard dal writer e tornano nei corpi di toggle e delete
+static void TestJsonRoundTrip() {
+    std::string everyByte;
+    for (int c = 1; c < 256; ++c) everyByte += static_cast<char>(c);
+    std::vector<std::string> samples = {"backup citt\xe0 \xe8 \xf9", std::string("a\0b", 3), everyByte};
+    unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+    for (int n = 0; n < 20000; ++n) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        std::string sample(seed % 40, ' ');
+        for (size_t k = 0; k < sample.size(); ++k) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            sample[k] = static_cast<char>(seed >> 24);
+        }
+        samples.push_back(sample);
+    }
+    
+    size_t mismatches = 0;
+    JsonDocument document;
+    for (const auto& sample : samples) {
+        JsonWriter writer(false);
+        writer.BeginObject();
+        writer.Key("name").String(sample);
+        writer.EndObject();
+        if (!document.Parse(writer.Text().data(), writer.Text().size()) ||
+            document.Text(document.Root(), "name") != sample) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// ====== CODA DELLO SCHEDULATORE ======
+
+static SchedulerTask CalendarTask(const std::set<int>& days, const std::set<int>& hours, const std::set<int>& minutes) {
+    SchedulerTask task;
+    task.days = days;
+    task.hours = hours;
+    task.minutes = minutes;
+    return task;
+}
+
+static bool CalendarMatches(const SchedulerTask& task, const struct tm& local) {
+    return task.days.count(local.tm_wday) && task.hours.count(local.tm_hour) && task.minutes.count(local.tm_min);
+}
+
+// Riferimento minuto per minuto sul tempo reale: scatta ogni istante il cui orario locale
+// corrisponde (quindi entrambe le occorrenze di un'ora ripetuta). Un minuto saltato in
+// primavera scatta dove mktime lo sposta, cioe' un'ora dopo (springForward: istante
+// del salto, l'ora successiva riceve i minuti saltati)
+static time_t ReferenceNextFire(const SchedulerTask& task, time_t after, time_t springForward) {
+    time_t t = after % 60 == 0 ? after : after - after % 60 + 60;
+    for (int step = 0; step < 8 * 24 * 60 + 120; ++step, t += 60) {
+        struct tm local = *localtime(&t);
+        if (CalendarMatches(task, local)) return t;
+        if (t >= springForward && t < springForward + 3600) {
+            struct tm skipped = local;
+            skipped.tm_hour -= 1;
+            if (CalendarMatches(task, skipped)) return t;
+        }
+    }
+    return static_cast<time_t>(-1);
+}
+
+static void TestSchedulerQueue() {
+    SchedulerTask task = CalendarTask({1, 3, 5}, {8, 20}, {0, 30});
+    SchedulerQueue queue;
+    std::vector<SchedulerTask> tasks;
+    tasks.push_back(task);
+    tasks.push_back(CalendarTask({}, {8}, {0}));   // selezione vuota: mai in coda
+    SchedulerTask interval;
+    interval.intervalSeconds = 10;
+    auto steadyNow = std::chrono::steady_clock::now();
+    interval.lastIntervalRun = steadyNow - std::chrono::seconds(4);
+    tasks.push_back(interval);
+    auto wallNow = std::chrono::system_clock::now();
+    queue.Rebuild(tasks, steadyNow, wallNow);
+    CHECK(queue.Size() == 2);
+    SchedulerDeadline first = queue.Pop();
+    CHECK(first.task == 2 && first.wallTime == 0 && first.due == steadyNow + std::chrono::seconds(6));
+    SchedulerDeadline second = queue.Pop();
+    CHECK(second.task == 0 && second.wallTime >= SchedulerQueue::CurrentMinute(wallNow) && second.wallTime % 60 == 0);
+    CHECK(queue.Empty());
+    
+    CHECK(SchedulerQueue::CurrentMinute(std::chrono::system_clock::from_time_t(1000000059)) == 1000000020);
+    CHECK(SchedulerQueue::DueFromWall(100, steadyNow, std::chrono::system_clock::from_time_t(200)) == steadyNow);
+    CHECK(SchedulerQueue::DueFromWall(260, steadyNow, std::chrono::system_clock::from_time_t(200)) ==
+          steadyNow + std::chrono::seconds(60));
+}
+
+#ifndef _WIN32
+static time_t Utc(int year, int month, int day, int hour, int minute, int second) {
+    struct tm utc = {};
+    utc.tm_year = year - 1900;
+    utc.tm_mon = month - 1;
+    utc.tm_mday = day;
+    utc.tm_hour = hour;
+    utc.tm_min = minute;
+    utc.tm_sec = second;
+    return timegm(&utc);
+}
+
+// Cambi dell'ora in Europe/Rome nel 2026: 29 marzo 02:00 CET -> 03:00 CEST,
+// 25 ottobre 03:00 CEST -> 02:00 CET (le 02:xx si ripetono)
+static void TestSchedulerDaylightSaving() {
+    const char* previous = getenv("TZ");
+    std::string saved = previous ? previous : "";
+    setenv("TZ", "Europe/Rome", 1);
+    tzset();
+    
+    std::set<int> everyDay = {0, 1, 2, 3, 4, 5, 6};
+    SchedulerTask at0256 = CalendarTask(everyDay, {2}, {56});
+    
+    // 02:49:38 CEST (prima occorrenza): prima le 02:56 CEST, poi le 02:56 CET
+    time_t fire = SchedulerQueue::NextCalendarFire(at0256, Utc(2026, 10, 25, 0, 49, 38));
+    CHECK(fire == Utc(2026, 10, 25, 0, 56, 0));
+    fire = SchedulerQueue::NextCalendarFire(at0256, fire + 60);
+    CHECK(fire == Utc(2026, 10, 25, 1, 56, 0));
+    fire = SchedulerQueue::NextCalendarFire(at0256, fire + 60);
+    CHECK(fire == Utc(2026, 10, 26, 1, 56, 0));
+    
+    // Seconda occorrenza (02:10 CET): le 02:30 CET, non l'ora successiva
+    SchedulerTask at0230 = CalendarTask(everyDay, {2}, {30});
+    CHECK(SchedulerQueue::NextCalendarFire(at0230, Utc(2026, 10, 25, 1, 10, 0)) == Utc(2026, 10, 25, 1, 30, 0));
+    // Dalla prima occorrenza, dopo le 02:30 CEST: le 02:30 CET
+    CHECK(SchedulerQueue::NextCalendarFire(at0230, Utc(2026, 10, 25, 0, 45, 0)) == Utc(2026, 10, 25, 1, 30, 0));
+    // Dalla prima occorrenza, un minuto minore di quello corrente: seconda occorrenza
+    SchedulerTask at0210 = CalendarTask(everyDay, {2}, {10, 50});
+    CHECK(SchedulerQueue::NextCalendarFire(at0210, Utc(2026, 10, 25, 0, 51, 0)) == Utc(2026, 10, 25, 1, 10, 0));
+    // Ore prima e dopo il cambio nello stesso giorno
+    SchedulerTask around = CalendarTask(everyDay, {1, 3}, {15});
+    CHECK(SchedulerQueue::NextCalendarFire(around, Utc(2026, 10, 24, 23, 0, 0)) == Utc(2026, 10, 24, 23, 15, 0));
+    CHECK(SchedulerQueue::NextCalendarFire(around, Utc(2026, 10, 24, 23, 16, 0)) == Utc(2026, 10, 25, 2, 15, 0));
+    
+    // Primavera: le 02:30 non esistono e scattano alle 03:30 CEST, una sola volta
+    CHECK(SchedulerQueue::NextCalendarFire(at0230, Utc(2026, 3, 29, 0, 30, 0)) == Utc(2026, 3, 29, 1, 30, 0));
+    CHECK(SchedulerQueue::NextCalendarFire(at0230, Utc(2026, 3, 29, 1, 31, 0)) == Utc(2026, 3, 30, 0, 30, 0));
+    SchedulerTask spring = CalendarTask(everyDay, {2, 3}, {10});
+    CHECK(SchedulerQueue::NextCalendarFire(spring, Utc(2026, 3, 29, 0, 30, 0)) == Utc(2026, 3, 29, 1, 10, 0));
+    
+    // Confronto con il riferimento su task e istanti casuali, concentrati attorno ai cambi
+    unsigned long long seed = 0x2545F4914F6CDD1DULL;
+    auto next = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+    const time_t anchors[] = {Utc(2026, 3, 29, 1, 0, 0), Utc(2026, 10, 25, 1, 0, 0), Utc(2026, 7, 1, 0, 0, 0)};
+    size_t mismatches = 0;
+    for (int n = 0; n < 2000; ++n) {
+        std::set<int> days, hours, minutes;
+        for (int i = 1 + static_cast<int>(next() % 3); i > 0; --i) days.insert(static_cast<int>(next() % 7));
+        for (int i = 1 + static_cast<int>(next() % 4); i > 0; --i) {
+            // Prevalenza delle ore attorno al cambio (1-3)
+            hours.insert(next() % 3 == 0 ? static_cast<int>(next() % 24) : 1 + static_cast<int>(next() % 3));
+        }
+        for (int i = 1 + static_cast<int>(next() % 4); i > 0; --i) minutes.insert(static_cast<int>(next() % 60));
+        SchedulerTask random = CalendarTask(days, hours, minutes);
+        time_t after = anchors[next() % 3] + static_cast<time_t>(next() % (4 * 24 * 3600)) - 2 * 24 * 3600;
+        time_t expected = ReferenceNextFire(random, after, anchors[0]);
+        time_t actual = SchedulerQueue::NextCalendarFire(random, after);
+        if (expected != actual) {
+            mismatches++;
+            if (mismatches <= 5) std::cerr << "after " << after << ": atteso " << expected << ", ottenuto " << actual << std::endl;
+        }
+    }
+    CHECK(mismatches == 0);
+    
+    if (previous) setenv("TZ", saved.c_str(), 1);
+    else unsetenv("TZ");
+    tzset();
+}
+#endif
+
+int main() {
+    TestHttpRequestLine();
+    TestHttpKeepAlive();
+    TestHttpBody();
+    TestHttpInvalid();
+    TestHttpLimits();
+    TestHttpParserRandomized();
+    TestJsonWriterLayout();
+    TestJsonEscape();
+    TestJsonDocument();
+    TestJsonRoundTrip();
+    TestSchedulerQueue();
+#ifndef _WIN32
+    TestSchedulerDaylightSaving();
+#endif
+    
+    std::cout << "Verifiche: " << checksRun << ", fallite: " << checksFailed << std::endl;
+    return checksFailed == 0 ? 0 : 1;
+}